@@ -312,6 +312,8 @@ HEADERS += src/version_check.h \
            src/builtin.h \
            src/calc.h \
            src/context.h \
+           src/Symbol.h \
+           src/ParallelInstantiation.h \
            src/modcontext.h \
            src/evalcontext.h \
            src/csgops.h \
@@ -323,6 +325,7 @@ HEADERS += src/version_check.h \
            src/stackcheck.h \
            src/exceptions.h \
            src/grid.h \
+           src/FlatHashMap.h \
            src/hash.h \
            src/highlighter.h \
            src/localscope.h \
@@ -358,8 +361,13 @@ HEADERS += src/version_check.h \
            src/nodecache.h \
            src/nodedumper.h \
            src/ModuleCache.h \
+           src/ASTCache.h \
            src/GeometryCache.h \
            src/GeometryEvaluator.h \
+           src/Profiler.h \
+           src/parallel.h \
+           src/numparse.h \
+           src/BufferedWriter.h \
            src/Tree.h \
            src/DrawingCallback.h \
            src/FreetypeRenderer.h \
@@ -375,6 +383,7 @@ HEADERS += src/version_check.h \
            \
            src/lodepng.h \
            src/OffscreenView.h \
+           src/SoftwareRenderer.h \
            src/OffscreenContext.h \
            src/OffscreenContextAll.hpp \
            src/fbo.h \
@@ -425,11 +434,14 @@ SOURCES += \
            src/handle_dep.cc \
            src/value.cc \
            src/stackcheck.cc \
+           src/parallel.cc \
            src/func.cc \
            src/localscope.cc \
            src/feature.cc \
            src/node.cc \
            src/context.cc \
+           src/Symbol.cc \
+           src/ParallelInstantiation.cc \
            src/modcontext.cc \
            src/evalcontext.cc \
            src/csgnode.cc \
@@ -439,6 +451,7 @@ SOURCES += \
            src/Polygon2d.cc \
            src/clipper-utils.cc \
            src/polyset-utils.cc \
+           src/polyset-utils-simplify.cc \
            src/GeometryUtils.cc \
            src/polyset.cc \
            src/polyset-gl.cc \
@@ -469,7 +482,9 @@ SOURCES += \
            src/nodedumper.cc \
            src/NodeVisitor.cc \
            src/GeometryEvaluator.cc \
+           src/Profiler.cc \
            src/ModuleCache.cc \
+           src/ASTCache.cc \
            src/GeometryCache.cc \
            src/Tree.cc \
 	   src/DrawingCallback.cc \
@@ -500,6 +515,7 @@ SOURCES += \
            src/export_svg.cc \
            src/export_nef.cc \
            src/export_png.cc \
+           src/SoftwareRenderer.cc \
            src/import.cc \
            src/import_stl.cc \
            src/import_off.cc \
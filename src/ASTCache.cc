@@ -0,0 +1,524 @@
+#include "ASTCache.h"
+#include "FileModule.h"
+#include "UserModule.h"
+#include "ModuleInstantiation.h"
+#include "expression.h"
+#include "function.h"
+#include "feature.h"
+#include "printutils.h"
+#include "parsersettings.h"
+
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#define QUOTE(x__) # x__
+#define QUOTED(x__) QUOTE(x__)
+
+ASTCache *ASTCache::inst = NULL;
+
+namespace {
+	const char *MAGIC = "OpenSCAD AST cache";
+	// Increase when the format changes in a way not covered by the OpenSCAD version
+	const int64_t FORMAT_VERSION = 3;
+	const std::string VERSION = QUOTED(OPENSCAD_VERSION);
+
+	std::runtime_error malformed() { return std::runtime_error("Malformed AST cache file"); }
+}
+
+void ASTWriter::writeTag(ASTTag tag)
+{
+	this->stream.put(char(tag));
+}
+
+// Zigzag encoded variable length integer
+void ASTWriter::writeInt(int64_t v)
+{
+	uint64_t u = (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+	while (u >= 0x80) {
+		this->stream.put(char(u | 0x80));
+		u >>= 7;
+	}
+	this->stream.put(char(u));
+}
+
+void ASTWriter::writeDouble(double v)
+{
+	char buf[sizeof(double)];
+	memcpy(buf, &v, sizeof(double));
+	this->stream.write(buf, sizeof(double));
+}
+
+// Strings are written on first use and referenced by index afterwards
+void ASTWriter::writeString(const std::string &str)
+{
+	auto result = this->strings.insert(std::make_pair(str, int64_t(this->strings.size())));
+	writeInt(result.first->second);
+	if (result.second) {
+		writeInt(str.size());
+		this->stream.write(str.data(), str.size());
+	}
+}
+
+void ASTWriter::write(const Location &loc)
+{
+	writeInt(loc.firstLine());
+	writeInt(loc.firstColumn());
+	writeInt(loc.lastLine());
+	writeInt(loc.lastColumn());
+}
+
+void ASTWriter::write(const ValuePtr &value)
+{
+	writeInt(value->type());
+	switch (value->type()) {
+	case Value::UNDEFINED:
+		break;
+	case Value::BOOL:
+		writeInt(value->toBool());
+		break;
+	case Value::NUMBER:
+		writeDouble(value->toDouble());
+		break;
+	case Value::STRING:
+		writeString(value->toString());
+		break;
+	case Value::VECTOR:
+		writeInt(value->toVector().size());
+		for (const auto &v : value->toVector()) write(v);
+		break;
+	default:
+		// The parser doesn't create literals of other types
+		throw std::runtime_error("Unsupported literal type");
+	}
+}
+
+void ASTWriter::write(const Expression *expr)
+{
+	if (expr) expr->serialize(*this);
+	else writeTag(ASTTag::Null);
+}
+
+void ASTWriter::write(const AssignmentList &assignments)
+{
+	writeInt(assignments.size());
+	for (const auto &assignment : assignments) {
+		if (assignment.hasAnnotations()) throw std::runtime_error("Annotations are not supported");
+		writeString(assignment.name);
+		write(assignment.location());
+		write(assignment.expr.get());
+	}
+}
+
+void ASTWriter::write(const LocalScope &scope)
+{
+	write(scope.assignments);
+	writeInt(scope.children.size());
+	for (const auto &child : scope.children) write(child);
+	writeInt(scope.functions.size());
+	for (const auto &f : scope.functions) {
+		const UserFunction *func = dynamic_cast<const UserFunction *>(f.second);
+		if (!func) throw std::runtime_error("Unsupported function type");
+		writeString(f.first);
+		writeString(func->name);
+		write(func->location());
+		write(func->definition_arguments);
+		write(func->expr.get());
+	}
+	writeInt(scope.modules.size());
+	for (const auto &m : scope.modules) {
+		const UserModule *module = dynamic_cast<const UserModule *>(m.second);
+		if (!module || module->is_experimental()) throw std::runtime_error("Unsupported module type");
+		writeString(m.first);
+		write(module->location());
+		write(module->definition_arguments);
+		write(module->scope);
+	}
+}
+
+void ASTWriter::write(const ModuleInstantiation *inst)
+{
+	const IfElseModuleInstantiation *ifelse = dynamic_cast<const IfElseModuleInstantiation *>(inst);
+	writeNode(ifelse ? ASTTag::IfElseModuleInstantiation : ASTTag::ModuleInstantiation, *inst);
+	writeString(inst->name());
+	writeString(inst->path());
+	write(inst->arguments);
+	writeInt(inst->tag_root | inst->tag_highlight << 1 | inst->tag_background << 2);
+	write(inst->scope);
+	if (ifelse) write(ifelse->else_scope);
+}
+
+ASTTag ASTReader::readTag()
+{
+	if (this->pos == this->end) throw malformed();
+	uint8_t tag = *this->pos++;
+	if (tag > uint8_t(ASTTag::IfElseModuleInstantiation)) throw malformed();
+	return ASTTag(tag);
+}
+
+int64_t ASTReader::readInt()
+{
+	uint64_t u = 0;
+	for (int shift = 0;; shift += 7) {
+		if (this->pos == this->end || shift > 63) throw malformed();
+		uint8_t byte = *this->pos++;
+		u |= uint64_t(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) break;
+	}
+	return int64_t(u >> 1) ^ -int64_t(u & 1);
+}
+
+double ASTReader::readDouble()
+{
+	if (this->end - this->pos < int(sizeof(double))) throw malformed();
+	double v;
+	memcpy(&v, this->pos, sizeof(double));
+	this->pos += sizeof(double);
+	return v;
+}
+
+std::string ASTReader::readString()
+{
+	int64_t idx = readInt();
+	if (idx == int64_t(this->strings.size())) {
+		int64_t size = readInt();
+		if (size < 0 || size > this->end - this->pos) throw malformed();
+		this->strings.push_back(std::string(this->pos, size));
+		this->pos += size;
+	}
+	else if (idx < 0 || idx > int64_t(this->strings.size())) throw malformed();
+	return this->strings[idx];
+}
+
+Location ASTReader::readLocation()
+{
+	int firstLine = readInt();
+	int firstCol = readInt();
+	int lastLine = readInt();
+	int lastCol = readInt();
+	return Location(firstLine, firstCol, lastLine, lastCol);
+}
+
+ValuePtr ASTReader::readValue()
+{
+	switch (readInt()) {
+	case Value::UNDEFINED:
+		return ValuePtr::undefined;
+	case Value::BOOL:
+		return ValuePtr(readInt() != 0);
+	case Value::NUMBER:
+		return ValuePtr(readDouble());
+	case Value::STRING:
+		return ValuePtr(readString());
+	case Value::VECTOR: {
+		Value::VectorType vec;
+		for (int64_t i = 0, n = readInt(); i < n; i++) vec.push_back(readValue());
+		return ValuePtr(vec);
+	}
+	default:
+		throw malformed();
+	}
+}
+
+/*!
+	Returns NULL for a serialized null expression.
+	Operands are read into owning pointers first, so nothing leaks if the
+	input turns out to be malformed.
+*/
+Expression *ASTReader::readExpression()
+{
+	typedef std::unique_ptr<Expression> ExprPtr;
+	ASTTag tag = readTag();
+	if (tag == ASTTag::Null) return NULL;
+	Location loc = readLocation();
+	switch (tag) {
+	case ASTTag::UnaryOp: {
+		int64_t op = readInt();
+		if (op < 0 || op > int64_t(UnaryOp::Op::Negate)) throw malformed();
+		ExprPtr expr(readExpression());
+		return new UnaryOp(UnaryOp::Op(op), expr.release(), loc);
+	}
+	case ASTTag::BinaryOp: {
+		int64_t op = readInt();
+		if (op < 0 || op > int64_t(BinaryOp::Op::NotEqual)) throw malformed();
+		ExprPtr left(readExpression());
+		ExprPtr right(readExpression());
+		return new BinaryOp(left.release(), BinaryOp::Op(op), right.release(), loc);
+	}
+	case ASTTag::TernaryOp: {
+		ExprPtr cond(readExpression());
+		ExprPtr ifexpr(readExpression());
+		ExprPtr elseexpr(readExpression());
+		return new TernaryOp(cond.release(), ifexpr.release(), elseexpr.release(), loc);
+	}
+	case ASTTag::ArrayLookup: {
+		ExprPtr array(readExpression());
+		ExprPtr index(readExpression());
+		return new ArrayLookup(array.release(), index.release(), loc);
+	}
+	case ASTTag::Literal:
+		return new Literal(readValue(), loc);
+	case ASTTag::Range: {
+		ExprPtr begin(readExpression());
+		ExprPtr step(readExpression());
+		ExprPtr end(readExpression());
+		return new Range(begin.release(), step.release(), end.release(), loc);
+	}
+	case ASTTag::Vector: {
+		std::unique_ptr<Vector> vec(new Vector(loc));
+		for (int64_t i = 0, n = readInt(); i < n; i++) vec->push_back(readExpression());
+		return vec.release();
+	}
+	case ASTTag::Lookup:
+		return new Lookup(readString(), loc);
+	case ASTTag::MemberLookup: {
+		ExprPtr expr(readExpression());
+		std::string member = readString();
+		return new MemberLookup(expr.release(), member, loc);
+	}
+	case ASTTag::FunctionCall: {
+		std::string name = readString();
+		AssignmentList args = readAssignments();
+		return new FunctionCall(name, args, loc);
+	}
+	case ASTTag::Assert:
+	case ASTTag::Echo:
+	case ASTTag::Let:
+	case ASTTag::LcFor:
+	case ASTTag::LcLet: {
+		AssignmentList args = readAssignments();
+		ExprPtr expr(readExpression());
+		if (tag == ASTTag::Assert) return new Assert(args, expr.release(), loc);
+		if (tag == ASTTag::Echo) return new Echo(args, expr.release(), loc);
+		if (tag == ASTTag::Let) return new Let(args, expr.release(), loc);
+		if (tag == ASTTag::LcFor) return new LcFor(args, expr.release(), loc);
+		return new LcLet(args, expr.release(), loc);
+	}
+	case ASTTag::LcIf: {
+		ExprPtr cond(readExpression());
+		ExprPtr ifexpr(readExpression());
+		ExprPtr elseexpr(readExpression());
+		return new LcIf(cond.release(), ifexpr.release(), elseexpr.release(), loc);
+	}
+	case ASTTag::LcForC: {
+		AssignmentList args = readAssignments();
+		AssignmentList incrargs = readAssignments();
+		ExprPtr cond(readExpression());
+		ExprPtr expr(readExpression());
+		return new LcForC(args, incrargs, cond.release(), expr.release(), loc);
+	}
+	case ASTTag::LcEach: {
+		ExprPtr expr(readExpression());
+		return new LcEach(expr.release(), loc);
+	}
+	default:
+		throw malformed();
+	}
+}
+
+AssignmentList ASTReader::readAssignments()
+{
+	AssignmentList assignments;
+	for (int64_t i = 0, n = readInt(); i < n; i++) {
+		std::string name = readString();
+		Location loc = readLocation();
+		shared_ptr<Expression> expr(readExpression());
+		assignments.push_back(Assignment(name, expr, loc));
+	}
+	return assignments;
+}
+
+void ASTReader::readScope(LocalScope &scope)
+{
+	scope.assignments = readAssignments();
+	for (int64_t i = 0, n = readInt(); i < n; i++) {
+		scope.addChild(readModuleInstantiation());
+	}
+	for (int64_t i = 0, n = readInt(); i < n; i++) {
+		std::string key = readString();
+		std::string name = readString();
+		Location loc = readLocation();
+		AssignmentList args = readAssignments();
+		shared_ptr<Expression> expr(readExpression());
+		// Recreate through create(), which sets up tail recursion elimination
+		AbstractFunction *&func = scope.functions[key];
+		delete func;
+		func = UserFunction::create(name.c_str(), args, expr, loc);
+	}
+	for (int64_t i = 0, n = readInt(); i < n; i++) {
+		std::string key = readString();
+		UserModule *module = new UserModule(readLocation());
+		AbstractModule *&entry = scope.modules[key];
+		delete entry;
+		entry = module;
+		module->definition_arguments = readAssignments();
+		readScope(module->scope);
+	}
+}
+
+ModuleInstantiation *ASTReader::readModuleInstantiation()
+{
+	ASTTag tag = readTag();
+	if (tag != ASTTag::ModuleInstantiation && tag != ASTTag::IfElseModuleInstantiation) throw malformed();
+	Location loc = readLocation();
+	std::string name = readString();
+	std::string path = readString();
+	AssignmentList args = readAssignments();
+
+	std::unique_ptr<ModuleInstantiation> inst;
+	if (tag == ASTTag::IfElseModuleInstantiation) {
+		if (args.size() != 1) throw malformed();
+		inst.reset(new IfElseModuleInstantiation(args[0].expr, path, loc));
+	}
+	else {
+		inst.reset(new ModuleInstantiation(name, args, path, loc));
+	}
+	int64_t tags = readInt();
+	inst->tag_root = tags & 1;
+	inst->tag_highlight = tags & 2;
+	inst->tag_background = tags & 4;
+	readScope(inst->scope);
+	if (tag == ASTTag::IfElseModuleInstantiation) {
+		readScope(static_cast<IfElseModuleInstantiation *>(inst.get())->else_scope);
+	}
+	return inst.release();
+}
+
+/*!
+	Returns the cache file for the given source file and contents.
+	All inputs influencing the parse result are part of the hash.
+*/
+std::string ASTCache::cacheFile(const std::string &filename, const std::string &text) const
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	auto add = [&hash](const std::string &str) {
+		for (unsigned char c : str) {
+			hash ^= c;
+			hash *= 1099511628211ULL;
+		}
+		hash ^= 0xff; // Separator
+		hash *= 1099511628211ULL;
+	};
+	add(VERSION);
+	add(filename);
+	add(text);
+	// The library path decides which files use<> and include<> resolve to
+	const std::vector<std::string> &librarypath = get_library_path();
+	add(std::to_string(librarypath.size()));
+	for (const auto &dir : librarypath) add(dir);
+	for (Feature::iterator it = Feature::begin(); it != Feature::end(); ++it) {
+		add((*it)->is_enabled() ? "1" : "0");
+	}
+	return (fs::path(this->path) / str(boost::format("%016x.ast") % hash)).generic_string();
+}
+
+/*!
+	Returns the cached parse result of the given file, or NULL if there is
+	no valid cache entry. text must be the full text passed to the parser.
+	The messages printed by the parser are added to output.
+*/
+FileModule *ASTCache::load(const std::string &filename, const std::string &text, PrintCapture &output)
+{
+	if (!isEnabled()) return NULL;
+
+	std::ifstream ifs(cacheFile(filename, text).c_str(), std::ios::binary);
+	if (!ifs.is_open()) return NULL;
+	std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	try {
+		ASTReader reader(data.data(), data.data() + data.size());
+		// Guard against hash collisions and stale formats
+		if (reader.readString() != MAGIC ||
+				reader.readInt() != FORMAT_VERSION ||
+				reader.readString() != VERSION ||
+				reader.readString() != filename ||
+				reader.readInt() != int64_t(text.size()) ||
+				reader.readInt() != int64_t(std::hash<std::string>()(text)) ||
+				reader.readInt() != int64_t(get_library_path().size())) {
+			return NULL;
+		}
+		for (const auto &dir : get_library_path()) {
+			if (reader.readString() != dir) return NULL;
+		}
+		PrintCapture::Messages messages;
+		for (int64_t i = 0, n = reader.readInt(); i < n; i++) {
+			int64_t kind = reader.readInt();
+			if (kind < 0 || kind > int64_t(PrintCapture::Kind::Deprecation)) throw malformed();
+			messages.push_back(std::make_pair(PrintCapture::Kind(kind), reader.readString()));
+		}
+		FileModule *module = FileModule::deserialize(reader);
+		// Files appearing or disappearing since parsing change the resolution of
+		// include<> and use<>, and the parser warnings about missing files
+		if (!reader.atEnd() || module->includesChanged() || module->usesChanged()) {
+			delete module;
+			return NULL;
+		}
+		for (const auto &msg : messages) output.addMessage(msg.first, msg.second);
+		PRINTDB("Loaded cached AST for '%s'", filename);
+		return module;
+	}
+	catch (const std::exception &e) {
+		PRINTDB("Ignoring AST cache for '%s': %s", filename % e.what());
+		return NULL;
+	}
+}
+
+/*!
+	Stores the parse result of the given file, together with the messages
+	printed by the parser. Must be called directly after parsing.
+*/
+void ASTCache::store(const std::string &filename, const std::string &text, const FileModule &module,
+										 const PrintCapture &output)
+{
+	if (!isEnabled()) return;
+
+	std::ostringstream out(std::ios::binary);
+	try {
+		ASTWriter writer(out);
+		writer.writeString(MAGIC);
+		writer.writeInt(FORMAT_VERSION);
+		writer.writeString(VERSION);
+		writer.writeString(filename);
+		writer.writeInt(text.size());
+		writer.writeInt(std::hash<std::string>()(text));
+		writer.writeInt(get_library_path().size());
+		for (const auto &dir : get_library_path()) writer.writeString(dir);
+		writer.writeInt(output.getMessages().size());
+		for (const auto &msg : output.getMessages()) {
+			writer.writeInt(int64_t(msg.first));
+			writer.writeString(msg.second);
+		}
+		module.serialize(writer);
+	}
+	catch (const std::exception &e) {
+		PRINTDB("Not caching AST for '%s': %s", filename % e.what());
+		return;
+	}
+
+	// Write to a temporary file and rename it, so concurrent runs never see partial files
+	try {
+		fs::path cachefile(cacheFile(filename, text));
+		fs::create_directories(cachefile.parent_path());
+		fs::path tmpfile = cachefile.parent_path() / fs::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+		{
+			std::ofstream ofs(tmpfile.string().c_str(), std::ios::binary);
+			ofs << out.str();
+			if (!ofs.good()) {
+				ofs.close();
+				fs::remove(tmpfile);
+				return;
+			}
+		}
+		fs::rename(tmpfile, cachefile);
+	}
+	catch (const fs::filesystem_error &e) {
+		PRINTDB("Can't write AST cache for '%s': %s", filename % e.what());
+	}
+}
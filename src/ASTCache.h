@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <cstdint>
+
+#include "AST.h"
+#include "Assignment.h"
+#include "value.h"
+
+/*!
+	Tags identifying serialized AST elements
+*/
+enum class ASTTag : uint8_t {
+	Null,
+	UnaryOp,
+	BinaryOp,
+	TernaryOp,
+	ArrayLookup,
+	Literal,
+	Range,
+	Vector,
+	Lookup,
+	MemberLookup,
+	FunctionCall,
+	Assert,
+	Echo,
+	Let,
+	LcIf,
+	LcFor,
+	LcForC,
+	LcEach,
+	LcLet,
+	ModuleInstantiation,
+	IfElseModuleInstantiation
+};
+
+/*!
+	Writes an AST in a compact binary format.
+
+	Integers are written as variable length, strings are written once and
+	referenced by index afterwards. The format is only meant to be read back
+	by the same OpenSCAD version on the same machine.
+*/
+class ASTWriter
+{
+public:
+	ASTWriter(std::ostream &stream) : stream(stream) {}
+
+	void writeTag(ASTTag tag);
+	void writeInt(int64_t v);
+	void writeDouble(double v);
+	void writeString(const std::string &str);
+	void write(const Location &loc);
+	void write(const ValuePtr &value);
+	void write(const class Expression *expr);
+	void write(const AssignmentList &assignments);
+	void write(const class LocalScope &scope);
+	void write(const class ModuleInstantiation *inst);
+
+	// Writes tag and location; called first by all serialize() implementations
+	void writeNode(ASTTag tag, const ASTNode &node) {
+		writeTag(tag);
+		write(node.location());
+	}
+
+private:
+	std::ostream &stream;
+	std::unordered_map<std::string, int64_t> strings;
+};
+
+/*!
+	Reads an AST written by ASTWriter.
+	Throws std::runtime_error on malformed input.
+*/
+class ASTReader
+{
+public:
+	ASTReader(const char *begin, const char *end) : pos(begin), end(end) {}
+
+	ASTTag readTag();
+	int64_t readInt();
+	double readDouble();
+	std::string readString();
+	Location readLocation();
+	ValuePtr readValue();
+	class Expression *readExpression();
+	AssignmentList readAssignments();
+	void readScope(class LocalScope &scope);
+	class ModuleInstantiation *readModuleInstantiation();
+
+	bool atEnd() const { return this->pos == this->end; }
+
+private:
+	const char *pos;
+	const char *end;
+	std::vector<std::string> strings;
+};
+
+/*!
+	Caches parsed files on disk, so unchanged libraries don't need to be
+	parsed again by later runs.
+
+	Cache files are keyed by a hash of the file name, its contents, the
+	OpenSCAD version, the library path and the enabled experimental features.
+	When loading, included files are validated by their modification time,
+	and used libraries are looked up again. The messages
+	printed while parsing are stored too, so they can be printed again.
+
+	The cache is disabled until a cache directory is set.
+*/
+class ASTCache
+{
+public:
+	static ASTCache *instance() { if (!inst) inst = new ASTCache; return inst; }
+
+	void setPath(const std::string &path) { this->path = path; }
+	const std::string &getPath() const { return this->path; }
+	bool isEnabled() const { return !this->path.empty(); }
+
+	class FileModule *load(const std::string &filename, const std::string &text, class PrintCapture &output);
+	void store(const std::string &filename, const std::string &text, const class FileModule &module,
+						 const class PrintCapture &output);
+
+private:
+	ASTCache() {}
+	std::string cacheFile(const std::string &filename, const std::string &text) const;
+
+	static ASTCache *inst;
+	std::string path;
+};
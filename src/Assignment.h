@@ -8,17 +8,19 @@
 #include "AST.h"
 #include "memory.h"
 #include "annotation.h"
+#include "Symbol.h"
 
 class Assignment :  public ASTNode
 {
 public:
 	Assignment(std::string name, const Location &loc)
-				: ASTNode(loc), name(name) { }
+				: ASTNode(loc), name(name), symbol(name) { }
 	Assignment(std::string name,
 						 shared_ptr<class Expression> expr = shared_ptr<class Expression>(),
 						 const Location &loc = Location::NONE)
-		: ASTNode(loc), name(name), expr(expr) { }
+		: ASTNode(loc), name(name), symbol(name), expr(expr) { }
 	std::string name;
+	Symbol symbol;
 	shared_ptr<class Expression> expr;
 
 	virtual void addAnnotations(AnnotationList *annotations);
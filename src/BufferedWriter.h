@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+/*!
+	Formats text into a buffer which is written to the stream in large blocks,
+	avoiding the per value overhead of stream formatting when writing large
+	meshes.
+
+	Numbers are formatted like the stream would with its precision. Like
+	printf(), this depends on LC_NUMERIC, so callers writing numbers should
+	set it to "C".
+*/
+class BufferedWriter
+{
+public:
+	BufferedWriter(std::ostream &output) : output(output), precision(int(output.precision())) {
+		this->buffer.reserve(BUFFER_SIZE + 1024);
+	}
+	~BufferedWriter() { flush(); }
+
+	int getPrecision() const { return this->precision; }
+
+	BufferedWriter &operator<<(double value) {
+		char str[32];
+		int len = snprintf(str, sizeof(str), "%.*g", this->precision, value);
+		return append(str, len);
+	}
+	BufferedWriter &operator<<(int value) { return appendInteger(value < 0, value < 0 ? -(unsigned long long)value : value); }
+	BufferedWriter &operator<<(long value) { return appendInteger(value < 0, value < 0 ? -(unsigned long long)value : value); }
+	BufferedWriter &operator<<(long long value) { return appendInteger(value < 0, value < 0 ? -(unsigned long long)value : value); }
+	BufferedWriter &operator<<(unsigned int value) { return appendInteger(false, value); }
+	BufferedWriter &operator<<(unsigned long value) { return appendInteger(false, value); }
+	BufferedWriter &operator<<(unsigned long long value) { return appendInteger(false, value); }
+	BufferedWriter &operator<<(char c) { return append(&c, 1); }
+	BufferedWriter &operator<<(const char *str) { return append(str, strlen(str)); }
+	BufferedWriter &operator<<(const std::string &str) { return append(str.data(), str.size()); }
+
+	void flush() {
+		this->output.write(this->buffer.data(), this->buffer.size());
+		this->buffer.clear();
+	}
+
+private:
+	BufferedWriter &append(const char *str, size_t len) {
+		this->buffer.append(str, len);
+		if (this->buffer.size() >= BUFFER_SIZE) flush();
+		return *this;
+	}
+	BufferedWriter &appendInteger(bool negative, unsigned long long value) {
+		char str[24];
+		char *p = str + sizeof(str);
+		do { *--p = '0' + value % 10; value /= 10; } while (value);
+		if (negative) *--p = '-';
+		return append(p, str + sizeof(str) - p);
+	}
+
+	static const size_t BUFFER_SIZE = 1 << 16;
+	std::ostream &output;
+	int precision;
+	std::string buffer;
+};
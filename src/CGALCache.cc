@@ -4,8 +4,10 @@
 
 CGALCache *CGALCache::inst = NULL;
 
-CGALCache::CGALCache(size_t limit) : cache(limit)
+CGALCache::CGALCache(size_t limit) : cache(limit), partscache(limit)
 {
+	this->cache.setBudget(CacheBudget::global());
+	this->partscache.setBudget(CacheBudget::global());
 }
 
 shared_ptr<const CGAL_Nef_polyhedron> CGALCache::get(const std::string &id) const
@@ -17,9 +19,15 @@ shared_ptr<const CGAL_Nef_polyhedron> CGALCache::get(const std::string &id) cons
 	return N;
 }
 
-bool CGALCache::insert(const std::string &id, const shared_ptr<const CGAL_Nef_polyhedron> &N)
+/*!
+	Inserts N into the cache. computetime is the time in seconds it took to
+	create the polyhedron, see GeometryCache::insert().
+*/
+bool CGALCache::insert(const std::string &id, const shared_ptr<const CGAL_Nef_polyhedron> &N, double computetime)
 {
-	bool inserted = this->cache.insert(id, new cache_entry(N), N ? N->memsize() : 0);
+	cache_entry *entry = new cache_entry(N);
+	bool inserted = this->cache.insert(id, entry, entry->memsize(id), computetime,
+																		 N.get(), N ? N->memsize() : 0);
 #ifdef DEBUG
 	if (inserted) PRINTB("CGAL Cache insert: %s (%d bytes)", id.substr(0, 40) % (N ? N->memsize() : 0));
 	else PRINTB("CGAL Cache insert failed: %s (%d bytes)", id.substr(0, 40) % (N ? N->memsize() : 0));
@@ -27,6 +35,21 @@ bool CGALCache::insert(const std::string &id, const shared_ptr<const CGAL_Nef_po
 	return inserted;
 }
 
+shared_ptr<const CGALCache::ConvexParts> CGALCache::getConvexParts(const std::string &id) const
+{
+	const shared_ptr<const ConvexParts> &parts = this->partscache[id]->parts;
+#ifdef DEBUG
+	PRINTB("CGAL Cache convex parts hit: %s (%d parts)", id.substr(0, 40) % (parts ? parts->size() : 0));
+#endif
+	return parts;
+}
+
+bool CGALCache::insertConvexParts(const std::string &id, const shared_ptr<const ConvexParts> &parts, double computetime)
+{
+	parts_entry *entry = new parts_entry(parts);
+	return this->partscache.insert(id, entry, entry->memsize(id), computetime);
+}
+
 size_t CGALCache::maxSize() const
 {
 	return this->cache.maxCost();
@@ -35,17 +58,20 @@ size_t CGALCache::maxSize() const
 void CGALCache::setMaxSize(size_t limit)
 {
 	this->cache.setMaxCost(limit);
+	this->partscache.setMaxCost(limit);
 }
 
 void CGALCache::clear()
 {
 	cache.clear();
+	partscache.clear();
 }
 
 void CGALCache::print()
 {
 	PRINTB("CGAL Polyhedrons in cache: %d", this->cache.size());
 	PRINTB("CGAL cache size in bytes: %d", this->cache.totalCost());
+	PRINTB("Convex decompositions in cache: %d (%d bytes)", this->partscache.size() % this->partscache.totalCost());
 }
 
 CGALCache::cache_entry::cache_entry(const shared_ptr<const CGAL_Nef_polyhedron> &N)
@@ -53,3 +79,18 @@ CGALCache::cache_entry::cache_entry(const shared_ptr<const CGAL_Nef_polyhedron>
 {
 	if (print_messages_stack.size() > 0) this->msg = print_messages_stack.back();
 }
+
+// See GeometryCache::cache_entry::memsize()
+size_t CGALCache::cache_entry::memsize(const std::string &id) const
+{
+	return sizeof(cache_entry) + this->msg.capacity() + id.capacity() + 4 * sizeof(void *) + 64;
+}
+
+size_t CGALCache::parts_entry::memsize(const std::string &id) const
+{
+	size_t mem = sizeof(parts_entry) + id.capacity() + 4 * sizeof(void *) + 64;
+	if (this->parts) {
+		for (const auto &part : *this->parts) mem += sizeof(part) + part.capacity() * sizeof(Vector3d);
+	}
+	return mem;
+}
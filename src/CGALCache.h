@@ -2,6 +2,8 @@
 
 #include "cache.h"
 #include "memory.h"
+#include "linalg.h"
+#include <vector>
 
 /*!
 */
@@ -14,7 +16,17 @@ public:
 
 	bool contains(const std::string &id) const { return this->cache.contains(id); }
 	shared_ptr<const class CGAL_Nef_polyhedron> get(const std::string &id) const;
-	bool insert(const std::string &id, const shared_ptr<const CGAL_Nef_polyhedron> &N);
+	bool insert(const std::string &id, const shared_ptr<const CGAL_Nef_polyhedron> &N, double computetime = 0);
+
+	/*!
+		Convex decomposition of a geometry as used by Minkowski sums,
+		stored as the vertices of each convex part.
+	*/
+	typedef std::vector<std::vector<Vector3d>> ConvexParts;
+	bool containsConvexParts(const std::string &id) const { return this->partscache.contains(id); }
+	shared_ptr<const ConvexParts> getConvexParts(const std::string &id) const;
+	bool insertConvexParts(const std::string &id, const shared_ptr<const ConvexParts> &parts, double computetime = 0);
+
 	size_t maxSize() const;
 	void setMaxSize(size_t limit);
 	void clear();
@@ -28,7 +40,15 @@ private:
 		std::string msg;
 		cache_entry(const shared_ptr<const CGAL_Nef_polyhedron> &N);
 		~cache_entry() { }
+		size_t memsize(const std::string &id) const;
+	};
+
+	struct parts_entry {
+		shared_ptr<const ConvexParts> parts;
+		parts_entry(const shared_ptr<const ConvexParts> &parts) : parts(parts) {}
+		size_t memsize(const std::string &id) const;
 	};
 
 	Cache<std::string, cache_entry> cache;
+	Cache<std::string, parts_entry> partscache;
 };
@@ -90,7 +90,8 @@ void CGALRenderer::setColorScheme(const ColorScheme &cs)
 {
 	PRINTD("setColorScheme");
 	Renderer::setColorScheme(cs);
-	this->polyhedron.reset(); // Mark as dirty
+	// Colors are applied at draw time, no need to rebuild the polyhedron
+	if (this->polyhedron) this->polyhedron->setColorScheme(cs);
 	PRINTD("setColorScheme done");
 }
 
@@ -5,13 +5,13 @@
 #include "polyset.h"
 #include "svg.h"
 
-CGAL_Nef_polyhedron::CGAL_Nef_polyhedron(CGAL_Nef_polyhedron3 *p)
+CGAL_Nef_polyhedron::CGAL_Nef_polyhedron(CGAL_Nef_polyhedron3 *p) : cached_memsize(0)
 {
 	if (p) p3.reset(p);
 }
 
 // Copy constructor
-CGAL_Nef_polyhedron::CGAL_Nef_polyhedron(const CGAL_Nef_polyhedron &src)
+CGAL_Nef_polyhedron::CGAL_Nef_polyhedron(const CGAL_Nef_polyhedron &src) : cached_memsize(src.cached_memsize)
 {
 	if (src.p3) this->p3.reset(new CGAL_Nef_polyhedron3(*src.p3));
 }
@@ -19,33 +19,69 @@ CGAL_Nef_polyhedron::CGAL_Nef_polyhedron(const CGAL_Nef_polyhedron &src)
 CGAL_Nef_polyhedron& CGAL_Nef_polyhedron::operator+=(const CGAL_Nef_polyhedron &other)
 {
 	(*this->p3) += (*other.p3);
+	this->cached_memsize = 0;
 	return *this;
 }
 
 CGAL_Nef_polyhedron& CGAL_Nef_polyhedron::operator*=(const CGAL_Nef_polyhedron &other)
 {
 	(*this->p3) *= (*other.p3);
+	this->cached_memsize = 0;
 	return *this;
 }
 
 CGAL_Nef_polyhedron& CGAL_Nef_polyhedron::operator-=(const CGAL_Nef_polyhedron &other)
 {
 	(*this->p3) -= (*other.p3);
+	this->cached_memsize = 0;
 	return *this;
 }
 
 CGAL_Nef_polyhedron &CGAL_Nef_polyhedron::minkowski(const CGAL_Nef_polyhedron &other)
 {
 	(*this->p3) = CGAL::minkowski_sum_3(*this->p3, *other.p3);
+	this->cached_memsize = 0;
 	return *this;
 }
 
+// Heap memory of an exact number: The shared representation and both limb arrays
+static size_t gmpq_memsize(const NT3 &q)
+{
+	return sizeof(mpq_t) + sizeof(size_t) +
+		(mpz_size(mpq_numref(q.mpq())) + mpz_size(mpq_denref(q.mpq()))) * sizeof(mp_limb_t);
+}
+
+/*!
+	SNC_structure::bytes() only counts the items themselves, while most of
+	the memory of a Nef polyhedron is held by the exact coordinates of the
+	vertices, the halfedge directions and the halffacet planes, so we add those.
+	Visiting every number is linear in the size of the polyhedron, so the
+	result is kept until the polyhedron is modified through this class.
+*/
 size_t CGAL_Nef_polyhedron::memsize() const
 {
 	if (this->isEmpty()) return 0;
+	if (this->cached_memsize) return this->cached_memsize;
 
 	size_t memsize = sizeof(CGAL_Nef_polyhedron);
 	memsize += this->p3->bytes();
+	CGAL_Nef_polyhedron3::Vertex_const_iterator v;
+	CGAL_forall_vertices(v, *this->p3) {
+		const CGAL_Point_3 &p = v->point();
+		memsize += gmpq_memsize(p.x()) + gmpq_memsize(p.y()) + gmpq_memsize(p.z());
+	}
+	CGAL_Nef_polyhedron3::Halfedge_const_iterator e;
+	CGAL_forall_halfedges(e, *this->p3) {
+		const CGAL_Nef_polyhedron3::Sphere_point &p = e->point();
+		memsize += gmpq_memsize(p.x()) + gmpq_memsize(p.y()) + gmpq_memsize(p.z());
+	}
+	CGAL_Nef_polyhedron3::Halffacet_const_iterator f;
+	CGAL_forall_halffacets(f, *this->p3) {
+		const CGAL_Nef_polyhedron3::Plane_3 &plane = f->plane();
+		memsize += gmpq_memsize(plane.a()) + gmpq_memsize(plane.b()) +
+			gmpq_memsize(plane.c()) + gmpq_memsize(plane.d());
+	}
+	this->cached_memsize = memsize;
 	return memsize;
 }
 
@@ -156,6 +192,7 @@ void CGAL_Nef_polyhedron::transform( const Transform3d &matrix )
 				matrix(1,0), matrix(1,1), matrix(1,2), matrix(1,3),
 				matrix(2,0), matrix(2,1), matrix(2,2), matrix(2,3), matrix(3,3));
 			this->p3->transform(t);
+			this->cached_memsize = 0;
 		}
 	}
 }
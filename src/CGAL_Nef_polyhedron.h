@@ -22,7 +22,7 @@ public:
 	virtual bool isEmpty() const;
 	virtual Geometry *copy() const { return new CGAL_Nef_polyhedron(*this); }
 
-	void reset() { p3.reset(); }
+	void reset() { p3.reset(); cached_memsize = 0; }
 	CGAL_Nef_polyhedron &operator+=(const CGAL_Nef_polyhedron &other);
 	CGAL_Nef_polyhedron &operator*=(const CGAL_Nef_polyhedron &other);
 	CGAL_Nef_polyhedron &operator-=(const CGAL_Nef_polyhedron &other);
@@ -33,4 +33,8 @@ public:
 	void resize(const Vector3d &newsize, const Eigen::Matrix<bool,3,1> &autosize);
 
 	shared_ptr<CGAL_Nef_polyhedron3> p3;
+
+private:
+	// Result of memsize(), 0 until computed. Reset by the modifying members.
+	mutable size_t cached_memsize;
 };
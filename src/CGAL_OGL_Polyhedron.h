@@ -62,39 +62,41 @@ public:
 
 	void draw(bool showedges) const {
 		PRINTD("draw()");
+		if (!bind_buffers()) return;
 		if(this->style == SNC_BOUNDARY) {
-			glCallList(this->object_list_+2);
+			draw_facets();
 			if(showedges) {
 				glDisable(GL_LIGHTING);
-				glCallList(this->object_list_+1);
-				glCallList(this->object_list_);
+				draw_edges();
+				draw_vertices();
 			}
 		} else {
 			glDisable(GL_LIGHTING);
-			glCallList(this->object_list_+1);
-			glCallList(this->object_list_);
+			draw_edges();
+			draw_vertices();
 		}
+		unbind_buffers();
 		PRINTD("draw() end");
 	}
 
 	// overrides function in OGL_helper.h
-	CGAL::Color getVertexColor(Vertex_iterator v) const {
+	CGAL::Color getVertexColor(bool mark) const {
 		PRINTD("getVertexColor");
-		CGAL::Color c = v->mark() ? colors[CGAL_NEF3_UNMARKED_VERTEX_COLOR] : colors[CGAL_NEF3_MARKED_VERTEX_COLOR];
+		CGAL::Color c = mark ? colors[CGAL_NEF3_UNMARKED_VERTEX_COLOR] : colors[CGAL_NEF3_MARKED_VERTEX_COLOR];
 		return c;
 	}
 
 	// overrides function in OGL_helper.h
-	CGAL::Color getEdgeColor(Edge_iterator e) const {
+	CGAL::Color getEdgeColor(bool mark) const {
 		PRINTD("getEdgeColor");
-		CGAL::Color c = e->mark() ? colors[CGAL_NEF3_UNMARKED_EDGE_COLOR] : colors[CGAL_NEF3_MARKED_EDGE_COLOR];
+		CGAL::Color c = mark ? colors[CGAL_NEF3_UNMARKED_EDGE_COLOR] : colors[CGAL_NEF3_MARKED_EDGE_COLOR];
 		return c;
 	}
 
 	// overrides function in OGL_helper.h
-	CGAL::Color getFacetColor(Halffacet_iterator f, bool is_back_facing) const {
+	CGAL::Color getFacetColor(bool mark) const {
 		PRINTD("getFacetColor");
-		CGAL::Color c = f->mark() ? colors[CGAL_NEF3_UNMARKED_FACET_COLOR] : colors[CGAL_NEF3_MARKED_FACET_COLOR];
+		CGAL::Color c = mark ? colors[CGAL_NEF3_UNMARKED_FACET_COLOR] : colors[CGAL_NEF3_MARKED_FACET_COLOR];
 		return c;
 	}
 
@@ -111,6 +113,8 @@ public:
 
 	// set this->colors based on the given colorscheme. vertex colors
 	// are not set here as colorscheme doesnt yet hold vertex colors.
+	// Colors are applied when drawing, so this is cheap to call on an
+	// already initialized polyhedron.
 	void setColorScheme(const ColorScheme &cs) {
 		PRINTD("setColorScheme");
 		setColor(CGAL_NEF3_MARKED_FACET_COLOR, ColorMap::getColor(cs, CGAL_FACE_BACK_COLOR));
@@ -12,6 +12,9 @@
 #include "GeometryEvaluator.h"
 #include "polyset.h"
 #include "polyset-utils.h"
+#include "GeometryCache.h"
+#include "rendersettings.h"
+#include "Tree.h"
 
 #include <string>
 #include <map>
@@ -20,6 +23,7 @@
 #include <iostream>
 #include <assert.h>
 #include <cstddef>
+#include <limits>
 
 /*!
 	\class CSGTreeEvaluator
@@ -176,7 +180,25 @@ shared_ptr<CSGNode> CSGTreeEvaluator::evaluateCSGNodeFromGeometry(
 			// Since is_convex() doesn't handle non-planar faces, we need to tessellate
 			// also in the indeterminate state so we cannot just use a boolean comparison. See #1061
 			bool convex = ps->convexValue();
-			if (ps && !convex) {
+			// Preview large meshes at a reduced level of detail. The simplified mesh
+			// consists of triangles, so it doesn't need to be tessellated.
+			unsigned int lodfaces = RenderSettings::inst()->previewLodFaces;
+			if (ps && lodfaces > 0 && ps->getDimension() == 3 && ps->polygons.size() > lodfaces) {
+				std::string key = "preview_lod(" + std::to_string(lodfaces) + ")" + this->tree.getIdString(node);
+				shared_ptr<const Geometry> lod;
+				if (GeometryCache::instance()->contains(key)) {
+					lod = GeometryCache::instance()->get(key);
+				}
+				else {
+					lod.reset(PolysetUtils::simplify(*ps, lodfaces, std::numeric_limits<double>::infinity()));
+					GeometryCache::instance()->insert(key, lod);
+				}
+				this->lodstats.objects++;
+				this->lodstats.faces += ps->polygons.size();
+				this->lodstats.lodfaces += static_cast<const PolySet *>(lod.get())->polygons.size();
+				g = lod;
+			}
+			else if (ps && !convex) {
 				assert(ps->getDimension() == 3);
 				PolySet *ps_tri = new PolySet(3, ps->convexValue());
 				ps_tri->setConvexity(ps->getConvexity());
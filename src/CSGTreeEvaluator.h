@@ -37,6 +37,17 @@ public:
 		return this->backgroundNodes;
 	}
 
+	// Objects previewed at a reduced level of detail, with their number of faces
+	struct LodStats {
+		LodStats() : objects(0), faces(0), lodfaces(0) {}
+		size_t objects;
+		size_t faces;
+		size_t lodfaces;
+	};
+	const LodStats &getLodStats() const {
+		return this->lodstats;
+	}
+
 private:
   void addToParent(const State &state, const AbstractNode &node);
 	void applyToChildren(State &state, const AbstractNode &node, OpenSCADOperator op);
@@ -57,4 +68,5 @@ protected:
 	std::vector<shared_ptr<CSGNode>> highlightNodes;
 	std::vector<shared_ptr<CSGNode>> backgroundNodes;
 	std::map<int, shared_ptr<CSGNode>> stored_term; // The term evaluated from each node index
+	LodStats lodstats;
 };
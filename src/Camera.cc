@@ -92,6 +92,41 @@ void Camera::viewAll(const BoundingBox &bbox)
 	PRINTDB("modified obj rot   x y z %f %f %f",object_rot.x() % object_rot.y() % object_rot.z());
 }
 
+/*!
+	Changes the view as if the object was turned by angle degrees around an
+	axis through the view center. Call before viewAll(), which keeps the view
+	direction. Vector cameras always keep z up, so turning them around other
+	axes gives an upright version of the turned view.
+*/
+void Camera::turntable(const Eigen::Vector3d &axis, double angle)
+{
+	if (this->type == Camera::NONE) {
+		// Same view as viewAll() sets up for NONE cameras
+		this->type = Camera::VECTOR;
+		this->eye = this->center - Vector3d(1,1,-0.5);
+		this->viewall = true;
+		this->autocenter = true;
+	}
+
+	Eigen::AngleAxisd rot(angle*M_PI/180, axis.normalized());
+	switch (this->type) {
+	case Camera::GIMBAL: {
+		// GLView applies the rotations in x, y, z order after the object translation
+		Eigen::Matrix3d m = (Eigen::AngleAxisd(this->object_rot.x()*M_PI/180, Vector3d::UnitX()) *
+												 Eigen::AngleAxisd(this->object_rot.y()*M_PI/180, Vector3d::UnitY()) *
+												 Eigen::AngleAxisd(this->object_rot.z()*M_PI/180, Vector3d::UnitZ()) * rot).toRotationMatrix();
+		this->object_rot = m.eulerAngles(0, 1, 2) * 180/M_PI;
+		break;
+	}
+	case Camera::VECTOR:
+		// Moving the eye the other way around the center gives the same image
+		this->eye = this->center + rot.inverse() * (this->eye - this->center);
+		break;
+	default:
+		break;
+	}
+}
+
 void Camera::zoom(int delta)
 {
 	this->viewer_distance *= pow(0.9, delta / 120.0);
@@ -33,6 +33,7 @@ public:
 	double zoomValue();
 	void resetView();
 	void viewAll(const BoundingBox &bbox);
+	void turntable(const Eigen::Vector3d &axis, double angle);
 	std::string statusText();
 
 	// Vectorcam
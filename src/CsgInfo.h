@@ -26,6 +26,10 @@ public:
 		shared_ptr<CSGNode> csgRoot = evaluator.buildCSGTree(*root_node);
 		std::vector<shared_ptr<CSGNode> > highlightNodes = evaluator.getHighlightNodes();
 		std::vector<shared_ptr<CSGNode> > backgroundNodes = evaluator.getBackgroundNodes();
+		const CSGTreeEvaluator::LodStats &lod = evaluator.getLodStats();
+		if (lod.objects > 0) {
+			PRINTB("Previewing %d objects at reduced detail (%d of %d faces)", lod.objects % lod.lodfaces % lod.faces);
+		}
 
 		PRINT("Compiling design (CSG Products normalization)...");
 		CSGTreeNormalizer normalizer(RenderSettings::inst()->openCSGTermLimit);
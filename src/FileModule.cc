@@ -31,6 +31,8 @@
 #include "exceptions.h"
 #include "modcontext.h"
 #include "parsersettings.h"
+#include "handle_dep.h"
+#include "ASTCache.h"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
@@ -48,6 +50,7 @@ std::string FileModule::dump(const std::string &indent, const std::string &name)
 }
 
 void FileModule::registerUse(const std::string path) {
+	this->usepaths.push_back(path);
 	std::string extraw = fs::path(path).extension().generic_string();
 	std::string ext = boost::algorithm::to_lower_copy(extraw);
 	
@@ -72,6 +75,57 @@ void FileModule::registerInclude(const std::string &localpath,
 	this->includes[localpath] = inc;
 }
 
+/*!
+	Writes the parse result, i.e. the scope and the dependencies.
+	Must be called before dependencies have been handled.
+*/
+void FileModule::serialize(ASTWriter &writer) const
+{
+	writer.writeString(this->path);
+	writer.writeInt(this->usepaths.size());
+	for (const auto &path : this->usepaths) writer.writeString(path);
+	writer.writeInt(this->includes.size());
+	for (const auto &item : this->includes) {
+		writer.writeString(item.first);
+		writer.writeString(item.second.filename);
+		writer.writeInt(item.second.valid);
+		writer.writeInt(item.second.mtime);
+	}
+	writer.write(this->scope);
+}
+
+/*!
+	Reads a module written by serialize(). Dependencies are registered the
+	same way as when parsing.
+*/
+FileModule *FileModule::deserialize(ASTReader &reader)
+{
+	FileModule *module = new FileModule();
+	try {
+		module->setModulePath(reader.readString());
+		for (int64_t i = 0, n = reader.readInt(); i < n; i++) {
+			const std::string &path = reader.readString();
+			if (fs::path(path).is_absolute()) handle_dep(path);
+			module->registerUse(path);
+		}
+		for (int64_t i = 0, n = reader.readInt(); i < n; i++) {
+			IncludeFile inc;
+			const std::string localpath = reader.readString();
+			inc.filename = reader.readString();
+			inc.valid = reader.readInt() != 0;
+			inc.mtime = reader.readInt();
+			if (inc.valid) handle_dep(inc.filename);
+			module->includes[localpath] = inc;
+		}
+		reader.readScope(module->scope);
+	}
+	catch (...) {
+		delete module;
+		throw;
+	}
+	return module;
+}
+
 bool FileModule::includesChanged() const
 {
 	for(const auto &item : this->includes) {
@@ -80,6 +134,22 @@ bool FileModule::includesChanged() const
 	return false;
 }
 
+/*!
+	Returns true if a library passed to registerUse() was removed, or was
+	missing and can be found now. Libraries are passed with their absolute
+	path when found, and with the name given to use<> otherwise.
+*/
+bool FileModule::usesChanged() const
+{
+	for (const auto &path : this->usepaths) {
+		if (fs::path(path).is_absolute()) {
+			if (!fs::exists(path)) return true;
+		}
+		else if (!find_valid_path(this->path, path).empty()) return true;
+	}
+	return false;
+}
+
 bool FileModule::include_modified(const IncludeFile &inc) const
 {
 	struct stat st;
@@ -101,6 +171,8 @@ bool FileModule::include_modified(const IncludeFile &inc) const
 bool FileModule::handleDependencies()
 {
 	if (this->is_handling_dependencies) return false;
+	// Top-level updates are a safe point to evict unused libraries
+	if (!ModuleCache::instance()->isEvaluating()) ModuleCache::instance()->trim(this);
 	this->is_handling_dependencies = true;
 
 	bool somethingchanged = false;
@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <time.h>
+#include <vector>
 
 #include "module.h"
 #include "value.h"
@@ -24,11 +25,15 @@ void setModulePath(const std::string &path) { this->path = path; }
         void registerUse(const std::string path);
 	void registerInclude(const std::string &localpath, const std::string &fullpath);
 	bool includesChanged() const;
+	bool usesChanged() const;
 	bool handleDependencies();
 	bool hasIncludes() const { return !this->includes.empty(); }
 	bool usesLibraries() const { return !this->usedlibs.empty(); }
 	bool isHandlingDependencies() const { return this->is_handling_dependencies; }
 
+	void serialize(class ASTWriter &writer) const;
+	static FileModule *deserialize(class ASTReader &reader);
+
 	LocalScope scope;
 	typedef std::unordered_set<std::string> ModuleContainer;
 	ModuleContainer usedlibs;
@@ -43,6 +48,7 @@ private:
 
 	typedef std::unordered_map<std::string, struct IncludeFile> IncludeContainer;
 	IncludeContainer includes;
+	std::vector<std::string> usepaths; // All paths passed to registerUse(), in order
 	bool is_handling_dependencies;
 	std::string path;
 };
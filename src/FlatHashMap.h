@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+/*!
+	Hash map from keys to non-negative int values using open addressing with
+	linear probing.
+
+	Keys and values are kept in two flat arrays, which is considerably more cache
+	friendly than std::unordered_map for the large number of small lookups done
+	when indexing or welding mesh vertices. Elements cannot be removed.
+*/
+template <typename Key, typename Hash = std::hash<Key>>
+class FlatHashMap
+{
+public:
+	FlatHashMap() : mask(0), count(0) {}
+
+	size_t size() const { return this->count; }
+
+	/*!
+		Makes room for n elements without rehashing.
+	*/
+	void reserve(size_t n) {
+		if (2 * n > this->values.size()) rehash(capacityFor(n));
+	}
+
+	/*!
+		Returns the value stored for key, or -1 if key isn't found.
+	*/
+	int find(const Key &key) const {
+		if (this->values.empty()) return -1;
+		for (size_t i = slot(key);; i = (i + 1) & this->mask) {
+			if (this->values[i] < 0) return -1;
+			if (this->keys[i] == key) return this->values[i];
+		}
+	}
+
+	/*!
+		Inserts value for key unless key already exists.
+		Returns the value stored for key.
+	*/
+	int insert(const Key &key, int value) {
+		if (2 * (this->count + 1) > this->values.size()) rehash(capacityFor(this->count + 1));
+		size_t i = slot(key);
+		for (; this->values[i] >= 0; i = (i + 1) & this->mask) {
+			if (this->keys[i] == key) return this->values[i];
+		}
+		this->keys[i] = key;
+		this->values[i] = value;
+		this->count++;
+		return value;
+	}
+
+private:
+	size_t slot(const Key &key) const {
+		// Linear probing needs well distributed low bits, which std::hash
+		// doesn't guarantee, so finalize the hash (MurmurHash3 fmix64)
+		uint64_t h = Hash()(key);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return size_t(h) & this->mask;
+	}
+
+	// Power of two capacity keeping the load factor at or below 1/2
+	static size_t capacityFor(size_t n) {
+		size_t capacity = 16;
+		while (capacity < 2 * n) capacity *= 2;
+		return capacity;
+	}
+
+	void rehash(size_t capacity) {
+		std::vector<Key> oldkeys;
+		std::vector<int> oldvalues;
+		oldkeys.swap(this->keys);
+		oldvalues.swap(this->values);
+		this->keys.resize(capacity);
+		this->values.assign(capacity, -1);
+		this->mask = capacity - 1;
+		this->count = 0;
+		for (size_t i = 0; i < oldvalues.size(); i++) {
+			if (oldvalues[i] >= 0) insert(oldkeys[i], oldvalues[i]);
+		}
+	}
+
+	std::vector<Key> keys;
+	std::vector<int> values;
+	size_t mask;
+	size_t count;
+};
@@ -19,9 +19,17 @@ shared_ptr<const Geometry> GeometryCache::get(const std::string &id) const
 	return geom;
 }
 
-bool GeometryCache::insert(const std::string &id, const shared_ptr<const Geometry> &geom)
+/*!
+	Inserts geom into the cache. computetime is the time in seconds it took to
+	create the geometry, and makes expensive geometries less likely to be evicted.
+	The geometry itself is accounted for only once, even if it's inserted under
+	several ids.
+*/
+bool GeometryCache::insert(const std::string &id, const shared_ptr<const Geometry> &geom, double computetime)
 {
-	bool inserted = this->cache.insert(id, new cache_entry(geom), geom ? geom->memsize() : 0);
+	cache_entry *entry = new cache_entry(geom);
+	bool inserted = this->cache.insert(id, entry, entry->memsize(id), computetime,
+																		 geom.get(), geom ? geom->memsize() : 0);
 #ifdef DEBUG
 	assert(!dynamic_cast<const CGAL_Nef_polyhedron*>(geom.get()));
 	if (inserted) PRINTDB("Geometry Cache insert: %s (%d bytes)", 
@@ -46,6 +54,7 @@ void GeometryCache::print()
 {
 	PRINTB("Geometries in cache: %d", this->cache.size());
 	PRINTB("Geometry cache size in bytes: %d", this->cache.totalCost());
+	PRINTB("Total cache size in bytes: %d", CacheBudget::global()->totalCost());
 }
 
 GeometryCache::cache_entry::cache_entry(const shared_ptr<const Geometry> &geom)
@@ -53,3 +62,12 @@ GeometryCache::cache_entry::cache_entry(const shared_ptr<const Geometry> &geom)
 {
 	if (print_messages_stack.size() > 0) this->msg = print_messages_stack.back();
 }
+
+/*!
+	Returns the memory used by the cache entry and its key, excluding the geometry.
+*/
+size_t GeometryCache::cache_entry::memsize(const std::string &id) const
+{
+	// Hash and eviction order nodes add a few pointers and allocator overhead per entry
+	return sizeof(cache_entry) + this->msg.capacity() + id.capacity() + 4 * sizeof(void *) + 64;
+}
@@ -7,13 +7,15 @@
 class GeometryCache
 {
 public:	
-	GeometryCache(size_t memorylimit = 100*1024*1024) : cache(memorylimit) {}
+	GeometryCache(size_t memorylimit = 100*1024*1024) : cache(memorylimit) {
+		this->cache.setBudget(CacheBudget::global());
+	}
 
 	static GeometryCache *instance() { if (!inst) inst = new GeometryCache; return inst; }
 
 	bool contains(const std::string &id) const { return this->cache.contains(id); }
 	shared_ptr<const class Geometry> get(const std::string &id) const;
-	bool insert(const std::string &id, const shared_ptr<const Geometry> &geom);
+	bool insert(const std::string &id, const shared_ptr<const Geometry> &geom, double computetime = 0);
 	size_t maxSize() const;
 	void setMaxSize(size_t limit);
 	void clear() { cache.clear(); }
@@ -27,6 +29,7 @@ private:
 		std::string msg;
 		cache_entry(const shared_ptr<const Geometry> &geom);
 		~cache_entry() { }
+		size_t memsize(const std::string &id) const;
 	};
 
 	Cache<std::string, cache_entry> cache;
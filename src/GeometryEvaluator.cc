@@ -26,11 +26,12 @@
 #include "svg.h"
 #include "calc.h"
 #include "dxfdata.h"
+#include "Profiler.h"
+#include "parallel.h"
 
 #include <algorithm>
+#include <limits>
 
-#include <CGAL/convex_hull_2.h>
-#include <CGAL/Point_2.h>
 
 GeometryEvaluator::GeometryEvaluator(const class Tree &tree):
 	tree(tree)
@@ -76,6 +77,53 @@ shared_ptr<const Geometry> GeometryEvaluator::evaluateGeometry(const AbstractNod
 	return GeometryCache::instance()->get(this->tree.getIdString(node));
 }
 
+static size_t countVertices(const Geometry &geom)
+{
+	if (const PolySet *ps = dynamic_cast<const PolySet *>(&geom)) {
+		size_t num = 0;
+		for (const auto &p : ps->polygons) num += p.size();
+		return num;
+	}
+	else if (const Polygon2d *poly = dynamic_cast<const Polygon2d *>(&geom)) {
+		size_t num = 0;
+		for (const auto &o : poly->outlines()) num += o.vertices.size();
+		return num;
+	}
+	else if (const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron *>(&geom)) {
+		if (N->p3) return N->p3->number_of_vertices();
+	}
+	return 0;
+}
+
+/*!
+	Wraps the traversal of each node to measure the time it took to evaluate,
+	which is used to weigh cache entries against each other, and to record
+	profiling information when the Profiler is enabled.
+*/
+Response GeometryEvaluator::traverse(const AbstractNode &node, const State &state)
+{
+	Profiler::Scope scope(Profiler::GEOMETRY, node.modinst);
+	if (scope.isActive()) scope.cachehit = isSmartCached(node);
+	Profiler::wallclock::time_point start = Profiler::wallclock::now();
+	Response response = NodeVisitor::traverse(node, state);
+	this->computetimes[node.index()] += std::chrono::duration<double>(Profiler::wallclock::now() - start).count();
+	if (!scope.isActive()) return response;
+
+	shared_ptr<const Geometry> geom;
+	if (state.parent()) {
+		const Geometry::Geometries &siblings = this->visitedchildren[state.parent()->index()];
+		if (!siblings.empty() && siblings.back().first == &node) geom = siblings.back().second;
+	}
+	else {
+		geom = this->root;
+	}
+	if (geom) {
+		scope.outvertices = countVertices(*geom);
+		scope.memsize = geom->memsize();
+	}
+	return response;
+}
+
 GeometryEvaluator::ResultObject GeometryEvaluator::applyToChildren(const AbstractNode &node, OpenSCADOperator op)
 {
 	unsigned int dim = 0;
@@ -110,7 +158,7 @@ GeometryEvaluator::ResultObject GeometryEvaluator::applyToChildren3D(const Abstr
 	if (op == OPENSCAD_HULL) {
 		PolySet *ps = new PolySet(3, true);
 
-		if (CGALUtils::applyHull(children, *ps)) {
+		if (CGALUtils::applyHull(children, *ps, getIdStrings(children))) {
 			return ps;
 		}
 
@@ -128,7 +176,7 @@ GeometryEvaluator::ResultObject GeometryEvaluator::applyToChildren3D(const Abstr
 		}
 		if (actualchildren.empty()) return ResultObject();
 		if (actualchildren.size() == 1) return ResultObject(actualchildren.front().second);
-		return ResultObject(CGALUtils::applyMinkowski(actualchildren));
+		return ResultObject(CGALUtils::applyMinkowski(actualchildren, getIdStrings(actualchildren)));
 	}
 
 	CGAL_Nef_polyhedron *N = CGALUtils::applyOperator(children, op);
@@ -146,32 +194,9 @@ GeometryEvaluator::ResultObject GeometryEvaluator::applyToChildren3D(const Abstr
 */
 Polygon2d *GeometryEvaluator::applyHull2D(const AbstractNode &node)
 {
-	std::vector<const Polygon2d *> children = collectChildren2D(node);
-	Polygon2d *geometry = new Polygon2d();
-
-	typedef CGAL::Point_2<CGAL::Cartesian<double>> CGALPoint2;
-	// Collect point cloud
-	std::list<CGALPoint2> points;
-	for(const auto &p : children) {
-		for(const auto &o : p->outlines()) {
-			for(const auto &v : o.vertices) {
-				points.push_back(CGALPoint2(v[0], v[1]));
-			}
-		}
-	}
-	if (points.size() > 0) {
-		// Apply hull
-		std::list<CGALPoint2> result;
-		CGAL::convex_hull_2(points.begin(), points.end(), std::back_inserter(result));
-
-		// Construct Polygon2d
-		Outline2d outline;
-		for(const auto &p : result) {
-			outline.vertices.push_back(Vector2d(p[0], p[1]));
-		}
-		geometry->addOutline(outline);
-	}
-	return geometry;
+	std::vector<std::string> ids;
+	std::vector<const Polygon2d *> children = collectChildren2D(node, &ids);
+	return CGALUtils::applyHull2D(children, ids);
 }
 
 Geometry *GeometryEvaluator::applyHull3D(const AbstractNode &node)
@@ -179,7 +204,7 @@ Geometry *GeometryEvaluator::applyHull3D(const AbstractNode &node)
 	Geometry::Geometries children = collectChildren3D(node);
 
 	PolySet *P = new PolySet(3);
-	if (CGALUtils::applyHull(children, *P)) {
+	if (CGALUtils::applyHull(children, *P, getIdStrings(children))) {
 		return P;
 	}
 	delete P;
@@ -197,9 +222,11 @@ Polygon2d *GeometryEvaluator::applyMinkowski2D(const AbstractNode &node)
 
 /*!
 	Returns a list of Polygon2d children of the given node.
-	May return empty Polygon2d object, but not NULL objects
+	May return empty Polygon2d object, but not NULL objects.
+	If ids is given, the cache ids of the returned children are appended to it.
 */
-std::vector<const class Polygon2d *> GeometryEvaluator::collectChildren2D(const AbstractNode &node)
+std::vector<const class Polygon2d *> GeometryEvaluator::collectChildren2D(const AbstractNode &node,
+																																				std::vector<std::string> *ids)
 {
 	std::vector<const Polygon2d *> children;
 	for(const auto &item : this->visitedchildren[node.index()]) {
@@ -218,6 +245,7 @@ std::vector<const class Polygon2d *> GeometryEvaluator::collectChildren2D(const
 				const Polygon2d *polygons = dynamic_cast<const Polygon2d *>(chgeom.get());
 				assert(polygons);
 				children.push_back(polygons);
+				if (ids) ids->push_back(this->tree.getIdString(*chnode));
 			}
 			else {
 				PRINT("WARNING: Ignoring 3D child object for 2D operation");
@@ -227,6 +255,18 @@ std::vector<const class Polygon2d *> GeometryEvaluator::collectChildren2D(const
 	return children;
 }
 
+/*!
+	Returns the cache ids of the given children, used to cache
+	intermediate results derived from the children.
+*/
+std::vector<std::string> GeometryEvaluator::getIdStrings(const Geometry::Geometries &children) const
+{
+	std::vector<std::string> ids;
+	ids.reserve(children.size());
+	for (const auto &item : children) ids.push_back(this->tree.getIdString(*item.first));
+	return ids;
+}
+
 /*!
 	Since we can generate both Nef and non-Nef geometry, we need to insert it into
 	the appropriate cache.
@@ -236,14 +276,16 @@ void GeometryEvaluator::smartCacheInsert(const AbstractNode &node,
 																				 const shared_ptr<const Geometry> &geom)
 {
 	const std::string &key = this->tree.getIdString(node);
+	std::map<int, double>::const_iterator t = this->computetimes.find(node.index());
+	double computetime = t == this->computetimes.end() ? 0 : t->second;
 
 	shared_ptr<const CGAL_Nef_polyhedron> N = dynamic_pointer_cast<const CGAL_Nef_polyhedron>(geom);
 	if (N) {
-		if (!CGALCache::instance()->contains(key)) CGALCache::instance()->insert(key, N);
+		if (!CGALCache::instance()->contains(key)) CGALCache::instance()->insert(key, N, computetime);
 	}
 	else {
 		if (!GeometryCache::instance()->contains(key)) {
-			if (!GeometryCache::instance()->insert(key, geom)) {
+			if (!GeometryCache::instance()->insert(key, geom, computetime)) {
 				PRINT("WARNING: GeometryEvaluator: Node didn't fit into cache");
 			}
 		}
@@ -624,56 +666,79 @@ static void translate_PolySet(PolySet &ps, const Vector3d &translation)
 	}
 }
 
-static void add_slice(PolySet *ps, const Polygon2d &poly, 
-											double rot1, double rot2, 
-											double h1, double h2, 
-											const Vector2d &scale1,
-											const Vector2d &scale2)
+static Vector2d slice_scale(const LinearExtrudeNode &node, size_t j, size_t slices)
+{
+	return Vector2d(1 - (1-node.scale_x)*j / slices,
+									1 - (1-node.scale_y)*j / slices);
+}
+
+static double slice_rotation(const LinearExtrudeNode &node, size_t j, size_t slices)
+{
+	return node.twist*j / slices;
+}
+
+/*!
+	Transforms all outline vertices of poly to slice j of the extrusion.
+	The outlines are concatenated into ring.
+*/
+static void transform_ring(std::vector<Vector2d> &ring, const Polygon2d &poly,
+													 const LinearExtrudeNode &node, size_t j, size_t slices)
+{
+	Eigen::Affine2d trans(Eigen::Scaling(slice_scale(node, j, slices)) *
+												Eigen::Rotation2D<double>(-slice_rotation(node, j, slices)*M_PI/180));
+	ring.clear();
+	for(const auto &o : poly.outlines()) {
+		for(const auto &v : o.vertices) ring.push_back(trans * v);
+	}
+}
+
+/*!
+	Writes the side triangles between two rings to out, one or two per
+	outline vertex (see extrudePolygon()).
+*/
+static void add_slice(Polygons::iterator out, const Polygon2d &poly,
+											const std::vector<Vector2d> &ring1,
+											const std::vector<Vector2d> &ring2,
+											double rot1, double rot2,
+											double h1, double h2,
+											bool fullslice)
 {
-	Eigen::Affine2d trans1(Eigen::Scaling(scale1) * Eigen::Rotation2D<double>(-rot1*M_PI/180));
-	Eigen::Affine2d trans2(Eigen::Scaling(scale2) * Eigen::Rotation2D<double>(-rot2*M_PI/180));
-	
 	bool splitfirst = sin((rot1 - rot2)*M_PI/180) > 0.0;
+	size_t start = 0;
 	for(const auto &o : poly.outlines()) {
-		Vector2d prev1 = trans1 * o.vertices[0];
-		Vector2d prev2 = trans2 * o.vertices[0];
-		for (size_t i=1;i<=o.vertices.size();i++) {
-			Vector2d curr1 = trans1 * o.vertices[i % o.vertices.size()];
-			Vector2d curr2 = trans2 * o.vertices[i % o.vertices.size()];
-			ps->append_poly();
-			
+		size_t n = o.vertices.size();
+		for (size_t i=1;i<=n;i++) {
+			const Vector2d &prev1 = ring1[start + i - 1];
+			const Vector2d &prev2 = ring2[start + i - 1];
+			const Vector2d &curr1 = ring1[start + i % n];
+			const Vector2d &curr2 = ring2[start + i % n];
+
 			// Make sure to split negative outlines correctly
 			if (splitfirst xor !o.positive) {
-				ps->insert_vertex(prev1[0], prev1[1], h1);
-				ps->insert_vertex(curr2[0], curr2[1], h2);
-				ps->insert_vertex(curr1[0], curr1[1], h1);
-				if (scale2[0] > 0 || scale2[1] > 0) {
-					ps->append_poly();
-					ps->insert_vertex(curr2[0], curr2[1], h2);
-					ps->insert_vertex(prev1[0], prev1[1], h1);
-					ps->insert_vertex(prev2[0], prev2[1], h2);
+				*out++ = {Vector3d(curr1[0], curr1[1], h1), Vector3d(curr2[0], curr2[1], h2), Vector3d(prev1[0], prev1[1], h1)};
+				if (fullslice) {
+					*out++ = {Vector3d(prev2[0], prev2[1], h2), Vector3d(prev1[0], prev1[1], h1), Vector3d(curr2[0], curr2[1], h2)};
 				}
 			}
 			else {
-				ps->insert_vertex(prev1[0], prev1[1], h1);
-				ps->insert_vertex(prev2[0], prev2[1], h2);
-				ps->insert_vertex(curr1[0], curr1[1], h1);
-				if (scale2[0] > 0 || scale2[1] > 0) {
-					ps->append_poly();
-					ps->insert_vertex(prev2[0], prev2[1], h2);
-					ps->insert_vertex(curr2[0], curr2[1], h2);
-					ps->insert_vertex(curr1[0], curr1[1], h1);
+				*out++ = {Vector3d(curr1[0], curr1[1], h1), Vector3d(prev2[0], prev2[1], h2), Vector3d(prev1[0], prev1[1], h1)};
+				if (fullslice) {
+					*out++ = {Vector3d(curr1[0], curr1[1], h1), Vector3d(curr2[0], curr2[1], h2), Vector3d(prev2[0], prev2[1], h2)};
 				}
 			}
-			prev1 = curr1;
-			prev2 = curr2;
 		}
+		start += n;
 	}
 }
 
 /*!
 	Input to extrude should be sanitized. This means non-intersecting, correct winding order
 	etc., the input coming from a library like Clipper.
+
+	The polygon is tessellated only once; the top cap reuses the bottom
+	triangulation unless the top is scaled to a degenerate shape. The side
+	triangles are written in parallel into a presized polygon list, in the
+	same order as building them slice by slice would.
 */
 static Geometry *extrudePolygon(const LinearExtrudeNode &node, const Polygon2d &poly)
 {
@@ -692,39 +757,76 @@ static Geometry *extrudePolygon(const LinearExtrudeNode &node, const Polygon2d &
 		h2 = node.height;
 	}
 
-	PolySet *ps_bottom = poly.tessellate(); // bottom
-	
-	// Flip vertex ordering for bottom polygon
-	for(auto &p : ps_bottom->polygons) {
-		std::reverse(p.begin(), p.end());
+	PolySet *ps_cap = poly.tessellate();
+	if (ps_cap) {
+		// Flip vertex ordering for bottom polygon
+		PolySet ps_bottom(*ps_cap);
+		for(auto &p : ps_bottom.polygons) {
+			std::reverse(p.begin(), p.end());
+		}
+		translate_PolySet(ps_bottom, Vector3d(0,0,h1));
+		ps->append(ps_bottom);
 	}
-	translate_PolySet(*ps_bottom, Vector3d(0,0,h1));
-
-	ps->append(*ps_bottom);
-	delete ps_bottom;
-	if (node.scale_x > 0 || node.scale_y > 0) {
+	if (node.scale_x > 0 && node.scale_y > 0 && ps_cap) {
+		// The top is an affine image of the bottom, so its triangulation can be reused
+		Eigen::Affine2d trans(Eigen::Scaling(node.scale_x, node.scale_y) *
+													Eigen::Rotation2D<double>(-node.twist*M_PI/180));
+		for(auto &p : ps_cap->polygons) {
+			for(auto &v : p) {
+				Vector2d t = trans * Vector2d(v[0], v[1]);
+				v = Vector3d(t[0], t[1], h2);
+			}
+		}
+		ps->append(*ps_cap);
+	}
+	else if (node.scale_x > 0 || node.scale_y > 0) {
 		Polygon2d top_poly(poly);
 		Eigen::Affine2d trans(Eigen::Scaling(node.scale_x, node.scale_y) *
 													 Eigen::Rotation2D<double>(-node.twist*M_PI/180));
 		top_poly.transform(trans); // top
 		PolySet *ps_top = top_poly.tessellate();
-		translate_PolySet(*ps_top, Vector3d(0,0,h2));
-		ps->append(*ps_top);
-		delete ps_top;
+		if (ps_top) {
+			translate_PolySet(*ps_top, Vector3d(0,0,h2));
+			ps->append(*ps_top);
+			delete ps_top;
+		}
 	}
-    size_t slices = node.slices;
-
-	for (unsigned int j = 0; j < slices; j++) {
-		double rot1 = node.twist*j / slices;
-		double rot2 = node.twist*(j+1) / slices;
-		double height1 = h1 + (h2-h1)*j / slices;
-		double height2 = h1 + (h2-h1)*(j+1) / slices;
-		Vector2d scale1(1 - (1-node.scale_x)*j / slices,
-										1 - (1-node.scale_y)*j / slices);
-		Vector2d scale2(1 - (1-node.scale_x)*(j+1) / slices,
-										1 - (1-node.scale_y)*(j+1) / slices);
-		add_slice(ps, poly, rot1, rot2, height1, height2, scale1, scale2);
+	delete ps_cap;
+
+	size_t slices = node.slices;
+	size_t numverts = 0;
+	for(const auto &o : poly.outlines()) numverts += o.vertices.size();
+
+	// Each slice has two triangles per vertex, only one if it ends in a point
+	std::vector<size_t> offsets(slices);
+	size_t numpolygons = ps->polygons.size();
+	for (size_t j = 0; j < slices; j++) {
+		Vector2d scale2 = slice_scale(node, j+1, slices);
+		offsets[j] = numpolygons;
+		numpolygons += (scale2[0] > 0 || scale2[1] > 0) ? 2 * numverts : numverts;
 	}
+	ps->resize_polygons(numpolygons);
+
+	// Slices are generated in chunks, sharing each ring between the two
+	// slices it bounds
+	size_t numchunks = std::min<size_t>(slices, 64);
+	parallel_for(numchunks, [&](size_t c) {
+		size_t begin = slices * c / numchunks;
+		size_t end = slices * (c+1) / numchunks;
+		std::vector<Vector2d> ring1, ring2;
+		ring1.reserve(numverts);
+		ring2.reserve(numverts);
+		transform_ring(ring1, poly, node, begin, slices);
+		for (size_t j = begin; j < end; j++) {
+			transform_ring(ring2, poly, node, j+1, slices);
+			Vector2d scale2 = slice_scale(node, j+1, slices);
+			add_slice(ps->polygons.begin() + offsets[j], poly, ring1, ring2,
+								slice_rotation(node, j, slices), slice_rotation(node, j+1, slices),
+								h1 + (h2-h1)*j / slices, h1 + (h2-h1)*(j+1) / slices,
+								scale2[0] > 0 || scale2[1] > 0);
+			ring1.swap(ring2);
+		}
+	});
 
 	return ps;
 }
@@ -769,21 +871,10 @@ Response GeometryEvaluator::visit(State &state, const LinearExtrudeNode &node)
 	return ContinueTraversal;
 }
 
-static void fill_ring(std::vector<Vector3d> &ring, const Outline2d &o, double a, bool flip)
+static void fill_ring(std::vector<Vector3d> &ring, const Outline2d &o, double sin_a, double cos_a)
 {
-	if (flip) {
-		unsigned int l = o.vertices.size()-1;
-		for (unsigned int i=0 ;i<o.vertices.size();i++) {
-			ring[i][0] = o.vertices[l-i][0] * sin(a);
-			ring[i][1] = o.vertices[l-i][0] * cos(a);
-			ring[i][2] = o.vertices[l-i][1];
-		}
-	} else {
-		for (unsigned int i=0 ;i<o.vertices.size();i++) {
-			ring[i][0] = o.vertices[i][0] * sin(a);
-			ring[i][1] = o.vertices[i][0] * cos(a);
-			ring[i][2] = o.vertices[i][1];
-		}
+	for (size_t i=0;i<o.vertices.size();i++) {
+		ring[i] = Vector3d(o.vertices[i][0] * sin_a, o.vertices[i][0] * cos_a, o.vertices[i][1]);
 	}
 }
 
@@ -856,32 +947,64 @@ static Geometry *rotatePolygon(const RotateExtrudeNode &node, const Polygon2d &p
 		delete ps_end;
 	}
 
-	for(const auto &o : poly.outlines()) {
-		std::vector<Vector3d> rings[2];
-		rings[0].resize(o.vertices.size());
-		rings[1].resize(o.vertices.size());
-
-		fill_ring(rings[0], o, (node.angle == 360) ? -M_PI/2 : M_PI/2, flip_faces); // first ring
-		for (int j = 0; j < fragments; j++) {
-			double a;
-			if (node.angle == 360)
-			    a = -M_PI/2 + ((j+1)%fragments*2*M_PI) / fragments; // start on the -X axis, for legacy support
-			else
-				a = M_PI/2 - (j+1)*(node.angle*M_PI/180) / fragments; // start on the X axis
-			fill_ring(rings[(j+1)%2], o, a, flip_faces);
-
-			for (size_t i=0;i<o.vertices.size();i++) {
-				ps->append_poly();
-				ps->insert_vertex(rings[j%2][i]);
-				ps->insert_vertex(rings[(j+1)%2][(i+1)%o.vertices.size()]);
-				ps->insert_vertex(rings[j%2][(i+1)%o.vertices.size()]);
-				ps->append_poly();
-				ps->insert_vertex(rings[j%2][i]);
-				ps->insert_vertex(rings[(j+1)%2][i]);
-				ps->insert_vertex(rings[(j+1)%2][(i+1)%o.vertices.size()]);
-			}
+	if (fragments == 0) return ps;
+
+	// Angle table, ring j lies at angle a_j. For full revolutions the last
+	// ring coincides with the first one.
+	std::vector<double> sin_a(fragments + 1), cos_a(fragments + 1);
+	for (int j = 0; j <= fragments; j++) {
+		double a;
+		if (node.angle == 360)
+		    a = -M_PI/2 + (j%fragments*2*M_PI) / fragments; // start on the -X axis, for legacy support
+		else
+			a = M_PI/2 - j*(node.angle*M_PI/180) / fragments; // start on the X axis
+		sin_a[j] = sin(a);
+		cos_a[j] = cos(a);
+	}
+
+	// Outlines with the vertex order used for the rings
+	std::vector<Outline2d> outlines = poly.outlines();
+	if (flip_faces) {
+		for(auto &o : outlines) std::reverse(o.vertices.begin(), o.vertices.end());
+	}
+
+	// Each fragment has two triangles per outline vertex. Split the work into
+	// tasks of consecutive fragments of one outline, each writing into its own
+	// range of the presized polygon list.
+	struct Task { size_t outline, begin, end, offset; };
+	std::vector<Task> tasks;
+	size_t numpolygons = ps->polygons.size();
+	for (size_t k = 0; k < outlines.size(); k++) {
+		size_t n = outlines[k].vertices.size();
+		size_t numchunks = std::min<size_t>(fragments, 1 + n * fragments / 16384);
+		for (size_t c = 0; c < numchunks; c++) {
+			Task task;
+			task.outline = k;
+			task.begin = fragments * c / numchunks;
+			task.end = fragments * (c+1) / numchunks;
+			task.offset = numpolygons + 2 * n * task.begin;
+			tasks.push_back(task);
 		}
+		numpolygons += 2 * n * fragments;
 	}
+	ps->resize_polygons(numpolygons);
+
+	parallel_for(tasks.size(), [&](size_t t) {
+		const Task &task = tasks[t];
+		const Outline2d &o = outlines[task.outline];
+		size_t n = o.vertices.size();
+		std::vector<Vector3d> ring1(n), ring2(n);
+		fill_ring(ring1, o, sin_a[task.begin], cos_a[task.begin]);
+		Polygons::iterator out = ps->polygons.begin() + task.offset;
+		for (size_t j = task.begin; j < task.end; j++) {
+			fill_ring(ring2, o, sin_a[j+1], cos_a[j+1]);
+			for (size_t i=0;i<n;i++) {
+				*out++ = {ring1[(i+1)%n], ring2[(i+1)%n], ring1[i]};
+				*out++ = {ring2[(i+1)%n], ring2[i], ring1[i]};
+			}
+			ring1.swap(ring2);
+		}
+	});
 	
 	return ps;
 }
@@ -1108,6 +1231,34 @@ Response GeometryEvaluator::visit(State &state, const CgaladvNode &node)
 				}
 				break;
 			}
+			case SIMPLIFY: {
+				ResultObject res = applyToChildren(node, OPENSCAD_UNION);
+				geom = res.constptr();
+				if (!geom || geom->getDimension() != 3 || (node.faces == 0 && node.maxerror == 0)) break;
+
+				shared_ptr<const PolySet> ps = dynamic_pointer_cast<const PolySet>(geom);
+				if (!ps) {
+					shared_ptr<const CGAL_Nef_polyhedron> N = dynamic_pointer_cast<const CGAL_Nef_polyhedron>(geom);
+					if (N && !N->isEmpty()) {
+						PolySet *nps = new PolySet(3);
+						bool err = CGALUtils::createPolySetFromNefPolyhedron3(*N->p3, *nps);
+						if (err) {
+							PRINT("ERROR: Nef->PolySet failed");
+							delete nps;
+						}
+						else {
+							ps.reset(nps);
+						}
+					}
+				}
+				if (ps) {
+					// error is given as a distance, the quadric error is a squared distance
+					double maxerror = node.maxerror > 0 ? node.maxerror * node.maxerror : std::numeric_limits<double>::infinity();
+					PolySet *result = PolysetUtils::simplify(*ps, node.faces, maxerror);
+					geom.reset(result);
+				}
+				break;
+			}
 			default:
 				assert(false && "not implemented");
 			}
@@ -18,6 +18,8 @@ public:
 
 	shared_ptr<const Geometry> evaluateGeometry(const AbstractNode &node, bool allownef);
 
+	virtual Response traverse(const AbstractNode &node, const class State &state = NodeVisitor::nullstate);
+
 	virtual Response visit(State &state, const AbstractNode &node);
 	virtual Response visit(State &state, const AbstractIntersectionNode &node);
 	virtual Response visit(State &state, const AbstractPolyNode &node);
@@ -58,8 +60,10 @@ private:
 	void smartCacheInsert(const AbstractNode &node, const shared_ptr<const Geometry> &geom);
 	shared_ptr<const Geometry> smartCacheGet(const AbstractNode &node, bool preferNef);
 	bool isSmartCached(const AbstractNode &node);
-	std::vector<const class Polygon2d *> collectChildren2D(const AbstractNode &node);
+	std::vector<const class Polygon2d *> collectChildren2D(const AbstractNode &node,
+																												 std::vector<std::string> *ids = NULL);
 	Geometry::Geometries collectChildren3D(const AbstractNode &node);
+	std::vector<std::string> getIdStrings(const Geometry::Geometries &children) const;
 	Polygon2d *applyMinkowski2D(const AbstractNode &node);
 	Polygon2d *applyHull2D(const AbstractNode &node);
 	Geometry *applyHull3D(const AbstractNode &node);
@@ -70,6 +74,7 @@ private:
 	void addToParent(const State &state, const AbstractNode &node, const shared_ptr<const Geometry> &geom);
 
 	std::map<int, Geometry::Geometries> visitedchildren;
+	std::map<int, double> computetimes; // Evaluation time per node index in seconds
 	const Tree &tree;
 	shared_ptr<const Geometry> root;
 
@@ -18,6 +18,41 @@ static void stdFree(void* userData, void* ptr) {
 	free(ptr);
 }
 
+/*!
+	Keeps one libtess2 tessellator per thread.
+
+	A tessellator can be reused once tessTesselate() has completed successfully,
+	which saves setting one up for every polygon. After a failure, its internal
+	state is undefined, so it's discarded and a new one is created on next use.
+*/
+class ThreadTessellator {
+public:
+	ThreadTessellator() : tess(NULL) {}
+	~ThreadTessellator() { discard(); }
+
+	TESStesselator *get() {
+		if (!this->tess) {
+			TESSalloc ma;
+			memset(&ma, 0, sizeof(ma));
+			ma.memalloc = stdAlloc;
+			ma.memfree = stdFree;
+			ma.extraVertices = 256; // realloc not provided, allow 256 extra vertices.
+			this->tess = tessNewTess(&ma);
+		}
+		return this->tess;
+	}
+
+	void discard() {
+		if (this->tess) tessDeleteTess(this->tess);
+		this->tess = NULL;
+	}
+
+private:
+	TESStesselator *tess;
+};
+
+static thread_local ThreadTessellator threadtess;
+
 typedef std::pair<int,int> IndexedEdge;
 
 /*!
@@ -257,24 +292,17 @@ bool GeometryUtils::tessellatePolygonWithHoles(const Vector3f *vertices,
 		edges.add(face);
 	}
 
-  TESSreal *normalvec = NULL;
-  TESSreal passednormal[3];
+	// The normal must always be passed, as a reused tessellator would otherwise
+	// keep the normal of a previous call. A zero normal means auto-detect.
+  TESSreal normalvec[3] = {0, 0, 0};
   if (normal) {
-    passednormal[0] = (*normal)[0];
-		passednormal[1] = (*normal)[1];
-		passednormal[2] = (*normal)[2];
-    normalvec = passednormal;
+    normalvec[0] = (*normal)[0];
+		normalvec[1] = (*normal)[1];
+		normalvec[2] = (*normal)[2];
   }
 
-  TESSalloc ma;
-  TESStesselator* tess = 0;
-
-  memset(&ma, 0, sizeof(ma));
-  ma.memalloc = stdAlloc;
-  ma.memfree = stdFree;
-  ma.extraVertices = 256; // realloc not provided, allow 256 extra vertices.
-  
-  if (!(tess = tessNewTess(&ma))) return true;
+  TESStesselator* tess = threadtess.get();
+  if (!tess) return true;
 
 	int numContours = 0;
   std::vector<TESSreal> contour;
@@ -296,7 +324,10 @@ bool GeometryUtils::tessellatePolygonWithHoles(const Vector3f *vertices,
 		numContours++;
   }
 
-  if (!tessTesselate(tess, TESS_WINDING_ODD, TESS_CONSTRAINED_DELAUNAY_TRIANGLES, 3, 3, normalvec)) return -1;
+  if (!tessTesselate(tess, TESS_WINDING_ODD, TESS_CONSTRAINED_DELAUNAY_TRIANGLES, 3, 3, normalvec)) {
+		threadtess.discard();
+		return true;
+	}
 
   const TESSindex *vindices = tessGetVertexIndices(tess);
   const TESSindex *elements = tessGetElements(tess);
@@ -411,8 +442,6 @@ bool GeometryUtils::tessellatePolygonWithHoles(const Vector3f *vertices,
 		}
 #endif
 
-  tessDeleteTess(tess);
-
   return false;
 }
 
@@ -2,6 +2,7 @@
 #include "FileModule.h"
 #include "printutils.h"
 #include "openscad.h"
+#include "ASTCache.h"
 
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
@@ -10,13 +11,13 @@
 #include <fstream>
 #include <sstream>
 #include <time.h>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
 #include <sys/stat.h>
 
 namespace fs=boost::filesystem;
 //#include "parsersettings.h"
-/*!
-	FIXME: Implement an LRU scheme to avoid having an ever-growing module cache
-*/
 
 ModuleCache *ModuleCache::inst = NULL;
 
@@ -60,6 +61,7 @@ bool ModuleCache::evaluate(const std::string &filename, FileModule *&module)
 		entry.module = NULL;
 		entry.cache_id = cache_id;
 	}
+	entry.lastused = ++this->clock;
   
 	bool shouldCompile = true;
 	if (found) {
@@ -100,14 +102,24 @@ bool ModuleCache::evaluate(const std::string &filename, FileModule *&module)
 			textbuf << ifs.rdbuf();
 		}
 		textbuf << "\n" << commandline_commands;
+		const std::string text = textbuf.str();
 		
 		print_messages_push();
 		
 		FileModule *oldmodule = lib_mod;
 		
-        fs::path pathname = fs::path(filename);
-		lib_mod = parse(textbuf.str().c_str(), pathname, false);
-		PRINTDB("  compiled module: %p", lib_mod);
+		// Parser messages are stored with the cached AST and printed on every load
+		PrintCapture output;
+		lib_mod = ASTCache::instance()->load(filename, text, output);
+		if (!lib_mod) {
+			fs::path pathname = fs::path(filename);
+			output.start();
+			lib_mod = parse(text.c_str(), pathname, false);
+			output.stop();
+			PRINTDB("  compiled module: %p", lib_mod);
+			if (lib_mod) ASTCache::instance()->store(filename, text, *lib_mod, output);
+		}
+		output.replay();
 		
 		// We defer deletion so we can ensure that the new module won't
 		// have the same address as the old
@@ -119,7 +131,9 @@ bool ModuleCache::evaluate(const std::string &filename, FileModule *&module)
 	}
 	
 	module = lib_mod;
+	this->evaluating++;
 	bool depschanged = lib_mod ? lib_mod->handleDependencies() : false;
+	this->evaluating--;
 
 	return shouldCompile || depschanged;
 }
@@ -129,6 +143,45 @@ void ModuleCache::clear()
 	this->entries.clear();
 }
 
+/*!
+	Evicts the least recently used modules until at most maxEntries() remain.
+	Modules used directly or indirectly by root are kept, since nodes
+	instantiated from root may refer to them. Must not be called while
+	modules are being evaluated or instantiated, as evicted modules are deleted.
+*/
+void ModuleCache::trim(const FileModule *root)
+{
+	if (this->entries.size() <= this->maxentries) return;
+
+	std::unordered_set<std::string> reachable;
+	std::vector<const FileModule *> pending;
+	if (root) pending.push_back(root);
+	while (!pending.empty()) {
+		const FileModule *module = pending.back();
+		pending.pop_back();
+		for (const auto &filename : module->usedlibs) {
+			if (!reachable.insert(filename).second) continue;
+			auto it = this->entries.find(filename);
+			if (it != this->entries.end() && it->second.module) pending.push_back(it->second.module);
+		}
+	}
+
+	std::vector<std::pair<unsigned long, std::string>> byage;
+	for (const auto &item : this->entries) {
+		if (reachable.count(item.first)) continue;
+		// Modules in the middle of a dependency update are in use
+		if (item.second.module && item.second.module->isHandlingDependencies()) continue;
+		byage.push_back(std::make_pair(item.second.lastused, item.first));
+	}
+	std::sort(byage.begin(), byage.end());
+	size_t toevict = std::min(byage.size(), this->entries.size() - this->maxentries);
+	for (size_t i = 0; i < toevict; i++) {
+		PRINTDB("Evicting cached library: %s", byage[i].second);
+		delete this->entries[byage[i].second].module;
+		this->entries.erase(byage[i].second);
+	}
+}
+
 FileModule *ModuleCache::lookup(const std::string &filename)
 {
 	return isCached(filename) ? this->entries[filename].module : NULL;
@@ -4,7 +4,13 @@
 #include <unordered_map>
 
 /*!
-	Caches FileModules based on their filenames
+	Caches FileModules based on their filenames.
+
+	The number of cached modules is bounded. When exceeded, the least recently
+	used modules not used by the top-level file are evicted before its next
+	dependency update.
+	Parse results are also stored in the ASTCache, if enabled, so evicted or
+	previously seen libraries can be loaded without parsing.
 */
 class ModuleCache
 {
@@ -16,8 +22,13 @@ public:
 	size_t size() { return this->entries.size(); }
 	void clear();
 
+	void setMaxEntries(size_t maxentries) { this->maxentries = maxentries; }
+	size_t maxEntries() const { return this->maxentries; }
+	bool isEvaluating() const { return this->evaluating > 0; }
+	void trim(const class FileModule *root);
+
 private:
-	ModuleCache() {}
+	ModuleCache() : maxentries(256), evaluating(0), clock(0) {}
 	~ModuleCache() {}
 
 	static ModuleCache *inst;
@@ -25,6 +36,10 @@ private:
 	struct cache_entry {
 		class FileModule *module;
 		std::string cache_id;
+		unsigned long lastused;
 	};
 	std::unordered_map<std::string, cache_entry> entries;
+	size_t maxentries;
+	int evaluating;
+	unsigned long clock;
 };
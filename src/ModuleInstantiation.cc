@@ -1,6 +1,7 @@
 #include "ModuleInstantiation.h"
 #include "evalcontext.h"
 #include "expression.h"
+#include "Profiler.h"
 #include <boost/filesystem.hpp>
 namespace fs = boost::filesystem;
 
@@ -80,6 +81,7 @@ AbstractNode *ModuleInstantiation::evaluate(const Context *ctx) const
 	c.dump(NULL, this);
 #endif
 
+	Profiler::Scope scope(Profiler::INSTANTIATION, this);
 	AbstractNode *node = ctx->instantiate_module(*this, &c); // Passes c as evalctx
 	return node;
 }
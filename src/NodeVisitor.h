@@ -30,7 +30,7 @@ public:
   NodeVisitor() {}
   virtual ~NodeVisitor() {}
   
-	Response traverse(const AbstractNode &node, const class State &state = NodeVisitor::nullstate);
+	virtual Response traverse(const AbstractNode &node, const class State &state = NodeVisitor::nullstate);
 
   virtual Response visit(class State &state, const class AbstractNode &node) = 0;
   virtual Response visit(class State &state, const class AbstractIntersectionNode &node) {
@@ -89,6 +89,6 @@ public:
 	}
 	// Add visit() methods for new visitable subtypes of AbstractNode here
 
-private:
+protected:
 	static State nullstate;
 };
@@ -26,6 +26,8 @@
 #include <CGAL/Nef_3/SNC_decorator.h>
 #include "system-gl.h"
 #include <cstdlib>
+#include <deque>
+#include <vector>
 
 // Overridden in CGAL_renderer
 /*
@@ -41,7 +43,6 @@
 */
 
 const bool cull_backfaces = false;
-const bool color_backfaces = false;
 
 #ifdef _WIN32
 #include <windows.h> // For the CALLBACK macro
@@ -230,11 +231,13 @@ namespace OGL {
 // OGL Drawable Polyhedron:
 // ----------------------------------------------------------------------------
 
-  inline void CGAL_GLU_TESS_CALLBACK beginCallback(GLenum which)
-  { glBegin(which); }
-
-  inline void CGAL_GLU_TESS_CALLBACK endCallback(void)
-  { glEnd(); }
+  // Receives the triangles of one facet from the GLU tessellator.
+  // Vertices created by combineCallback are owned by the collector.
+  struct TessCollector {
+    std::vector<GLfloat> *out;
+    const double *normal;
+    std::deque<Double_triple> combined;
+  };
 
   inline void CGAL_GLU_TESS_CALLBACK errorCallback(GLenum errorCode)
   { const GLubyte *estring;
@@ -246,40 +249,53 @@ namespace OGL {
   inline void CGAL_GLU_TESS_CALLBACK vertexCallback(GLvoid* vertex,
 			                            GLvoid* user)
   { GLdouble* pc(static_cast<GLdouble*>(vertex));
-    GLdouble* pu(static_cast<GLdouble*>(user));
-    //    CGAL_NEF_TRACEN("vertexCallback coord  "<<pc[0]<<","<<pc[1]<<","<<pc[2]);
-    //    CGAL_NEF_TRACEN("vertexCallback normal "<<pu[0]<<","<<pu[1]<<","<<pu[2]);
-    glNormal3dv(pu);
-    glVertex3dv(pc); 
+    TessCollector* tc(static_cast<TessCollector*>(user));
+    tc->out->push_back(pc[0]);
+    tc->out->push_back(pc[1]);
+    tc->out->push_back(pc[2]);
+    tc->out->push_back(tc->normal[0]);
+    tc->out->push_back(tc->normal[1]);
+    tc->out->push_back(tc->normal[2]);
   }
 
-  inline void CGAL_GLU_TESS_CALLBACK combineCallback(GLdouble coords[3], GLvoid *[4], GLfloat [4], GLvoid **dataOut)
-  { static std::list<GLdouble*> pcache;
-    if (dataOut) {
-      GLdouble *n = new GLdouble[3];
-      n[0] = coords[0];
-      n[1] = coords[1];
-      n[2] = coords[2];
-      pcache.push_back(n);
-      *dataOut = n;
-    } else {
-      for (std::list<GLdouble*>::const_iterator i = pcache.begin(); i != pcache.end(); i++)
-        delete[] *i;
-      pcache.clear();
-    }
+  // Registering an edge flag callback makes the tessellator emit
+  // independent triangles only, which is what the buffers hold.
+  inline void CGAL_GLU_TESS_CALLBACK edgeFlagCallback(GLboolean)
+  { }
+
+  inline void CGAL_GLU_TESS_CALLBACK combineCallback(GLdouble coords[3], GLvoid *[4], GLfloat [4], GLvoid **dataOut, GLvoid* user)
+  { TessCollector* tc(static_cast<TessCollector*>(user));
+    tc->combined.push_back(Double_triple(coords[0], coords[1], coords[2]));
+    *dataOut = static_cast<double*>(tc->combined.back());
   }
 
 
  enum { SNC_AXES};
  enum { SNC_BOUNDARY, SNC_SKELETON };
 
+ // The polyhedron is converted once into a single vertex buffer holding
+ // triangles, edge segments and points, grouped by kind and mark. Each
+ // vertex is stored as position and normal. Colors aren't part of the
+ // buffer but set per group when drawing, so changing colors doesn't
+ // require converting the polyhedron again.
  class Polyhedron : public OGL_base_object {
  protected:
     std::list<DPoint>    vertices_;
     std::list<DSegment>  edges_;
     std::list<DFacet>    halffacets_;
 
-    GLuint         object_list_;
+    enum {
+      UNMARKED_FACETS, MARKED_FACETS,
+      UNMARKED_EDGES, MARKED_EDGES,
+      UNMARKED_VERTICES, MARKED_VERTICES,
+      NUM_RANGES
+    };
+    static const int FLOATS_PER_VERTEX = 6;
+
+    std::vector<GLfloat> data_;
+    GLint ranges_[NUM_RANGES + 1]; // first vertex of each range
+    mutable GLuint vbo_;
+    mutable bool uploaded_;
     bool init_;
 
     Bbox_3  bbox_;
@@ -292,59 +308,15 @@ namespace OGL {
     typedef std::list<DFacet>::const_iterator   Halffacet_iterator;
 
   public:
-    Polyhedron() : bbox_(-1,-1,-1,1,1,1), switches(1) { 
-      object_list_ = 0;
+    Polyhedron() : vbo_(0), uploaded_(false), bbox_(-1,-1,-1,1,1,1), switches(1) { 
       init_ = false;
       style = SNC_BOUNDARY;
       switches[SNC_AXES] = false; 
+      std::fill(ranges_, ranges_ + NUM_RANGES + 1, 0);
     }
 
-    /*
-    Polyhedron(const Polyhedron& P) :
-      object_list_(0),
-      init_(false),
-      bbox_(P.bbox_),
-      style(P.style),
-      switches(2) {
-      
-      switches[SNC_AXES] = P.switches[SNC_AXES]; 
-
-      Vertex_iterator v;
-      for(v=P.vertices_.begin();v!=P.vertices_.end();++v)
-	vertices_.push_back(*v);
-      Edge_iterator e;
-      for(e=P.edges_.begin();e!=P.edges_.end();++e)
-	edges_.push_back(*e);
-      Halffacet_iterator f;
-      for(f=P.halffacets_.begin();f!=P.halffacets_.end();++f)
-	halffacets_.push_back(*f);
-    }
-
-    Polyhedron& operator=(const Polyhedron& P) { 
-      if (object_list_) glDeleteLists(object_list_, 4);
-      object_list_ = 0;
-      init_ = false;
-      style = P.style;
-      switches[SNC_AXES] = P.switches[SNC_AXES]; 
-
-      Vertex_iterator v;
-      vertices_.clear();
-      for(v=P.vertices_.begin();v!=P.vertices_.end();++v)
-	vertices_.push_back(*v);
-      Edge_iterator e;
-      edges_.clear();
-      for(e=P.edges_.begin();e!=P.edges_.end();++e)
-	edges_.push_back(*e);
-      Halffacet_iterator f;
-      halffacets_.clear();
-      for(f=P.halffacets_.begin();f!=P.halffacets_.end();++f)
-	halffacets_.push_back(*f);
-      init();      
-      return *this;
-    }
-    */
     ~Polyhedron() 
-    { if (object_list_) glDeleteLists(object_list_, 4); }
+    { if (vbo_) glDeleteBuffers(1, &vbo_); }
 
     void push_back(const Double_point& p, bool m) {
         vertices_.push_back(DPoint(p,m));
@@ -368,125 +340,176 @@ namespace OGL {
     Bbox_3& bbox()       { return bbox_; }
 
     // Overridden in CGAL_renderer
-    virtual CGAL::Color getVertexColor(Vertex_iterator v) const
+    virtual CGAL::Color getVertexColor(bool mark) const
     {
       PRINTD("getVertexColor()");
-	(void)v;
-//	CGAL::Color cf(CGAL_NEF3_OGL_MARKED_VERTEX_COLOR),
-//	  ct(CGAL_NEF3_OGL_UNMARKED_VERTEX_COLOR); // more blue-ish
-//	CGAL::Color c = v->mark() ? ct : cf;
+	(void)mark;
 	CGAL::Color c(0,0,200);
 	return c;
     }
 
-    void draw(Vertex_iterator v) const { 
-      PRINTD("draw( Vertex_iterator )");
-      //      CGAL_NEF_TRACEN("drawing vertex "<<*v);
-      CGAL::Color c = getVertexColor(v);
-      glPointSize(10);
-      //glPointSize(1);
-      glColor3ub(c.red(), c.green(), c.blue());
-      glBegin(GL_POINTS);
-      glVertex3d(v->x(),v->y(),v->z());
-#ifdef CGAL_NEF_EMPHASIZE_VERTEX
-      glColor3ub(255,0,0);
-      glVertex3d(CGAL_NEF_EMPHASIZE_VERTEX);
-#endif
-      glEnd();
-    }
-
     // Overridden in CGAL_renderer
-    virtual CGAL::Color getEdgeColor(Edge_iterator e) const
+    virtual CGAL::Color getEdgeColor(bool mark) const
     {
       PRINTD("getEdgeColor)");
-	(void)e;
-//	CGAL::Color cf(CGAL_NEF3_OGL_MARKED_EDGE_COLOR),
-//	  ct(CGAL_NEF3_OGL_UNMARKED_EDGE_COLOR); // more blue-ish
-//	CGAL::Color c = e->mark() ? ct : cf;
-	// Overridden in CGAL_renderer
+	(void)mark;
 	CGAL::Color c(200,0,0);
 	return c;
     }
 
-    void draw(Edge_iterator e) const { 
-      PRINTD("draw(Edge_iterator)");
-      //      CGAL_NEF_TRACEN("drawing edge "<<*e);
-      Double_point p = e->source(), q = e->target();
-      CGAL::Color c = getEdgeColor(e);
-      glLineWidth(5);
-      //glLineWidth(1);
-      glColor3ub(c.red(),c.green(),c.blue());
-      glBegin(GL_LINE_STRIP);
-      glVertex3d(p.x(), p.y(), p.z());
-      glVertex3d(q.x(), q.y(), q.z());
-      glEnd();
-    }
-
-
     // Overridden in CGAL_renderer
-    virtual CGAL::Color getFacetColor(Halffacet_iterator f, bool is_back_facing) const
+    virtual CGAL::Color getFacetColor(bool mark) const
     {
       PRINTD("getFacetColor");
-/*
-	(void)f;
-//	CGAL::Color cf(CGAL_NEF3_OGL_MARKED_FACET_COLOR),
-//	  ct(CGAL_NEF3_OGL_UNMARKED_FACET_COLOR); // more blue-ish
-//	CGAL::Color c = (f->mark() ? ct : cf);
-*/
+	(void)mark;
 	CGAL::Color c(0,200,0);
 	return c;
+    }
 
-/*
-      if (is_back_facing) return !f->mark()
-          ? CGAL::Color(CGAL_NEF3_OGL_MARKED_BACK_FACET_COLOR)
-          : CGAL::Color(CGAL_NEF3_OGL_UNMARKED_BACK_FACET_COLOR);
-      else return !f->mark()
-          ? CGAL::Color(CGAL_NEF3_OGL_MARKED_FACET_COLOR)
-          : CGAL::Color(CGAL_NEF3_OGL_UNMARKED_FACET_COLOR);
-*/
+    static void push_back_vertex(std::vector<GLfloat>& out, double x, double y, double z) {
+      out.push_back(x);
+      out.push_back(y);
+      out.push_back(z);
+      out.push_back(0);
+      out.push_back(0);
+      out.push_back(0);
     }
 
-    void draw(Halffacet_iterator f, bool is_back_facing) const {
-      PRINTD("draw(Halffacet_iterator)");
-      //      CGAL_NEF_TRACEN("drawing facet "<<(f->debug(),""));
+    void fill_buffers() {
+      PRINTD("fill_buffers");
+      std::vector<GLfloat> ranges[NUM_RANGES];
+
+      for(Vertex_iterator v=vertices_.begin();v!=vertices_.end();++v)
+        push_back_vertex(ranges[UNMARKED_VERTICES + v->mark()], v->x(), v->y(), v->z());
+
+      for(Edge_iterator e=edges_.begin();e!=edges_.end();++e) {
+        std::vector<GLfloat>& out = ranges[UNMARKED_EDGES + e->mark()];
+        Double_point p = e->source(), q = e->target();
+        push_back_vertex(out, p.x(), p.y(), p.z());
+        push_back_vertex(out, q.x(), q.y(), q.z());
+      }
+
+      // One tessellator is reused for all facets
       GLUtesselator* tess_ = gluNewTess();
       gluTessCallback(tess_, GLenum(GLU_TESS_VERTEX_DATA),
 		      (GLvoid (CGAL_GLU_TESS_CALLBACK *)(CGAL_GLU_TESS_DOTS)) &vertexCallback);
-      gluTessCallback(tess_, GLenum(GLU_TESS_COMBINE),
+      gluTessCallback(tess_, GLenum(GLU_TESS_COMBINE_DATA),
 		      (GLvoid (CGAL_GLU_TESS_CALLBACK *)(CGAL_GLU_TESS_DOTS)) &combineCallback);
-      gluTessCallback(tess_, GLenum(GLU_TESS_BEGIN),
-		      (GLvoid (CGAL_GLU_TESS_CALLBACK *)(CGAL_GLU_TESS_DOTS)) &beginCallback);
-      gluTessCallback(tess_, GLenum(GLU_TESS_END),
-		      (GLvoid (CGAL_GLU_TESS_CALLBACK *)(CGAL_GLU_TESS_DOTS)) &endCallback);
+      gluTessCallback(tess_, GLenum(GLU_TESS_EDGE_FLAG),
+		      (GLvoid (CGAL_GLU_TESS_CALLBACK *)(CGAL_GLU_TESS_DOTS)) &edgeFlagCallback);
       gluTessCallback(tess_, GLenum(GLU_TESS_ERROR),
 		      (GLvoid (CGAL_GLU_TESS_CALLBACK *)(CGAL_GLU_TESS_DOTS)) &errorCallback);
       gluTessProperty(tess_, GLenum(GLU_TESS_WINDING_RULE),
 		      GLU_TESS_WINDING_POSITIVE);
 
-      DFacet::Coord_const_iterator cit;
-      CGAL::Color c = getFacetColor(f,is_back_facing);
-      glColor3ub(c.red(),c.green(),c.blue());
-      gluTessBeginPolygon(tess_,f->normal());
-      //      CGAL_NEF_TRACEN(" ");
-      //      CGAL_NEF_TRACEN("Begin Polygon");
-      gluTessNormal(tess_,f->dx(),f->dy(),f->dz());
-      // forall facet cycles of f:
-      for(unsigned i = 0; i < f->number_of_facet_cycles(); ++i) {
-        gluTessBeginContour(tess_);
-	//	CGAL_NEF_TRACEN("  Begin Contour");
-	// put all vertices in facet cycle into contour:
-	for(cit = f->facet_cycle_begin(i); 
-	    cit != f->facet_cycle_end(i); ++cit) {
-	  gluTessVertex(tess_, *cit, *cit);
-	  //	  CGAL_NEF_TRACEN("    add Vertex");
-	}
-        gluTessEndContour(tess_);
-	//	CGAL_NEF_TRACEN("  End Contour");
+      for(Halffacet_iterator f=halffacets_.begin();f!=halffacets_.end();++f) {
+        TessCollector tc;
+        tc.out = &ranges[UNMARKED_FACETS + f->mark()];
+        tc.normal = f->normal();
+        gluTessBeginPolygon(tess_, &tc);
+        gluTessNormal(tess_,f->dx(),f->dy(),f->dz());
+        // forall facet cycles of f:
+        for(unsigned i = 0; i < f->number_of_facet_cycles(); ++i) {
+          gluTessBeginContour(tess_);
+          // put all vertices in facet cycle into contour:
+          for(DFacet::Coord_const_iterator cit = f->facet_cycle_begin(i); 
+              cit != f->facet_cycle_end(i); ++cit) {
+            gluTessVertex(tess_, *cit, *cit);
+          }
+          gluTessEndContour(tess_);
+        }
+        gluTessEndPolygon(tess_);
       }
-      gluTessEndPolygon(tess_);
-      //      CGAL_NEF_TRACEN("End Polygon");
       gluDeleteTess(tess_);
-      combineCallback(NULL, NULL, NULL, NULL);
+
+      size_t total = 0;
+      for (int i = 0; i < NUM_RANGES; i++) total += ranges[i].size();
+      data_.clear();
+      data_.reserve(total);
+      for (int i = 0; i < NUM_RANGES; i++) {
+        ranges_[i] = data_.size() / FLOATS_PER_VERTEX;
+        data_.insert(data_.end(), ranges[i].begin(), ranges[i].end());
+      }
+      ranges_[NUM_RANGES] = data_.size() / FLOATS_PER_VERTEX;
+
+      // The buffer holds everything needed for drawing
+      vertices_.clear();
+      edges_.clear();
+      halffacets_.clear();
+    }
+
+    // Uploads the buffer to the graphics card on first use. Needs a
+    // current GL context, so it's deferred until drawing. Falls back
+    // to client side arrays if vertex buffer objects aren't supported.
+    void upload_buffers() const {
+      if (uploaded_) return;
+      uploaded_ = true;
+      if (!data_.empty() && GLEW_VERSION_1_5) {
+        glGenBuffers(1, &vbo_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBufferData(GL_ARRAY_BUFFER, data_.size() * sizeof(GLfloat), &data_[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+      }
+    }
+
+    // Sets up the vertex and normal arrays; returns false if there's nothing to draw
+    bool bind_buffers() const {
+      if (data_.empty()) return false;
+      upload_buffers();
+      const char* base = NULL;
+      if (vbo_) glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+      else base = reinterpret_cast<const char*>(&data_[0]);
+      GLsizei stride = FLOATS_PER_VERTEX * sizeof(GLfloat);
+      glEnableClientState(GL_VERTEX_ARRAY);
+      glVertexPointer(3, GL_FLOAT, stride, base);
+      glNormalPointer(GL_FLOAT, stride, base + 3 * sizeof(GLfloat));
+      return true;
+    }
+
+    void unbind_buffers() const {
+      glDisableClientState(GL_VERTEX_ARRAY);
+      if (vbo_) glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void draw_range(int range, GLenum mode) const {
+      GLsizei count = ranges_[range + 1] - ranges_[range];
+      if (count > 0) glDrawArrays(mode, ranges_[range], count);
+    }
+
+    void draw_facets() const {
+      PRINTD("draw_facets()");
+      if (cull_backfaces) {
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+      }
+      glEnableClientState(GL_NORMAL_ARRAY);
+      for (int mark = 0; mark < 2; mark++) {
+        CGAL::Color c = getFacetColor(mark);
+        glColor3ub(c.red(),c.green(),c.blue());
+        draw_range(UNMARKED_FACETS + mark, GL_TRIANGLES);
+      }
+      glDisableClientState(GL_NORMAL_ARRAY);
+      if (cull_backfaces) glDisable(GL_CULL_FACE);
+    }
+
+    void draw_edges() const {
+      PRINTD("draw_edges()");
+      glLineWidth(5);
+      for (int mark = 0; mark < 2; mark++) {
+        CGAL::Color c = getEdgeColor(mark);
+        glColor3ub(c.red(),c.green(),c.blue());
+        draw_range(UNMARKED_EDGES + mark, GL_LINES);
+      }
+    }
+
+    void draw_vertices() const {
+      PRINTD("draw_vertices()");
+      glPointSize(10);
+      for (int mark = 0; mark < 2; mark++) {
+        CGAL::Color c = getVertexColor(mark);
+        glColor3ub(c.red(),c.green(),c.blue());
+        draw_range(UNMARKED_VERTICES + mark, GL_POINTS);
+      }
     }
 
     void construct_axes() const
@@ -523,54 +546,14 @@ namespace OGL {
       glEnd();
     }
 
-
-    void fill_display_lists() {
-      PRINTD("fill_display_lists");
-      glNewList(object_list_, GL_COMPILE);
-      Vertex_iterator v;
-      for(v=vertices_.begin();v!=vertices_.end();++v) 
-	draw(v);
-      glEndList();     
-
-      glNewList(object_list_+1, GL_COMPILE);
-      Edge_iterator e;
-      for(e=edges_.begin();e!=edges_.end();++e)
-	draw(e);
-      glEndList();     
-
-      glNewList(object_list_+2, GL_COMPILE);
-
-      if (cull_backfaces || color_backfaces) {
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-	  }
-      for (int i = 0; i < (color_backfaces ? 2 : 1); i++) {
-        Halffacet_iterator f;
-        for(f=halffacets_.begin();f!=halffacets_.end();++f)
-          draw(f, i);
-		if (color_backfaces) glCullFace(GL_FRONT);
-	  }
-	  if (cull_backfaces || color_backfaces) {
-        glCullFace(GL_BACK);
-        glDisable(GL_CULL_FACE);
-	  }
-	  glEndList();
-
-      glNewList(object_list_+3, GL_COMPILE); // axes:
-      construct_axes();
-      glEndList();
-
-    }
-
+    // Converts the polyhedron to the vertex buffer. Doesn't need a GL context.
     void init() { 
       PRINTD("init()");
       if (init_) return;
       init_ = true;
       switches[SNC_AXES] = false;
       style = SNC_BOUNDARY;
-      object_list_ = glGenLists(4); 
-      CGAL_assertion(object_list_); 
-      fill_display_lists();
+      fill_buffers();
       PRINTD("init() end");
     }
 
@@ -588,36 +571,25 @@ namespace OGL {
       glTranslated( -(bbox().xmax() + bbox().xmin()) / 2.0,
                     -(bbox().ymax() + bbox().ymin()) / 2.0,
                     -(bbox().zmax() + bbox().zmin()) / 2.0);
-      if (style == SNC_BOUNDARY) {
-	//glEnable(GL_LIGHTING); 
-	glCallList(object_list_+2); // facets
-	//glDisable(GL_LIGHTING);
+      if (bind_buffers()) {
+        if (style == SNC_BOUNDARY) draw_facets();
+        draw_edges();
+        draw_vertices();
+        unbind_buffers();
       }
-      // move edges and vertices a bit towards the view-point, 
-      // i.e., 1/100th of the unit vector in camera space
-      //      double f = l / 4.0 / 100.0;
-      //      glTranslated( z_vec[0] * f, z_vec[1] * f, z_vec[2] * f);
-      glCallList(object_list_+1); // edges
-      glCallList(object_list_);   // vertices
-      if (switches[SNC_AXES]) glCallList(object_list_+3); // axis
+      if (switches[SNC_AXES]) construct_axes();
       PRINTD("draw() end");
    }
 
     void debug(std::ostream& os = std::cerr) const
     {
       os << "OGL::Polyhedron" << std::endl;
-      os << "Vertices:" << std::endl;
-      Vertex_iterator v;
-      for(v=vertices_.begin();v!=vertices_.end();++v) 
-	os << "  "<<*v<<", mark="<<v->mark()<<std::endl;
-      os << "Edges:" << std::endl;
-      Edge_iterator e;
-      for(e=edges_.begin();e!=edges_.end();++e)
-	os << "  "<<*e<<", mark="<<e->mark()<<std::endl;
-      os << "Facets:" << std::endl;
-      Halffacet_iterator f;
-      for(f=halffacets_.begin();f!=halffacets_.end();++f)
-	f->debug(); os << std::endl;
+      const char* names[NUM_RANGES] = {
+        "Unmarked facets", "Marked facets", "Unmarked edges",
+        "Marked edges", "Unmarked vertices", "Marked vertices"
+      };
+      for (int i = 0; i < NUM_RANGES; i++)
+        os << names[i] << ": " << (ranges_[i + 1] - ranges_[i]) << " buffer vertices" << std::endl;
       os << std::endl;
     }
 
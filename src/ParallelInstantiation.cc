@@ -0,0 +1,76 @@
+#include "ParallelInstantiation.h"
+#include "context.h"
+#include "node.h"
+#include "UserModule.h"
+#include "feature.h"
+#include "printutils.h"
+#include "parallel.h"
+#include "Profiler.h"
+
+#include <deque>
+#include <exception>
+#include <string>
+
+namespace ParallelInstantiation
+{
+	const size_t MIN_PARTS = 8;
+
+	bool enabled(size_t n)
+	{
+		if (!Feature::ExperimentalParallelInstantiation.is_enabled() || in_parallel_worker()) return false;
+		// The profiler records nested frames of a single thread
+		if (Profiler::instance()->isEnabled()) return false;
+		// Too few parts don't pay for distributing them. The cutoff doesn't
+		// depend on the number of cores, so any machine takes the same path.
+		return n >= MIN_PARTS && parallel_thread_count() > 1;
+	}
+
+	namespace {
+		struct Part {
+			std::vector<AbstractNode*> nodes;
+			PrintCapture output;
+			std::exception_ptr error;
+		};
+	}
+
+	void instantiate(size_t n, const Context *parent,
+									 const std::function<void(size_t, Context &, std::vector<AbstractNode*> &)> &fn,
+									 std::vector<AbstractNode*> &children)
+	{
+		std::vector<Part> parts(n);
+		const std::deque<std::string> modulestack = UserModule::getModuleStack();
+		const size_t firstindex = AbstractNode::getIndexCounter();
+
+		parallel_for(n, [&](size_t i) {
+			Part &part = parts[i];
+			part.output.start();
+			const std::deque<std::string> outerstack = UserModule::getModuleStack();
+			UserModule::setModuleStack(modulestack);
+			try {
+				Context c(parent, Context::Fork());
+				fn(i, c, part.nodes);
+			}
+			catch (...) {
+				part.error = std::current_exception();
+			}
+			UserModule::setModuleStack(outerstack);
+			part.output.stop();
+		});
+
+		// Number the nodes as if the parts were instantiated in order
+		AbstractNode::resetIndexCounter(firstindex);
+		for (size_t i = 0; i < n; i++) {
+			parts[i].output.replay();
+			if (parts[i].error) {
+				for (size_t j = i; j < n; j++) {
+					for (auto node : parts[j].nodes) delete node;
+				}
+				std::rethrow_exception(parts[i].error);
+			}
+			for (auto node : parts[i].nodes) {
+				node->reindex();
+				children.push_back(node);
+			}
+		}
+	}
+}
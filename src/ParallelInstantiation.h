@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+class Context;
+class AbstractNode;
+
+/*!
+	Instantiates independent parts of a tree, e.g. for() iterations or the
+	children of a scope, on all available cores.
+
+	The result is identical to instantiating the parts in order: nodes are
+	appended and numbered in part order, and echo() output and warnings are
+	printed in part order once all parts are done.
+*/
+namespace ParallelInstantiation
+{
+	// Returns true if n parts should be instantiated in parallel. Always false while profiling.
+	bool enabled(size_t n);
+
+	/*!
+		Calls fn(i, ctx, nodes) for all parts i in [0, n) and appends the nodes
+		to children. ctx is a child context of parent, owned by the calling thread.
+		If a part throws, the nodes of earlier parts are appended and the
+		exception is rethrown.
+	*/
+	void instantiate(size_t n, const Context *parent,
+									 const std::function<void(size_t, Context &, std::vector<AbstractNode*> &)> &fn,
+									 std::vector<AbstractNode*> &children);
+}
@@ -1,5 +1,8 @@
 #include "Polygon2d.h"
 #include "printutils.h"
+#include "clipper-utils.h"
+
+#include <mutex>
 
 /*!
 	Class for holding 2D geometry.
@@ -14,12 +17,79 @@
 	for positive outlines and clockwise for holes. Sanitization is typically 
 	done by ClipperUtils, but if you create geometry which you know is sanitized, 
 	the flag can be set manually.
+
+	Polygons created by ClipperUtils keep the integer Clipper paths as their
+	native representation, so chained 2D operations can use them directly
+	instead of converting to and from double precision outlines at each step.
+	The outlines are only created when first accessed, e.g. for extrusion,
+	export or rendering. Modifying the polygon drops the Clipper paths.
 */
 
+struct Polygon2d::ClipperData {
+	ClipperPaths paths;
+	std::vector<bool> positive;
+	Outlines2d outlines;
+	std::once_flag converted;
+};
+
+Polygon2d::Polygon2d(const ClipperPaths &paths, const std::vector<bool> &positive)
+	: sanitized(true), clipperdata(new ClipperData)
+{
+	this->clipperdata->paths = paths;
+	this->clipperdata->positive = positive;
+}
+
+const Polygon2d::ClipperPaths *Polygon2d::clipperPaths() const
+{
+	return this->clipperdata ? &this->clipperdata->paths : NULL;
+}
+
+/*!
+	Returns the outlines, converting them from the Clipper paths if necessary.
+	Safe to call from multiple threads.
+*/
+const Polygon2d::Outlines2d &Polygon2d::outlines() const
+{
+	if (!this->clipperdata) return this->theoutlines;
+
+	ClipperData &data = *this->clipperdata;
+	std::call_once(data.converted, [&data]() {
+			data.outlines.resize(data.paths.size());
+			for (size_t i = 0; i < data.paths.size(); i++) {
+				Outline2d &outline = data.outlines[i];
+				outline.positive = data.positive[i];
+				outline.vertices.reserve(data.paths[i].size());
+				for (const auto &ip : data.paths[i]) {
+					outline.vertices.push_back(Vector2d(1.0*ip.X/ClipperUtils::CLIPPER_SCALE,
+																							1.0*ip.Y/ClipperUtils::CLIPPER_SCALE));
+				}
+			}
+		});
+	return data.outlines;
+}
+
+/*!
+	Makes the outlines the only representation, before they are modified.
+*/
+void Polygon2d::detachClipperPaths()
+{
+	if (this->clipperdata) {
+		this->theoutlines = outlines();
+		this->clipperdata.reset();
+	}
+}
+
 size_t Polygon2d::memsize() const
 {
 	size_t mem = 0;
-	for(const auto &o : this->outlines()) {
+	if (this->clipperdata) {
+		// Count the outlines as well, as they're created on demand
+		for(const auto &p : this->clipperdata->paths) {
+			mem += p.size() * (sizeof(ClipperLib::IntPoint) + sizeof(Vector2d)) + sizeof(p) + sizeof(Outline2d);
+		}
+		mem += sizeof(ClipperData);
+	}
+	for(const auto &o : this->theoutlines) {
 		mem += o.vertices.size() * sizeof(Vector2d) + sizeof(Outline2d);
 	}
 	mem += sizeof(Polygon2d);
@@ -29,6 +99,14 @@ size_t Polygon2d::memsize() const
 BoundingBox Polygon2d::getBoundingBox() const
 {
 	BoundingBox bbox;
+	if (this->clipperdata) {
+		for(const auto &p : this->clipperdata->paths) {
+			for(const auto &ip : p) {
+				bbox.extend(Vector3d(1.0*ip.X/ClipperUtils::CLIPPER_SCALE, 1.0*ip.Y/ClipperUtils::CLIPPER_SCALE, 0));
+			}
+		}
+		return bbox;
+	}
 	for(const auto &o : this->outlines()) {
 		for(const auto &v : o.vertices) {
 			bbox.extend(Vector3d(v[0], v[1], 0));
@@ -40,7 +118,7 @@ BoundingBox Polygon2d::getBoundingBox() const
 std::string Polygon2d::dump() const
 {
 	std::stringstream out;
-	for(const auto &o : this->theoutlines) {
+	for(const auto &o : this->outlines()) {
 		out << "contour:\n";
 		for(const auto &v : o.vertices) {
 			out << "  " << v.transpose();
@@ -52,11 +130,12 @@ std::string Polygon2d::dump() const
 
 bool Polygon2d::isEmpty() const
 {
-	return this->theoutlines.empty();
+	return this->clipperdata ? this->clipperdata->paths.empty() : this->theoutlines.empty();
 }
 
 void Polygon2d::transform(const Transform2d &mat)
 {
+	detachClipperPaths();
 	if (mat.matrix().determinant() == 0) {
 		PRINT("WARNING: Scaling a 2D object with 0 - removing object");
 		this->theoutlines.clear();
@@ -95,10 +174,11 @@ void Polygon2d::resize(const Vector2d &newsize, const Eigen::Matrix<bool,2,1> &a
 }
 
 bool Polygon2d::is_convex() const {
-	if (theoutlines.size() > 1) return false;
-	if (theoutlines.empty()) return true;
+	const Outlines2d &outlines = this->outlines();
+	if (outlines.size() > 1) return false;
+	if (outlines.empty()) return true;
 
-	std::vector<Vector2d> const& pts = theoutlines[0].vertices;
+	std::vector<Vector2d> const& pts = outlines[0].vertices;
 	int N = pts.size();
 
 	// Check for a right turn. This assumes the polygon is simple.
@@ -2,8 +2,11 @@
 
 #include "Geometry.h"
 #include "linalg.h"
+#include "memory.h"
 #include <vector>
 
+namespace ClipperLib { struct IntPoint; }
+
 /*!
 	A single contour.
 	positive is (optionally) used to distinguish between polygon contours and hold contours.
@@ -17,7 +20,10 @@ struct Outline2d {
 class Polygon2d : public Geometry
 {
 public:
+	typedef std::vector<std::vector<ClipperLib::IntPoint>> ClipperPaths;
+
 	Polygon2d() : sanitized(false) {}
+	Polygon2d(const ClipperPaths &paths, const std::vector<bool> &positive);
 	virtual size_t memsize() const;
 	virtual BoundingBox getBoundingBox() const;
 	virtual std::string dump() const;
@@ -25,11 +31,12 @@ public:
 	virtual bool isEmpty() const;
 	virtual Geometry *copy() const { return new Polygon2d(*this); }
 
-	void addOutline(const Outline2d &outline) { this->theoutlines.push_back(outline); }
+	void addOutline(const Outline2d &outline) { detachClipperPaths(); this->theoutlines.push_back(outline); }
 	class PolySet *tessellate() const;
 
 	typedef std::vector<Outline2d> Outlines2d;
-	const Outlines2d &outlines() const { return theoutlines; }
+	const Outlines2d &outlines() const;
+	const ClipperPaths *clipperPaths() const;
 
 	void transform(const Transform2d &mat);
 	void resize(const Vector2d &newsize, const Eigen::Matrix<bool,2,1> &autosize);
@@ -38,6 +45,12 @@ public:
 	void setSanitized(bool s) { this->sanitized = s; }
 	bool is_convex() const;
 private:
+	void detachClipperPaths();
+
 	Outlines2d theoutlines;
 	bool sanitized;
+
+	// Native representation of polygons created by ClipperUtils, shared between copies
+	struct ClipperData;
+	shared_ptr<ClipperData> clipperdata;
 };
@@ -160,6 +160,7 @@ void Preferences::init() {
 	this->defaultmap["advanced/cgalCacheSize"] = uint(CGALCache::instance()->maxSize());
 #endif
 	this->defaultmap["advanced/openCSGLimit"] = RenderSettings::inst()->openCSGTermLimit;
+	this->defaultmap["advanced/previewLodFaces"] = RenderSettings::inst()->previewLodFaces;
 	this->defaultmap["advanced/forceGoldfeather"] = false;
 	this->defaultmap["advanced/mdi"] = true;
 	this->defaultmap["advanced/undockableWindows"] = false;
@@ -197,6 +198,7 @@ void Preferences::init() {
 #endif
 	this->polysetCacheSizeEdit->setValidator(validator);
 	this->opencsgLimitEdit->setValidator(validator);
+	this->previewLodEdit->setValidator(validator);
 
 	initComboBox(this->comboBoxIndentUsing, Settings::Settings::indentStyle);
 	initComboBox(this->comboBoxLineWrap, Settings::Settings::lineWrap);
@@ -439,6 +441,7 @@ void Preferences::on_cgalCacheSizeEdit_textChanged(const QString &text)
 #ifdef ENABLE_CGAL
 	CGALCache::instance()->setMaxSize(text.toULong());
 #endif
+	updateCacheBudget();
 }
 
 void Preferences::on_polysetCacheSizeEdit_textChanged(const QString &text)
@@ -446,6 +449,21 @@ void Preferences::on_polysetCacheSizeEdit_textChanged(const QString &text)
 	QSettings settings;
 	settings.setValue("advanced/polysetCacheSize", text);
 	GeometryCache::instance()->setMaxSize(text.toULong());
+	updateCacheBudget();
+}
+
+/*!
+	Sets the memory budget shared by the geometry caches to the sum of the
+	limits of the individual caches, so their total never exceeds the sizes
+	given in the preferences.
+*/
+void Preferences::updateCacheBudget()
+{
+	size_t budget = GeometryCache::instance()->maxSize();
+#ifdef ENABLE_CGAL
+	budget += CGALCache::instance()->maxSize();
+#endif
+	CacheBudget::global()->setMaxCost(budget);
 }
 
 void Preferences::on_opencsgLimitEdit_textChanged(const QString &text)
@@ -455,6 +473,13 @@ void Preferences::on_opencsgLimitEdit_textChanged(const QString &text)
 	// FIXME: Set this globally?
 }
 
+void Preferences::on_previewLodEdit_textChanged(const QString &text)
+{
+	QSettings settings;
+	settings.setValue("advanced/previewLodFaces", text);
+	RenderSettings::inst()->previewLodFaces = text.toUInt();
+}
+
 void Preferences::on_localizationCheckBox_toggled(bool state)
 {
 	QSettings settings;
@@ -673,6 +698,7 @@ void Preferences::updateGUI()
 	this->cgalCacheSizeEdit->setText(getValue("advanced/cgalCacheSize").toString());
 	this->polysetCacheSizeEdit->setText(getValue("advanced/polysetCacheSize").toString());
 	this->opencsgLimitEdit->setText(getValue("advanced/openCSGLimit").toString());
+	this->previewLodEdit->setText(getValue("advanced/previewLodFaces").toString());
 	this->localizationCheckBox->setChecked(getValue("advanced/localization").toBool());
 	this->forceGoldfeatherBox->setChecked(getValue("advanced/forceGoldfeather").toBool());
 	this->mdiCheckBox->setChecked(getValue("advanced/mdi").toBool());
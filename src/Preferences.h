@@ -21,6 +21,7 @@ public:
 	void init();
 	void apply() const;
 	void fireEditorConfigChanged() const;
+	static void updateCacheBudget();
 
 public slots:
 	void actionTriggered(class QAction *);
@@ -34,6 +35,7 @@ public slots:
 	void on_cgalCacheSizeEdit_textChanged(const QString &);
 	void on_polysetCacheSizeEdit_textChanged(const QString &);
 	void on_opencsgLimitEdit_textChanged(const QString &);
+	void on_previewLodEdit_textChanged(const QString &);
 	void on_forceGoldfeatherBox_toggled(bool);
 	void on_mouseWheelZoomBox_toggled(bool);
 	void on_localizationCheckBox_toggled(bool);
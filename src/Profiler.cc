@@ -0,0 +1,191 @@
+#include "Profiler.h"
+#include "ModuleInstantiation.h"
+
+#include <map>
+#include <tuple>
+#include <sstream>
+#include <boost/format.hpp>
+
+Profiler *Profiler::inst = NULL;
+
+static const char *stage_name(Profiler::Stage stage)
+{
+	return stage == Profiler::INSTANTIATION ? "instantiation" : "geometry";
+}
+
+static std::string json_escape(const std::string &str)
+{
+	std::string out;
+	out.reserve(str.size());
+	for (const auto &c : str) {
+		switch (c) {
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20) out += boost::str(boost::format("\\u%04x") % int(c));
+			else out += c;
+		}
+	}
+	return out;
+}
+
+void Profiler::clear()
+{
+	this->framestack.clear();
+	this->allentries.clear();
+	this->allphases.clear();
+}
+
+/*!
+	Adds time to the given phase. Phases are reported in the order they
+	were first recorded.
+*/
+void Profiler::addPhase(const std::string &name, double wall, double cpu)
+{
+	for (auto &phase : this->allphases) {
+		if (phase.name == name) {
+			phase.wall += wall;
+			phase.cpu += cpu;
+			return;
+		}
+	}
+	Phase phase = {name, wall, cpu};
+	this->allphases.push_back(phase);
+}
+
+void Profiler::begin(Stage stage, const ModuleInstantiation *modinst)
+{
+	Frame frame;
+	frame.stage = stage;
+	frame.name = modinst ? modinst->name() : std::string("<root>");
+	frame.line = modinst ? modinst->location().firstLine() : 0;
+	frame.column = modinst ? modinst->location().firstColumn() : 0;
+
+	// Collapsed stack frames must not contain the separator or the trailing
+	// count delimiter
+	std::string label = frame.name;
+	for (auto &c : label) if (c == ';' || c == ' ') c = '_';
+	if (frame.line > 0) label += ":" + std::to_string(frame.line);
+	if (this->framestack.empty() || this->framestack.back().stage != stage) {
+		frame.stack = std::string(stage_name(stage)) + ";" + label;
+	}
+	else {
+		frame.stack = this->framestack.back().stack + ";" + label;
+	}
+
+	frame.childwall = 0;
+	frame.childcpu = 0;
+	frame.invertices = 0;
+	frame.cpustart = std::clock();
+	frame.wallstart = wallclock::now();
+	this->framestack.push_back(frame);
+}
+
+void Profiler::end(int cachehit, size_t outvertices, size_t memsize)
+{
+	if (this->framestack.empty()) return;
+	wallclock::time_point wallend = wallclock::now();
+	std::clock_t cpuend = std::clock();
+
+	const Frame &frame = this->framestack.back();
+	Entry entry;
+	entry.stage = frame.stage;
+	entry.name = frame.name;
+	entry.line = frame.line;
+	entry.column = frame.column;
+	entry.stack = frame.stack;
+	entry.wall = std::chrono::duration<double>(wallend - frame.wallstart).count();
+	entry.cpu = double(cpuend - frame.cpustart) / CLOCKS_PER_SEC;
+	entry.selfwall = std::max(0.0, entry.wall - frame.childwall);
+	entry.selfcpu = std::max(0.0, entry.cpu - frame.childcpu);
+	entry.cachehit = cachehit;
+	entry.invertices = frame.invertices;
+	entry.outvertices = outvertices;
+	entry.memsize = memsize;
+	this->framestack.pop_back();
+
+	if (!this->framestack.empty()) {
+		Frame &parent = this->framestack.back();
+		if (parent.stage == entry.stage) {
+			parent.childwall += entry.wall;
+			parent.childcpu += entry.cpu;
+			parent.invertices += entry.outvertices;
+		}
+	}
+	this->allentries.push_back(entry);
+}
+
+/*!
+	Writes the phase totals and all recorded entries, followed by a per-module
+	summary where entries with the same name and source location are accumulated.
+*/
+void Profiler::exportJSON(std::ostream &output) const
+{
+	output << "{\n  \"phases\": [";
+	bool first = true;
+	for (const auto &phase : this->allphases) {
+		output << (first ? "\n" : ",\n");
+		first = false;
+		output << boost::format("    {\"name\": \"%s\", \"wall\": %.6f, \"cpu\": %.6f}")
+			% json_escape(phase.name) % phase.wall % phase.cpu;
+	}
+	output << "\n  ],\n  \"entries\": [";
+	first = true;
+	for (const auto &e : this->allentries) {
+		output << (first ? "\n" : ",\n");
+		first = false;
+		output << boost::format("    {\"stage\": \"%s\", \"name\": \"%s\", \"line\": %d, \"column\": %d, "
+														"\"stack\": \"%s\", \"wall\": %.6f, \"self_wall\": %.6f, "
+														"\"cpu\": %.6f, \"self_cpu\": %.6f, \"cache\": %s, "
+														"\"vertices_in\": %d, \"vertices_out\": %d, \"memsize\": %d}")
+			% stage_name(e.stage) % json_escape(e.name) % e.line % e.column
+			% json_escape(e.stack) % e.wall % e.selfwall % e.cpu % e.selfcpu
+			% (e.cachehit < 0 ? "null" : e.cachehit ? "\"hit\"" : "\"miss\"")
+			% e.invertices % e.outvertices % e.memsize;
+	}
+	output << "\n  ],\n  \"summary\": [";
+
+	struct Summary {
+		size_t count;
+		size_t cachehits;
+		double selfwall;
+		double selfcpu;
+	};
+	typedef std::tuple<int, std::string, int, int> SummaryKey;
+	std::map<SummaryKey, Summary> summary;
+	for (const auto &e : this->allentries) {
+		Summary &s = summary[SummaryKey(e.stage, e.name, e.line, e.column)];
+		s.count++;
+		if (e.cachehit > 0) s.cachehits++;
+		s.selfwall += e.selfwall;
+		s.selfcpu += e.selfcpu;
+	}
+	first = true;
+	for (const auto &item : summary) {
+		output << (first ? "\n" : ",\n");
+		first = false;
+		output << boost::format("    {\"stage\": \"%s\", \"name\": \"%s\", \"line\": %d, \"column\": %d, "
+														"\"count\": %d, \"cache_hits\": %d, \"self_wall\": %.6f, \"self_cpu\": %.6f}")
+			% stage_name(Stage(std::get<0>(item.first))) % json_escape(std::get<1>(item.first))
+			% std::get<2>(item.first) % std::get<3>(item.first)
+			% item.second.count % item.second.cachehits % item.second.selfwall % item.second.selfcpu;
+	}
+	output << "\n  ]\n}\n";
+}
+
+/*!
+	Writes self wall time in microseconds in the collapsed stack format
+	used by flamegraph.pl and compatible tools: "frame;frame;frame count"
+*/
+void Profiler::exportCollapsed(std::ostream &output) const
+{
+	std::map<std::string, unsigned long> stacks;
+	for (const auto &e : this->allentries) {
+		stacks[e.stack] += (unsigned long)(e.selfwall * 1e6 + 0.5);
+	}
+	for (const auto &item : stacks) {
+		if (item.second > 0) output << item.first << " " << item.second << "\n";
+	}
+}
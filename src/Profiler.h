@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <ctime>
+
+/*!
+	Collects per-node timing information for module instantiation and
+	geometry evaluation.
+
+	Each recorded entry corresponds to one ModuleInstantiation (instantiation
+	stage) or one AbstractNode (geometry stage) and carries the source location
+	of the ModuleInstantiation which created it.
+
+	The profiler is disabled by default. When disabled, all begin/end calls
+	are no-ops, so instrumented code paths only pay for a flag check.
+ */
+class Profiler
+{
+public:
+	enum Stage { INSTANTIATION, GEOMETRY };
+	typedef std::chrono::steady_clock wallclock;
+
+	struct Entry {
+		Stage stage;
+		std::string name;
+		int line;
+		int column;
+		std::string stack;      // Collapsed call stack, frames separated by ';'
+		double wall;            // Total wall time (seconds), including children
+		double selfwall;        // Wall time excluding children
+		double cpu;             // Total CPU time (seconds), including children
+		double selfcpu;         // CPU time excluding children
+		int cachehit;           // 1 = hit, 0 = miss, -1 = not applicable
+		size_t invertices;      // Sum of output vertices of all children
+		size_t outvertices;
+		size_t memsize;         // Size of resulting geometry in bytes
+	};
+
+	static Profiler *instance() { if (!inst) inst = new Profiler; return inst; }
+
+	bool isEnabled() const { return this->enabled; }
+	void setEnabled(bool on) { this->enabled = on; }
+	void clear();
+
+	void begin(Stage stage, const class ModuleInstantiation *modinst);
+	void end(int cachehit = -1, size_t outvertices = 0, size_t memsize = 0);
+
+	/*!
+		Accumulated time of a top-level processing phase, e.g. parsing
+		or export. Phases may overlap with recorded entries.
+	 */
+	struct Phase {
+		std::string name;
+		double wall;
+		double cpu;
+	};
+
+	const std::vector<Entry> &entries() const { return this->allentries; }
+	const std::vector<Phase> &phases() const { return this->allphases; }
+	void addPhase(const std::string &name, double wall, double cpu);
+
+	void exportJSON(std::ostream &output) const;
+	void exportCollapsed(std::ostream &output) const;
+
+	/*!
+		Begins a profiling frame on construction and ends it on destruction,
+		so frames are closed correctly when exceptions propagate.
+		The result statistics can be filled in before the scope ends.
+	 */
+	class Scope {
+	public:
+		Scope(Stage stage, const class ModuleInstantiation *modinst)
+			: active(Profiler::instance()->isEnabled()), cachehit(-1), outvertices(0), memsize(0) {
+			if (this->active) Profiler::instance()->begin(stage, modinst);
+		}
+		~Scope() {
+			if (this->active) Profiler::instance()->end(this->cachehit, this->outvertices, this->memsize);
+		}
+		bool isActive() const { return this->active; }
+
+		bool active;
+		int cachehit;
+		size_t outvertices;
+		size_t memsize;
+	};
+
+	/*!
+		Measures a processing phase for the lifetime of the object.
+	 */
+	class PhaseScope {
+	public:
+		PhaseScope(const std::string &name)
+			: active(Profiler::instance()->isEnabled()), name(name) {
+			if (this->active) {
+				this->cpustart = std::clock();
+				this->wallstart = wallclock::now();
+			}
+		}
+		~PhaseScope() {
+			if (this->active) {
+				Profiler::instance()->addPhase(this->name,
+																			 std::chrono::duration<double>(wallclock::now() - this->wallstart).count(),
+																			 double(std::clock() - this->cpustart) / CLOCKS_PER_SEC);
+			}
+		}
+	private:
+		bool active;
+		std::string name;
+		wallclock::time_point wallstart;
+		std::clock_t cpustart;
+	};
+
+private:
+	Profiler() : enabled(false) {}
+
+	struct Frame {
+		Stage stage;
+		std::string name;
+		int line;
+		int column;
+		std::string stack;
+		wallclock::time_point wallstart;
+		std::clock_t cpustart;
+		double childwall;
+		double childcpu;
+		size_t invertices;
+	};
+
+	static Profiler *inst;
+
+	bool enabled;
+	std::vector<Frame> framestack;
+	std::vector<Entry> allentries;
+	std::vector<Phase> allphases;
+};
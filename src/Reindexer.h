@@ -1,10 +1,10 @@
 #pragma once
 
-#include <unordered_map>
 #include <functional>
 #include <vector>
 #include <algorithm>
 #include "hash.h"
+#include "FlatHashMap.h"
 
 /*!
   Reindexes a collection of elements of type T.
@@ -21,43 +21,41 @@ public:
     Looks up a value. Will insert the value if it doesn't already exist.
     Returns the new index. */
   int lookup(const T &val) {
-    typename std::unordered_map<T, int>::const_iterator iter = this->map.find(val);
-    if (iter != this->map.end()) return iter->second;
-    else {
-      this->map.insert(std::make_pair(val, this->map.size()));
-      return this->map.size() - 1;
-    }
+    int idx = this->map.insert(val, this->vec.size());
+    if (idx == int(this->vec.size())) this->vec.push_back(val);
+    return idx;
+  }
+
+  /*!
+    Makes room for n elements.
+  */
+  void reserve(std::size_t n) {
+    this->map.reserve(n);
+    this->vec.reserve(n);
   }
 
   /*!
     Returns the current size of the new element array
   */
   std::size_t size() const {
-    return this->map.size();
+    return this->vec.size();
   }
 
   /*!
     Return the new element array.
   */
   const T *getArray() {
-    this->vec.resize(this->map.size());
-    typename std::unordered_map<T, int>::const_iterator iter = this->map.begin();
-    while (iter != this->map.end()) {
-      this->vec[iter->second] = iter->first;
-      iter++;
-    }
-    return &this->vec[0];
+    return this->vec.data();
   }
 
   /*!
     Copies the internal vector to the given destination
   */
   template <class OutputIterator> void copy(OutputIterator dest) {
-    this->getArray();
     std::copy(this->vec.begin(), this->vec.end(), dest);
   }
 
 private:
-  std::unordered_map<T, int> map;
+  FlatHashMap<T> map;
   std::vector<T> vec;
 };
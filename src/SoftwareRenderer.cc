@@ -0,0 +1,520 @@
+/*
+ *  OpenSCAD (www.openscad.org)
+ *  Copyright (C) 2009-2011 Clifford Wolf <clifford@clifford.at> and
+ *                          Marius Kintel <marius@kintel.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  As a special exception, you have permission to link this program
+ *  with the CGAL library and distribute executables, as long as you
+ *  follow the requirements of the GNU GPL in regard to all of the
+ *  software in the executable aside from CGAL.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "SoftwareRenderer.h"
+#include "polyset.h"
+#include "polyset-utils.h"
+#include "Polygon2d.h"
+#include "csgnode.h"
+#include "imageutils.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <set>
+
+namespace {
+	// Rows per band; bands are the unit of work for the rasterizer threads
+	const unsigned int BAND_HEIGHT = 16;
+	// Depth tolerance for drawing edges on top of their own faces
+	const float EDGE_DEPTH_BIAS = 1e-5f;
+
+	// The matrices below are the ones set up by gluPerspective(), glOrtho(),
+	// gluLookAt() and glRotated()
+	Matrix4d perspective(double fovy, double aspect, double znear, double zfar)
+	{
+		double f = 1.0 / tan(fovy / 2 * M_PI / 180);
+		Matrix4d m = Matrix4d::Zero();
+		m(0, 0) = f / aspect;
+		m(1, 1) = f;
+		m(2, 2) = (zfar + znear) / (znear - zfar);
+		m(2, 3) = 2 * zfar * znear / (znear - zfar);
+		m(3, 2) = -1;
+		return m;
+	}
+
+	Matrix4d ortho(double left, double right, double bottom, double top, double znear, double zfar)
+	{
+		Matrix4d m = Matrix4d::Identity();
+		m(0, 0) = 2 / (right - left);
+		m(1, 1) = 2 / (top - bottom);
+		m(2, 2) = -2 / (zfar - znear);
+		m(0, 3) = -(right + left) / (right - left);
+		m(1, 3) = -(top + bottom) / (top - bottom);
+		m(2, 3) = -(zfar + znear) / (zfar - znear);
+		return m;
+	}
+
+	Matrix4d lookAt(const Vector3d &eye, const Vector3d &center, const Vector3d &up)
+	{
+		Vector3d f = (center - eye).normalized();
+		Vector3d s = f.cross(up).normalized();
+		Vector3d u = s.cross(f);
+		Matrix4d m = Matrix4d::Identity();
+		m.block<1, 3>(0, 0) = s.transpose();
+		m.block<1, 3>(1, 0) = u.transpose();
+		m.block<1, 3>(2, 0) = -f.transpose();
+		m(0, 3) = -s.dot(eye);
+		m(1, 3) = -u.dot(eye);
+		m(2, 3) = f.dot(eye);
+		return m;
+	}
+
+	Matrix4d rotate(double angle, const Vector3d &axis)
+	{
+		Transform3d t(Eigen::AngleAxisd(angle * M_PI / 180, axis));
+		return t.matrix();
+	}
+
+	// Same as GLView::setupCamera(), including the object translation of paintGL()
+	void setupCamera(Camera cam, double aspectratio, Matrix4d &projection, Matrix4d &modelview)
+	{
+		double dist = cam.type == Camera::VECTOR ? (cam.center - cam.eye).norm() : cam.zoomValue();
+		if (cam.projection == Camera::PERSPECTIVE) {
+			projection = perspective(cam.fov, aspectratio, 0.1*dist, 100*dist);
+		}
+		else {
+			double height = dist * tan(cam.fov/2*M_PI/180);
+			projection = ortho(-height*aspectratio, height*aspectratio, -height, height, -100*dist, +100*dist);
+		}
+
+		if (cam.type == Camera::VECTOR) {
+			Vector3d dir(cam.eye - cam.center);
+			Vector3d up(0.0, 0.0, 1.0);
+			if (dir.cross(up).norm() < 0.001) { // View direction is ~parallel with up vector
+				up << 0.0, 1.0, 0.0;
+			}
+			modelview = lookAt(cam.eye, cam.center, up);
+		}
+		else {
+			modelview = lookAt(Vector3d(0.0, -dist, 0.0), Vector3d::Zero(), Vector3d(0.0, 0.0, 1.0)) *
+				rotate(cam.object_rot.x(), Vector3d::UnitX()) *
+				rotate(cam.object_rot.y(), Vector3d::UnitY()) *
+				rotate(cam.object_rot.z(), Vector3d::UnitZ());
+			Transform3d t(Eigen::Translation3d(cam.object_trans));
+			modelview = modelview * t.matrix();
+		}
+	}
+
+	// A vertex in window coordinates: x to the right, y down, depth in [0,1]
+	struct ScreenVertex {
+		double x, y, z;
+	};
+
+	struct ScreenTriangle {
+		ScreenVertex v[3];
+		uint8_t rgba[4];
+	};
+
+	struct ScreenEdge {
+		ScreenVertex v[2];
+		uint8_t rgba[4];
+	};
+
+	void toRgba(const Color4f &c, uint8_t rgba[4])
+	{
+		for (int i = 0; i < 4; i++) {
+			rgba[i] = uint8_t(std::lround(std::min(1.0f, std::max(0.0f, c[i])) * 255));
+		}
+	}
+
+	// Clips a polygon given in clip coordinates to the near plane
+	std::vector<Eigen::Vector4d> clipNear(const std::vector<Eigen::Vector4d> &in)
+	{
+		std::vector<Eigen::Vector4d> out;
+		for (size_t i = 0; i < in.size(); i++) {
+			const Eigen::Vector4d &a = in[i];
+			const Eigen::Vector4d &b = in[(i + 1) % in.size()];
+			double da = a[2] + a[3], db = b[2] + b[3];
+			if (da >= 0) out.push_back(a);
+			if ((da >= 0) != (db >= 0)) out.push_back(a + (b - a) * (da / (da - db)));
+		}
+		return out;
+	}
+
+	// Clips a segment to the given rectangle, returns false if nothing is left
+	bool clipSegment(ScreenVertex &a, ScreenVertex &b, double xmin, double xmax, double ymin, double ymax)
+	{
+		double t0 = 0, t1 = 1;
+		const double dx = b.x - a.x, dy = b.y - a.y;
+		const double p[4] = {-dx, dx, -dy, dy};
+		const double q[4] = {a.x - xmin, xmax - a.x, a.y - ymin, ymax - a.y};
+		for (int i = 0; i < 4; i++) {
+			if (p[i] == 0) {
+				if (q[i] < 0) return false;
+				continue;
+			}
+			double r = q[i] / p[i];
+			if (p[i] < 0) t0 = std::max(t0, r);
+			else t1 = std::min(t1, r);
+		}
+		if (t0 > t1) return false;
+		const ScreenVertex start = a;
+		a.x = start.x + t0 * dx, a.y = start.y + t0 * dy, a.z = start.z + t0 * (b.z - start.z);
+		b.x = start.x + t1 * dx, b.y = start.y + t1 * dy, b.z = start.z + t1 * (b.z - start.z);
+		return true;
+	}
+
+	class Rasterizer
+	{
+	public:
+		Rasterizer(unsigned int width, unsigned int height, const Matrix4d &mvp)
+			: width(width), height(height), mvp(mvp) {}
+
+		bool project(const Vector3d &p, Eigen::Vector4d &clip) const {
+			clip = mvp * Eigen::Vector4d(p[0], p[1], p[2], 1.0);
+			return clip[2] + clip[3] >= 0;
+		}
+
+		ScreenVertex toWindow(const Eigen::Vector4d &clip) const {
+			ScreenVertex v;
+			v.x = (clip[0] / clip[3] * 0.5 + 0.5) * this->width;
+			v.y = (0.5 - clip[1] / clip[3] * 0.5) * this->height;
+			v.z = clip[2] / clip[3] * 0.5 + 0.5;
+			return v;
+		}
+
+		void rasterize(const ScreenTriangle &t, unsigned int y0, unsigned int y1,
+									 uint8_t *pixels, float *depth) const;
+		void rasterize(const ScreenEdge &e, unsigned int y0, unsigned int y1,
+									 uint8_t *pixels, float *depth) const;
+
+		unsigned int width;
+		unsigned int height;
+		Matrix4d mvp;
+	};
+
+	void blend(uint8_t *dst, const uint8_t *src)
+	{
+		if (src[3] == 255) {
+			dst[0] = src[0], dst[1] = src[1], dst[2] = src[2];
+			return;
+		}
+		unsigned int a = src[3];
+		for (int i = 0; i < 3; i++) dst[i] = uint8_t((src[i] * a + dst[i] * (255 - a) + 127) / 255);
+	}
+
+	void Rasterizer::rasterize(const ScreenTriangle &t, unsigned int y0, unsigned int y1,
+														 uint8_t *pixels, float *depth) const
+	{
+		const ScreenVertex &a = t.v[0], &b = t.v[1], &c = t.v[2];
+		double area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+		if (area == 0) return;
+		double sign = area < 0 ? -1 : 1;
+
+		int xmin = std::max(0, int(std::floor(std::min({a.x, b.x, c.x}))));
+		int xmax = std::min(int(this->width) - 1, int(std::ceil(std::max({a.x, b.x, c.x}))));
+		int ymin = std::max(int(y0), int(std::floor(std::min({a.y, b.y, c.y}))));
+		int ymax = std::min(int(y1) - 1, int(std::ceil(std::max({a.y, b.y, c.y}))));
+
+		for (int y = ymin; y <= ymax; y++) {
+			double py = y + 0.5;
+			for (int x = xmin; x <= xmax; x++) {
+				double px = x + 0.5;
+				double w0 = sign * ((b.x - px) * (c.y - py) - (c.x - px) * (b.y - py));
+				double w1 = sign * ((c.x - px) * (a.y - py) - (a.x - px) * (c.y - py));
+				double w2 = sign * ((a.x - px) * (b.y - py) - (b.x - px) * (a.y - py));
+				if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+				float z = float((w0 * a.z + w1 * b.z + w2 * c.z) / (sign * area));
+				if (z > 1) continue;
+				size_t idx = size_t(y) * this->width + x;
+				if (z < depth[idx]) {
+					depth[idx] = z;
+					blend(&pixels[idx * 4], t.rgba);
+				}
+			}
+		}
+	}
+
+	void Rasterizer::rasterize(const ScreenEdge &e, unsigned int y0, unsigned int y1,
+														 uint8_t *pixels, float *depth) const
+	{
+		const ScreenVertex &a = e.v[0], &b = e.v[1];
+		double dx = b.x - a.x, dy = b.y - a.y;
+		bool steep = std::abs(dy) > std::abs(dx);
+		size_t steps = size_t(std::ceil(std::max(std::abs(dx), std::abs(dy)))) + 1;
+		// Lines are two pixels wide, like the glLineWidth(2) of the OpenGL views
+		for (size_t i = 0; i < steps; i++) {
+			double t = steps > 1 ? double(i) / (steps - 1) : 0;
+			int x = int(std::floor(a.x + t * dx)), y = int(std::floor(a.y + t * dy));
+			if (y + 1 < int(y0) || y >= int(y1)) continue;
+			float z = float(a.z + t * (b.z - a.z));
+			if (z > 1) continue;
+			for (int k = 0; k < 2; k++) {
+				int px = steep ? x + k : x, py = steep ? y : y + k;
+				if (px < 0 || px >= int(this->width) || py < int(y0) || py >= int(y1)) continue;
+				size_t idx = size_t(py) * this->width + px;
+				if (z - EDGE_DEPTH_BIAS <= depth[idx]) {
+					depth[idx] = std::min(depth[idx], z);
+					blend(&pixels[idx * 4], e.rgba);
+				}
+			}
+		}
+	}
+}
+
+SoftwareRenderer::SoftwareRenderer(unsigned int width, unsigned int height)
+	: width(std::max(1u, width)), height(std::max(1u, height)),
+		colorscheme(&ColorMap::inst()->defaultColorScheme()), showedges(false)
+{
+}
+
+void SoftwareRenderer::clear()
+{
+	this->triangles.clear();
+	this->edges.clear();
+}
+
+void SoftwareRenderer::addPolygons(const PolySet &ps, const Transform3d &m, const Color4f &color,
+																	 const Color4f &backcolor, const Color4f &edgecolor, bool lit)
+{
+	bool mirrored = m.matrix().determinant() < 0;
+	const PolySet *tris = &ps;
+	PolySet tessellated(3, ps.convexValue());
+	if (ps.getDimension() == 3) {
+		for (const auto &poly : ps.polygons) {
+			if (poly.size() != 3) {
+				PolysetUtils::tessellate_faces(ps, tessellated);
+				tris = &tessellated;
+				break;
+			}
+		}
+	}
+
+	for (const auto &poly : tris->polygons) {
+		// 2D polygons are already triangles, but don't rely on it
+		for (size_t i = 2; i < poly.size(); i++) {
+			Triangle t;
+			t.p[0] = m * poly[0];
+			t.p[1] = m * poly[mirrored ? i : i - 1];
+			t.p[2] = m * poly[mirrored ? i - 1 : i];
+			t.color = color;
+			t.backcolor = backcolor;
+			t.lit = lit;
+			this->triangles.push_back(t);
+		}
+	}
+	for (const auto &poly : ps.polygons) {
+		for (size_t i = 0; i < poly.size(); i++) {
+			Edge e;
+			e.p[0] = m * poly[i];
+			e.p[1] = m * poly[(i + 1) % poly.size()];
+			e.color = edgecolor;
+			this->edges.push_back(e);
+		}
+	}
+}
+
+void SoftwareRenderer::addGeometry(const Geometry &geom, const Transform3d &m,
+																	 const Color4f &color, const Color4f &backcolor, const Color4f &edgecolor)
+{
+	if (const PolySet *ps = dynamic_cast<const PolySet *>(&geom)) {
+		addPolygons(*ps, m, color, backcolor, edgecolor, ps->getDimension() == 3);
+	}
+	else if (const Polygon2d *poly = dynamic_cast<const Polygon2d *>(&geom)) {
+		shared_ptr<PolySet> ps(poly->tessellate());
+		if (ps) addPolygons(*ps, m, color, color, edgecolor, false);
+	}
+}
+
+/*!
+	Uses the colors of ThrownTogetherRenderer: leaves may override the material,
+	cutout and background colors, and faces seen from behind are drawn in magenta
+	for the main products.
+*/
+void SoftwareRenderer::addProducts(const CSGProducts &products, bool highlight_mode, bool background_mode)
+{
+	const Color4f highlight(255, 81, 81, 128), background(180, 180, 180, 128);
+	const Color4f highlight_edges(255, 171, 86, 128), background_edges(150, 150, 150, 128);
+	const Color4f fberror(255, 0, 255);
+	std::set<std::pair<const Geometry *, const Transform3d *>> visited;
+
+	for (const auto &product : products.products) {
+		for (int difference = 0; difference < 2; difference++) {
+			for (const auto &csgobj : difference ? product.subtractions : product.intersections) {
+				if (!csgobj.leaf->geom) continue;
+				if (!visited.insert(std::make_pair(csgobj.leaf->geom.get(), &csgobj.leaf->matrix)).second) continue;
+
+				bool highlighted = (csgobj.flags & CSGNode::FLAG_HIGHLIGHT) != 0;
+				Color4f base, edgecolor;
+				if (highlight_mode) {
+					base = highlight;
+					edgecolor = highlight_edges;
+				}
+				else if (background_mode) {
+					base = highlighted ? highlight : background;
+					edgecolor = background_edges;
+				}
+				else if (difference) {
+					base = highlighted ? highlight : ColorMap::getColor(*this->colorscheme, OPENCSG_FACE_BACK_COLOR);
+					edgecolor = ColorMap::getColor(*this->colorscheme, CGAL_EDGE_BACK_COLOR);
+				}
+				else {
+					base = highlighted ? highlight : ColorMap::getColor(*this->colorscheme, OPENCSG_FACE_FRONT_COLOR);
+					edgecolor = ColorMap::getColor(*this->colorscheme, CGAL_EDGE_FRONT_COLOR);
+				}
+				// Highlights ignore the object color
+				Color4f color = base;
+				if (!highlight_mode && !highlighted) {
+					const Color4f &c = csgobj.leaf->color;
+					for (int i = 0; i < 4; i++) if (c[i] >= 0) color[i] = c[i];
+				}
+				const bool main_products = !highlight_mode && !background_mode;
+				addGeometry(*csgobj.leaf->geom, csgobj.leaf->matrix, color, main_products ? fberror : color, edgecolor);
+			}
+		}
+	}
+}
+
+BoundingBox SoftwareRenderer::getBoundingBox() const
+{
+	BoundingBox bbox;
+	for (const auto &t : this->triangles) {
+		for (int i = 0; i < 3; i++) bbox.extend(t.p[i]);
+	}
+	for (const auto &e : this->edges) {
+		for (int i = 0; i < 2; i++) bbox.extend(e.p[i]);
+	}
+	return bbox;
+}
+
+void SoftwareRenderer::render(const Camera &cam)
+{
+	Matrix4d projection, modelview;
+	setupCamera(cam, double(this->width) / this->height, projection, modelview);
+	const Rasterizer rasterizer(this->width, this->height, projection * modelview);
+	const Matrix3d normalmatrix = modelview.topLeftCorner<3, 3>();
+	// The lights of GLView::initializeGL(), given in eye coordinates
+	const Vector3d light0 = Vector3d(-1.0, -1.0, +1.0).normalized();
+	const Vector3d light1 = Vector3d(+1.0, +1.0, -1.0).normalized();
+
+	std::vector<ScreenTriangle> screentris;
+	screentris.reserve(this->triangles.size());
+	std::vector<Eigen::Vector4d> clip(3);
+	for (const auto &t : this->triangles) {
+		int visible = 0;
+		for (int i = 0; i < 3; i++) visible += rasterizer.project(t.p[i], clip[i]);
+		if (visible == 0) continue;
+		std::vector<Eigen::Vector4d> poly = visible == 3 ? clip : clipNear(clip);
+		std::vector<ScreenVertex> v;
+		for (const auto &p : poly) v.push_back(rasterizer.toWindow(p));
+		if (v.size() < 3) continue;
+
+		// Front faces are counter-clockwise on screen; y points down in window coordinates
+		double area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+		Color4f color = area < 0 ? t.color : t.backcolor;
+		if (t.lit) {
+			// Same normal as gl_draw_triangle(), with the default OpenGL material and ambient light
+			Vector3d n = (normalmatrix * (t.p[1] - t.p[0]).cross(t.p[1] - t.p[2])).normalized();
+			double shade = 0.2 + std::max(0.0, n.dot(light0)) + std::max(0.0, n.dot(light1));
+			for (int i = 0; i < 3; i++) color[i] = float(std::min(1.0, color[i] * shade));
+		}
+
+		ScreenTriangle st;
+		toRgba(color, st.rgba);
+		for (size_t i = 2; i < v.size(); i++) {
+			st.v[0] = v[0];
+			st.v[1] = v[i - 1];
+			st.v[2] = v[i];
+			screentris.push_back(st);
+		}
+	}
+
+	std::vector<ScreenEdge> screenedges;
+	if (this->showedges) {
+		screenedges.reserve(this->edges.size());
+		for (const auto &e : this->edges) {
+			Eigen::Vector4d a, b;
+			bool va = rasterizer.project(e.p[0], a), vb = rasterizer.project(e.p[1], b);
+			if (!va && !vb) continue;
+			if (!va || !vb) {
+				double da = a[2] + a[3], db = b[2] + b[3];
+				Eigen::Vector4d p = a + (b - a) * (da / (da - db));
+				if (!va) a = p;
+				else b = p;
+			}
+			ScreenEdge se;
+			se.v[0] = rasterizer.toWindow(a);
+			se.v[1] = rasterizer.toWindow(b);
+			if (!clipSegment(se.v[0], se.v[1], -1, this->width + 1, -1, this->height + 1)) continue;
+			toRgba(e.color, se.rgba);
+			screenedges.push_back(se);
+		}
+	}
+
+	// Sort the primitives into bands, keeping the drawing order within each band
+	const size_t numbands = (this->height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	std::vector<std::vector<uint32_t>> tribands(numbands), edgebands(numbands);
+	auto bandrange = [&](double ymin, double ymax, size_t &first, size_t &last) {
+		if (!(ymax >= 0 && ymin < this->height)) return false;
+		first = size_t(std::max(0.0, std::floor(ymin) - 1)) / BAND_HEIGHT;
+		last = std::min(numbands - 1, size_t(std::max(0.0, std::ceil(ymax) + 1)) / BAND_HEIGHT);
+		return true;
+	};
+	for (size_t i = 0; i < screentris.size(); i++) {
+		const ScreenTriangle &t = screentris[i];
+		if (std::max({t.v[0].x, t.v[1].x, t.v[2].x}) < 0 ||
+				std::min({t.v[0].x, t.v[1].x, t.v[2].x}) > this->width) continue;
+		size_t first, last;
+		if (bandrange(std::min({t.v[0].y, t.v[1].y, t.v[2].y}), std::max({t.v[0].y, t.v[1].y, t.v[2].y}), first, last)) {
+			for (size_t b = first; b <= last; b++) tribands[b].push_back(uint32_t(i));
+		}
+	}
+	for (size_t i = 0; i < screenedges.size(); i++) {
+		const ScreenEdge &e = screenedges[i];
+		size_t first, last;
+		if (bandrange(std::min(e.v[0].y, e.v[1].y), std::max(e.v[0].y, e.v[1].y), first, last)) {
+			for (size_t b = first; b <= last; b++) edgebands[b].push_back(uint32_t(i));
+		}
+	}
+
+	Color4f bgcol = ColorMap::getColor(*this->colorscheme, BACKGROUND_COLOR);
+	bgcol[3] = 1.0f;
+	uint8_t bg[4];
+	toRgba(bgcol, bg);
+	this->pixels.resize(size_t(this->width) * this->height * 4);
+	this->depth.resize(size_t(this->width) * this->height);
+
+	parallel_for(numbands, [&](size_t b) {
+			unsigned int y0 = b * BAND_HEIGHT, y1 = std::min(this->height, y0 + BAND_HEIGHT);
+			uint8_t *pixels = this->pixels.data();
+			float *depth = this->depth.data();
+			for (size_t i = size_t(y0) * this->width; i < size_t(y1) * this->width; i++) {
+				std::copy(bg, bg + 4, &pixels[i * 4]);
+				depth[i] = std::numeric_limits<float>::max();
+			}
+			for (auto i : tribands[b]) rasterizer.rasterize(screentris[i], y0, y1, pixels, depth);
+			for (auto i : edgebands[b]) rasterizer.rasterize(screenedges[i], y0, y1, pixels, depth);
+		});
+}
+
+bool SoftwareRenderer::save(std::ostream &output)
+{
+	if (this->pixels.empty()) return false;
+	return write_png(output, this->pixels.data(), this->width, this->height);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "linalg.h"
+#include "memory.h"
+#include "colormap.h"
+#include "Camera.h"
+#include <iostream>
+#include <vector>
+
+/*!
+	Renders geometry into an RGBA image on the CPU, without an OpenGL context.
+
+	Triangles are z-buffered and lit like the OpenGL views, with optional edge
+	overlay. The image is split into bands of rows which are rasterized on all
+	available cores.
+
+	Geometry is added once in world coordinates, so the same scene can be
+	rendered from several cameras.
+*/
+class SoftwareRenderer
+{
+public:
+	SoftwareRenderer(unsigned int width, unsigned int height);
+
+	void setColorScheme(const ColorScheme &cs) { this->colorscheme = &cs; }
+	const ColorScheme &getColorScheme() const { return *this->colorscheme; }
+	void setShowEdges(bool showedges) { this->showedges = showedges; }
+
+	/*!
+		Adds the surface of geom, transformed by m. Faces seen from the front are
+		drawn in color, faces seen from behind in backcolor. 2D geometry is drawn
+		flat and unlit.
+	*/
+	void addGeometry(const class Geometry &geom, const Transform3d &m,
+									 const Color4f &color, const Color4f &backcolor, const Color4f &edgecolor);
+	// Adds the objects of CSG products in the style of the thrown together preview
+	void addProducts(const class CSGProducts &products, bool highlight_mode, bool background_mode);
+	void clear();
+	bool isEmpty() const { return this->triangles.empty() && this->edges.empty(); }
+	BoundingBox getBoundingBox() const;
+
+	void render(const Camera &cam);
+	const std::vector<unsigned char> &getPixels() const { return this->pixels; }
+	bool save(std::ostream &output);
+
+private:
+	struct Triangle {
+		Vector3d p[3];
+		Color4f color;
+		Color4f backcolor;
+		bool lit;
+	};
+	struct Edge {
+		Vector3d p[2];
+		Color4f color;
+	};
+
+	void addPolygons(const class PolySet &ps, const Transform3d &m, const Color4f &color,
+									 const Color4f &backcolor, const Color4f &edgecolor, bool lit);
+
+	unsigned int width;
+	unsigned int height;
+	const ColorScheme *colorscheme;
+	bool showedges;
+	std::vector<Triangle> triangles;
+	std::vector<Edge> edges;
+	std::vector<unsigned char> pixels;
+	std::vector<float> depth;
+};
@@ -0,0 +1,46 @@
+#include "Symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	struct SymbolTable {
+		std::mutex mutex;
+		std::unordered_map<std::string, int> ids;
+		// Appending to a deque keeps references to existing names valid
+		std::deque<std::string> names;
+	};
+
+	// Constructed on first use, so symbols may be interned during static initialization
+	SymbolTable &table()
+	{
+		static SymbolTable *table = new SymbolTable;
+		return *table;
+	}
+}
+
+Symbol::Symbol(const std::string &name)
+	: config(!name.empty() && name[0] == '$' && name != "$children")
+{
+	SymbolTable &t = table();
+	std::lock_guard<std::mutex> lock(t.mutex);
+	auto res = t.ids.emplace(name, int(t.names.size()));
+	if (res.second) t.names.push_back(name);
+	this->id = res.first->second;
+}
+
+const std::string &Symbol::name() const
+{
+	static const std::string none;
+	if (this->id < 0) return none;
+	SymbolTable &t = table();
+	std::lock_guard<std::mutex> lock(t.mutex);
+	return t.names[this->id];
+}
+
+namespace Symbols {
+	const Symbol fn("$fn");
+	const Symbol fs("$fs");
+	const Symbol fa("$fa");
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+/*!
+	An identifier interned in a global symbol table.
+
+	Symbols compare as integers, so variables can be stored in flat arrays and
+	looked up without hashing or comparing strings. Identifiers in the AST are
+	interned when they are parsed. Interning is thread safe.
+*/
+class Symbol
+{
+public:
+	Symbol() : id(-1), config(false) {}
+	explicit Symbol(const std::string &name);
+
+	int index() const { return this->id; }
+	const std::string &name() const;
+
+	// $-variables have dynamic scope, except $children which is simply misnamed
+	bool isConfigVariable() const { return this->config; }
+
+	bool operator==(const Symbol &other) const { return this->id == other.id; }
+	bool operator!=(const Symbol &other) const { return this->id != other.id; }
+
+private:
+	int id;
+	bool config;
+};
+
+namespace Symbols {
+	// Special variables looked up by every builtin primitive
+	extern const Symbol fn, fs, fa;
+}
@@ -67,4 +67,5 @@ void Tree::setRoot(const AbstractNode *root)
 {
 	this->root_node = root; 
 	this->nodecache.clear();
+	this->nodeidcache.clear();
 }
@@ -35,7 +35,7 @@
 
 #include <sstream>
 
-std::deque<std::string> UserModule::module_stack;
+thread_local std::deque<std::string> UserModule::module_stack;
 
 AbstractNode *UserModule::instantiate(const Context *ctx, const ModuleInstantiation *inst, EvalContext *evalctx) const
 {
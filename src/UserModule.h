@@ -17,11 +17,14 @@ public:
 	virtual std::string dump(const std::string &indent, const std::string &name) const;
 	static const std::string& stack_element(int n) { return module_stack[n]; };
 	static int stack_size() { return module_stack.size(); };
+	// The module stack is per thread; these continue it in another thread
+	static const std::deque<std::string> &getModuleStack() { return module_stack; }
+	static void setModuleStack(const std::deque<std::string> &stack) { module_stack = stack; }
 
 	AssignmentList definition_arguments;
 
 	LocalScope scope;
 
 private:
-	static std::deque<std::string> module_stack;
+	static thread_local std::deque<std::string> module_stack;
 };
@@ -45,33 +45,146 @@
 #pragma once
 
 #include <unordered_map>
+#include <map>
+#include <vector>
+#include <limits>
+#include <algorithm>
 #include <boost/format.hpp>
 #include "printutils.h"
 
+/*!
+	Interface used by CacheBudget to evict entries from the caches sharing a budget.
+*/
+class CacheBase
+{
+public:
+	virtual ~CacheBase() {}
+	// Returns false if the cache is empty, otherwise the priority of the next entry to evict
+	virtual bool evictionPriority(double &priority) const = 0;
+	virtual void evictNext() = 0;
+};
+
+/*!
+	A memory budget shared by several caches.
+
+	Each cache still has its own cost limit, while the budget limits the sum
+	of all attached caches. When the budget is exceeded, the entry with the
+	lowest eviction priority among all attached caches is evicted.
+	The aging value of the eviction policy is kept in the budget, so priorities
+	of different caches are comparable.
+*/
+class CacheBudget
+{
+public:
+	explicit CacheBudget(size_t maxCost = std::numeric_limits<size_t>::max())
+		: mx(maxCost), total(0), age(0) {}
+
+	static CacheBudget *global() { static CacheBudget budget; return &budget; }
+
+	size_t maxCost() const { return mx; }
+	void setMaxCost(size_t m) { mx = m; trim(mx); }
+	size_t totalCost() const { return total; }
+
+	void attach(CacheBase *cache) { caches.push_back(cache); }
+	void detach(CacheBase *cache) {
+		caches.erase(std::remove(caches.begin(), caches.end(), cache), caches.end());
+	}
+
+	void trim(size_t m) {
+		while (total > m) {
+			CacheBase *victim = NULL;
+			double lowest = 0;
+			for (const auto &cache : caches) {
+				double priority;
+				if (cache->evictionPriority(priority) && (!victim || priority < lowest)) {
+					victim = cache;
+					lowest = priority;
+				}
+			}
+			if (!victim) break;
+			victim->evictNext();
+		}
+	}
+
+private:
+	template <class Key, class T> friend class Cache;
+
+	std::vector<CacheBase *> caches;
+	size_t mx, total;
+	double age;
+};
+
+/*!
+	Cost-aware LRU cache.
+
+	Entries are evicted using the GreedyDual-Size policy: each entry gets the
+	priority age + weight/size when inserted or accessed, where weight is
+	the (user defined) cost of recreating the entry, e.g. the time it took
+	to compute it. The entry with the lowest priority is evicted first and
+	its priority becomes the new age, so entries which are not accessed
+	eventually age out. With all weights being zero, this is plain LRU.
+
+	An entry can reference a shared object (e.g. a geometry inserted under
+	several keys). The cost of the shared object is only counted once,
+	for as long as any entry references it.
+*/
 template <class Key, class T>
-class Cache
+class Cache : public CacheBase
 {
 	struct Node {
 		inline Node() : keyPtr(0) {}
-		inline Node(T *data, int cost)
-			: keyPtr(0), t(data), c(cost), p(0), n(0) {}
-		const Key *keyPtr; T *t; int c; Node *p,*n;
+		inline Node(T *data, size_t cost, double weight, const void *shared)
+			: keyPtr(0), t(data), c(cost), weight(weight), shared(shared), priority(0), seq(0) {}
+		const Key *keyPtr; T *t; size_t c; double weight; const void *shared; double priority; unsigned long seq;
+	};
+	struct SharedNode {
+		SharedNode() : refs(0), c(0) {}
+		size_t refs, c;
 	};
 	typedef typename std::unordered_map<Key, Node> map_type;
 	typedef typename map_type::iterator iterator_type;
 	typedef typename map_type::value_type value_type;
+	typedef std::pair<double, unsigned long> order_key;
 
 	std::unordered_map<Key, Node> hash;
-	Node *f, *l;
-	void *unused;
-	int mx, total;
+	std::map<order_key, Node *> order;
+	std::unordered_map<const void *, SharedNode> sharedobjects;
+	CacheBudget *budget;
+	size_t mx, total;
+	double ownage;
+	unsigned long counter;
 
+	inline double &age() { return budget ? budget->age : ownage; }
+	inline size_t sizeOf(const Node &n) const {
+		size_t size = n.c;
+		if (n.shared) size += sharedobjects.find(n.shared)->second.c;
+		return size ? size : 1;
+	}
+	inline void charge(size_t cost) {
+		total += cost;
+		if (budget) budget->total += cost;
+	}
+	inline void release(size_t cost) {
+		total -= cost;
+		if (budget) budget->total -= cost;
+	}
+	inline void touch(Node &n) {
+		order.erase(order_key(n.priority, n.seq));
+		n.priority = age() + n.weight / sizeOf(n);
+		n.seq = ++counter;
+		order[order_key(n.priority, n.seq)] = &n;
+	}
 	inline void unlink(Node &n) {
-		if (n.p) n.p->n = n.n;
-		if (n.n) n.n->p = n.p;
-		if (l == &n) l = n.p;
-		if (f == &n) f = n.n;
-		total -= n.c;
+		order.erase(order_key(n.priority, n.seq));
+		size_t cost = n.c;
+		if (n.shared) {
+			auto s = sharedobjects.find(n.shared);
+			if (--s->second.refs == 0) {
+				cost += s->second.c;
+				sharedobjects.erase(s);
+			}
+		}
+		release(cost);
 		T *obj = n.t;
 		hash.erase(*n.keyPtr);
 		delete obj;
@@ -81,36 +194,47 @@ class Cache
 		if (i == hash.end()) return 0;
 
 		Node &n = i->second;
-		if (f != &n) {
-			if (n.p) n.p->n = n.n;
-			if (n.n) n.n->p = n.p;
-			if (l == &n) l = n.p;
-			n.p = 0;
-			n.n = f;
-			f->p = &n;
-			f = &n;
-		}
+		touch(n);
 		return n.t;
 	}
 
 public:
-	inline explicit Cache(int maxCost = 100)
-		: f(0), l(0), unused(0), mx(maxCost), total(0) { }
-	inline ~Cache() { clear(); }
+	inline explicit Cache(size_t maxCost = 100)
+		: budget(0), mx(maxCost), total(0), ownage(0), counter(0) { }
+	inline ~Cache() { setBudget(0); clear(); }
 
-	inline int maxCost() const { return mx; }
-	void setMaxCost(int m) { mx = m; trim(mx); }
-	inline int totalCost() const { return total; }
+	inline size_t maxCost() const { return mx; }
+	void setMaxCost(size_t m) { mx = m; trim(mx); }
+	inline size_t totalCost() const { return total; }
+
+	/*!
+		Attaches the cache to a budget shared with other caches, or detaches
+		it if budget is NULL.
+	*/
+	void setBudget(CacheBudget *b) {
+		if (budget) {
+			budget->total -= total;
+			budget->detach(this);
+		}
+		budget = b;
+		if (budget) {
+			budget->attach(this);
+			budget->total += total;
+			budget->trim(budget->mx);
+		}
+	}
 
 	inline int size() const { return hash.size(); }
 	inline bool empty() const { return hash.empty(); }
 
 	void clear() {
-		while (f) { delete f->t; f = f->n; }
-		hash.clear(); l = 0; total = 0;
+		for (auto &item : hash) delete item.second.t;
+		hash.clear(); order.clear(); sharedobjects.clear();
+		release(total);
 	}
 
-	bool insert(const Key &key, T *object, int cost = 1);
+	bool insert(const Key &key, T *object, size_t cost = 1, double weight = 0,
+							const void *shared = 0, size_t sharedcost = 0);
 	T *object(const Key &key) const { return const_cast<Cache<Key,T>*>(this)->relink(key); }
 	inline bool contains(const Key &key) const { return hash.find(key) != hash.end(); }
 	T *operator[](const Key &key) const { return object(key); }
@@ -118,8 +242,15 @@ public:
 	bool remove(const Key &key);
 	T *take(const Key &key);
 
+	virtual bool evictionPriority(double &priority) const {
+		if (order.empty()) return false;
+		priority = order.begin()->first.first;
+		return true;
+	}
+	virtual void evictNext();
+
 private:
-	void trim(int m);
+	void trim(size_t m);
 };
 
 template <class Key, class T>
@@ -140,7 +271,7 @@ inline T *Cache<Key,T>::take(const Key &key)
 	iterator_type i = hash.find(key);
 	if (i == hash.end()) return 0;
 
-	Node &n = *i;
+	Node &n = i->second;
 	T *t = n.t;
 	n.t = 0;
 	unlink(n);
@@ -148,37 +279,50 @@ inline T *Cache<Key,T>::take(const Key &key)
 }
 
 template <class Key, class T>
-bool Cache<Key,T>::insert(const Key &akey, T *aobject, int acost)
+bool Cache<Key,T>::insert(const Key &akey, T *aobject, size_t acost, double aweight,
+													const void *ashared, size_t asharedcost)
 {
 	remove(akey);
-	if (acost > mx) {
+	size_t maxcharge = acost;
+	if (ashared && !sharedobjects.count(ashared)) maxcharge += asharedcost;
+	if (maxcharge > mx || (budget && maxcharge > budget->mx)) {
 		delete aobject;
 		return false;
 	}
-	trim(mx - acost);
-	Node node(aobject, acost);
-	hash[akey] = node;
-	iterator_type i = hash.find(akey);
-	total += acost;
-	Node *n = &i->second;
-	n->keyPtr = &i->first;
-	if (f) f->p = n;
-	n->n = f;
-	f = n;
-	if (!l) l = f;
+	trim(mx - maxcharge);
+	if (budget) budget->trim(budget->mx - maxcharge);
+
+	// Trimming may have evicted other references to the shared object
+	size_t charged = acost;
+	if (ashared) {
+		SharedNode &s = sharedobjects[ashared];
+		if (s.refs++ == 0) {
+			s.c = asharedcost;
+			charged += asharedcost;
+		}
+	}
+	charge(charged);
+
+	Node &n = hash[akey] = Node(aobject, acost, aweight, ashared);
+	n.keyPtr = &hash.find(akey)->first;
+	touch(n);
 	return true;
 }
 
 template <class Key, class T>
-void Cache<Key,T>::trim(int m)
+void Cache<Key,T>::evictNext()
 {
-	Node *n = l;
-	while (n && total > m) {
-		Node *u = n;
-		n = n->p;
+	if (order.empty()) return;
+	Node *u = order.begin()->second;
+	age() = u->priority;
 #ifdef DEBUG
-		PRINTB("Trimming cache: %1% (%2% bytes)", u->keyPtr->substr(0, 40) % u->c);
+	PRINTB("Trimming cache: %1% (%2% bytes)", u->keyPtr->substr(0, 40) % u->c);
 #endif
-		unlink(*u);
-	}
+	unlink(*u);
+}
+
+template <class Key, class T>
+void Cache<Key,T>::trim(size_t m)
+{
+	while (total > m && !order.empty()) evictNext();
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+// Smallest $fs and $fa accepted by modules creating fragments
+#define F_MINIMUM 0.01
+
 namespace Calc {
 	int get_fragments_from_r(double r, double fn, double fs, double fa);
 }
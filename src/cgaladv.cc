@@ -30,6 +30,7 @@
 #include "evalcontext.h"
 #include "builtin.h"
 #include "polyset.h"
+#include "printutils.h"
 #include <sstream>
 #include <assert.h>
 #include <boost/assign/std/vector.hpp>
@@ -61,6 +62,9 @@ AbstractNode *CgaladvModule::instantiate(const Context *ctx, const ModuleInstant
 	if (type == RESIZE)
 		args += Assignment("newsize"), Assignment("auto");
 
+	if (type == SIMPLIFY)
+		args += Assignment("faces"), Assignment("error");
+
 	Context c(ctx);
 	c.setVariables(args, evalctx);
 	inst->scope.apply(*evalctx);
@@ -107,6 +111,20 @@ AbstractNode *CgaladvModule::instantiate(const Context *ctx, const ModuleInstant
 		}
 	}
 
+	if (type == SIMPLIFY) {
+		double faces;
+		if (c.lookup_variable("faces", true)->getDouble(faces) && faces > 0) {
+			node->faces = size_t(faces);
+		}
+		double maxerror;
+		if (c.lookup_variable("error", true)->getFiniteDouble(maxerror) && maxerror > 0) {
+			node->maxerror = maxerror;
+		}
+		if (node->faces == 0 && node->maxerror == 0) {
+			PRINT("WARNING: simplify() needs a positive faces or error parameter, ignoring.");
+		}
+	}
+
 	node->convexity = (int)convexity->toDouble();
 	node->path = path;
 	node->subdiv_type = subdiv_type->toString();
@@ -139,6 +157,9 @@ std::string CgaladvNode::name() const
 	case RESIZE:
 		return "resize";
 		break;
+	case SIMPLIFY:
+		return "simplify";
+		break;
 	default:
 		assert(false);
 	}
@@ -170,6 +191,9 @@ std::string CgaladvNode::toString() const
 		  << this->autosize[0] << "," << this->autosize[1] << "," << this->autosize[2] << "]"
 		  << ")";
 		break;
+	case SIMPLIFY:
+		stream << "(faces = " << this->faces << ", error = " << this->maxerror << ")";
+		break;
 	default:
 		assert(false);
 	}
@@ -184,4 +208,5 @@ void register_builtin_cgaladv()
 	Builtins::init("subdiv", new CgaladvModule(SUBDIV));
 	Builtins::init("hull", new CgaladvModule(HULL));
 	Builtins::init("resize", new CgaladvModule(RESIZE));
+	Builtins::init("simplify", new CgaladvModule(SIMPLIFY));
 }
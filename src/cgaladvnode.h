@@ -9,7 +9,8 @@ enum cgaladv_type_e {
 	GLIDE,
 	SUBDIV,
 	HULL,
-	RESIZE
+	RESIZE,
+	SIMPLIFY
 };
 
 class CgaladvNode : public AbstractNode
@@ -18,6 +19,8 @@ public:
 	VISITABLE();
 	CgaladvNode(const ModuleInstantiation *mi, cgaladv_type_e type) : AbstractNode(mi), type(type) {
 		convexity = 1;
+		faces = 0;
+		maxerror = 0;
 	}
 	virtual ~CgaladvNode() { }
 	virtual std::string toString() const;
@@ -28,5 +31,8 @@ public:
 	int convexity, level;
 	Vector3d newsize;
 	Eigen::Matrix<bool,3,1> autosize;
+	// simplify() targets, 0 if not given
+	size_t faces;
+	double maxerror;
 	cgaladv_type_e type;
 };
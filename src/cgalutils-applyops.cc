@@ -13,6 +13,8 @@
 
 #include "cgal.h"
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Exact_predicates_exact_constructions_kernel.h>
+#include <CGAL/convex_hull_2.h>
 #include <CGAL/normal_vector_newell_3.h>
 #include <CGAL/Handle_hash_function.h>
 
@@ -29,9 +31,14 @@
 #include "svg.h"
 #include "Reindexer.h"
 #include "GeometryUtils.h"
+#include "CGALCache.h"
+#include "parallel.h"
+
+#include "hash.h"
 
 #include <map>
 #include <queue>
+#include <chrono>
 #include <unordered_set>
 
 namespace CGALUtils {
@@ -149,250 +156,457 @@ namespace CGALUtils {
 
 
 
-	bool applyHull(const Geometry::Geometries &children, PolySet &result)
+	/*!
+		Removes duplicate points, keeping the order of first occurrence.
+	*/
+	template <typename V>
+	static void removeDuplicates(std::vector<V> &points)
+	{
+		std::unordered_set<V> seen;
+		seen.reserve(points.size());
+		size_t n = 0;
+		for (size_t i = 0; i < points.size(); i++) {
+			if (seen.insert(points[i]).second) points[n++] = points[i];
+		}
+		points.resize(n);
+	}
+
+	/*!
+		Reduces points to the vertices of their convex hull.
+		Uses only the inexact kernel and is safe to call from multiple threads.
+		If the hull cannot be computed, all unique points are kept.
+	*/
+	static void reduceToHull(std::vector<Vector3d> &points)
+	{
+		removeDuplicates(points);
+		if (points.size() < 4) return;
+		try {
+			std::vector<K::Point_3> kpoints;
+			kpoints.reserve(points.size());
+			for (const auto &p : points) kpoints.push_back(K::Point_3(p[0], p[1], p[2]));
+			CGAL::Polyhedron_3<K> r;
+			CGAL::convex_hull_3(kpoints.begin(), kpoints.end(), r);
+			points.clear();
+			points.reserve(r.size_of_vertices());
+			for (CGAL::Polyhedron_3<K>::Vertex_const_iterator i = r.vertices_begin(); i != r.vertices_end(); ++i) {
+				points.push_back(Vector3d(i->point().x(), i->point().y(), i->point().z()));
+			}
+		}
+		catch (const CGAL::Failure_exception &) {
+		}
+	}
+
+	static void reduceToHull(std::vector<Vector2d> &points)
+	{
+		removeDuplicates(points);
+		if (points.size() < 3) return;
+		std::vector<K::Point_2> kpoints, result;
+		kpoints.reserve(points.size());
+		for (const auto &p : points) kpoints.push_back(K::Point_2(p[0], p[1]));
+		CGAL::convex_hull_2(kpoints.begin(), kpoints.end(), std::back_inserter(result));
+		points.clear();
+		points.reserve(result.size());
+		for (const auto &p : result) points.push_back(Vector2d(p.x(), p.y()));
+	}
+
+	// Hulls are cached alongside the convex decompositions of the same nodes
+	static std::string hullCacheId(const std::vector<std::string> &ids, size_t i)
+	{
+		return (i < ids.size() && !ids[i].empty()) ? "hull:" + ids[i] : std::string();
+	}
+
+	static std::vector<bool> findCachedHulls(size_t numchildren, const std::vector<std::string> &ids)
+	{
+		std::vector<bool> cached(numchildren);
+		for (size_t i = 0; i < numchildren; i++) {
+			std::string id = hullCacheId(ids, i);
+			cached[i] = !id.empty() && CGALCache::instance()->containsConvexParts(id);
+		}
+		return cached;
+	}
+
+	static Vector3d toVector3d(const Vector3d &v) { return v; }
+	static Vector3d toVector3d(const Vector2d &v) { return Vector3d(v[0], v[1], 0); }
+
+	/*!
+		Reduces each child to the vertices of its own hull, in parallel.
+		Hulls of children marked as cached are fetched from the CGALCache,
+		all other hulls are inserted into the cache if ids are given.
+	*/
+	template <typename V>
+	static void reduceChildrenToHulls(std::vector<std::vector<V>> &points,
+																		const std::vector<std::string> &ids, const std::vector<bool> &cached)
+	{
+		typedef std::chrono::steady_clock wallclock;
+		for (size_t i = 0; i < points.size(); i++) {
+			if (!cached[i]) continue;
+			const std::vector<Vector3d> &hull = CGALCache::instance()->getConvexParts(hullCacheId(ids, i))->front();
+			points[i].clear();
+			points[i].reserve(hull.size());
+			for (const auto &v : hull) points[i].push_back(V(v.data()));
+		}
+
+		std::vector<double> times(points.size());
+		parallel_for(points.size(), [&](size_t i) {
+				if (cached[i]) return;
+				wallclock::time_point start = wallclock::now();
+				reduceToHull(points[i]);
+				times[i] = std::chrono::duration<double>(wallclock::now() - start).count();
+			});
+
+		for (size_t i = 0; i < points.size(); i++) {
+			std::string id = hullCacheId(ids, i);
+			if (cached[i] || id.empty()) continue;
+			shared_ptr<CGALCache::ConvexParts> hull(new CGALCache::ConvexParts(1));
+			hull->front().reserve(points[i].size());
+			for (const auto &v : points[i]) hull->front().push_back(toVector3d(v));
+			CGALCache::instance()->insertConvexParts(id, hull, times[i]);
+		}
+	}
+
+	template <typename Kernel>
+	static bool createHull(const std::vector<Vector3d> &points, PolySet &result)
 	{
-		typedef CGAL::Epick K;
-		// Collect point cloud
-		// NB! CGAL's convex_hull_3() doesn't like std::set iterators, so we use a list
-		// instead.
-		std::list<K::Point_3> points;
+		std::vector<typename Kernel::Point_3> kpoints;
+		kpoints.reserve(points.size());
+		for (const auto &p : points) kpoints.push_back(typename Kernel::Point_3(p[0], p[1], p[2]));
+		CGAL::Polyhedron_3<Kernel> r;
+		CGAL::convex_hull_3(kpoints.begin(), kpoints.end(), r);
+		PRINTDB("After hull vertices: %d", r.size_of_vertices());
+		PRINTDB("After hull facets: %d", r.size_of_facets());
+		PRINTDB("After hull closed: %d", r.is_closed());
+		PRINTDB("After hull valid: %d", r.is_valid());
+		return !createPolySetFromPolyhedron(r, result);
+	}
+
+	/*!
+		Computes the convex hull of all children.
 
+		Each child is first reduced to its own hull, which is cached under the
+		corresponding id if ids are given, so only the hull vertices of each child
+		take part in the final hull.
+		The hulls are computed using the inexact kernel. Should this fail, the
+		final hull is retried using exact constructions.
+	*/
+	bool applyHull(const Geometry::Geometries &children, PolySet &result, const std::vector<std::string> &ids)
+	{
+		// Collect point cloud of each child. Nef polyhedra are not thread safe,
+		// so we convert them up front.
+		std::vector<bool> cached = findCachedHulls(children.size(), ids);
+		std::vector<std::vector<Vector3d>> points(children.size());
+		std::vector<const PolySet *> polysets(children.size());
+		size_t i = 0;
 		for(const auto &item : children) {
 			const shared_ptr<const Geometry> &chgeom = item.second;
-			const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron *>(chgeom.get());
-			if (N) {
-				if (!N->isEmpty()) {
-					for (CGAL_Nef_polyhedron3::Vertex_const_iterator i = N->p3->vertices_begin(); i != N->p3->vertices_end(); ++i) {
-						points.push_back(vector_convert<K::Point_3>(i->point()));
-					}
-				}
-			} else {
-				const PolySet *ps = dynamic_cast<const PolySet *>(chgeom.get());
-				if (ps) {
-					for(const auto &p : ps->polygons) {
-						for(const auto &v : p) {
-							points.push_back(K::Point_3(v[0], v[1], v[2]));
+			if (!cached[i]) {
+				const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron *>(chgeom.get());
+				if (N) {
+					if (!N->isEmpty()) {
+						points[i].reserve(N->p3->number_of_vertices());
+						for (CGAL_Nef_polyhedron3::Vertex_const_iterator v = N->p3->vertices_begin(); v != N->p3->vertices_end(); ++v) {
+							points[i].push_back(vector_convert<Vector3d>(v->point()));
 						}
 					}
+				} else {
+					polysets[i] = dynamic_cast<const PolySet *>(chgeom.get());
 				}
 			}
+			i++;
 		}
+		parallel_for(children.size(), [&](size_t i) {
+				if (!polysets[i]) return;
+				size_t numverts = 0;
+				for (const auto &p : polysets[i]->polygons) numverts += p.size();
+				points[i].reserve(numverts);
+				for (const auto &p : polysets[i]->polygons) points[i].insert(points[i].end(), p.begin(), p.end());
+			});
+
+		reduceChildrenToHulls(points, ids, cached);
 
-		if (points.size() <= 3) return false;
+		std::vector<Vector3d> allpoints;
+		size_t numpoints = 0;
+		for (const auto &p : points) numpoints += p.size();
+		allpoints.reserve(numpoints);
+		for (const auto &p : points) allpoints.insert(allpoints.end(), p.begin(), p.end());
+		removeDuplicates(allpoints);
+
+		if (allpoints.size() <= 3) return false;
 
 		// Apply hull
 		bool success = false;
-		if (points.size() >= 4) {
-			CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
+		CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
+		try {
+			success = createHull<CGAL::Epick>(allpoints, result);
+		}
+		catch (const CGAL::Failure_exception &e) {
+			PRINTDB("applyHull(): Retrying with exact constructions: %s", e.what());
+			result.polygons.clear();
 			try {
-				CGAL::Polyhedron_3<K> r;
-				CGAL::convex_hull_3(points.begin(), points.end(), r);
-                            PRINTDB("After hull vertices: %d", r.size_of_vertices());
-                            PRINTDB("After hull facets: %d", r.size_of_facets());
-                            PRINTDB("After hull closed: %d", r.is_closed());
-                            PRINTDB("After hull valid: %d", r.is_valid());
-				success = !createPolySetFromPolyhedron(r, result);
+				success = createHull<CGAL::Epeck>(allpoints, result);
 			}
 			catch (const CGAL::Failure_exception &e) {
 				PRINTB("ERROR: CGAL error in applyHull(): %s", e.what());
 			}
-			CGAL::set_error_behaviour(old_behaviour);
 		}
+		CGAL::set_error_behaviour(old_behaviour);
 		return success;
 	}
 
-
 	/*!
-		children cannot contain NULL objects
+		Computes the 2D convex hull of all children, see applyHull().
+		Will not return NULL.
 	*/
-	Geometry const * applyMinkowski(const Geometry::Geometries &children)
+	Polygon2d *applyHull2D(const std::vector<const Polygon2d *> &children, const std::vector<std::string> &ids)
 	{
-		CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
-		CGAL::Timer t,t_tot;
-		assert(children.size() >= 2);
-		Geometry::Geometries::const_iterator it = children.begin();
-		t_tot.start();
-		Geometry const* operands[2] = {it->second.get(), NULL};
-		try {
-			while (++it != children.end()) {
-				operands[1] = it->second.get();
+		std::vector<bool> cached = findCachedHulls(children.size(), ids);
+		std::vector<std::vector<Vector2d>> points(children.size());
+		parallel_for(children.size(), [&](size_t i) {
+				if (cached[i]) return;
+				for (const auto &o : children[i]->outlines()) {
+					points[i].insert(points[i].end(), o.vertices.begin(), o.vertices.end());
+				}
+			});
 
-				typedef CGAL::Epick Hull_kernel;
+		reduceChildrenToHulls(points, ids, cached);
 
-				std::list<CGAL_Polyhedron> P[2];
-				std::list<CGAL::Polyhedron_3<Hull_kernel>> result_parts;
+		std::vector<Vector2d> allpoints;
+		for (const auto &p : points) allpoints.insert(allpoints.end(), p.begin(), p.end());
+		reduceToHull(allpoints);
 
-				for (size_t i = 0; i < 2; i++) {
-					CGAL_Polyhedron poly;
+		Polygon2d *geometry = new Polygon2d();
+		if (allpoints.size() > 0) {
+			Outline2d outline;
+			outline.vertices = allpoints;
+			geometry->addOutline(outline);
+		}
+		return geometry;
+	}
 
-					const PolySet * ps = dynamic_cast<const PolySet *>(operands[i]);
-
-					const CGAL_Nef_polyhedron * nef = dynamic_cast<const CGAL_Nef_polyhedron *>(operands[i]);
-
-					if (ps) CGALUtils::createPolyhedronFromPolySet(*ps, poly);
-					else if (nef && nef->p3->is_simple()) nefworkaround::convert_to_Polyhedron<CGAL_Kernel3>(*nef->p3, poly);
-					else throw 0;
-
-					if ((ps && ps->is_convex()) ||
-							(!ps && is_weakly_convex(poly))) {
-						PRINTDB("Minkowski: child %d is convex and %s",i % (ps?"PolySet":"Nef"));
-						P[i].push_back(poly);
-					} else {
-						CGAL_Nef_polyhedron3 decomposed_nef;
-
-						if (ps) {
-							PRINTDB("Minkowski: child %d is nonconvex PolySet, transforming to Nef and decomposing...", i);
-							CGAL_Nef_polyhedron *p = createNefPolyhedronFromGeometry(*ps);
-							if (!p->isEmpty()) decomposed_nef = *p->p3;
-							delete p;
-						} else {
-							PRINTDB("Minkowski: child %d is nonconvex Nef, decomposing...",i);
-							decomposed_nef = *nef->p3;
-						}
+	static void appendConvexPart(const CGAL_Polyhedron &poly, CGALCache::ConvexParts &parts)
+	{
+		parts.push_back(std::vector<Vector3d>());
+		std::vector<Vector3d> &part = parts.back();
+		part.reserve(poly.size_of_vertices());
+		for (CGAL_Polyhedron::Vertex_const_iterator pi = poly.vertices_begin(); pi != poly.vertices_end(); ++pi) {
+			CGAL_Polyhedron::Point_3 const& p = pi->point();
+			part.push_back(Vector3d(to_double(p[0]), to_double(p[1]), to_double(p[2])));
+		}
+	}
 
-						t.start();
-						CGAL::convex_decomposition_3(decomposed_nef);
-
-						// the first volume is the outer volume, which ignored in the decomposition
-						CGAL_Nef_polyhedron3::Volume_const_iterator ci = ++decomposed_nef.volumes_begin();
-						for(; ci != decomposed_nef.volumes_end(); ++ci) {
-							if(ci->mark()) {
-								CGAL_Polyhedron poly;
-								decomposed_nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), poly);
-								P[i].push_back(poly);
-							}
-						}
+	/*!
+		Returns the vertices of the convex parts of a Minkowski operand.
+		If id is non-empty, the decomposition is cached in the CGALCache under this id,
+		so operands which are used repeatedly are only decomposed once.
+		Throws if the operand cannot be decomposed.
+	*/
+	static shared_ptr<const CGALCache::ConvexParts> convexParts(const Geometry &operand, const std::string &id, int i)
+	{
+		if (!id.empty() && CGALCache::instance()->containsConvexParts(id)) {
+			PRINTDB("Minkowski: child %d convex parts found in cache", i);
+			return CGALCache::instance()->getConvexParts(id);
+		}
 
+		CGAL::Timer t;
+		t.start();
+		shared_ptr<CGALCache::ConvexParts> parts(new CGALCache::ConvexParts);
+		CGAL_Polyhedron poly;
 
-						PRINTDB("Minkowski: decomposed into %d convex parts", P[i].size());
-						t.stop();
-						PRINTDB("Minkowski: decomposition took %f s", t.time());
-					}
-				}
+		const PolySet * ps = dynamic_cast<const PolySet *>(&operand);
 
-				std::vector<Hull_kernel::Point_3> points[2];
-				std::vector<Hull_kernel::Point_3> minkowski_points;
+		const CGAL_Nef_polyhedron * nef = dynamic_cast<const CGAL_Nef_polyhedron *>(&operand);
 
-				for (size_t i = 0; i < P[0].size(); i++) {
-					for (size_t j = 0; j < P[1].size(); j++) {
-						t.start();
-						points[0].clear();
-						points[1].clear();
+		if (ps) CGALUtils::createPolyhedronFromPolySet(*ps, poly);
+		else if (nef && nef->p3->is_simple()) nefworkaround::convert_to_Polyhedron<CGAL_Kernel3>(*nef->p3, poly);
+		else throw 0;
 
-						for (int k = 0; k < 2; k++) {
-							std::list<CGAL_Polyhedron>::iterator it = P[k].begin();
-							std::advance(it, k==0?i:j);
+		if ((ps && ps->is_convex()) ||
+				(!ps && is_weakly_convex(poly))) {
+			PRINTDB("Minkowski: child %d is convex and %s",i % (ps?"PolySet":"Nef"));
+			appendConvexPart(poly, *parts);
+		} else {
+			CGAL_Nef_polyhedron3 decomposed_nef;
 
-							CGAL_Polyhedron const& poly = *it;
-							points[k].reserve(poly.size_of_vertices());
+			if (ps) {
+				PRINTDB("Minkowski: child %d is nonconvex PolySet, transforming to Nef and decomposing...", i);
+				CGAL_Nef_polyhedron *p = createNefPolyhedronFromGeometry(*ps);
+				if (!p->isEmpty()) decomposed_nef = *p->p3;
+				delete p;
+			} else {
+				PRINTDB("Minkowski: child %d is nonconvex Nef, decomposing...",i);
+				decomposed_nef = *nef->p3;
+			}
 
-							for (CGAL_Polyhedron::Vertex_const_iterator pi = poly.vertices_begin(); pi != poly.vertices_end(); ++pi) {
-								CGAL_Polyhedron::Point_3 const& p = pi->point();
-								points[k].push_back(Hull_kernel::Point_3(to_double(p[0]),to_double(p[1]),to_double(p[2])));
-							}
-						}
+			CGAL::convex_decomposition_3(decomposed_nef);
 
-						minkowski_points.clear();
-						minkowski_points.reserve(points[0].size() * points[1].size());
-						for (size_t i = 0; i < points[0].size(); i++) {
-							for (size_t j = 0; j < points[1].size(); j++) {
-								minkowski_points.push_back(points[0][i]+(points[1][j]-CGAL::ORIGIN));
-							}
-						}
+			// the first volume is the outer volume, which ignored in the decomposition
+			CGAL_Nef_polyhedron3::Volume_const_iterator ci = ++decomposed_nef.volumes_begin();
+			for(; ci != decomposed_nef.volumes_end(); ++ci) {
+				if(ci->mark()) {
+					CGAL_Polyhedron poly;
+					decomposed_nef.convert_inner_shell_to_polyhedron(ci->shells_begin(), poly);
+					appendConvexPart(poly, *parts);
+				}
+			}
 
-						if (minkowski_points.size() <= 3) {
-							t.stop();
-							continue;
-						}
+			PRINTDB("Minkowski: decomposed into %d convex parts", parts->size());
+		}
+		t.stop();
+		PRINTDB("Minkowski: decomposition took %f s", t.time());
+		if (!id.empty()) CGALCache::instance()->insertConvexParts(id, parts, t.time());
+		return parts;
+	}
 
+	/*!
+		Returns the convex hull of the Minkowski sum of two convex point sets,
+		or NULL if the result is degenerate.
+		This only uses the inexact kernel and is safe to call from multiple threads.
+	*/
+	static PolySet *convexMinkowski(const std::vector<Vector3d> &a, const std::vector<Vector3d> &b)
+	{
+		typedef CGAL::Epick Hull_kernel;
 
-						CGAL::Polyhedron_3<Hull_kernel> result;
-						t.stop();
-						PRINTDB("Minkowski: Point cloud creation (%d ⨉ %d -> %d) took %f ms", points[0].size() % points[1].size() % minkowski_points.size() % (t.time()*1000));
-						t.reset();
+		std::vector<Hull_kernel::Point_3> minkowski_points;
+		minkowski_points.reserve(a.size() * b.size());
+		for (const auto &p : a) {
+			for (const auto &q : b) {
+				minkowski_points.push_back(Hull_kernel::Point_3(p[0] + q[0], p[1] + q[1], p[2] + q[2]));
+			}
+		}
 
-						t.start();
+		if (minkowski_points.size() <= 3) return NULL;
 
-						CGAL::convex_hull_3(minkowski_points.begin(), minkowski_points.end(), result);
+		CGAL::Polyhedron_3<Hull_kernel> result;
+		CGAL::convex_hull_3(minkowski_points.begin(), minkowski_points.end(), result);
 
-						std::vector<Hull_kernel::Point_3> strict_points;
-						strict_points.reserve(minkowski_points.size());
+		std::vector<Hull_kernel::Point_3> strict_points;
+		strict_points.reserve(minkowski_points.size());
 
-						for (CGAL::Polyhedron_3<Hull_kernel>::Vertex_iterator i = result.vertices_begin(); i != result.vertices_end(); ++i) {
-							Hull_kernel::Point_3 const& p = i->point();
+		for (CGAL::Polyhedron_3<Hull_kernel>::Vertex_iterator i = result.vertices_begin(); i != result.vertices_end(); ++i) {
+			Hull_kernel::Point_3 const& p = i->point();
 
-							CGAL::Polyhedron_3<Hull_kernel>::Vertex::Halfedge_handle h,e;
-							h = i->halfedge();
-							e = h;
-							bool collinear = false;
-							bool coplanar = true;
+			CGAL::Polyhedron_3<Hull_kernel>::Vertex::Halfedge_handle h,e;
+			h = i->halfedge();
+			e = h;
+			bool collinear = false;
+			bool coplanar = true;
 
-							do {
-								Hull_kernel::Point_3 const& q = h->opposite()->vertex()->point();
-								if (coplanar && !CGAL::coplanar(p,q,
-																h->next_on_vertex()->opposite()->vertex()->point(),
-																h->next_on_vertex()->next_on_vertex()->opposite()->vertex()->point())) {
-									coplanar = false;
-								}
+			do {
+				Hull_kernel::Point_3 const& q = h->opposite()->vertex()->point();
+				if (coplanar && !CGAL::coplanar(p,q,
+																				h->next_on_vertex()->opposite()->vertex()->point(),
+																				h->next_on_vertex()->next_on_vertex()->opposite()->vertex()->point())) {
+					coplanar = false;
+				}
 
 
-								for (CGAL::Polyhedron_3<Hull_kernel>::Vertex::Halfedge_handle j = h->next_on_vertex();
-									 j != h && !collinear && ! coplanar;
-									 j = j->next_on_vertex()) {
+				for (CGAL::Polyhedron_3<Hull_kernel>::Vertex::Halfedge_handle j = h->next_on_vertex();
+						 j != h && !collinear && ! coplanar;
+						 j = j->next_on_vertex()) {
 
-									Hull_kernel::Point_3 const& r = j->opposite()->vertex()->point();
-									if (CGAL::collinear(p,q,r)) {
-										collinear = true;
-									}
-								}
+					Hull_kernel::Point_3 const& r = j->opposite()->vertex()->point();
+					if (CGAL::collinear(p,q,r)) {
+						collinear = true;
+					}
+				}
 
-								h = h->next_on_vertex();
-							} while (h != e && !collinear);
+				h = h->next_on_vertex();
+			} while (h != e && !collinear);
 
-							if (!collinear && !coplanar)
-								strict_points.push_back(p);
-						}
+			if (!collinear && !coplanar)
+				strict_points.push_back(p);
+		}
 
-						result.clear();
-						CGAL::convex_hull_3(strict_points.begin(), strict_points.end(), result);
+		result.clear();
+		CGAL::convex_hull_3(strict_points.begin(), strict_points.end(), result);
 
+		PolySet *ps = new PolySet(3, true);
+		createPolySetFromPolyhedron(result, *ps);
+		return ps;
+	}
 
-						t.stop();
-						PRINTDB("Minkowski: Computing convex hull took %f s", t.time());
-						t.reset();
+	/*!
+		Unions the given parts pairwise in a balanced tree, so every part takes
+		part in O(log n) unions of similarly sized operands. Returns an empty
+		polyhedron if no part is a non-empty Nef polyhedron.
+	*/
+	static CGAL_Nef_polyhedron *applyBalancedUnion(std::vector<shared_ptr<PolySet>> &parts)
+	{
+		std::vector<shared_ptr<CGAL_Nef_polyhedron>> nefs;
+		nefs.reserve(parts.size());
+		for (auto &ps : parts) {
+			shared_ptr<CGAL_Nef_polyhedron> nef(createNefPolyhedronFromGeometry(*ps));
+			// Empty parts, or parts which failed to convert, don't contribute to the union
+			if (nef && !nef->isEmpty()) nefs.push_back(nef);
+			ps.reset();
+		}
+		if (nefs.empty()) return new CGAL_Nef_polyhedron();
+		while (nefs.size() > 1) {
+			size_t n = 0;
+			for (size_t i = 0; i + 1 < nefs.size(); i += 2) {
+				*nefs[i] += *nefs[i + 1];
+				nefs[n++] = nefs[i];
+			}
+			if (nefs.size() % 2) nefs[n++] = nefs.back();
+			nefs.resize(n);
+		}
+		return new CGAL_Nef_polyhedron(*nefs.front());
+	}
 
-						result_parts.push_back(result);
-					}
+	/*!
+		children cannot contain NULL objects.
+		ids are the cache ids of the children, used to cache their convex decompositions.
+		If empty, or if an id is empty, the decomposition of that child is not cached.
+	*/
+	Geometry const * applyMinkowski(const Geometry::Geometries &children, const std::vector<std::string> &ids)
+	{
+		CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
+		CGAL::Timer t,t_tot;
+		assert(children.size() >= 2);
+		assert(ids.empty() || ids.size() == children.size());
+		Geometry::Geometries::const_iterator it = children.begin();
+		t_tot.start();
+		Geometry const* operands[2] = {it->second.get(), NULL};
+		std::string operandids[2] = {ids.empty() ? std::string() : ids[0], std::string()};
+		size_t index = 0;
+		try {
+			while (++it != children.end()) {
+				operands[1] = it->second.get();
+				operandids[1] = ids.empty() ? std::string() : ids[++index];
+
+				shared_ptr<const CGALCache::ConvexParts> P[2];
+				for (size_t i = 0; i < 2; i++) {
+					P[i] = convexParts(*operands[i], operandids[i], i);
 				}
 
+				// Hull all pairs of convex parts in parallel
+				t.start();
+				const size_t numpairs = P[0]->size() * P[1]->size();
+				std::vector<shared_ptr<PolySet>> result_parts(numpairs);
+				parallel_for(numpairs, [&](size_t k) {
+						result_parts[k].reset(convexMinkowski((*P[0])[k / P[1]->size()], (*P[1])[k % P[1]->size()]));
+					});
+				result_parts.erase(std::remove(result_parts.begin(), result_parts.end(), shared_ptr<PolySet>()),
+													 result_parts.end());
+				t.stop();
+				PRINTDB("Minkowski: Computing %d convex hulls took %f s", numpairs % t.time());
+				t.reset();
+
 				if (it != boost::next(children.begin()))
 					delete operands[0];
 
 				if (result_parts.size() == 1) {
-					PolySet *ps = new PolySet(3,true);
-					createPolySetFromPolyhedron(*result_parts.begin(), *ps);
-					operands[0] = ps;
+					operands[0] = new PolySet(*result_parts.front());
 				} else if (!result_parts.empty()) {
 					t.start();
 					PRINTDB("Minkowski: Computing union of %d parts",result_parts.size());
-					Geometry::Geometries fake_children;
-					for (std::list<CGAL::Polyhedron_3<Hull_kernel>>::iterator i = result_parts.begin(); i != result_parts.end(); ++i) {
-						PolySet ps(3,true);
-						createPolySetFromPolyhedron(*i, ps);
-						fake_children.push_back(std::make_pair((const AbstractNode*)NULL,
-															   shared_ptr<const Geometry>(createNefPolyhedronFromGeometry(ps))));
-					}
-					CGAL_Nef_polyhedron *N = CGALUtils::applyOperator(fake_children, OPENSCAD_UNION);
-					// FIXME: This hould really never throw.
-					// Assert once we figured out what went wrong with issue #1069?
-					if (!N) throw 0;
+					operands[0] = applyBalancedUnion(result_parts);
 					t.stop();
 					PRINTDB("Minkowski: Union done: %f s",t.time());
 					t.reset();
-					operands[0] = N;
 				} else {
                     operands[0] = new CGAL_Nef_polyhedron();
 				}
+				operandids[0].clear();
 			}
 
 			t_tot.stop();
@@ -43,23 +43,26 @@ namespace /* anonymous */ {
 		void operator()(HDS& hds) {
 			CGAL_Polybuilder B(hds, true);
 		
-			Grid3d<int> grid(GRID_FINE);
+			// Align all vertices to grid in one batch and build vertex array in vertices
+			std::vector<Vector3d> allvertices;
+			for(const auto &p : ps.polygons) {
+				for (const auto &v : boost::adaptors::reverse(p)) allvertices.push_back(v);
+			}
+			VertexWelder welder(GRID_FINE);
+			std::vector<int> allindices = welder.align(allvertices);
+
 			std::vector<CGALPoint> vertices;
+			vertices.reserve(welder.size());
+			for (size_t i = 0; i < welder.size(); i++) {
+				Vector3d v = welder.vertex(i);
+				vertices.push_back(CGALPoint(v[0], v[1], v[2]));
+			}
 			std::vector<std::vector<size_t>> indices;
-
-			// Align all vertices to grid and build vertex array in vertices
+			indices.reserve(ps.polygons.size());
+			size_t offset = 0;
 			for(const auto &p : ps.polygons) {
-				indices.push_back(std::vector<size_t>());
-				indices.back().reserve(p.size());
-				for (auto v : boost::adaptors::reverse(p)) {
-					// align v to the grid; the CGALPoint will receive the aligned vertex
-					size_t idx = grid.align(v);
-					if (idx == vertices.size()) {
-						CGALPoint p(v[0], v[1], v[2]);
-						vertices.push_back(p);
-					}
-					indices.back().push_back(idx);
-				}
+				indices.push_back(std::vector<size_t>(allindices.begin() + offset, allindices.begin() + offset + p.size()));
+				offset += p.size();
 			}
 
 #ifdef GEN_SURFACE_DEBUG
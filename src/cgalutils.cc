@@ -260,13 +260,29 @@ namespace CGALUtils {
 */
 #if 1
 	bool createPolySetFromNefPolyhedron3(const CGAL_Nef_polyhedron3 &N, PolySet &ps)
+	{
+		IndexedTriangleMesh mesh;
+		bool err = createTriangleMeshFromNefPolyhedron3(N, mesh);
+		for(const auto &t : mesh.triangles) {
+			ps.append_poly();
+			ps.append_vertex(mesh.vertices[t[0]]);
+			ps.append_vertex(mesh.vertices[t[1]]);
+			ps.append_vertex(mesh.vertices[t[2]]);
+		}
+		return err;
+	}
+
+/*
+	Create an indexed triangle mesh from a Nef Polyhedron 3, with each vertex
+	stored once. Returns false on success, true on failure.
+*/
+	bool createTriangleMeshFromNefPolyhedron3(const CGAL_Nef_polyhedron3 &N, IndexedTriangleMesh &mesh)
 	{
 		// 1. Build Indexed PolyMesh
 		// 2. Validate mesh (manifoldness)
 		// 3. Triangulate each face
 		//    -> IndexedTriangleMesh
 		// 4. Validate mesh (manifoldness)
-		// 5. Create PolySet
 
 		bool err = false;
 
@@ -373,12 +389,8 @@ namespace CGALUtils {
 			PRINTB("Error: Non-manifold triangle mesh created: %d unconnected edges", unconnected2);
 		}
 
-		for(const auto &t : allTriangles) {
-			ps.append_poly();
-			ps.append_vertex(verts[t[0]]);
-			ps.append_vertex(verts[t[1]]);
-			ps.append_vertex(verts[t[2]]);
-		}
+		allVertices.copy(std::back_inserter(mesh.vertices));
+		mesh.triangles = std::move(allTriangles);
 
 #if 0 // For debugging
 		std::cerr.precision(20);
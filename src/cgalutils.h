@@ -19,14 +19,18 @@ namespace /* anonymous */ {
 }
 
 namespace CGALUtils {
-	bool applyHull(const Geometry::Geometries &children, PolySet &P);
+	bool applyHull(const Geometry::Geometries &children, PolySet &P,
+								 const std::vector<std::string> &ids = std::vector<std::string>());
+	Polygon2d *applyHull2D(const std::vector<const Polygon2d *> &children,
+												 const std::vector<std::string> &ids = std::vector<std::string>());
 	CGAL_Nef_polyhedron *applyOperator(const Geometry::Geometries &children, OpenSCADOperator op);
 	//FIXME: Old, can be removed:
 	//void applyBinaryOperator(CGAL_Nef_polyhedron &target, const CGAL_Nef_polyhedron &src, OpenSCADOperator op);
 	Polygon2d *project(const CGAL_Nef_polyhedron &N, bool cut);
 	CGAL_Iso_cuboid_3 boundingBox(const CGAL_Nef_polyhedron3 &N);
 	bool is_approximately_convex(const PolySet &ps);
-	Geometry const* applyMinkowski(const Geometry::Geometries &children);
+	Geometry const* applyMinkowski(const Geometry::Geometries &children,
+																 const std::vector<std::string> &ids = std::vector<std::string>());
 
 	template <typename Polyhedron> std::string printPolyhedron(const Polyhedron &p);
 	template <typename Polyhedron> bool createPolySetFromPolyhedron(const Polyhedron &p, PolySet &ps);
@@ -36,6 +40,7 @@ namespace CGALUtils {
 
 	CGAL_Nef_polyhedron *createNefPolyhedronFromGeometry(const class Geometry &geom);
 	bool createPolySetFromNefPolyhedron3(const CGAL_Nef_polyhedron3 &N, PolySet &ps);
+	bool createTriangleMeshFromNefPolyhedron3(const CGAL_Nef_polyhedron3 &N, IndexedTriangleMesh &mesh);
 
 	bool tessellatePolygon(const PolygonK &polygon,
 												 Polygons &triangles,
@@ -1,5 +1,8 @@
 #include "clipper-utils.h"
 #include "printutils.h"
+#include "parallel.h"
+
+#include <algorithm>
 
 namespace ClipperUtils {
 
@@ -16,6 +19,9 @@ namespace ClipperUtils {
 	}
 
 	ClipperLib::Paths fromPolygon2d(const Polygon2d &poly) {
+		// Polygons created by Clipper are already in integer space
+		if (const ClipperLib::Paths *paths = poly.clipperPaths()) return *paths;
+
 		ClipperLib::Paths result;
 		for(const auto &outline : poly.outlines()) {
 			result.push_back(fromOutline2d(outline, poly.isSanitized() ? true : false));
@@ -24,6 +30,7 @@ namespace ClipperUtils {
 	}
 
 	Polygon2d *sanitize(const Polygon2d &poly) {
+		if (poly.clipperPaths()) return new Polygon2d(poly);
 		return toPolygon2d(sanitize(ClipperUtils::fromPolygon2d(poly)));
 	}
 
@@ -48,34 +55,50 @@ namespace ClipperUtils {
 	 have an explicit notion of holes.
 	 We could use a Paths structure, but we'd have to check the orientation of each
 	 path before adding it to the Polygon2d.
+
+	 The resulting Polygon2d keeps the cleaned paths as its native representation,
+	 and only converts them to outlines when these are accessed.
  */
 	Polygon2d *toPolygon2d(const ClipperLib::PolyTree &poly) {
 		const double CLEANING_DISTANCE = 0.001 * CLIPPER_SCALE;
 
-		Polygon2d *result = new Polygon2d;
+		ClipperLib::Paths paths;
+		std::vector<bool> positive;
 		const ClipperLib::PolyNode *node = poly.GetFirst();
 		while (node) {
-			Outline2d outline;
-			// Apparently, when using offset(), clipper gets the hole status wrong
-			//outline.positive = !node->IsHole();
-			outline.positive = Orientation(node->Contour);
-
 			ClipperLib::Path cleaned_path;
 			ClipperLib::CleanPolygon(node->Contour, cleaned_path, CLEANING_DISTANCE);
 
 			// CleanPolygon can in some cases reduce the polygon down to no vertices
 			if (cleaned_path.size() >= 3)  {
-				for(const auto &ip : cleaned_path) {
-					Vector2d v(1.0*ip.X/CLIPPER_SCALE, 1.0*ip.Y/CLIPPER_SCALE);
-					outline.vertices.push_back(v);
-				}
-				result->addOutline(outline);
+				// Apparently, when using offset(), clipper gets the hole status wrong
+				//positive.push_back(!node->IsHole());
+				positive.push_back(Orientation(node->Contour));
+				paths.push_back(std::move(cleaned_path));
 			}
 
 			node = node->GetNext();
 		}
-		result->setSanitized(true);
-		return result;
+		return new Polygon2d(paths, positive);
+	}
+
+	/*!
+		Converts the result of a Clipper operation given as Paths, see toPolygon2d(PolyTree).
+	*/
+	Polygon2d *toPolygon2d(const ClipperLib::Paths &poly) {
+		const double CLEANING_DISTANCE = 0.001 * CLIPPER_SCALE;
+
+		ClipperLib::Paths paths;
+		std::vector<bool> positive;
+		for (const auto &path : poly) {
+			ClipperLib::Path cleaned_path;
+			ClipperLib::CleanPolygon(path, cleaned_path, CLEANING_DISTANCE);
+			if (cleaned_path.size() >= 3)  {
+				positive.push_back(Orientation(path));
+				paths.push_back(std::move(cleaned_path));
+			}
+		}
+		return new Polygon2d(paths, positive);
 	}
 
 	ClipperLib::Paths process(const ClipperLib::Paths &polygons, 
@@ -89,14 +112,210 @@ namespace ClipperUtils {
 		return result;
 	}
 
+	// With fewer operands, a single Clipper sweep is faster than partitioning
+	static const size_t PARTITION_THRESHOLD = 64;
+	// Number of operands unioned in one sweep before results are merged pairwise
+	static const size_t UNION_GROUP_SIZE = 32;
+
+	struct BoundingBox2i {
+		ClipperLib::cInt minx, miny, maxx, maxy;
+		bool empty() const { return minx > maxx; }
+		bool intersects(const BoundingBox2i &other) const {
+			return !empty() && !other.empty() &&
+				minx <= other.maxx && other.minx <= maxx && miny <= other.maxy && other.miny <= maxy;
+		}
+	};
+
+	static BoundingBox2i boundingBox(const ClipperLib::Paths &paths)
+	{
+		BoundingBox2i bbox = {1, 1, 0, 0};
+		for (const auto &path : paths) {
+			for (const auto &p : path) {
+				if (bbox.empty()) {
+					bbox.minx = bbox.maxx = p.X;
+					bbox.miny = bbox.maxy = p.Y;
+				}
+				else {
+					bbox.minx = std::min(bbox.minx, p.X);
+					bbox.maxx = std::max(bbox.maxx, p.X);
+					bbox.miny = std::min(bbox.miny, p.Y);
+					bbox.maxy = std::max(bbox.maxy, p.Y);
+				}
+			}
+		}
+		return bbox;
+	}
+
+	static size_t findRoot(std::vector<size_t> &parent, size_t i)
+	{
+		while (parent[i] != i) i = parent[i] = parent[parent[i]];
+		return i;
+	}
+
+	/*!
+		Partitions the operands into clusters such that no operand overlaps the
+		bounding box of an operand in another cluster. Since geometry can only
+		interact within its bounding box, the clusters can be processed independently.
+		Operands with empty bounding boxes are dropped.
+	*/
+	static std::vector<std::vector<size_t>> partition(const std::vector<BoundingBox2i> &bboxes)
+	{
+		std::vector<size_t> order;
+		for (size_t i = 0; i < bboxes.size(); i++) {
+			if (!bboxes[i].empty()) order.push_back(i);
+		}
+		// Stable, so the order of clusters and operands doesn't depend on the platform
+		std::stable_sort(order.begin(), order.end(), [&bboxes](size_t a, size_t b) {
+				return bboxes[a].minx < bboxes[b].minx;
+			});
+
+		// Sweep along x, comparing each box only to boxes still overlapping in x
+		std::vector<size_t> parent(bboxes.size());
+		for (size_t i = 0; i < parent.size(); i++) parent[i] = i;
+		std::vector<size_t> active;
+		for (const auto &i : order) {
+			size_t n = 0;
+			for (const auto &j : active) {
+				if (bboxes[j].maxx < bboxes[i].minx) continue;
+				active[n++] = j;
+				if (bboxes[i].intersects(bboxes[j])) parent[findRoot(parent, i)] = findRoot(parent, j);
+			}
+			active.resize(n);
+			active.push_back(i);
+		}
+
+		std::vector<std::vector<size_t>> clusters;
+		std::vector<size_t> clusterindex(bboxes.size(), size_t(-1));
+		for (const auto &i : order) {
+			size_t root = findRoot(parent, i);
+			if (clusterindex[root] == size_t(-1)) {
+				clusterindex[root] = clusters.size();
+				clusters.push_back(std::vector<size_t>());
+			}
+			clusters[clusterindex[root]].push_back(i);
+		}
+		return clusters;
+	}
+
+	static ClipperLib::Paths unionPaths(const std::vector<const ClipperLib::Paths *> &operands)
+	{
+		ClipperLib::Clipper clipper;
+		for (const auto &paths : operands) clipper.AddPaths(*paths, ClipperLib::ptSubject, true);
+		ClipperLib::Paths result;
+		clipper.Execute(ClipperLib::ctUnion, result, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+		return result;
+	}
+
+	/*!
+		Unions small groups of operands in parallel, then merges the results pairwise
+		in a balanced tree, also in parallel.
+	*/
+	static ClipperLib::Paths balancedUnion(const std::vector<const ClipperLib::Paths *> &operands)
+	{
+		if (operands.size() <= UNION_GROUP_SIZE) return unionPaths(operands);
+
+		std::vector<ClipperLib::Paths> results((operands.size() + UNION_GROUP_SIZE - 1) / UNION_GROUP_SIZE);
+		parallel_for(results.size(), [&](size_t i) {
+				std::vector<const ClipperLib::Paths *> group(operands.begin() + i * UNION_GROUP_SIZE,
+																										 operands.begin() + std::min(operands.size(), (i + 1) * UNION_GROUP_SIZE));
+				results[i] = unionPaths(group);
+			});
+		while (results.size() > 1) {
+			std::vector<ClipperLib::Paths> merged((results.size() + 1) / 2);
+			parallel_for(merged.size(), [&](size_t i) {
+					if (2 * i + 1 < results.size()) {
+						std::vector<const ClipperLib::Paths *> pair = {&results[2 * i], &results[2 * i + 1]};
+						merged[i] = unionPaths(pair);
+					}
+					else merged[i].swap(results[2 * i]);
+				});
+			results.swap(merged);
+		}
+		return results.front();
+	}
+
+	/*!
+		Union of many operands: Spatially independent clusters of operands are
+		unioned in parallel, and their results are concatenated. Large clusters
+		are unioned using balancedUnion().
+	*/
+	static Polygon2d *applyPartitionedUnion(const std::vector<ClipperLib::Paths> &pathsvector)
+	{
+		std::vector<BoundingBox2i> bboxes(pathsvector.size());
+		parallel_for(pathsvector.size(), [&](size_t i) { bboxes[i] = boundingBox(pathsvector[i]); });
+		std::vector<std::vector<size_t>> clusters = partition(bboxes);
+		PRINTDB("Union: %d operands in %d independent clusters", pathsvector.size() % clusters.size());
+
+		std::vector<ClipperLib::Paths> results(clusters.size());
+		std::vector<size_t> small, large;
+		for (size_t i = 0; i < clusters.size(); i++) {
+			(clusters[i].size() > UNION_GROUP_SIZE ? large : small).push_back(i);
+		}
+		parallel_for(small.size(), [&](size_t k) {
+				const std::vector<size_t> &cluster = clusters[small[k]];
+				if (cluster.size() == 1) {
+					// A single sanitized operand is already its own union
+					results[small[k]] = pathsvector[cluster.front()];
+					return;
+				}
+				std::vector<const ClipperLib::Paths *> operands;
+				for (const auto &i : cluster) operands.push_back(&pathsvector[i]);
+				results[small[k]] = unionPaths(operands);
+			});
+		// Large clusters parallelize internally
+		for (const auto &c : large) {
+			std::vector<const ClipperLib::Paths *> operands;
+			for (const auto &i : clusters[c]) operands.push_back(&pathsvector[i]);
+			results[c] = balancedUnion(operands);
+		}
+
+		ClipperLib::Paths result;
+		for (auto &paths : results) result.insert(result.end(), paths.begin(), paths.end());
+		return toPolygon2d(result);
+	}
+
+	/*!
+		Difference with many operands: Operands not touching the first operand
+		are dropped, and the rest is unioned in parallel before being subtracted.
+	*/
+	static Polygon2d *applyPartitionedDifference(const std::vector<ClipperLib::Paths> &pathsvector)
+	{
+		BoundingBox2i subjectbox = boundingBox(pathsvector[0]);
+		std::vector<char> overlaps(pathsvector.size());
+		parallel_for(pathsvector.size() - 1, [&](size_t i) {
+				overlaps[i + 1] = boundingBox(pathsvector[i + 1]).intersects(subjectbox);
+			});
+		std::vector<const ClipperLib::Paths *> operands;
+		for (size_t i = 1; i < pathsvector.size(); i++) {
+			if (overlaps[i]) operands.push_back(&pathsvector[i]);
+		}
+		PRINTDB("Difference: %d of %d operands overlap", operands.size() % (pathsvector.size() - 1));
+
+		ClipperLib::Clipper clipper;
+		clipper.AddPaths(pathsvector[0], ClipperLib::ptSubject, true);
+		if (!operands.empty()) clipper.AddPaths(balancedUnion(operands), ClipperLib::ptClip, true);
+		ClipperLib::PolyTree result;
+		clipper.Execute(ClipperLib::ctDifference, result, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+		return ClipperUtils::toPolygon2d(result);
+	}
+
 	/*!
 		Apply the clipper operator to the given paths.
+		Each element of pathsvector is expected to be sanitized.
+
+		Unions and differences of many operands are split into independent
+		parts which are processed in parallel.
 
      May return an empty Polygon2d, but will not return NULL.
 	 */
 	Polygon2d *apply(const std::vector<ClipperLib::Paths> &pathsvector,
 									 ClipperLib::ClipType clipType)
 	{
+		if (pathsvector.size() >= PARTITION_THRESHOLD) {
+			if (clipType == ClipperLib::ctUnion) return applyPartitionedUnion(pathsvector);
+			if (clipType == ClipperLib::ctDifference) return applyPartitionedDifference(pathsvector);
+		}
+
 		ClipperLib::Clipper clipper;
 
 		if (clipType == ClipperLib::ctIntersection && pathsvector.size() >= 2) {
@@ -136,12 +355,15 @@ namespace ClipperUtils {
 	Polygon2d *apply(const std::vector<const Polygon2d*> &polygons, 
 									 ClipperLib::ClipType clipType)
 	{
-		std::vector<ClipperLib::Paths> pathsvector;
-		for(const auto &polygon : polygons) {
+		std::vector<ClipperLib::Paths> pathsvector(polygons.size());
+		auto convert = [&](size_t i) {
+			const Polygon2d *polygon = polygons[i];
 			ClipperLib::Paths polypaths = fromPolygon2d(*polygon);
 			if (!polygon->isSanitized()) ClipperLib::PolyTreeToPaths(sanitize(polypaths), polypaths);
-			pathsvector.push_back(polypaths);
-		}
+			pathsvector[i].swap(polypaths);
+		};
+		if (polygons.size() >= PARTITION_THRESHOLD) parallel_for(polygons.size(), convert);
+		else for (size_t i = 0; i < polygons.size(); i++) convert(i);
 		Polygon2d *res = apply(pathsvector, clipType);
         assert(res);
 		return res;
@@ -35,38 +35,72 @@
 #include <boost/filesystem.hpp>
 namespace fs = boost::filesystem;
 
-// $children is not a config_variable. config_variables have dynamic scope, 
-// meaning they are passed down the call chain implicitly.
-// $children is simply misnamed and shouldn't have included the '$'.
-static bool is_config_variable(const std::string &name) {
-	return name[0] == '$' && name != "$children";
-}
-
 /*!
 	Initializes this context. Optionally initializes a context for an 
 	external library. Note that if parent is null, a new stack will be
 	created, and all children will share the root parent's stack.
 */
+thread_local Context::Stack *Context::thread_stack = NULL;
+
 Context::Context(const Context *parent)
-	: parent(parent)
+	: parent(parent), forked(false), outer_thread_stack(NULL)
 {
 	if (parent) {
 		assert(parent->ctx_stack && "Parent context stack was null!");
-		this->ctx_stack = parent->ctx_stack;
+		this->ctx_stack = thread_stack ? thread_stack : parent->ctx_stack;
 		this->document_path = parent->document_path;
 	}
 	else {
 		this->ctx_stack = new Stack;
 	}
 
-	this->ctx_stack->push_back(this);
+	this->depth = this->ctx_stack->contexts.size();
+	this->ctx_stack->contexts.push_back(this);
+}
+
+/*!
+	Initializes a child context of parent with a new stack, so the calling
+	thread can evaluate in it while other threads use parent's stack.
+	The new stack starts with the $-variables visible to parent.
+	Contexts created by the calling thread use the new stack until this
+	context is destroyed, which must happen in the same thread.
+*/
+Context::Context(const Context *parent, Fork)
+	: parent(parent), forked(true), outer_thread_stack(thread_stack)
+{
+	assert(parent && parent->ctx_stack && "Parent context stack was null!");
+	this->document_path = parent->document_path;
+
+	const Stack *outer = thread_stack ? thread_stack : parent->ctx_stack;
+	this->ctx_stack = new Stack;
+	// The inherited bindings belong to a placeholder at depth 0
+	this->ctx_stack->contexts.push_back(NULL);
+	this->ctx_stack->bindings.resize(outer->bindings.size());
+	for (size_t i = 0; i < outer->bindings.size(); i++) {
+		if (!outer->bindings[i].empty()) {
+			this->ctx_stack->bindings[i].push_back(std::make_pair(size_t(0), outer->bindings[i].back().second));
+		}
+	}
+	this->depth = this->ctx_stack->contexts.size();
+	this->ctx_stack->contexts.push_back(this);
+	thread_stack = this->ctx_stack;
 }
 
 Context::~Context()
 {
 	assert(this->ctx_stack && "Context stack was null at destruction!");
-	this->ctx_stack->pop_back();
-	if (!parent) delete this->ctx_stack;
+	// All contexts nested in this one are gone, so our bindings are innermost
+	for (const auto &var : this->config_variables) {
+		auto &bindings = this->ctx_stack->bindings[var.first.index()];
+		assert(!bindings.empty() && bindings.back().first == this->depth);
+		bindings.pop_back();
+	}
+	this->ctx_stack->contexts.pop_back();
+	if (this->forked) {
+		thread_stack = this->outer_thread_stack;
+		delete this->ctx_stack;
+	}
+	else if (!parent) delete this->ctx_stack;
 }
 
 const Context::Expressions Context::getExpressions(const AssignmentList &args, const EvalContext *evalctx)
@@ -99,35 +133,75 @@ const Context::Expressions Context::getExpressions(const AssignmentList &args, c
 /*!
 	Initialize context from a module argument list and a evaluation context
 	which may pass variables which will be preferred over default values.
+
+	Same rules as getExpressions(), but works on the interned symbols of the
+	arguments.
 */
-const Context::Expressions Context::setVariables(const AssignmentList &args, const EvalContext *evalctx)
+void Context::setVariables(const AssignmentList &args, const EvalContext *evalctx)
 {
-	const Expressions expressions = getExpressions(args, evalctx);
+	std::vector<std::pair<const Assignment *, const Expression *>> expressions;
+	expressions.reserve(args.size() + (evalctx ? evalctx->numArgs() : 0));
+	auto assign = [&expressions](const Assignment &arg, const Expression *expr) {
+		for (auto &e : expressions) {
+			if (e.first->symbol == arg.symbol) {
+				e.second = expr;
+				return;
+			}
+		}
+		expressions.push_back(std::make_pair(&arg, expr));
+	};
+
+	for (const auto &arg : args) assign(arg, arg.expr.get());
+	if (evalctx) {
+		size_t posarg = 0;
+		for (const auto &arg : evalctx->getArgs()) {
+			if (arg.name.empty()) {
+				if (posarg < args.size()) assign(args[posarg++], arg.expr.get());
+			}
+			else {
+				assign(arg, arg.expr.get());
+			}
+		}
+	}
+
+	// Evaluate in the same order as before symbols were introduced, which is
+	// visible through echo() and warnings
+	std::sort(expressions.begin(), expressions.end(), [](const std::pair<const Assignment *, const Expression *> &a, const std::pair<const Assignment *, const Expression *> &b) {
+		return a.first->name < b.first->name;
+	});
 	for (const auto &expr : expressions) {
 		const ValuePtr val = expr.second ? expr.second->evaluate(evalctx) : ValuePtr::undefined;
-		this->set_variable(expr.first, val);
+		this->set_variable(expr.first->symbol, val);
 	}
-	return expressions;
 }
 
-void Context::set_variable(const std::string &name, const ValuePtr &value)
+void Context::set_variable(const Symbol &symbol, const ValuePtr &value)
 {
-	if (is_config_variable(name)) this->config_variables[name] = value;
-	else this->variables[name] = value;
-}
+	if (!symbol.isConfigVariable()) {
+		this->variables.set(symbol, value);
+		return;
+	}
 
-void Context::set_variable(const std::string &name, const Value &value)
-{
-	set_variable(name, ValuePtr(value));
+	this->config_variables.set(symbol, value);
+	auto &allbindings = this->ctx_stack->bindings;
+	if (size_t(symbol.index()) >= allbindings.size()) allbindings.resize(symbol.index() + 1);
+	auto &bindings = allbindings[symbol.index()];
+	// Usually this is the innermost context, but outer contexts may still be
+	// assigned to while nested contexts exist
+	auto it = bindings.end();
+	while (it != bindings.begin() && (it - 1)->first > this->depth) --it;
+	if (it != bindings.begin() && (it - 1)->first == this->depth) (it - 1)->second = value;
+	else bindings.insert(it, std::make_pair(this->depth, value));
 }
 
 void Context::set_constant(const std::string &name, const ValuePtr &value)
 {
-	if (this->constants.find(name) != this->constants.end()) {
+	Symbol symbol(name);
+	if (this->constants.find(symbol)) {
 		PRINTB("WARNING: Attempt to modify constant '%s'.", name);
 	}
 	else {
-		this->constants[name] = value;
+		this->constants.set(symbol, value);
 	}
 }
 
@@ -138,43 +212,42 @@ void Context::set_constant(const std::string &name, const Value &value)
 
 void Context::apply_variables(const Context &other)
 {
-	for (ValueMap::const_iterator it = other.variables.begin();it != other.variables.end();it++) {
-		set_variable((*it).first, (*it).second);
+	for (const auto &var : other.variables) {
+		set_variable(var.first, var.second);
 	}
 }
 
-ValuePtr Context::lookup_variable(const std::string &name, bool silent) const
+ValuePtr Context::lookup_variable(const Symbol &symbol, bool silent) const
 {
 	if (!this->ctx_stack) {
 		PRINT("ERROR: Context had null stack in lookup_variable()!!");
 		return ValuePtr::undefined;
 	}
-	if (is_config_variable(name)) {
-		for (int i = this->ctx_stack->size()-1; i >= 0; i--) {
-			const ValueMap &confvars = ctx_stack->at(i)->config_variables;
-			if (confvars.find(name) != confvars.end())
-				return confvars.find(name)->second;
+	if (symbol.isConfigVariable()) {
+		const auto &allbindings = this->ctx_stack->bindings;
+		if (size_t(symbol.index()) < allbindings.size() && !allbindings[symbol.index()].empty()) {
+			return allbindings[symbol.index()].back().second;
 		}
 		return ValuePtr::undefined;
 	}
-	if (!this->parent && this->constants.find(name) != this->constants.end())
-		return this->constants.find(name)->second;
-	if (this->variables.find(name) != this->variables.end())
-		return this->variables.find(name)->second;
-	if (this->parent)
-		return this->parent->lookup_variable(name, silent);
+	for (const Context *c = this; c; c = c->parent) {
+		if (!c->parent) {
+			if (const ValuePtr *v = c->constants.find(symbol)) return *v;
+		}
+		if (const ValuePtr *v = c->variables.find(symbol)) return *v;
+	}
 	if (!silent)
-		PRINTB("WARNING: Ignoring unknown variable '%s'.", name);
+		PRINTB("WARNING: Ignoring unknown variable '%s'.", symbol.name());
 	return ValuePtr::undefined;
 }
 
-bool Context::has_local_variable(const std::string &name) const
+bool Context::has_local_variable(const Symbol &symbol) const
 {
-	if (is_config_variable(name))
-		return config_variables.find(name) != config_variables.end();
-	if (!parent && constants.find(name) != constants.end())
+	if (symbol.isConfigVariable())
+		return this->config_variables.find(symbol) != NULL;
+	if (!parent && this->constants.find(symbol))
 		return true;
-	return variables.find(name) != variables.end();
+	return this->variables.find(symbol) != NULL;
 }
 
 /**
@@ -231,20 +304,20 @@ std::string Context::dump(const AbstractModule *mod, const ModuleInstantiation *
 		if (m) {
 			s << "  module args:";
 			for(const auto &arg : m->definition_arguments) {
-				s << boost::format("    %s = %s") % arg.name % variables[arg.name];
+				const ValuePtr *v = variables.find(arg.symbol);
+				s << boost::format("    %s = %s") % arg.name % (v ? *v : ValuePtr::undefined);
 			}
 		}
 	}
-	typedef std::pair<std::string, ValuePtr> ValueMapType;
 	s << "  vars:";
 	for(const auto &v : constants) {
-		s << boost::format("    %s = %s") % v.first % v.second;
+		s << boost::format("    %s = %s") % v.first.name() % v.second;
 	}
 	for(const auto &v : variables) {
-		s << boost::format("    %s = %s") % v.first % v.second;
+		s << boost::format("    %s = %s") % v.first.name() % v.second;
 	}
 	for(const auto &v : config_variables) {
-		s << boost::format("    %s = %s") % v.first % v.second;
+		s << boost::format("    %s = %s") % v.first.name() % v.second;
 	}
 	return s.str();
 }
@@ -7,14 +7,17 @@
 #include "value.h"
 #include "Assignment.h"
 #include "memory.h"
+#include "Symbol.h"
+#include "FlatHashMap.h"
 
 class Context
 {
 public:
-	typedef std::vector<const Context*> Stack;
 	typedef std::map<std::string, const class Expression *> Expressions;
 
 	Context(const Context *parent = NULL);
+	struct Fork {};
+	Context(const Context *parent, Fork);
 	virtual ~Context();
 
 	const Context *getParent() const { return this->parent; }
@@ -22,28 +25,97 @@ public:
 	virtual class AbstractNode *instantiate_module(const class ModuleInstantiation &inst, EvalContext *evalctx) const;
 
 	const Expressions getExpressions(const AssignmentList &args, const class EvalContext *evalctx);
-	const Expressions setVariables(const AssignmentList &args, const class EvalContext *evalctx = NULL);
+	void setVariables(const AssignmentList &args, const class EvalContext *evalctx = NULL);
 
-	void set_variable(const std::string &name, const ValuePtr &value);
-	void set_variable(const std::string &name, const Value &value);
+	void set_variable(const Symbol &symbol, const ValuePtr &value);
+	void set_variable(const std::string &name, const ValuePtr &value) { set_variable(Symbol(name), value); }
+	void set_variable(const std::string &name, const Value &value) { set_variable(Symbol(name), ValuePtr(value)); }
 	void set_constant(const std::string &name, const ValuePtr &value);
 	void set_constant(const std::string &name, const Value &value);
 
 	void apply_variables(const Context &other);
-	ValuePtr lookup_variable(const std::string &name, bool silent = false) const;
-	bool has_local_variable(const std::string &name) const;
+	ValuePtr lookup_variable(const Symbol &symbol, bool silent = false) const;
+	ValuePtr lookup_variable(const std::string &name, bool silent = false) const { return lookup_variable(Symbol(name), silent); }
+	bool has_local_variable(const Symbol &symbol) const;
+	bool has_local_variable(const std::string &name) const { return has_local_variable(Symbol(name)); }
 
 	void setDocumentPath(const std::string &path) { this->document_path = path; }
 	const std::string &documentPath() const { return this->document_path; }
 	std::string getAbsolutePath(const std::string &filename) const;
-        
-public:
 
 protected:
+	/*!
+		Variables of a single context, keyed by symbol. Most contexts only hold a
+		few variables, which are found fastest by scanning a flat array; larger
+		maps, like the top-level assignments of a file, also get a hash index.
+	*/
+	class ValueMap
+	{
+	public:
+		typedef std::vector<std::pair<Symbol, ValuePtr>>::const_iterator const_iterator;
+
+		const ValuePtr *find(const Symbol &symbol) const {
+			int i = position(symbol);
+			return i < 0 ? NULL : &this->entries[i].second;
+		}
+		void set(const Symbol &symbol, const ValuePtr &value) {
+			int i = position(symbol);
+			if (i >= 0) {
+				this->entries[i].second = value;
+				return;
+			}
+			this->entries.push_back(std::make_pair(symbol, value));
+			if (this->entries.size() > indexThreshold) {
+				for (size_t j = this->index.size(); j < this->entries.size(); j++) {
+					this->index.insert(this->entries[j].first.index(), int(j));
+				}
+			}
+		}
+		size_t size() const { return this->entries.size(); }
+		const_iterator begin() const { return this->entries.begin(); }
+		const_iterator end() const { return this->entries.end(); }
+
+	private:
+		static const size_t indexThreshold = 16;
+
+		int position(const Symbol &symbol) const {
+			if (this->entries.size() > indexThreshold) return this->index.find(symbol.index());
+			for (size_t i = 0; i < this->entries.size(); i++) {
+				if (this->entries[i].first == symbol) return int(i);
+			}
+			return -1;
+		}
+
+		std::vector<std::pair<Symbol, ValuePtr>> entries;
+		FlatHashMap<int> index;
+	};
+
+	/*!
+		Shared by a root context and all its descendants, unless they are created
+		in a thread with a forked context. Contexts are pushed when created and
+		popped when destroyed, so the contexts in the stack are always nested in
+		each other.
+
+		$-variables have dynamic scope: a lookup finds the binding of the innermost
+		context on the stack defining the variable, regardless of which context
+		the lookup starts in. To make this O(1), the bindings of each symbol are
+		kept sorted by the depth of their context; the innermost one is at the back.
+	*/
+	struct Stack {
+		std::vector<const Context *> contexts;
+		std::vector<std::vector<std::pair<size_t, ValuePtr>>> bindings; // by symbol index
+	};
+
 	const Context *parent;
 	Stack *ctx_stack;
+	size_t depth; // Position in ctx_stack
+
+	// Set while a forked context lives in a thread. Contexts created by that thread
+	// use this stack, even when their parent belongs to another thread.
+	static thread_local Stack *thread_stack;
+	bool forked;
+	Stack *outer_thread_stack;
 
-	typedef std::unordered_map<std::string, ValuePtr> ValueMap;
 	ValueMap constants;
 	ValueMap variables;
 	ValueMap config_variables;
@@ -32,7 +32,10 @@
 #include "expression.h"
 #include "builtin.h"
 #include "printutils.h"
+#include "ParallelInstantiation.h"
 #include <cstdint>
+#include <limits>
+#include <algorithm>
 #include <sstream>
 
 class ControlModule : public AbstractModule
@@ -56,7 +59,7 @@ public: // methods
 
 	virtual AbstractNode *instantiate(const Context *ctx, const ModuleInstantiation *inst, EvalContext *evalctx) const;
 
-	static void for_eval(AbstractNode &node, const ModuleInstantiation &inst, size_t l, 
+	static void for_eval(std::vector<AbstractNode*> &children, const ModuleInstantiation &inst, size_t l, 
 						 const Context *ctx, const EvalContext *evalctx);
 
 	static const EvalContext* getLastModuleCtx(const EvalContext *evalctx);
@@ -68,45 +71,70 @@ private: // data
 
 }; // class ControlModule
 
-void ControlModule::for_eval(AbstractNode &node, const ModuleInstantiation &inst, size_t l, 
+void ControlModule::for_eval(std::vector<AbstractNode*> &children, const ModuleInstantiation &inst, size_t l, 
 							const Context *ctx, const EvalContext *evalctx)
 {
 	if (evalctx->numArgs() > l) {
-		const std::string &it_name = evalctx->getArgName(l);
+		const Symbol &it_name = evalctx->getArgs()[l].symbol;
 		ValuePtr it_values = evalctx->getArgValue(l, ctx);
 		Context c(ctx);
 		if (it_values->type() == Value::RANGE) {
 			RangeType range = it_values->toRange();
+			// Ranges are iterated lazily, so only infinite ones need to be rejected
 			uint32_t steps = range.numValues();
-			if (steps >= 10000) {
+			if (steps == std::numeric_limits<uint32_t>::max()) {
 				PRINTB("WARNING: Bad range parameter in for statement: too many elements (%lu).", steps);
+			} else if (steps <= (1 << 20) && ParallelInstantiation::enabled(steps)) {
+				// Iterate to get the exact values of the serial loop
+				std::vector<double> values;
+				values.reserve(steps);
+				for (RangeType::iterator it = range.begin();it != range.end();it++) values.push_back(*it);
+				ParallelInstantiation::instantiate(values.size(), ctx, [&](size_t i, Context &itctx, std::vector<AbstractNode*> &nodes) {
+						itctx.set_variable(it_name, ValuePtr(values[i]));
+						for_eval(nodes, inst, l+1, &itctx, evalctx);
+					}, children);
 			} else {
+				// Single loops know their final size, avoid growing the child list. Don't
+				// trust huge ranges though, their bodies may not produce any nodes.
+				if (l == 0 && evalctx->numArgs() == 1) {
+					children.reserve(children.size() + std::min<size_t>(steps, 1 << 20) * inst.scope.children.size());
+				}
 				for (RangeType::iterator it = range.begin();it != range.end();it++) {
 					c.set_variable(it_name, ValuePtr(*it));
-					for_eval(node, inst, l+1, &c, evalctx);
+					for_eval(children, inst, l+1, &c, evalctx);
 				}
 			}
 		}
 		else if (it_values->type() == Value::VECTOR) {
-			for (size_t i = 0; i < it_values->toVector().size(); i++) {
-				c.set_variable(it_name, it_values->toVector()[i]);
-				for_eval(node, inst, l+1, &c, evalctx);
+			const Value::VectorType &vec = it_values->toVector();
+			if (ParallelInstantiation::enabled(vec.size())) {
+				ParallelInstantiation::instantiate(vec.size(), ctx, [&](size_t i, Context &itctx, std::vector<AbstractNode*> &nodes) {
+						itctx.set_variable(it_name, vec[i]);
+						for_eval(nodes, inst, l+1, &itctx, evalctx);
+					}, children);
+			} else {
+				if (l == 0 && evalctx->numArgs() == 1) {
+					children.reserve(children.size() + vec.size() * inst.scope.children.size());
+				}
+				for (size_t i = 0; i < vec.size(); i++) {
+					c.set_variable(it_name, vec[i]);
+					for_eval(children, inst, l+1, &c, evalctx);
+				}
 			}
 		}
 		else if (it_values->type() != Value::UNDEFINED) {
 			c.set_variable(it_name, it_values);
-			for_eval(node, inst, l+1, &c, evalctx);
+			for_eval(children, inst, l+1, &c, evalctx);
 		}
 	} else if (l > 0) {
 		// At this point, the for loop variables have been set and we can initialize
 		// the local scope (as they may depend on the for loop variables
 		Context c(ctx);
 		for(const auto &ass : inst.scope.assignments) {
-			c.set_variable(ass.name, ass.expr->evaluate(&c));
+			c.set_variable(ass.symbol, ass.expr->evaluate(&c));
 		}
 		
-		std::vector<AbstractNode *> instantiatednodes = inst.instantiateChildren(&c);
-		node.children.insert(node.children.end(), instantiatednodes.begin(), instantiatednodes.end());
+		inst.scope.instantiateChildren(&c, children);
 	}
 }
 
@@ -296,7 +324,7 @@ AbstractNode *ControlModule::instantiate(const Context* /*ctx*/, const ModuleIns
 		Context c(evalctx);
 		for (size_t i = 0; i < evalctx->numArgs(); i++) {
 			if (!evalctx->getArgName(i).empty())
-				c.set_variable(evalctx->getArgName(i), evalctx->getArgValue(i));
+				c.set_variable(evalctx->getArgs()[i].symbol, evalctx->getArgValue(i));
 		}
 		// Let any local variables override the parameters
 		inst->scope.apply(c);
@@ -307,12 +335,12 @@ AbstractNode *ControlModule::instantiate(const Context* /*ctx*/, const ModuleIns
 
 	case FOR:
 		node = new GroupNode(inst);
-		for_eval(*node, *inst, 0, evalctx, evalctx);
+		for_eval(node->children, *inst, 0, evalctx, evalctx);
 		break;
 
 	case INT_FOR:
 		node = new AbstractIntersectionNode(inst);
-		for_eval(*node, *inst, 0, evalctx, evalctx);
+		for_eval(node->children, *inst, 0, evalctx, evalctx);
 		break;
 
 	case IF: {
@@ -30,15 +30,21 @@
 #include "handle_dep.h"
 #include "calc.h"
 
+#include "numparse.h"
+#include "memory.h"
+
 #include <fstream>
 #include <assert.h>
+#include <clocale>
+#include <cstring>
+#include <ctime>
+#include <mutex>
 #include <unordered_map>
 #include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <algorithm>
 #include <sstream>
-#include <map>
+#include <set>
 
 #include "value.h"
 #include "boost-utils.h"
@@ -64,14 +70,157 @@ namespace fs=boost::filesystem;
 
 struct Line {
 	int idx[2]; // indices into DxfData::points
+	int node[2]; // endpoint nodes, shared by lines meeting at the same grid point
 	bool disabled;
-	Line(int i1 = -1, int i2 = -1) { idx[0] = i1; idx[1] = i2; disabled = false; }
+	Line(int i1 = -1, int i2 = -1, int n1 = -1, int n2 = -1) {
+		idx[0] = i1; idx[1] = i2; node[0] = n1; node[1] = n2; disabled = false;
+	}
+};
+
+namespace {
+
+/*!
+	A group code and its value. Values are converted to numbers once, when
+	the file is read.
+*/
+struct DxfGroup {
+	int id;
+	bool isnumber;
+	double number;
+	std::string data;
+
+	// Throws boost::bad_lexical_cast on illegal values
+	double toDouble() const { return this->isnumber ? this->number : boost::lexical_cast<double>(this->data); }
+};
+
+/*!
+	The groups of a DXF file, shared by all DxfData read from it.
+*/
+struct DxfFile {
+	std::vector<DxfGroup> groups;
+	std::string illegal_id; // Set if reading stopped at a line which isn't a group code
+};
+
+/*!
+	Files are cached by path, and reused as long as their modification time
+	and size are unchanged. This way importing several layers of a file, or
+	evaluating dxf_dim() and dxf_cross() on it, reads the file only once.
+*/
+struct DxfFileCacheEntry {
+	shared_ptr<const DxfFile> file;
+	std::time_t mtime;
+	uintmax_t size;
+	unsigned long lastused;
 };
 
+const size_t DXF_FILE_CACHE_SIZE = 8;
+std::unordered_map<std::string, DxfFileCacheEntry> dxf_file_cache;
+unsigned long dxf_file_cache_clock = 0;
+std::mutex dxf_file_cache_mutex;
+
+// Sets [b, e) to the next line without surrounding whitespace and advances p past it
+bool next_line(const char *&p, const char *end, const char *&b, const char *&e)
+{
+	if (p == end) return false;
+	const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+	if (!eol) eol = end;
+	b = p;
+	e = eol;
+	p = eol == end ? end : eol + 1;
+	while (b < e && std::isspace(static_cast<unsigned char>(*b))) b++;
+	while (e > b && std::isspace(static_cast<unsigned char>(e[-1]))) e--;
+	return true;
+}
+
+void read_dxf_groups(const char *p, const char *end, DxfFile &file)
+{
+	const char *idbegin, *idend, *databegin, *dataend;
+	while (next_line(p, end, idbegin, idend)) {
+		bool hasdata = next_line(p, end, databegin, dataend);
+		if (!hasdata) databegin = dataend = end;
+
+		const char *q = idbegin;
+		long id;
+		if (!NumParse::parseInt(q, idend, id) || q != idend) {
+			// A trailing line is just ignored
+			if (hasdata) file.illegal_id.assign(idbegin, idend);
+			break;
+		}
+
+		file.groups.push_back(DxfGroup());
+		DxfGroup &group = file.groups.back();
+		group.id = int(id);
+		group.data.assign(databegin, dataend);
+		q = databegin;
+		group.isnumber = NumParse::parseDouble(q, dataend, group.number) && q == dataend;
+	}
+}
+
+/*!
+	Returns the groups of the given file, reading it if it isn't cached.
+	Returns an empty pointer if the file can't be read.
+*/
+shared_ptr<const DxfFile> get_dxf_file(const std::string &filename)
+{
+	boost::system::error_code ec;
+	std::time_t mtime = fs::last_write_time(filename, ec);
+	uintmax_t size = ec ? 0 : fs::file_size(filename, ec);
+	if (!ec) {
+		std::lock_guard<std::mutex> lock(dxf_file_cache_mutex);
+		auto it = dxf_file_cache.find(filename);
+		if (it != dxf_file_cache.end() && it->second.mtime == mtime && it->second.size == size) {
+			it->second.lastused = ++dxf_file_cache_clock;
+			return it->second.file;
+		}
+	}
+
+	std::ifstream stream(filename.c_str(), std::ios::binary);
+	if (!stream.good()) return shared_ptr<const DxfFile>();
+	std::string contents;
+	stream.seekg(0, std::ios::end);
+	contents.resize(size_t(stream.tellg()));
+	stream.seekg(0, std::ios::beg);
+	stream.read(&contents[0], contents.size());
+	if (!stream.good()) return shared_ptr<const DxfFile>();
+
+	shared_ptr<DxfFile> file(new DxfFile);
+	setlocale(LC_NUMERIC, "C"); // Ensure radix is . (not ,) for strtod()
+	read_dxf_groups(contents.data(), contents.data() + contents.size(), *file);
+	setlocale(LC_NUMERIC, "");      // Set default locale
+
+	if (!ec) {
+		std::lock_guard<std::mutex> lock(dxf_file_cache_mutex);
+		if (dxf_file_cache.size() >= DXF_FILE_CACHE_SIZE && dxf_file_cache.find(filename) == dxf_file_cache.end()) {
+			auto oldest = dxf_file_cache.begin();
+			for (auto it = dxf_file_cache.begin(); it != dxf_file_cache.end(); it++) {
+				if (it->second.lastused < oldest->second.lastused) oldest = it;
+			}
+			dxf_file_cache.erase(oldest);
+		}
+		DxfFileCacheEntry &entry = dxf_file_cache[filename];
+		entry.file = file;
+		entry.mtime = mtime;
+		entry.size = size;
+		entry.lastused = ++dxf_file_cache_clock;
+	}
+	return file;
+}
+
+}
+
 DxfData::DxfData()
 {
 }
 
+/*!
+	Drops the cached contents of DXF files read so far
+ */
+void DxfData::clearFileCache()
+{
+	std::lock_guard<std::mutex> lock(dxf_file_cache_mutex);
+	dxf_file_cache.clear();
+}
+
 /*!
 	Reads a layer from the given file, or all layers if layername.empty()
  */
@@ -81,13 +230,16 @@ DxfData::DxfData(double fn, double fs, double fa,
 {
 	handle_dep(filename); // Register ourselves as a dependency
 
-	std::ifstream stream(filename.c_str());
-	if (!stream.good()) {
+	shared_ptr<const DxfFile> file = get_dxf_file(filename);
+	if (!file) {
 		PRINTB("WARNING: Can't open DXF file '%s'.", filename);
 		return;
 	}
 
-	Grid2d< std::vector<int>> grid(GRID_COARSE);
+	// Grid points hold the endpoint node of global lines ending there, plus one,
+	// or zero if there is none yet
+	Grid2d<int> grid(GRID_COARSE);
+	int numnodes = 0;
 	std::vector<Line> lines;                       // Global lines
 	std::unordered_map< std::string, std::vector<Line>> blockdata; // Lines in blocks
 
@@ -102,13 +254,15 @@ DxfData::DxfData(double fn, double fs, double fa,
 		if (in_entities_section &&                              \
 				!(layername.empty() || layername == layer))         \
 			break;                                                \
-		grid.align(_p1x, _p1y);                                 \
-		grid.align(_p2x, _p2y);                                 \
-		grid.data(_p1x, _p1y).push_back(lines.size());          \
-		grid.data(_p2x, _p2y).push_back(lines.size());          \
-		if (in_entities_section)                                \
+		int &_n1 = grid.align(_p1x, _p1y);                      \
+		int &_n2 = grid.align(_p2x, _p2y);                      \
+		if (in_entities_section) {                              \
+			if (!_n1) _n1 = ++numnodes;                           \
+			if (!_n2) _n2 = ++numnodes;                           \
 			lines.push_back(                                      \
-				Line(addPoint(_p1x, _p1y), addPoint(_p2x, _p2y)));	\
+				Line(addPoint(_p1x, _p1y), addPoint(_p2x, _p2y),    \
+						 _n1 - 1, _n2 - 1));                              \
+		}                                                       \
 		if (in_blocks_section && !current_block.empty())        \
 			blockdata[current_block].push_back(	                  \
 				Line(addPoint(_p1x, _p1y), addPoint(_p2x, _p2y)));	\
@@ -133,41 +287,27 @@ DxfData::DxfData(double fn, double fs, double fa,
 	//
 	// Parse DXF file. Will populate this->points, this->dims, lines and blockdata
 	//
-	while (!stream.eof())
+	for (const auto &group : file->groups)
 	{
-		std::string id_str, data;
-		std::getline(stream, id_str);
-		boost::trim(id_str);
-		std::getline(stream, data);
-		boost::trim(data);
-
-		int id;
-    try {
-		  id = boost::lexical_cast<int>(id_str);
-    }
-    catch (const boost::bad_lexical_cast &blc) {
-			if (!stream.eof()) {
-				PRINTB("WARNING: Illegal ID '%s' in `%s'", id_str % filename);
-			}
-			break;
-  	}
+		int id = group.id;
+		const std::string &data = group.data;
     try {
 		if (id >= 10 && id <= 16) {
 			if (in_blocks_section)
-				coords[id-10][0] = boost::lexical_cast<double>(data);
+				coords[id-10][0] = group.toDouble();
 			else if (id == 11 || id == 12 || id == 16)
-				coords[id-10][0] = boost::lexical_cast<double>(data) * scale;
+				coords[id-10][0] = group.toDouble() * scale;
 			else
-				coords[id-10][0] = (boost::lexical_cast<double>(data) - xorigin) * scale;
+				coords[id-10][0] = (group.toDouble() - xorigin) * scale;
 		}
 
 		if (id >= 20 && id <= 26) {
 			if (in_blocks_section)
-				coords[id-20][1] = boost::lexical_cast<double>(data);
+				coords[id-20][1] = group.toDouble();
 			else if (id == 21 || id == 22 || id == 26)
-				coords[id-20][1] = boost::lexical_cast<double>(data) * scale;
+				coords[id-20][1] = group.toDouble() * scale;
 			else
-				coords[id-20][1] = (boost::lexical_cast<double>(data) - yorigin) * scale;
+				coords[id-20][1] = (group.toDouble() - yorigin) * scale;
 		}
 
 		switch (id)
@@ -331,53 +471,53 @@ DxfData::DxfData(double fn, double fs, double fa,
 			break;
 		case 10:
 			if (in_blocks_section)
-				xverts.push_back((boost::lexical_cast<double>(data)));
+				xverts.push_back((group.toDouble()));
 			else
-				xverts.push_back((boost::lexical_cast<double>(data) - xorigin) * scale);
+				xverts.push_back((group.toDouble() - xorigin) * scale);
 			break;
 		case 11:
 			if (in_blocks_section)
-				xverts.push_back((boost::lexical_cast<double>(data)));
+				xverts.push_back((group.toDouble()));
 			else
-				xverts.push_back((boost::lexical_cast<double>(data) - xorigin) * scale);
+				xverts.push_back((group.toDouble() - xorigin) * scale);
 			break;
 		case 20:
 			if (in_blocks_section)
-				yverts.push_back((boost::lexical_cast<double>(data)));
+				yverts.push_back((group.toDouble()));
 			else
-				yverts.push_back((boost::lexical_cast<double>(data) - yorigin) * scale);
+				yverts.push_back((group.toDouble() - yorigin) * scale);
 			break;
 		case 21:
 			if (in_blocks_section)
-				yverts.push_back((boost::lexical_cast<double>(data)));
+				yverts.push_back((group.toDouble()));
 			else
-				yverts.push_back((boost::lexical_cast<double>(data) - yorigin) * scale);
+				yverts.push_back((group.toDouble() - yorigin) * scale);
 			break;
 		case 40:
 			// CIRCLE, ARC: radius
 			// ELLIPSE: minor to major ratio
 			// DIMENSION (radial, diameter): Leader length
-			radius = boost::lexical_cast<double>(data);
+			radius = group.toDouble();
 			if (!in_blocks_section) radius *= scale;
 			break;
 		case 41:
 			// ELLIPSE: start_angle
 			// INSERT: X scale
-			ellipse_start_angle = boost::lexical_cast<double>(data);
+			ellipse_start_angle = group.toDouble();
 			break;
 		case 50:
 			// ARC: start_angle
 			// INSERT: rot angle
       // DIMENSION: linear and rotated: angle
-			arc_start_angle = boost::lexical_cast<double>(data);
+			arc_start_angle = group.toDouble();
 			break;
 		case 42:
 			// ELLIPSE: stop_angle
 			// INSERT: Y scale
-			ellipse_stop_angle = boost::lexical_cast<double>(data);
+			ellipse_stop_angle = group.toDouble();
 			break;
 		case 51: // ARC
-			arc_stop_angle = boost::lexical_cast<double>(data);
+			arc_stop_angle = group.toDouble();
 			break;
 		case 70:
 			// LWPOLYLINE: polyline flag
@@ -394,6 +534,10 @@ DxfData::DxfData(double fn, double fs, double fa,
   	}
 	}
 
+	if (!file->illegal_id.empty()) {
+		PRINTB("WARNING: Illegal ID '%s' in `%s'", file->illegal_id % filename);
+	}
+
 	for(const auto &i : unsupported_entities_list) {
 		if (layername.empty()) {
 			PRINTB("WARNING: Unsupported DXF Entity '%s' (%x) in %s.",
@@ -404,103 +548,76 @@ DxfData::DxfData(double fn, double fs, double fa,
 		}
 	}
 
-	// Extract paths from parsed data
+	// Extract paths from parsed data. Lines are connected through their
+	// endpoint nodes, so this is linear in the number of lines.
 
-	typedef std::map<int, int> LineMap;
-	LineMap enabled_lines;
+	std::vector<std::vector<int>> node_lines(numnodes); // Lines ending at each node, in line order
+	std::vector<size_t> node_first(numnodes);           // First entry of node_lines which may be enabled
+	std::vector<int> node_degree(numnodes);             // Number of enabled line ends at each node
 	for (size_t i = 0; i < lines.size(); i++) {
-		enabled_lines[i] = i;
+		for (int j = 0; j < 2; j++) {
+			node_lines[lines[i].node[j]].push_back(i);
+			node_degree[lines[i].node[j]]++;
+		}
 	}
 
-	// extract all open paths
-	while (enabled_lines.size() > 0)
-	{
-		int current_line, current_point;
+	// A line end is free if no other enabled line ends at the same node
+	auto is_free = [&](int idx, int j) {
+		int node = lines[idx].node[j];
+		return node_degree[node] == (lines[idx].node[0] == node) + (lines[idx].node[1] == node);
+	};
 
-		for(const auto &l : enabled_lines) {
-			int idx = l.second;
+	// Enabled lines with a free end, which start open paths. Disabling lines
+	// never takes a free end away, so lines are added as they become free.
+	std::set<int> open_path_starts;
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (is_free(i, 0) || is_free(i, 1)) open_path_starts.insert(i);
+	}
+
+	// Follows and disables the lines connected to current_point of current_line
+	auto extract_path = [&](Path &path, int current_line, int current_point) {
+		path.indices.push_back(lines[current_line].idx[current_point]);
+		while (1) {
+			path.indices.push_back(lines[current_line].idx[!current_point]);
+			int ref_node = lines[current_line].node[!current_point];
+			lines[current_line].disabled = true;
 			for (int j = 0; j < 2; j++) {
-				std::vector<int> *lv = &grid.data(this->points[lines[idx].idx[j]][0], this->points[lines[idx].idx[j]][1]);
-				for (size_t ki = 0; ki < lv->size(); ki++) {
-					int k = lv->at(ki);
-					if (k == idx || lines[k].disabled)
-						continue;
-					goto next_open_path_j;
+				int node = lines[current_line].node[j];
+				if (--node_degree[node] > 2) continue;
+				for (size_t ki = node_first[node]; ki < node_lines[node].size(); ki++) {
+					int k = node_lines[node][ki];
+					if (!lines[k].disabled && (is_free(k, 0) || is_free(k, 1))) open_path_starts.insert(k);
 				}
-				current_line = idx;
-				current_point = j;
-				goto create_open_path;
-			next_open_path_j:;
 			}
+
+			std::vector<int> &lv = node_lines[ref_node];
+			size_t &ki = node_first[ref_node];
+			while (ki < lv.size() && lines[lv[ki]].disabled) ki++;
+			if (ki == lv.size()) break;
+			current_line = lv[ki];
+			current_point = lines[current_line].node[0] == ref_node ? 0 : 1;
 		}
+	};
 
-		break;
+	// extract all open paths
+	while (!open_path_starts.empty())
+	{
+		int current_line = *open_path_starts.begin();
+		open_path_starts.erase(open_path_starts.begin());
+		if (lines[current_line].disabled) continue;
 
-	create_open_path:
 		this->paths.push_back(Path());
-		Path *this_path = &this->paths.back();
-
-		this_path->indices.push_back(lines[current_line].idx[current_point]);
-		while (1) {
-			this_path->indices.push_back(lines[current_line].idx[!current_point]);
-			const Vector2d &ref_point = this->points[lines[current_line].idx[!current_point]];
-			lines[current_line].disabled = true;
-			enabled_lines.erase(current_line);
-			std::vector<int> *lv = &grid.data(ref_point[0], ref_point[1]);
-			for (size_t ki = 0; ki < lv->size(); ki++) {
-				int k = lv->at(ki);
-				if (lines[k].disabled)
-					continue;
-				if (grid.eq(ref_point[0], ref_point[1], this->points[lines[k].idx[0]][0], this->points[lines[k].idx[0]][1])) {
-					current_line = k;
-					current_point = 0;
-					goto found_next_line_in_open_path;
-				}
-				if (grid.eq(ref_point[0], ref_point[1], this->points[lines[k].idx[1]][0], this->points[lines[k].idx[1]][1])) {
-					current_line = k;
-					current_point = 1;
-					goto found_next_line_in_open_path;
-				}
-			}
-			break;
-		found_next_line_in_open_path:;
-		}
+		extract_path(this->paths.back(), current_line, is_free(current_line, 0) ? 0 : 1);
 	}
 
 	// extract all closed paths
-	while (enabled_lines.size() > 0)
+	for (size_t i = 0; i < lines.size(); i++)
 	{
-		int current_line = enabled_lines.begin()->second, current_point = 0;
+		if (lines[i].disabled) continue;
 
 		this->paths.push_back(Path());
-		Path *this_path = &this->paths.back();
-		this_path->is_closed = true;
-		
-		this_path->indices.push_back(lines[current_line].idx[current_point]);
-		while (1) {
-			this_path->indices.push_back(lines[current_line].idx[!current_point]);
-			const Vector2d &ref_point = this->points[lines[current_line].idx[!current_point]];
-			lines[current_line].disabled = true;
-			enabled_lines.erase(current_line);
-			std::vector<int> *lv = &grid.data(ref_point[0], ref_point[1]);
-			for (size_t ki = 0; ki < lv->size(); ki++) {
-				int k = lv->at(ki);
-				if (lines[k].disabled)
-					continue;
-				if (grid.eq(ref_point[0], ref_point[1], this->points[lines[k].idx[0]][0], this->points[lines[k].idx[0]][1])) {
-					current_line = k;
-					current_point = 0;
-					goto found_next_line_in_closed_path;
-				}
-					if (grid.eq(ref_point[0], ref_point[1], this->points[lines[k].idx[1]][0], this->points[lines[k].idx[1]][1])) {
-					current_line = k;
-					current_point = 1;
-					goto found_next_line_in_closed_path;
-				}
-			}
-			break;
-		found_next_line_in_closed_path:;
-		}
+		this->paths.back().is_closed = true;
+		extract_path(this->paths.back(), i, 0);
 	}
 
 	fixup_path_direction();
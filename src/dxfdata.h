@@ -36,6 +36,8 @@ public:
 					const std::string &filename, const std::string &layername = "",
 					double xorigin = 0.0, double yorigin = 0.0, double scale = 1.0);
 
+	static void clearFileCache();
+
 	int addPoint(double x, double y);
 
 	void fixup_path_direction();
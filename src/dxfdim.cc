@@ -36,10 +36,13 @@
 #include <cmath>
 #include <sstream>
 #include <cstdint>
+#include <mutex>
 
 #include <boost/filesystem.hpp>
 std::unordered_map<std::string, ValuePtr> dxf_dim_cache;
 std::unordered_map<std::string, ValuePtr> dxf_cross_cache;
+// Guards both caches, as builtins may be evaluated by several threads
+static std::mutex dxf_cache_mutex;
 namespace fs = boost::filesystem;
 
 ValuePtr builtin_dxf_dim(const Context *ctx, const EvalContext *evalctx)
@@ -79,6 +82,7 @@ ValuePtr builtin_dxf_dim(const Context *ctx, const EvalContext *evalctx)
 						<< "|" << yorigin <<"|" << scale << "|" << lastwritetime
 						<< "|" << filesize;
 	std::string key = keystream.str();
+	std::lock_guard<std::mutex> lock(dxf_cache_mutex);
 	if (dxf_dim_cache.find(key) != dxf_dim_cache.end())
 		return dxf_dim_cache.find(key)->second;
 
@@ -170,6 +174,7 @@ ValuePtr builtin_dxf_cross(const Context *ctx, const EvalContext *evalctx)
 						<< "|" << filesize;
 	std::string key = keystream.str();
 
+	std::lock_guard<std::mutex> lock(dxf_cache_mutex);
 	if (dxf_cross_cache.find(key) != dxf_cross_cache.end()) {
 		return dxf_cross_cache.find(key)->second;
 	}
@@ -46,10 +46,10 @@ void EvalContext::assignTo(Context &target) const
 	for(const auto &assignment : this->eval_arguments) {
 		ValuePtr v;
 		if (assignment.expr) v = assignment.expr->evaluate(&target);
-		if (target.has_local_variable(assignment.name)) {
+		if (target.has_local_variable(assignment.symbol)) {
 			PRINTB("WARNING: Ignoring duplicate variable assignment %s = %s", assignment.name % v->toString());
 		} else {
-			target.set_variable(assignment.name, v);
+			target.set_variable(assignment.symbol, v);
 		}
 	}
 }
@@ -90,7 +90,7 @@ std::string EvalContext::dump(const AbstractModule *mod, const ModuleInstantiati
 		if (m) {
 			s << boost::format("  module args:");
 			for(const auto &arg : m->definition_arguments) {
-				s << boost::format("    %s = %s") % arg.name % *(variables[arg.name]);
+				s << boost::format("    %s = %s") % arg.name % *lookup_variable(arg.symbol, true);
 			}
 		}
 	}
@@ -43,6 +43,7 @@ void exportFile(const shared_ptr<const Geometry> &root_geom, std::ostream &outpu
 		export_off(root_geom, output);
 		break;
 	case OPENSCAD_AMF:
+	case OPENSCAD_AMF_ZIP: // Only exportFileByName() can compress
 		export_amf(root_geom, output);
 		break;
 	case OPENSCAD_DXF:
@@ -65,6 +66,13 @@ void exportFile(const shared_ptr<const Geometry> &root_geom, std::ostream &outpu
 void exportFileByName(const shared_ptr<const Geometry> &root_geom, FileFormat format,
 	const char *name2open, const char *name2display)
 {
+	if (format == OPENSCAD_AMF_ZIP) {
+		if (!export_amf_zip(root_geom, name2open)) {
+			PRINTB(_("ERROR: \"%s\" write error. (Disk full?)"), name2display);
+		}
+		return;
+	}
+
 	std::ofstream fstream(name2open);
 	if (!fstream.is_open()) {
 		PRINTB(_("Can't open file \"%s\" for export"), name2display);
@@ -9,6 +9,7 @@ enum FileFormat {
 	OPENSCAD_STL,
 	OPENSCAD_OFF,
 	OPENSCAD_AMF,
+	OPENSCAD_AMF_ZIP,
 	OPENSCAD_DXF,
 	OPENSCAD_SVG,
 	OPENSCAD_NEFDBG,
@@ -21,6 +22,7 @@ void exportFileByName(const shared_ptr<const class Geometry> &root_geom, FileFor
 void export_stl(const shared_ptr<const Geometry> &geom, std::ostream &output);
 void export_off(const shared_ptr<const Geometry> &geom, std::ostream &output);
 void export_amf(const shared_ptr<const Geometry> &geom, std::ostream &output);
+bool export_amf_zip(const shared_ptr<const Geometry> &geom, const std::string &filename);
 void export_dxf(const shared_ptr<const Geometry> &geom, std::ostream &output);
 void export_svg(const shared_ptr<const Geometry> &geom, std::ostream &output);
 void export_nefdbg(const shared_ptr<const Geometry> &geom, std::ostream &output);
@@ -32,3 +34,7 @@ bool export_png(const shared_ptr<const class Geometry> &root_geom, Camera &c, st
 bool export_png(const shared_ptr<const class CGAL_Nef_polyhedron> &root_N, Camera &c, std::ostream &output);
 bool export_png_with_opencsg(Tree &tree, Camera &c, std::ostream &output);
 bool export_png_with_throwntogether(Tree &tree, Camera &c, std::ostream &output);
+// Render one image per camera into outputs[i], evaluating and setting up the view only once
+bool export_png(const shared_ptr<const class Geometry> &root_geom, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs);
+bool export_png_with_opencsg(Tree &tree, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs);
+bool export_png_with_throwntogether(Tree &tree, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs);
@@ -28,142 +28,110 @@
 #include "polyset.h"
 #include "polyset-utils.h"
 #include "dxfdata.h"
+#include "printutils.h"
 
 #ifdef ENABLE_CGAL
 #include "CGAL_Nef_polyhedron.h"
 #include "cgal.h"
 #include "cgalutils.h"
 
+#include "Reindexer.h"
+#include "FlatHashMap.h"
+#include "BufferedWriter.h"
+
+#include <fstream>
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#ifdef ENABLE_LIBZIP
+#include <zip.h>
+#endif
+
 #define QUOTE(x__) # x__
 #define QUOTED(x__) QUOTE(x__)
 
-struct triangle {
-    std::string vs1;
-    std::string vs2;
-    std::string vs3;
-};
-
 static int objectid;
 
 /*!
-    Saves the current 3D CGAL Nef polyhedron as AMF to the given file.
-    The file must be open.
- */
-static void append_amf(const CGAL_Nef_polyhedron &root_N, std::ostream &output)
+	Writes an indexed triangle mesh as an AMF object. Vertices which are equal
+	at the output precision are written once, and triangles which become
+	degenerate at that precision are skipped.
+*/
+template <typename Vertex>
+static void append_amf(const std::vector<Vertex> &vertices, const std::vector<IndexedTriangle> &triangles,
+											 BufferedWriter &output)
 {
-	if (!root_N.p3->is_simple()) {
-		PRINT("WARNING: Export failed, the object isn't a valid 2-manifold.");
-		return;
-	}
-	CGAL::Failure_behaviour old_behaviour = CGAL::set_error_behaviour(CGAL::THROW_EXCEPTION);
-	try {
-		CGAL_Polyhedron P;
-		root_N.p3->convert_to_Polyhedron(P);
-
-		typedef CGAL_Polyhedron::Vertex Vertex;
-		typedef CGAL_Polyhedron::Vertex_const_iterator VCI;
-		typedef CGAL_Polyhedron::Facet_const_iterator FCI;
-		typedef CGAL_Polyhedron::Halfedge_around_facet_const_circulator HFCC;
-
-		std::vector<std::string> vertices;
-		std::vector<triangle> triangles;
-
-		for (FCI fi = P.facets_begin(); fi != P.facets_end(); ++fi) {
-			HFCC hc = fi->facet_begin();
-			HFCC hc_end = hc;
-			Vertex v1, v2, v3;
-			v1 = *VCI((hc++)->vertex());
-			v3 = *VCI((hc++)->vertex());
-			do {
-				v2 = v3;
-				v3 = *VCI((hc++)->vertex());
-				double x1 = CGAL::to_double(v1.point().x());
-				double y1 = CGAL::to_double(v1.point().y());
-				double z1 = CGAL::to_double(v1.point().z());
-				double x2 = CGAL::to_double(v2.point().x());
-				double y2 = CGAL::to_double(v2.point().y());
-				double z2 = CGAL::to_double(v2.point().z());
-				double x3 = CGAL::to_double(v3.point().x());
-				double y3 = CGAL::to_double(v3.point().y());
-				double z3 = CGAL::to_double(v3.point().z());
-				std::stringstream stream;
-				stream << x1 << " " << y1 << " " << z1;
-				std::string vs1 = stream.str();
-				stream.str("");
-				stream << x2 << " " << y2 << " " << z2;
-				std::string vs2 = stream.str();
-				stream.str("");
-				stream << x3 << " " << y3 << " " << z3;
-				std::string vs3 = stream.str();
-				if (std::find(vertices.begin(), vertices.end(), vs1) == vertices.end())
-					vertices.push_back(vs1);
-				if (std::find(vertices.begin(), vertices.end(), vs2) == vertices.end())
-					vertices.push_back(vs2);
-				if (std::find(vertices.begin(), vertices.end(), vs3) == vertices.end())
-					vertices.push_back(vs3);
-
-				if (vs1 != vs2 && vs1 != vs3 && vs2 != vs3) {
-					// The above condition ensures that there are 3 distinct vertices, but
-					// they may be collinear. If they are, the unit normal is meaningless
-					// so the default value of "1 0 0" can be used. If the vertices are not
-					// collinear then the unit normal must be calculated from the
-					// components.
-					triangle tri = {vs1, vs2, vs3};
-					triangles.push_back(tri);
-				}
-			} while (hc != hc_end);
+	output << " <object id=\"" << objectid++ << "\">\r\n"
+				 << "  <mesh>\r\n";
+	output << "   <vertices>\r\n";
+	FlatHashMap<std::string> written;
+	written.reserve(vertices.size());
+	std::vector<int> outindex(vertices.size());
+	char coords[3][32];
+	for (size_t i = 0; i < vertices.size(); i++) {
+		std::string key;
+		for (int j = 0; j < 3; j++) {
+			snprintf(coords[j], sizeof(coords[j]), "%.*g", output.getPrecision(), double(vertices[i][j]));
+			key.append(coords[j]).push_back(' ');
 		}
-
-		output << " <object id=\"" << objectid++ << "\">\r\n"
-					 << "  <mesh>\r\n";
-		output << "   <vertices>\r\n";
-		for (size_t i = 0; i < vertices.size(); i++) {
-			std::string s = vertices[i];
+		const size_t numwritten = written.size();
+		outindex[i] = written.insert(key, numwritten);
+		if (written.size() > numwritten) {
 			output << "    <vertex><coordinates>\r\n";
-			char* chrs = new char[s.length() + 1];
-			strcpy(chrs, s.c_str());
-			std::string coords = strtok(chrs, " ");
-			output << "     <x>" << coords << "</x>\r\n";
-			coords = strtok(NULL, " ");
-			output << "     <y>" << coords << "</y>\r\n";
-			coords = strtok(NULL, " ");
-			output << "     <z>" << coords << "</z>\r\n";
+			output << "     <x>" << coords[0] << "</x>\r\n";
+			output << "     <y>" << coords[1] << "</y>\r\n";
+			output << "     <z>" << coords[2] << "</z>\r\n";
 			output << "    </coordinates></vertex>\r\n";
-			delete[] chrs;
 		}
-		output << "   </vertices>\r\n";
-		output << "   <volume>\r\n";
-		for (size_t i = 0; i < triangles.size(); i++) {
-			triangle t = triangles[i];
+	}
+	output << "   </vertices>\r\n";
+	output << "   <volume>\r\n";
+	for (const auto &t : triangles) {
+		int v1 = outindex[t[0]], v2 = outindex[t[1]], v3 = outindex[t[2]];
+		if (v1 != v2 && v1 != v3 && v2 != v3) {
 			output << "    <triangle>\r\n";
-			size_t index;
-			index = std::distance(vertices.begin(), std::find(vertices.begin(), vertices.end(), t.vs1));
-			output << "     <v1>" << index << "</v1>\r\n";
-			index = std::distance(vertices.begin(), std::find(vertices.begin(), vertices.end(), t.vs2));
-			output << "     <v2>" << index << "</v2>\r\n";
-			index = std::distance(vertices.begin(), std::find(vertices.begin(), vertices.end(), t.vs3));
-			output << "     <v3>" << index << "</v3>\r\n";
+			output << "     <v1>" << v1 << "</v1>\r\n";
+			output << "     <v2>" << v2 << "</v2>\r\n";
+			output << "     <v3>" << v3 << "</v3>\r\n";
 			output << "    </triangle>\r\n";
 		}
-		output << "   </volume>\r\n";
-		output << "  </mesh>\r\n"
-					 << " </object>\r\n";
-	} catch (CGAL::Assertion_exception e) {
-		PRINTB("ERROR: CGAL error in CGAL_Nef_polyhedron3::convert_to_Polyhedron(): %s", e.what());
 	}
-	CGAL::set_error_behaviour(old_behaviour);
+	output << "   </volume>\r\n";
+	output << "  </mesh>\r\n"
+				 << " </object>\r\n";
 }
 
-static void append_amf(const shared_ptr<const Geometry> &geom, std::ostream &output)
+static void append_amf(const shared_ptr<const Geometry> &geom, BufferedWriter &output)
 {
 	if (const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron *>(geom.get())) {
-		if (!N->isEmpty()) append_amf(*N, output);
+		if (N->isEmpty()) return;
+		if (!N->p3->is_simple()) {
+			PRINT("WARNING: Export failed, the object isn't a valid 2-manifold.");
+			return;
+		}
+		IndexedTriangleMesh mesh;
+		if (CGALUtils::createTriangleMeshFromNefPolyhedron3(*N->p3, mesh)) {
+			PRINT("ERROR: Nef->PolySet failed");
+			return;
+		}
+		append_amf(mesh.vertices, mesh.triangles, output);
 	}
 	else if (const PolySet *ps = dynamic_cast<const PolySet *>(geom.get())) {
-		// FIXME: Implement this without creating a Nef polyhedron
-		CGAL_Nef_polyhedron *N = CGALUtils::createNefPolyhedronFromGeometry(*ps);
-		if (!N->isEmpty()) append_amf(*N, output);
-		delete N;
+		PolySet triangulated(3);
+		bool istriangles = std::all_of(ps->polygons.begin(), ps->polygons.end(),
+																	 [](const Polygon &p) { return p.size() == 3; });
+		if (!istriangles) PolysetUtils::tessellate_faces(*ps, triangulated);
+		const Polygons &polygons = istriangles ? ps->polygons : triangulated.polygons;
+		Reindexer<Vector3d> vertices;
+		vertices.reserve(polygons.size());
+		std::vector<IndexedTriangle> triangles;
+		triangles.reserve(polygons.size());
+		for (const auto &p : polygons) {
+			triangles.push_back(IndexedTriangle(vertices.lookup(p[0]), vertices.lookup(p[1]), vertices.lookup(p[2])));
+		}
+		std::vector<Vector3d> vertexarray;
+		vertices.copy(std::back_inserter(vertexarray));
+		append_amf(vertexarray, triangles, output);
 	}
 	else if (const Polygon2d *poly = dynamic_cast<const Polygon2d *>(geom.get())) {
 		assert(false && "Unsupported file format");
@@ -175,20 +143,71 @@ static void append_amf(const shared_ptr<const Geometry> &geom, std::ostream &out
 void export_amf(const shared_ptr<const Geometry> &geom, std::ostream &output)
 {
 	setlocale(LC_NUMERIC, "C"); // Ensure radix is . (not ,) in output
-
-	output << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
-				 << "<amf unit=\"millimeter\">\r\n"
-				 << " <metadata type=\"producer\">OpenSCAD " << QUOTED(OPENSCAD_VERSION)
+	{
+		BufferedWriter writer(output);
+		writer << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+					 << "<amf unit=\"millimeter\">\r\n"
+					 << " <metadata type=\"producer\">OpenSCAD " << QUOTED(OPENSCAD_VERSION)
 #ifdef OPENSCAD_COMMIT
-				 << " (git " << QUOTED(OPENSCAD_COMMIT) << ")"
+					 << " (git " << QUOTED(OPENSCAD_COMMIT) << ")"
 #endif
-				 << "</metadata>\r\n";
+					 << "</metadata>\r\n";
 
-	objectid = 0;
-	append_amf(geom, output);
+		objectid = 0;
+		append_amf(geom, writer);
 
-	output << "</amf>\r\n";
+		writer << "</amf>\r\n";
+	}
 	setlocale(LC_NUMERIC, ""); // Set default locale
 }
 
+/*!
+	Writes compressed AMF, which is a zip archive holding the AMF file under
+	the archive's own file name. libzip reads its sources when the archive is
+	closed, so the AMF is streamed to a temporary file first rather than held
+	in memory. Returns false on error.
+*/
+bool export_amf_zip(const shared_ptr<const Geometry> &geom, const std::string &filename)
+{
+#ifdef ENABLE_LIBZIP
+	const std::string tmpname = filename + ".tmp";
+	{
+		std::ofstream fstream(tmpname.c_str(), std::ios::out | std::ios::binary);
+		if (!fstream.is_open()) return false;
+		export_amf(geom, fstream);
+		fstream.close();
+		if (fstream.fail()) {
+			fs::remove(tmpname);
+			return false;
+		}
+	}
+
+	boost::system::error_code ec;
+	fs::remove(filename, ec);
+	bool ok = false;
+	int error;
+	struct zip *archive = zip_open(filename.c_str(), ZIP_CREATE, &error);
+	if (archive) {
+		struct zip_source *source = zip_source_file(archive, tmpname.c_str(), 0, 0);
+		if (source && zip_add(archive, fs::path(filename).filename().string().c_str(), source) >= 0) {
+			ok = zip_close(archive) == 0;
+			if (!ok) zip_discard(archive);
+		}
+		else {
+			if (source) zip_source_free(source);
+			zip_discard(archive);
+		}
+	}
+	fs::remove(tmpname, ec);
+	return ok;
+#else
+	PRINT("WARNING: Compressed AMF export requires libzip, exporting uncompressed AMF.");
+	std::ofstream fstream(filename.c_str(), std::ios::out | std::ios::binary);
+	if (!fstream.is_open()) return false;
+	export_amf(geom, fstream);
+	fstream.close();
+	return !fstream.fail();
+#endif
+}
+
 #endif // ENABLE_CGAL
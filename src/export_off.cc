@@ -35,36 +35,64 @@
 #include "cgalutils.h"
 
 #include "Reindexer.h"
-#include "grid.h"
+#include "BufferedWriter.h"
 
+#include <clocale>
+
+/*!
+	Polygon mesh with each vertex stored once. Faces are stored as
+	consecutive vertex indices, each face terminated by -1.
+*/
 struct IndexedMesh {
 	IndexedMesh() : numfaces(0) {}
 
-	Reindexer<Vector3d> vertices;
+	std::vector<Vector3d> vertices;
 	std::vector<int> indices;
 	size_t numfaces;
 };
 
-
 static void append_geometry(const PolySet &ps, IndexedMesh &mesh)
 {
+	Reindexer<Vector3d> vertices;
+	size_t numindices = 0;
+	for (const auto &p : ps.polygons) numindices += p.size();
+	vertices.reserve(numindices / 4);
+	mesh.indices.reserve(mesh.indices.size() + numindices + ps.polygons.size());
+
 	for(const auto &p : ps.polygons) {
 		for(const auto &v : p) {
-			mesh.indices.push_back(mesh.vertices.lookup(v));
+			mesh.indices.push_back(mesh.vertices.size() + vertices.lookup(v));
 		}
 		mesh.numfaces++;
 		mesh.indices.push_back(-1);
 	}
+	vertices.copy(std::back_inserter(mesh.vertices));
+}
+
+// Nef polyhedra are already indexed, so their vertices are taken as they are
+static void append_geometry(const IndexedTriangleMesh &tm, IndexedMesh &mesh)
+{
+	const int offset = mesh.vertices.size();
+	mesh.vertices.reserve(mesh.vertices.size() + tm.vertices.size());
+	for (const auto &v : tm.vertices) mesh.vertices.push_back(v.cast<double>());
+	mesh.indices.reserve(mesh.indices.size() + 4 * tm.triangles.size());
+	for (const auto &t : tm.triangles) {
+		mesh.indices.push_back(offset + t[0]);
+		mesh.indices.push_back(offset + t[1]);
+		mesh.indices.push_back(offset + t[2]);
+		mesh.indices.push_back(-1);
+	}
+	mesh.numfaces += tm.triangles.size();
 }
 
 void append_geometry(const shared_ptr<const Geometry> &geom, IndexedMesh &mesh)
 {
 	if (const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron *>(geom.get())) {
-		PolySet ps(3);
-		bool err = CGALUtils::createPolySetFromNefPolyhedron3(*(N->p3), ps);
+		IndexedTriangleMesh tm;
+		bool err = CGALUtils::createTriangleMeshFromNefPolyhedron3(*(N->p3), tm);
 		if (err) { PRINT("ERROR: Nef->PolySet failed"); }
 		else {
-			append_geometry(ps, mesh);
+			append_geometry(tm, mesh);
 		}
 	}
 	else if (const PolySet *ps = dynamic_cast<const PolySet *>(geom.get())) {
@@ -82,23 +110,24 @@ void export_off(const shared_ptr<const Geometry> &geom, std::ostream &output)
 	IndexedMesh mesh;
 	append_geometry(geom, mesh);
 
-	output << "OFF " << mesh.vertices.size() << " " << mesh.numfaces << " 0\n";
-	const Vector3d *v = mesh.vertices.getArray();
-	size_t numverts = mesh.vertices.size();
-	for (size_t i=0;i<numverts;i++) {
-		output << v[i][0] << " " << v[i][1] << " " << v[i][2] << " " << "\n";
-	}
-	size_t cnt = 0;
-	for (size_t i=0;i<mesh.numfaces;i++) {
-		size_t nverts = 0;
-		while (mesh.indices[cnt++] != -1) nverts++;
-		output << nverts;
-		cnt -= nverts + 1;
-		for (size_t n=0;n<nverts;n++) output << " " << mesh.indices[cnt++];
-		output << "\n";
-        cnt++; // Skip the -1 marker
+	setlocale(LC_NUMERIC, "C"); // Ensure radix is . (not ,) in output
+	{
+		BufferedWriter writer(output);
+		writer << "OFF " << mesh.vertices.size() << " " << mesh.numfaces << " 0\n";
+		for (const auto &v : mesh.vertices) {
+			writer << v[0] << " " << v[1] << " " << v[2] << " " << "\n";
+		}
+		size_t cnt = 0;
+		for (size_t i=0;i<mesh.numfaces;i++) {
+			size_t nverts = 0;
+			while (mesh.indices[cnt + nverts] != -1) nverts++;
+			writer << nverts;
+			for (size_t n=0;n<nverts;n++) writer << " " << mesh.indices[cnt++];
+			writer << "\n";
+			cnt++; // Skip the -1 marker
+		}
 	}
-
+	setlocale(LC_NUMERIC, "");      // Set default locale
 }
 
 #endif // ENABLE_CGAL
@@ -3,8 +3,11 @@
 #include "OffscreenView.h"
 #include "CsgInfo.h"
 #include <stdio.h>
+#include <vector>
 #include "polyset.h"
 #include "rendersettings.h"
+#include "SoftwareRenderer.h"
+#include "colormap.h"
 
 #ifdef ENABLE_CGAL
 #include "CGALRenderer.h"
@@ -19,27 +22,98 @@ static void setupCamera(Camera &cam, const BoundingBox &bbox)
 	if (cam.viewall) cam.viewAll(bbox);
 }
 
-bool export_png(const shared_ptr<const Geometry> &root_geom, Camera &cam, std::ostream &output)
+static void setupSoftwareRenderer(SoftwareRenderer &renderer)
+{
+	const ColorScheme *cs = ColorMap::inst()->findColorScheme(RenderSettings::inst()->colorscheme);
+	if (cs) renderer.setColorScheme(*cs);
+	renderer.setShowEdges(RenderSettings::inst()->showEdges);
+}
+
+/*!
+	Renders an image per camera into the corresponding output.
+*/
+static bool export_png_software(SoftwareRenderer &renderer, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs)
+{
+	const BoundingBox bbox = renderer.getBoundingBox();
+	bool success = true;
+	for (size_t i = 0; i < cams.size(); i++) {
+		setupCamera(cams[i], bbox);
+		renderer.render(cams[i]);
+		success &= renderer.save(*outputs[i]);
+	}
+	return success;
+}
+
+static bool export_png_software(const shared_ptr<const Geometry> &root_geom, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs)
+{
+	PRINTD("export_png_software geom");
+	SoftwareRenderer renderer(cams[0].pixel_width, cams[0].pixel_height);
+	setupSoftwareRenderer(renderer);
+	const ColorScheme &cs = renderer.getColorScheme();
+	if (shared_ptr<const CGAL_Nef_polyhedron> N = dynamic_pointer_cast<const CGAL_Nef_polyhedron>(root_geom)) {
+		if (!N->isEmpty()) {
+			PolySet ps(3);
+			if (CGALUtils::createPolySetFromNefPolyhedron3(*N->p3, ps)) {
+				PRINT("ERROR: Nef->PolySet failed");
+				return false;
+			}
+			renderer.addGeometry(ps, Transform3d::Identity(),
+													 ColorMap::getColor(cs, CGAL_FACE_FRONT_COLOR), ColorMap::getColor(cs, CGAL_FACE_BACK_COLOR),
+													 ColorMap::getColor(cs, CGAL_EDGE_FRONT_COLOR));
+		}
+	}
+	else if (root_geom && root_geom->getDimension() == 2) {
+		const Color4f col = ColorMap::getColor(cs, CGAL_FACE_2D_COLOR);
+		renderer.addGeometry(*root_geom, Transform3d::Identity(), col, col, ColorMap::getColor(cs, CGAL_EDGE_2D_COLOR));
+	}
+	else if (root_geom) {
+		renderer.addGeometry(*root_geom, Transform3d::Identity(),
+												 ColorMap::getColor(cs, CGAL_FACE_FRONT_COLOR), ColorMap::getColor(cs, CGAL_FACE_BACK_COLOR),
+												 ColorMap::getColor(cs, CGAL_EDGE_FRONT_COLOR));
+	}
+	return export_png_software(renderer, cams, outputs);
+}
+
+static bool paint_views(OffscreenView *glview, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs)
+{
+	const BoundingBox bbox = glview->getRenderer()->getBoundingBox();
+	bool success = true;
+	for (size_t i = 0; i < cams.size(); i++) {
+		setupCamera(cams[i], bbox);
+		glview->setCamera(cams[i]);
+		glview->paintGL();
+		success &= glview->save(*outputs[i]);
+	}
+	return success;
+}
+
+bool export_png(const shared_ptr<const Geometry> &root_geom, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs)
 {
 	PRINTD("export_png geom");
+	assert(!cams.empty() && cams.size() == outputs.size());
+	if (RenderSettings::inst()->softwareRendering) return export_png_software(root_geom, cams, outputs);
+
 	OffscreenView *glview;
 	try {
-		glview = new OffscreenView(cam.pixel_width, cam.pixel_height);
+		glview = new OffscreenView(cams[0].pixel_width, cams[0].pixel_height);
 	} catch (int error) {
-		fprintf(stderr,"Can't create OpenGL OffscreenView. Code: %i.\n", error);
-		return false;
+		fprintf(stderr,"Can't create OpenGL OffscreenView. Code: %i. Using software rendering.\n", error);
+		return export_png_software(root_geom, cams, outputs);
 	}
 	CGALRenderer cgalRenderer(root_geom);
 
-	BoundingBox bbox = cgalRenderer.getBoundingBox();
-	setupCamera(cam, bbox);
-
-	glview->setCamera(cam);
 	glview->setRenderer(&cgalRenderer);
 	glview->setColorScheme(RenderSettings::inst()->colorscheme);
-	glview->paintGL();
-	glview->save(output);
-	return true;
+	glview->showedges = RenderSettings::inst()->showEdges;
+	return paint_views(glview, cams, outputs);
+}
+
+bool export_png(const shared_ptr<const Geometry> &root_geom, Camera &cam, std::ostream &output)
+{
+	std::vector<Camera> cams(1, cam);
+	bool success = export_png(root_geom, cams, std::vector<std::ostream *>(1, &output));
+	cam = cams[0];
+	return success;
 }
 
 enum Previewer { OPENCSG, THROWNTOGETHER } previewer;
@@ -50,18 +124,36 @@ enum Previewer { OPENCSG, THROWNTOGETHER } previewer;
 #endif
 #include "ThrownTogetherRenderer.h"
 
-bool export_png_preview_common(Tree &tree, Camera &cam, std::ostream &output, Previewer previewer = OPENCSG)
+/*!
+	The software renderer can't do CSG operations, so it always draws the
+	products in the ThrownTogether style.
+*/
+static bool export_png_preview_software(const CsgInfo &csgInfo, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs)
+{
+	PRINTD("export_png_preview_software");
+	SoftwareRenderer renderer(cams[0].pixel_width, cams[0].pixel_height);
+	setupSoftwareRenderer(renderer);
+	if (csgInfo.root_products) renderer.addProducts(*csgInfo.root_products, false, false);
+	if (csgInfo.background_products) renderer.addProducts(*csgInfo.background_products, false, true);
+	if (csgInfo.highlights_products) renderer.addProducts(*csgInfo.highlights_products, true, false);
+	return export_png_software(renderer, cams, outputs);
+}
+
+bool export_png_preview_common(Tree &tree, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs, Previewer previewer = OPENCSG)
 {
 	PRINTD("export_png_preview_common");
+	assert(!cams.empty() && cams.size() == outputs.size());
 	CsgInfo csgInfo = CsgInfo();
 	csgInfo.compile_products(tree);
 
+	if (RenderSettings::inst()->softwareRendering) return export_png_preview_software(csgInfo, cams, outputs);
+
 	OffscreenView *glview;
 	try {
-		glview = new OffscreenView(cam.pixel_width, cam.pixel_height);
+		glview = new OffscreenView(cams[0].pixel_width, cams[0].pixel_height);
 	} catch (int error) {
-		fprintf(stderr,"Can't create OpenGL OffscreenView. Code: %i.\n", error);
-		return false;
+		fprintf(stderr,"Can't create OpenGL OffscreenView. Code: %i. Using software rendering.\n", error);
+		return export_png_preview_software(csgInfo, cams, outputs);
 	}
 
 #ifdef ENABLE_OPENCSG
@@ -76,34 +168,46 @@ bool export_png_preview_common(Tree &tree, Camera &cam, std::ostream &output, Pr
 #endif
 		glview->setRenderer(&thrownTogetherRenderer);
 #ifdef ENABLE_OPENCSG
-	BoundingBox bbox = glview->getRenderer()->getBoundingBox();
-	setupCamera(cam, bbox);
-
-	glview->setCamera(cam);
 	OpenCSG::setContext(0);
 	OpenCSG::setOption(OpenCSG::OffscreenSetting, OpenCSG::FrameBufferObject);
 #endif
 	glview->setColorScheme(RenderSettings::inst()->colorscheme);
-	glview->paintGL();
-	glview->save(output);
-	return true;
+	glview->showedges = RenderSettings::inst()->showEdges;
+	return paint_views(glview, cams, outputs);
 }
 
-bool export_png_with_opencsg(Tree &tree, Camera &cam, std::ostream &output)
+bool export_png_with_opencsg(Tree &tree, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs)
 {
 	PRINTD("export_png_w_opencsg");
 #ifdef ENABLE_OPENCSG
-	return export_png_preview_common(tree, cam, output, OPENCSG);
+	return export_png_preview_common(tree, cams, outputs, OPENCSG);
 #else
+	if (RenderSettings::inst()->softwareRendering) return export_png_preview_common(tree, cams, outputs, THROWNTOGETHER);
 	fprintf(stderr,"This openscad was built without OpenCSG support\n");
 	return false;
 #endif
 }
 
-bool export_png_with_throwntogether(Tree &tree, Camera &cam, std::ostream &output)
+bool export_png_with_opencsg(Tree &tree, Camera &cam, std::ostream &output)
+{
+	std::vector<Camera> cams(1, cam);
+	bool success = export_png_with_opencsg(tree, cams, std::vector<std::ostream *>(1, &output));
+	cam = cams[0];
+	return success;
+}
+
+bool export_png_with_throwntogether(Tree &tree, std::vector<Camera> &cams, const std::vector<std::ostream *> &outputs)
 {
 	PRINTD("export_png_w_thrown");
-	return export_png_preview_common(tree, cam, output, THROWNTOGETHER);
+	return export_png_preview_common(tree, cams, outputs, THROWNTOGETHER);
+}
+
+bool export_png_with_throwntogether(Tree &tree, Camera &cam, std::ostream &output)
+{
+	std::vector<Camera> cams(1, cam);
+	bool success = export_png_with_throwntogether(tree, cams, std::vector<std::ostream *>(1, &output));
+	cam = cams[0];
+	return success;
 }
 
 #endif // ENABLE_CGAL
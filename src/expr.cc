@@ -26,6 +26,7 @@
 #include "expression.h"
 #include "value.h"
 #include "evalcontext.h"
+#include "ASTCache.h"
 #include <cstdint>
 #include <assert.h>
 #include <sstream>
@@ -127,6 +128,13 @@ void UnaryOp::print(std::ostream &stream) const
 	stream << opString() << *this->expr;
 }
 
+void UnaryOp::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::UnaryOp, *this);
+	writer.writeInt(int(this->op));
+	writer.write(this->expr.get());
+}
+
 BinaryOp::BinaryOp(Expression *left, BinaryOp::Op op, Expression *right, const Location &loc) :
 	Expression(loc), op(op), left(left), right(right)
 {
@@ -233,6 +241,14 @@ void BinaryOp::print(std::ostream &stream) const
 	stream << "(" << *this->left << " " << opString() << " " << *this->right << ")";
 }
 
+void BinaryOp::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::BinaryOp, *this);
+	writer.writeInt(int(this->op));
+	writer.write(this->left.get());
+	writer.write(this->right.get());
+}
+
 TernaryOp::TernaryOp(Expression *cond, Expression *ifexpr, Expression *elseexpr, const Location &loc)
 	: Expression(loc), cond(cond), ifexpr(ifexpr), elseexpr(elseexpr)
 {
@@ -248,6 +264,14 @@ void TernaryOp::print(std::ostream &stream) const
 	stream << "(" << *this->cond << " ? " << *this->ifexpr << " : " << *this->elseexpr << ")";
 }
 
+void TernaryOp::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::TernaryOp, *this);
+	writer.write(this->cond.get());
+	writer.write(this->ifexpr.get());
+	writer.write(this->elseexpr.get());
+}
+
 ArrayLookup::ArrayLookup(Expression *array, Expression *index, const Location &loc)
 	: Expression(loc), array(array), index(index)
 {
@@ -262,6 +286,13 @@ void ArrayLookup::print(std::ostream &stream) const
 	stream << *array << "[" << *index << "]";
 }
 
+void ArrayLookup::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::ArrayLookup, *this);
+	writer.write(this->array.get());
+	writer.write(this->index.get());
+}
+
 Literal::Literal(const ValuePtr &val, const Location &loc) : Expression(loc), value(val)
 {
 }
@@ -276,6 +307,12 @@ void Literal::print(std::ostream &stream) const
     stream << *this->value;
 }
 
+void Literal::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::Literal, *this);
+	writer.write(this->value);
+}
+
 Range::Range(Expression *begin, Expression *end, const Location &loc)
 	: Expression(loc), begin(begin), end(end)
 {
@@ -315,6 +352,14 @@ void Range::print(std::ostream &stream) const
 	stream << "]";
 }
 
+void Range::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::Range, *this);
+	writer.write(this->begin.get());
+	writer.write(this->step.get());
+	writer.write(this->end.get());
+}
+
 bool Range::isLiteral() const {
     if(!this->step){ 
         if( begin->isLiteral() && end->isLiteral())
@@ -371,13 +416,20 @@ void Vector::print(std::ostream &stream) const
 	stream << "]";
 }
 
-Lookup::Lookup(const std::string &name, const Location &loc) : Expression(loc), name(name)
+void Vector::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::Vector, *this);
+	writer.writeInt(this->children.size());
+	for (const auto &e : this->children) writer.write(e.get());
+}
+
+Lookup::Lookup(const std::string &name, const Location &loc) : Expression(loc), name(name), symbol(name)
 {
 }
 
 ValuePtr Lookup::evaluate(const Context *context) const
 {
-	return context->lookup_variable(this->name);
+	return context->lookup_variable(this->symbol);
 }
 
 void Lookup::print(std::ostream &stream) const
@@ -385,6 +437,12 @@ void Lookup::print(std::ostream &stream) const
 	stream << this->name;
 }
 
+void Lookup::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::Lookup, *this);
+	writer.writeString(this->name);
+}
+
 MemberLookup::MemberLookup(Expression *expr, const std::string &member, const Location &loc)
 	: Expression(loc), expr(expr), member(member)
 {
@@ -411,6 +469,13 @@ void MemberLookup::print(std::ostream &stream) const
 	stream << *this->expr << "." << this->member;
 }
 
+void MemberLookup::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::MemberLookup, *this);
+	writer.write(this->expr.get());
+	writer.writeString(this->member);
+}
+
 FunctionCall::FunctionCall(const std::string &name, 
 													 const AssignmentList &args, const Location &loc)
 	: Expression(loc), name(name), arguments(args)
@@ -434,6 +499,13 @@ void FunctionCall::print(std::ostream &stream) const
 	stream << this->name << "(" << this->arguments << ")";
 }
 
+void FunctionCall::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::FunctionCall, *this);
+	writer.writeString(this->name);
+	writer.write(this->arguments);
+}
+
 Expression * FunctionCall::create(const std::string &funcname, const AssignmentList &arglist, Expression *expr, const Location &loc)
 {
 	if (funcname == "assert" && Feature::ExperimentalAssertExpression.is_enabled()) {
@@ -471,6 +543,13 @@ void Assert::print(std::ostream &stream) const
 	if (this->expr) stream << " " << *this->expr;
 }
 
+void Assert::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::Assert, *this);
+	writer.write(this->arguments);
+	writer.write(this->expr.get());
+}
+
 Echo::Echo(const AssignmentList &args, Expression *expr, const Location &loc)
 	: Expression(loc), arguments(args), expr(expr)
 {
@@ -496,6 +575,13 @@ void Echo::print(std::ostream &stream) const
 	if (this->expr) stream << " " << *this->expr;
 }
 
+void Echo::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::Echo, *this);
+	writer.write(this->arguments);
+	writer.write(this->expr.get());
+}
+
 Let::Let(const AssignmentList &args, Expression *expr, const Location &loc)
 	: Expression(loc), arguments(args), expr(expr)
 {
@@ -514,6 +600,13 @@ void Let::print(std::ostream &stream) const
 	stream << "let(" << this->arguments << ") " << *expr;
 }
 
+void Let::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::Let, *this);
+	writer.write(this->arguments);
+	writer.write(this->expr.get());
+}
+
 ListComprehension::ListComprehension(const Location &loc) : Expression(loc)
 {
 }
@@ -551,6 +644,14 @@ void LcIf::print(std::ostream &stream) const
     }
 }
 
+void LcIf::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::LcIf, *this);
+	writer.write(this->cond.get());
+	writer.write(this->ifexpr.get());
+	writer.write(this->elseexpr.get());
+}
+
 LcEach::LcEach(Expression *expr, const Location &loc) : ListComprehension(loc), expr(expr)
 {
 }
@@ -594,6 +695,12 @@ void LcEach::print(std::ostream &stream) const
     stream << "each (" << *this->expr << ")";
 }
 
+void LcEach::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::LcEach, *this);
+	writer.write(this->expr.get());
+}
+
 LcFor::LcFor(const AssignmentList &args, Expression *expr, const Location &loc)
 	: ListComprehension(loc), arguments(args), expr(expr)
 {
@@ -608,7 +715,7 @@ ValuePtr LcFor::evaluate(const Context *context) const
     Context assign_context(context);
 
     // comprehension for statements are by the parser reduced to only contain one single element
-    const std::string &it_name = for_context.getArgName(0);
+    const Symbol &it_name = for_context.getArgs()[0].symbol;
     ValuePtr it_values = for_context.getArgValue(0, &assign_context);
 
     Context c(context);
@@ -646,6 +753,13 @@ void LcFor::print(std::ostream &stream) const
     stream << "for(" << this->arguments << ") (" << *this->expr << ")";
 }
 
+void LcFor::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::LcFor, *this);
+	writer.write(this->arguments);
+	writer.write(this->expr.get());
+}
+
 LcForC::LcForC(const AssignmentList &args, const AssignmentList &incrargs, Expression *cond, Expression *expr, const Location &loc)
 	: ListComprehension(loc), arguments(args), incr_arguments(incrargs), cond(cond), expr(expr)
 {
@@ -687,6 +801,15 @@ void LcForC::print(std::ostream &stream) const
         << ") " << *this->expr;
 }
 
+void LcForC::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::LcForC, *this);
+	writer.write(this->arguments);
+	writer.write(this->incr_arguments);
+	writer.write(this->cond.get());
+	writer.write(this->expr.get());
+}
+
 LcLet::LcLet(const AssignmentList &args, Expression *expr, const Location &loc)
 	: ListComprehension(loc), arguments(args), expr(expr)
 {
@@ -704,6 +827,13 @@ void LcLet::print(std::ostream &stream) const
     stream << "let(" << this->arguments << ") (" << *this->expr << ")";
 }
 
+void LcLet::serialize(ASTWriter &writer) const
+{
+	writer.writeNode(ASTTag::LcLet, *this);
+	writer.write(this->arguments);
+	writer.write(this->expr.get());
+}
+
 std::ostream &operator<<(std::ostream &stream, const Expression &expr)
 {
 	expr.print(stream);
@@ -718,13 +848,13 @@ void evaluate_assert(const Context &context, const class EvalContext *evalctx, c
 	args += Assignment("condition"), Assignment("message");
 
 	Context c(&context);
-	const Context::Expressions expressions = c.setVariables(args, evalctx);
+	c.setVariables(args, evalctx);
 	const ValuePtr condition = c.lookup_variable("condition");
 
 	if (!condition->toBool()) {
 		std::stringstream msg;
 		msg << "ERROR: Assertion";
-		const Expression *expr = expressions.at("condition");
+		const Expression *expr = c.getExpressions(args, evalctx).at("condition");
 		if (expr) {
 			msg << " '" << *expr << "'";
 		}
@@ -16,6 +16,7 @@ public:
     virtual bool isLiteral() const;
 	virtual ValuePtr evaluate(const class Context *context) const = 0;
 	virtual void print(std::ostream &stream) const = 0;
+	virtual void serialize(class ASTWriter &writer) const = 0;
 };
 
 std::ostream &operator<<(std::ostream &stream, const Expression &expr);
@@ -31,6 +32,7 @@ public:
 	UnaryOp(Op op, Expression *expr, const Location &loc);
 	virtual ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 
 private:
 	const char *opString() const;
@@ -61,6 +63,7 @@ public:
 	BinaryOp(Expression *left, Op op, Expression *right, const Location &loc);
 	virtual ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 
 private:
 	const char *opString() const;
@@ -76,6 +79,7 @@ public:
 	TernaryOp(Expression *cond, Expression *ifexpr, Expression *elseexpr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 
 	shared_ptr<Expression> cond;
 	shared_ptr<Expression> ifexpr;
@@ -88,6 +92,7 @@ public:
 	ArrayLookup(Expression *array, Expression *index, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	shared_ptr<Expression> array;
 	shared_ptr<Expression> index;
@@ -99,6 +104,7 @@ public:
 	Literal(const ValuePtr &val, const Location &loc = Location::NONE);
 	ValuePtr evaluate(const class Context *) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
     virtual bool isLiteral() const { return true;}
 private:
 	ValuePtr value;
@@ -111,6 +117,7 @@ public:
 	Range(Expression *begin, Expression *step, Expression *end, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 	virtual bool isLiteral() const;
 private:
 	shared_ptr<Expression> begin;
@@ -124,6 +131,7 @@ public:
 	Vector(const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 	void push_back(Expression *expr);
     virtual bool isLiteral() const ;
 private:
@@ -136,8 +144,10 @@ public:
 	Lookup(const std::string &name, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	std::string name;
+	Symbol symbol;
 };
 
 class MemberLookup : public Expression
@@ -146,6 +156,7 @@ public:
 	MemberLookup(Expression *expr, const std::string &member, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	shared_ptr<Expression> expr;
 	std::string member;
@@ -157,6 +168,7 @@ public:
 	FunctionCall(const std::string &funcname, const AssignmentList &arglist, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 	static Expression * create(const std::string &funcname, const AssignmentList &arglist, Expression *expr, const Location &loc);
 public:
 	std::string name;
@@ -169,6 +181,7 @@ public:
 	Assert(const AssignmentList &args, Expression *expr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	AssignmentList arguments;
 	shared_ptr<Expression> expr;
@@ -180,6 +193,7 @@ public:
 	Echo(const AssignmentList &args, Expression *expr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	AssignmentList arguments;
 	shared_ptr<Expression> expr;
@@ -191,6 +205,7 @@ public:
 	Let(const AssignmentList &args, Expression *expr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	AssignmentList arguments;
 	shared_ptr<Expression> expr;
@@ -209,6 +224,7 @@ public:
 	LcIf(Expression *cond, Expression *ifexpr, Expression *elseexpr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	shared_ptr<Expression> cond;
 	shared_ptr<Expression> ifexpr;
@@ -221,6 +237,7 @@ public:
 	LcFor(const AssignmentList &args, Expression *expr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	AssignmentList arguments;
 	shared_ptr<Expression> expr;
@@ -232,6 +249,7 @@ public:
 	LcForC(const AssignmentList &args, const AssignmentList &incrargs, Expression *cond, Expression *expr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	AssignmentList arguments;
 	AssignmentList incr_arguments;
@@ -245,6 +263,7 @@ public:
 	LcEach(Expression *expr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	shared_ptr<Expression> expr;
 };
@@ -255,6 +274,7 @@ public:
 	LcLet(const AssignmentList &args, Expression *expr, const Location &loc);
 	ValuePtr evaluate(const class Context *context) const;
 	virtual void print(std::ostream &stream) const;
+	virtual void serialize(class ASTWriter &writer) const;
 private:
 	AssignmentList arguments;
 	shared_ptr<Expression> expr;
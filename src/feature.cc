@@ -27,6 +27,7 @@ const Feature Feature::ExperimentalForCExpression("lc-for-c", "Enable C-style <c
 const Feature Feature::ExperimentalAmfImport("amf-import", "Enable AMF import.");
 const Feature Feature::ExperimentalSvgImport("svg-import", "Enable SVG import.");
 const Feature Feature::ExperimentalCustomizer("customizer", "Enable Customizer");
+const Feature Feature::ExperimentalParallelInstantiation("parallel-instantiation", "Enable parallel instantiation of <code>for</code> loops and sibling modules.");
 
 
 Feature::Feature(const std::string &name, const std::string &description)
@@ -22,6 +22,7 @@ public:
         static const Feature ExperimentalAmfImport;
         static const Feature ExperimentalSvgImport;
         static const Feature ExperimentalCustomizer;
+        static const Feature ExperimentalParallelInstantiation;
 
 
 	const std::string& get_name() const;
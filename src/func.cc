@@ -44,6 +44,7 @@
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <mutex>
 
 /*
  Random numbers
@@ -71,6 +72,8 @@ int process_id = getpid();
 
 boost::mt19937 deterministic_rng;
 boost::mt19937 lessdeterministic_rng( std::time(0) + process_id );
+// Guards both generators, as builtins may be evaluated by several threads
+std::mutex rng_mutex;
 
 static inline double deg2rad(double x)
 {
@@ -138,6 +141,7 @@ ValuePtr builtin_rands(const Context *, const EvalContext *evalctx)
 		}
 		size_t numresults = boost_numeric_cast<size_t,double>( numresultsd );
 
+		std::lock_guard<std::mutex> lock(rng_mutex);
 		bool deterministic = false;
 		if (n > 3) {
 			ValuePtr v3 = evalctx->getArgValue(3);
@@ -2,12 +2,16 @@
 
 #include "linalg.h"
 #include "hash.h"
+#include "FlatHashMap.h"
+#include "parallel.h"
 #include <boost/functional/hash.hpp>
 #include <cmath>
 
 #include <cstdint> // int64_t
 #include <unordered_map>
 #include <utility>
+#include <vector>
+#include <numeric>
 
 //const double GRID_COARSE = 0.001;
 //const double GRID_FINE   = 0.000001;
@@ -147,7 +151,8 @@ public:
 	}
 
 	bool has(const Vector3d &v, T *data = NULL) {
-		Vector3l key = createGridVertex(v);
+		Vector3l key;
+		createGridVertex(v, key);
 		typename GridContainer::iterator pos = db.find(key);
 		if (pos != db.end()) {
 			if (data) *data = pos->second;
@@ -170,3 +175,139 @@ public:
 	}
 
 };
+
+/*!
+	Welds 3D vertices on a grid, like Grid3d<int>, but optimized for large meshes.
+
+	Vertices are quantized to grid keys. A vertex whose key doesn't exist yet
+	is snapped to the nearest existing vertex in one of the 26 neighboring cells,
+	if any, otherwise it becomes a new vertex. Each key is resolved only once,
+	so all vertices falling into the same cell are welded to the same vertex.
+	Vertex indices are assigned in order of insertion.
+
+	Keys are stored in an open addressing hash table. For large inputs, the batch
+	version of align() computes keys and sorts them on all available cores, so
+	only the distinct keys need to be resolved serially.
+*/
+class VertexWelder
+{
+public:
+	typedef Vector3l Key;
+
+	VertexWelder(double resolution) : res(resolution) {}
+
+	size_t size() const { return this->keys.size(); }
+
+	// Returns the aligned position of the vertex with the given index
+	Vector3d vertex(int idx) const {
+		const Key &key = this->keys[idx];
+		return Vector3d(key[0] * this->res, key[1] * this->res, key[2] * this->res);
+	}
+
+	// Aligns vertex to the grid. Returns index of the vertex.
+	int align(Vector3d &v) {
+		int idx = lookup(createKey(v));
+		v = vertex(idx);
+		return idx;
+	}
+
+	/*!
+		Aligns all vertices to the grid. Returns the index of each vertex.
+		The result is the same as when calling align() for each vertex in order.
+	*/
+	std::vector<int> align(std::vector<Vector3d> &vertices) {
+		const size_t n = vertices.size();
+		std::vector<Key> vkeys(n);
+		std::vector<int> indices(n);
+		forBlocks(n, [&](size_t i) { vkeys[i] = createKey(vertices[i]); });
+
+		if (n < BATCH_THRESHOLD) {
+			for (size_t i = 0; i < n; i++) indices[i] = lookup(vkeys[i]);
+		}
+		else {
+			// Group equal keys. Ties are ordered by position, so the first member
+			// of each group is the first occurrence of its key.
+			std::vector<uint32_t> order(n);
+			std::iota(order.begin(), order.end(), 0);
+			parallel_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+				const Key &ka = vkeys[a], &kb = vkeys[b];
+				if (ka[0] != kb[0]) return ka[0] < kb[0];
+				if (ka[1] != kb[1]) return ka[1] < kb[1];
+				if (ka[2] != kb[2]) return ka[2] < kb[2];
+				return a < b;
+			});
+			std::vector<uint32_t> groups;
+			std::vector<int> groupof(n, -1);
+			for (size_t i = 0; i < n; i++) {
+				if (i == 0 || vkeys[order[i]] != vkeys[order[i - 1]]) {
+					groupof[order[i]] = groups.size();
+					groups.push_back(i);
+				}
+			}
+			groups.push_back(n);
+
+			// Resolve distinct keys in order of first occurrence
+			this->table.reserve(this->table.size() + groups.size());
+			std::vector<int> groupindex(groups.size() - 1);
+			for (size_t i = 0; i < n; i++) {
+				if (groupof[i] >= 0) groupindex[groupof[i]] = lookup(vkeys[i]);
+			}
+			forBlocks(groupindex.size(), [&](size_t g) {
+				for (size_t j = groups[g]; j < groups[g + 1]; j++) indices[order[j]] = groupindex[g];
+			});
+		}
+
+		forBlocks(n, [&](size_t i) { vertices[i] = vertex(indices[i]); });
+		return indices;
+	}
+
+private:
+	// Inputs with fewer vertices are aligned serially
+	static const size_t BATCH_THRESHOLD = 65536;
+
+	Key createKey(const Vector3d &v) const {
+		return Key(int64_t(v[0] / this->res), int64_t(v[1] / this->res), int64_t(v[2] / this->res));
+	}
+
+	// Calls fn(i) for all i in [0, n) on all cores, in blocks large enough to amortize scheduling
+	template <typename Fn>
+	static void forBlocks(size_t n, Fn fn) {
+		const size_t blocksize = 16384;
+		parallel_for((n + blocksize - 1) / blocksize, [&](size_t b) {
+			size_t end = std::min(n, (b + 1) * blocksize);
+			for (size_t i = b * blocksize; i < end; i++) fn(i);
+		});
+	}
+
+	int lookup(const Key &key) {
+		int idx = this->table.find(key);
+		if (idx >= 0) return idx;
+
+		float dist = 10.0f; // > max possible distance
+		for (int64_t jx = key[0] - 1; jx <= key[0] + 1; jx++) {
+			for (int64_t jy = key[1] - 1; jy <= key[1] + 1; jy++) {
+				for (int64_t jz = key[2] - 1; jz <= key[2] + 1; jz++) {
+					Key k(jx, jy, jz);
+					int i = this->table.find(k);
+					// Keys which were snapped themselves don't attract other vertices
+					if (i < 0 || this->keys[i] != k) continue;
+					float d = sqrt((key - k).squaredNorm());
+					if (d < dist) {
+						dist = d;
+						idx = i;
+					}
+				}
+			}
+		}
+		if (idx < 0) {
+			idx = this->keys.size();
+			this->keys.push_back(key);
+		}
+		this->table.insert(key, idx);
+		return idx;
+	}
+
+	double res;
+	FlatHashMap<Key> table;   // Key -> index of the vertex it was welded to
+	std::vector<Key> keys;    // Key of each vertex index
+};
@@ -25,14 +25,17 @@ void handle_dep(const std::string &filename)
 	}
 }
 
-bool write_deps(const std::string &filename, const std::string &output_file)
+bool write_deps(const std::string &filename, const std::vector<std::string> &output_files)
 {
 	FILE *fp = fopen(filename.c_str(), "wt");
 	if (!fp) {
 		fprintf(stderr, "Can't open dependencies file `%s' for writing!\n", filename.c_str());
 		return false;
 	}
-	fprintf(fp, "%s:", output_file.c_str());
+	for (size_t i = 0; i < output_files.size(); i++) {
+		fprintf(fp, i == 0 ? "%s" : " %s", output_files[i].c_str());
+	}
+	fprintf(fp, ":");
 
 	for(const auto &str : dependencies) {
 		fprintf(fp, " \\\n\t%s", str.c_str());
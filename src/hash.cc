@@ -2,6 +2,9 @@
 #include <boost/functional/hash.hpp>
 
 namespace std {
+	std::size_t hash<Vector2d>::operator()(const Vector2d &s) const {
+		return Eigen::hash_value(s);
+	}
 	std::size_t hash<Vector3f>::operator()(const Vector3f &s) const {
 		return Eigen::hash_value(s);
 	}
@@ -14,6 +17,11 @@ namespace std {
 }
 
 namespace Eigen {
+  size_t hash_value(Vector2d const &v) {
+    size_t seed = 0;
+    for (int i=0;i<2;i++) boost::hash_combine(seed, v[i]);
+    return seed;
+  }
   size_t hash_value(Vector3f const &v) {
     size_t seed = 0;
     for (int i=0;i<3;i++) boost::hash_combine(seed, v[i]);
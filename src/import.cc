@@ -40,6 +40,7 @@
 #include "printutils.h"
 #include "fileutils.h"
 #include "feature.h"
+#include "calc.h"
 
 #include <sys/types.h>
 #include <sstream>
@@ -111,9 +112,19 @@ AbstractNode *ImportModule::instantiate(const Context *ctx, const ModuleInstanti
 
 	ImportNode *node = new ImportNode(inst, actualtype);
 
-	node->fn = c.lookup_variable("$fn")->toDouble();
-	node->fs = c.lookup_variable("$fs")->toDouble();
-	node->fa = c.lookup_variable("$fa")->toDouble();
+	node->fn = c.lookup_variable(Symbols::fn)->toDouble();
+	node->fs = c.lookup_variable(Symbols::fs)->toDouble();
+	node->fa = c.lookup_variable(Symbols::fa)->toDouble();
+	if (actualtype == TYPE_DXF || actualtype == TYPE_SVG) {
+		if (node->fs < F_MINIMUM) {
+			PRINTB("WARNING: $fs too small - clamping to %f", F_MINIMUM);
+			node->fs = F_MINIMUM;
+		}
+		if (node->fa < F_MINIMUM) {
+			PRINTB("WARNING: $fa too small - clamping to %f", F_MINIMUM);
+			node->fa = F_MINIMUM;
+		}
+	}
 
 	node->filename = filename;
 	Value layerval = *c.lookup_variable("layer", true);
@@ -165,7 +176,7 @@ const Geometry *ImportNode::createGeometry() const
 		break;
 	}
 	case TYPE_SVG: {
-		g = import_svg(this->filename);
+		g = import_svg(this->filename, this->fn, this->fs, this->fa);
  		break;
 	}
 	case TYPE_DXF: {
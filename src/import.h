@@ -4,7 +4,8 @@
 
 class PolySet *import_stl(const std::string &filename);
 PolySet *import_off(const std::string &filename);
-class Polygon2d *import_svg(const std::string &filename);
+class Polygon2d *import_svg(const std::string &filename, double fn, double fs, double fa);
+void import_svg_clear_cache();
 #ifdef ENABLE_CGAL
 class CGAL_Nef_polyhedron *import_nef3(const std::string &filename);
 #endif
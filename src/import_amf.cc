@@ -28,231 +28,297 @@
 
 #include "polyset.h"
 #include "printutils.h"
+#include "numparse.h"
 
 #ifdef ENABLE_CGAL
 #include "cgalutils.h"
 #endif
 
 #include <sys/types.h>
-#include <map>
-#include <fstream>
+#include <cstdio>
+#include <clocale>
+#include <cstring>
+#include <unordered_map>
 #include <assert.h>
-#include <libxml/xmlreader.h>
+#include <libxml/parser.h>
 #include <boost/filesystem.hpp>
 namespace fs = boost::filesystem;
 
-static const std::string text_node("#text");
-static const std::string object("/amf/object");
-static const std::string coordinates("/amf/object/mesh/vertices/vertex/coordinates");
-static const std::string coordinates_x = coordinates + "/x";
-static const std::string coordinates_y = coordinates + "/y";
-static const std::string coordinates_z = coordinates + "/z";
-static const std::string triangle("/amf/object/mesh/volume/triangle");
-static const std::string triangle_v1 = triangle + "/v1";
-static const std::string triangle_v2 = triangle + "/v2";
-static const std::string triangle_v3 = triangle + "/v3";
+/*!
+	Reads AMF with a SAX parser fed in blocks, so only the mesh being built is
+	held in memory.
 
+	Element names are mapped to tags once per distinct name: libxml interns
+	names in its dictionary, so later lookups are by pointer. Each open element
+	gets a state from its parent's state and its tag, which replaces matching
+	the full element path.
+*/
 class AmfImporter {
-private:
-	fs::path path;
+public:
+	AmfImporter();
+	virtual ~AmfImporter();
+	PolySet *read(const std::string filename);
 
-	typedef void (*cb_func)(AmfImporter *, const xmlChar *);
+protected:
+	// Opens the AMF data of filename, returns false if it can't be read
+	virtual bool open(const std::string &filename);
+	// Reads up to len bytes, returns the number read, 0 at the end or -1 on error
+	virtual int readData(char *buffer, int len);
+	virtual void close();
+
+private:
+	enum Tag { TAG_OTHER, TAG_AMF, TAG_OBJECT, TAG_MESH, TAG_VERTICES, TAG_VERTEX, TAG_COORDINATES,
+						 TAG_X, TAG_Y, TAG_Z, TAG_VOLUME, TAG_TRIANGLE, TAG_V1, TAG_V2, TAG_V3 };
+	enum State { STATE_NONE, STATE_AMF, STATE_OBJECT, STATE_MESH, STATE_VERTICES, STATE_VERTEX,
+							 STATE_COORDINATES, STATE_COORDINATE, STATE_VOLUME, STATE_TRIANGLE, STATE_TRIANGLE_VERTEX };
+	struct Element {
+		Tag tag;
+		State state;
+	};
+
+	Tag tag(const xmlChar *name);
+	static State nextState(State parent, Tag tag);
+	bool streamFile(const std::string &filename);
+	void startElement(const xmlChar *name);
+	void endElement();
+	void fail(const char *what);
+
+	static void startElementCallback(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+																	 int nb_namespaces, const xmlChar **namespaces,
+																	 int nb_attributes, int nb_defaulted, const xmlChar **attributes);
+	static void endElementCallback(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI);
+	static void charactersCallback(void *ctx, const xmlChar *ch, int len);
+
+	FILE *file;
+	xmlParserCtxtPtr ctxt;
+	std::unordered_map<const xmlChar *, Tag> tags;
+	std::vector<Element> elements;
+	std::string text;
+	bool error;
 
 	PolySet *polySet;
 	std::vector<PolySet *> polySets;
-	
-	double x, y, z;
-	int idx_v1, idx_v2, idx_v3;
-	std::vector<Eigen::Vector3d> vertex_list;
-
-	std::map<const std::string, cb_func> funcs;
-	std::map<const std::string, cb_func> start_funcs;
-	std::map<const std::string, cb_func> end_funcs;
-
-	static void set_x(AmfImporter *importer, const xmlChar *value);
-	static void set_y(AmfImporter *importer, const xmlChar *value);
-	static void set_z(AmfImporter *importer, const xmlChar *value);
-	static void set_v1(AmfImporter *importer, const xmlChar *value);
-	static void set_v2(AmfImporter *importer, const xmlChar *value);
-	static void set_v3(AmfImporter *importer, const xmlChar *value);
-	static void start_object(AmfImporter *importer, const xmlChar *value);
-	static void end_object(AmfImporter *importer, const xmlChar *value);
-	static void end_triangle(AmfImporter *importer, const xmlChar *vlue);
-	static void end_vertex(AmfImporter *importer, const xmlChar *value);
-	
-	int streamFile(const char *filename);
-	void processNode(xmlTextReaderPtr reader);
 
-public:
-	AmfImporter();
-	virtual ~AmfImporter();
-	PolySet *read(const std::string filename);
-	
-	virtual xmlTextReaderPtr createXmlReader(const char *filename);
+	double coords[3];
+	long indices[3];
+	std::vector<Eigen::Vector3d> vertex_list;
 };
 
-AmfImporter::AmfImporter() : path("/")
+AmfImporter::AmfImporter() : file(NULL), ctxt(NULL), error(false), polySet(NULL)
 {
 }
 
 AmfImporter::~AmfImporter()
 {
 }
-	
-void AmfImporter::set_x(AmfImporter *importer, const xmlChar *value)
-{
-	importer->x = boost::lexical_cast<double>(std::string((const char *)value));
-}
 
-void AmfImporter::set_y(AmfImporter *importer, const xmlChar *value)
+AmfImporter::Tag AmfImporter::tag(const xmlChar *name)
 {
-	importer->y = boost::lexical_cast<double>(std::string((const char *)value));
+	auto it = this->tags.find(name);
+	if (it != this->tags.end()) return it->second;
+
+	static const struct { const char *name; Tag tag; } names[] = {
+		{"amf", TAG_AMF}, {"object", TAG_OBJECT}, {"mesh", TAG_MESH}, {"vertices", TAG_VERTICES},
+		{"vertex", TAG_VERTEX}, {"coordinates", TAG_COORDINATES}, {"x", TAG_X}, {"y", TAG_Y}, {"z", TAG_Z},
+		{"volume", TAG_VOLUME}, {"triangle", TAG_TRIANGLE}, {"v1", TAG_V1}, {"v2", TAG_V2}, {"v3", TAG_V3}
+	};
+	Tag t = TAG_OTHER;
+	for (const auto &n : names) {
+		if (!strcmp(n.name, reinterpret_cast<const char *>(name))) t = n.tag;
+	}
+	// Only names owned by the dictionary keep their address
+	if (xmlDictOwns(this->ctxt->dict, name) == 1) this->tags[name] = t;
+	return t;
 }
 
-void AmfImporter::set_z(AmfImporter *importer, const xmlChar *value)
+AmfImporter::State AmfImporter::nextState(State parent, Tag tag)
 {
-	importer->z = boost::lexical_cast<double>(std::string((const char *)value));
+	switch (parent) {
+	case STATE_NONE:
+		// The root element is only recognized at the top
+		return STATE_NONE;
+	case STATE_AMF: return tag == TAG_OBJECT ? STATE_OBJECT : STATE_NONE;
+	case STATE_OBJECT: return tag == TAG_MESH ? STATE_MESH : STATE_NONE;
+	case STATE_MESH:
+		if (tag == TAG_VERTICES) return STATE_VERTICES;
+		if (tag == TAG_VOLUME) return STATE_VOLUME;
+		return STATE_NONE;
+	case STATE_VERTICES: return tag == TAG_VERTEX ? STATE_VERTEX : STATE_NONE;
+	case STATE_VERTEX: return tag == TAG_COORDINATES ? STATE_COORDINATES : STATE_NONE;
+	case STATE_COORDINATES: return (tag == TAG_X || tag == TAG_Y || tag == TAG_Z) ? STATE_COORDINATE : STATE_NONE;
+	case STATE_VOLUME: return tag == TAG_TRIANGLE ? STATE_TRIANGLE : STATE_NONE;
+	case STATE_TRIANGLE: return (tag == TAG_V1 || tag == TAG_V2 || tag == TAG_V3) ? STATE_TRIANGLE_VERTEX : STATE_NONE;
+	default: return STATE_NONE;
+	}
 }
 
-void AmfImporter::set_v1(AmfImporter *importer, const xmlChar *value)
+void AmfImporter::fail(const char *what)
 {
-	importer->idx_v1 = boost::lexical_cast<int>(std::string((const char *)value));
+	if (!this->error) {
+		PRINTB("WARNING: AMF import: %s, line %d.", what % xmlSAX2GetLineNumber(this->ctxt));
+	}
+	this->error = true;
+	xmlStopParser(this->ctxt);
 }
 
-void AmfImporter::set_v2(AmfImporter *importer, const xmlChar *value)
+void AmfImporter::startElement(const xmlChar *name)
 {
-	importer->idx_v2 = boost::lexical_cast<int>(std::string((const char *)value));
+	Tag t = tag(name);
+	State state = this->elements.empty() ? (t == TAG_AMF ? STATE_AMF : STATE_NONE) : nextState(this->elements.back().state, t);
+	this->elements.push_back({t, state});
+	this->text.clear();
+
+	switch (state) {
+	case STATE_OBJECT:
+		this->polySet = new PolySet(3);
+		break;
+	case STATE_COORDINATES:
+		this->coords[0] = this->coords[1] = this->coords[2] = 0;
+		break;
+	case STATE_TRIANGLE:
+		this->indices[0] = this->indices[1] = this->indices[2] = 0;
+		break;
+	default:
+		break;
+	}
 }
 
-void AmfImporter::set_v3(AmfImporter *importer, const xmlChar *value)
+void AmfImporter::endElement()
 {
-	importer->idx_v3 = boost::lexical_cast<int>(std::string((const char *)value));
+	const Element element = this->elements.back();
+	this->elements.pop_back();
+
+	switch (element.state) {
+	case STATE_COORDINATE: {
+		const char *p = this->text.c_str();
+		while (std::isspace(static_cast<unsigned char>(*p))) p++;
+		if (!NumParse::parseDouble(p, this->text.c_str() + this->text.size(), this->coords[element.tag - TAG_X])) {
+			fail("Invalid coordinate");
+		}
+		break;
+	}
+	case STATE_TRIANGLE_VERTEX: {
+		const char *p = this->text.c_str();
+		while (std::isspace(static_cast<unsigned char>(*p))) p++;
+		if (!NumParse::parseInt(p, this->text.c_str() + this->text.size(), this->indices[element.tag - TAG_V1])) {
+			fail("Invalid vertex index");
+		}
+		break;
+	}
+	case STATE_COORDINATES:
+		this->vertex_list.push_back(Eigen::Vector3d(this->coords[0], this->coords[1], this->coords[2]));
+		break;
+	case STATE_TRIANGLE: {
+		const std::vector<Eigen::Vector3d> &v = this->vertex_list;
+		for (auto idx : this->indices) {
+			if (idx < 0 || idx >= long(v.size())) {
+				fail("Invalid vertex index");
+				return;
+			}
+		}
+		this->polySet->append_poly();
+		for (auto idx : this->indices) this->polySet->append_vertex(v[idx]);
+		break;
+	}
+	case STATE_OBJECT:
+		PRINTDB("AMF: add object %d", this->polySets.size());
+		this->polySets.push_back(this->polySet);
+		this->vertex_list.clear();
+		this->polySet = NULL;
+		break;
+	default:
+		break;
+	}
 }
 
-void AmfImporter::start_object(AmfImporter *importer, const xmlChar *)
+void AmfImporter::startElementCallback(void *ctx, const xmlChar *localname, const xmlChar *, const xmlChar *,
+																			 int, const xmlChar **, int, int, const xmlChar **)
 {
-	importer->polySet = new PolySet(3);
+	static_cast<AmfImporter *>(ctx)->startElement(localname);
 }
 
-void AmfImporter::end_object(AmfImporter *importer, const xmlChar *)
+void AmfImporter::endElementCallback(void *ctx, const xmlChar *, const xmlChar *, const xmlChar *)
 {
-	PRINTDB("AMF: add object %d", importer->polySets.size());
-	importer->polySets.push_back(importer->polySet);
-	importer->vertex_list.clear();
-	importer->polySet = NULL;
+	static_cast<AmfImporter *>(ctx)->endElement();
 }
 
-void AmfImporter::end_vertex(AmfImporter *importer, const xmlChar *)
+void AmfImporter::charactersCallback(void *ctx, const xmlChar *ch, int len)
 {
-	PRINTDB("AMF: add vertex %d - (%.2f, %.2f, %.2f)", importer->vertex_list.size() % importer->x % importer->y % importer->z);
-	importer->vertex_list.push_back(Eigen::Vector3d(importer->x, importer->y, importer->z));
+	AmfImporter *importer = static_cast<AmfImporter *>(ctx);
+	// Text may arrive in several pieces, collect it for the value elements only
+	if (!importer->elements.empty()) {
+		State state = importer->elements.back().state;
+		if (state == STATE_COORDINATE || state == STATE_TRIANGLE_VERTEX) {
+			importer->text.append(reinterpret_cast<const char *>(ch), len);
+		}
+	}
 }
 
-void AmfImporter::end_triangle(AmfImporter *importer, const xmlChar *)
+bool AmfImporter::open(const std::string &filename)
 {
-	int idx_v1 = importer->idx_v1;
-	int idx_v2 = importer->idx_v2;
-	int idx_v3 = importer->idx_v3;
-	PRINTDB("AMF: add triangle %d - (%.2f, %.2f, %.2f)", importer->vertex_list.size() % idx_v1 % idx_v2 % idx_v3);
-
-	std::vector<Eigen::Vector3d> &v = importer->vertex_list;
-	
-	importer->polySet->append_poly();
-	importer->polySet->append_vertex(v[idx_v1].x(), v[idx_v1].y(), v[idx_v1].z());
-	importer->polySet->append_vertex(v[idx_v2].x(), v[idx_v2].y(), v[idx_v2].z());
-	importer->polySet->append_vertex(v[idx_v3].x(), v[idx_v3].y(), v[idx_v3].z());
+	this->file = fopen(filename.c_str(), "rb");
+	return this->file != NULL;
 }
 
-void AmfImporter::processNode(xmlTextReaderPtr reader)
+int AmfImporter::readData(char *buffer, int len)
 {
-	const char *name = reinterpret_cast<const char *> (xmlTextReaderName(reader));
-	if (name == NULL)
-		name = reinterpret_cast<const char *> (xmlStrdup(BAD_CAST "--"));
-
-	xmlChar *value = xmlTextReaderValue(reader);
-	int node_type = xmlTextReaderNodeType(reader);
-	switch (node_type) {
-	case XML_READER_TYPE_ELEMENT:
-	{
-		path /= name;
-		cb_func startFunc = start_funcs[path.string()];
-		if (startFunc) {
-			PRINTDB("AMF: start %s", path.string());
-			startFunc(this, NULL);
-		}
-	}
-		break;
-	case XML_READER_TYPE_END_ELEMENT:
-	{
-		cb_func endFunc = end_funcs[path.string()];
-		if (endFunc) {
-			PRINTDB("AMF: end   %s", path.string());
-			endFunc(this, value);
-		}
-		path = path.parent_path();
-	}
-		break;
-	case XML_READER_TYPE_TEXT:
-	{
-		cb_func textFunc = funcs[path.string()];
-		if (textFunc) {
-			PRINTDB("AMF: text  %s - '%s'", path.string() % value);
-			textFunc(this, value);
-		}
-	}
-		break;
-	}
-
-	xmlFree(value);
-	xmlFree((void *) (name));
+	size_t n = fread(buffer, 1, len, this->file);
+	return ferror(this->file) ? -1 : int(n);
 }
 
-xmlTextReaderPtr AmfImporter::createXmlReader(const char *filename)
+void AmfImporter::close()
 {
-	return xmlReaderForFile(filename, NULL, XML_PARSE_NOENT | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+	if (this->file) fclose(this->file);
+	this->file = NULL;
 }
 
-int AmfImporter::streamFile(const char *filename)
+bool AmfImporter::streamFile(const std::string &filename)
 {
-	int ret;
-
-	xmlTextReaderPtr reader = createXmlReader(filename);
-	
-	if (reader == NULL) {
+	if (!open(filename)) {
 		PRINTB("WARNING: Can't open import file '%s'.", filename);
-		return 1;
+		return false;
 	}
 
-	try {
-		xmlTextReaderSetParserProp(reader, XML_PARSER_SUBST_ENTITIES, 1);
-		ret = xmlTextReaderRead(reader);
-		while (ret == 1) {
-			processNode(reader);
-			ret = xmlTextReaderRead(reader);
+	xmlSAXHandler handler;
+	memset(&handler, 0, sizeof(handler));
+	handler.initialized = XML_SAX2_MAGIC;
+	handler.startElementNs = startElementCallback;
+	handler.endElementNs = endElementCallback;
+	handler.characters = charactersCallback;
+
+	std::vector<char> buffer(1 << 16);
+	int len = readData(buffer.data(), buffer.size());
+	this->ctxt = xmlCreatePushParserCtxt(&handler, this, buffer.data(), std::max(len, 0), filename.c_str());
+	bool ok = this->ctxt != NULL && len >= 0;
+	if (ok) {
+		xmlCtxtUseOptions(this->ctxt, XML_PARSE_NOENT | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+		setlocale(LC_NUMERIC, "C"); // Ensure radix is . (not ,) for strtod()
+		while (!this->error) {
+			len = readData(buffer.data(), buffer.size());
+			if (len < 0) break;
+			if (xmlParseChunk(this->ctxt, buffer.data(), len, len == 0) != XML_ERR_OK || len == 0) break;
 		}
-		xmlFreeTextReader(reader);
-	} catch (boost::bad_lexical_cast &) {
-		ret = -1;
+		setlocale(LC_NUMERIC, "");      // Set default locale
+		ok = len == 0 && !this->error && this->ctxt->wellFormed;
 	}
-	if (ret != 0) {
+	if (this->ctxt) xmlFreeParserCtxt(this->ctxt);
+	this->ctxt = NULL;
+	close();
+
+	// Objects left open by a parse error
+	if (this->polySet) delete this->polySet;
+	this->polySet = NULL;
+	if (!ok) {
 		PRINTB("WARNING: Failed to parse file '%s'.", filename);
+		for (auto ps : this->polySets) delete ps;
+		this->polySets.clear();
 	}
-	return ret;
+	return ok;
 }
 
 PolySet * AmfImporter::read(const std::string filename)
 {
-	funcs[coordinates_x] = set_x;
-	funcs[coordinates_y] = set_y;
-	funcs[coordinates_z] = set_z;
-	funcs[triangle_v1] = set_v1;
-	funcs[triangle_v2] = set_v2;
-	funcs[triangle_v3] = set_v3;
-	start_funcs[object] = start_object;
-	end_funcs[coordinates] = end_vertex;
-	end_funcs[triangle] = end_triangle;
-	end_funcs[object] = end_object;
-	streamFile(filename.c_str());
+	streamFile(filename);
 	vertex_list.clear();
 
 	PolySet *p = NULL;
@@ -286,23 +352,27 @@ PolySet * AmfImporter::read(const std::string filename)
 
 #include <zip.h>
 
+/*!
+	Reads compressed AMF, which is a zip archive holding the AMF file. Files
+	which aren't zip archives are read as uncompressed AMF.
+*/
 class AmfImporterZIP : public AmfImporter
 {
 private:
 	struct zip *archive;
 	struct zip_file *zipfile;
 
-	static int read_callback(void *context, char *buffer, int len);
-	static int close_callback(void *context);
-
 public:
 	AmfImporterZIP();
 	virtual ~AmfImporterZIP();
 
-	virtual xmlTextReaderPtr createXmlReader(const char *filename);
+protected:
+	virtual bool open(const std::string &filename);
+	virtual int readData(char *buffer, int len);
+	virtual void close();
 };
 
-AmfImporterZIP::AmfImporterZIP()
+AmfImporterZIP::AmfImporterZIP() : archive(NULL), zipfile(NULL)
 {
 }
 
@@ -310,41 +380,45 @@ AmfImporterZIP::~AmfImporterZIP()
 {
 }
 
-int AmfImporterZIP::read_callback(void *context, char *buffer, int len)
+bool AmfImporterZIP::open(const std::string &filename)
 {
-	AmfImporterZIP *importer = (AmfImporterZIP *)context;
-	return zip_fread(importer->zipfile, buffer, len);
-}
-
-int AmfImporterZIP::close_callback(void *context)
-{
-	AmfImporterZIP *importer = (AmfImporterZIP *)context;
-	return zip_fclose(importer->zipfile);
-}
-
-xmlTextReaderPtr AmfImporterZIP::createXmlReader(const char *filename)
-{
-	archive = zip_open(filename, 0, NULL);
+	archive = zip_open(filename.c_str(), 0, NULL);
 	if (archive) {
 		fs::path f(filename);
-		zipfile = zip_fopen(archive, f.filename().c_str(), ZIP_FL_NODIR);
+		zipfile = zip_fopen(archive, f.filename().string().c_str(), ZIP_FL_NODIR);
 		if (zipfile == NULL) {
-			PRINTB("WARNING: Can't read file '%s' from zipped AMF '%s'", f.filename().c_str() % filename);
+			PRINTB("WARNING: Can't read file '%s' from zipped AMF '%s'", f.filename().string() % filename);
 		}
 		if ((zipfile == NULL) && (zip_get_num_files(archive) == 1)) {
 			PRINTB("WARNING: Trying to read single entry '%s'", zip_get_name(archive, 0, 0));
 			zipfile = zip_fopen_index(archive, 0, 0);
 		}
-		if (zipfile) {
-			return xmlReaderForIO(read_callback, close_callback, this, f.filename().c_str(), NULL,
-				XML_PARSE_NOENT | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
-		} else {
+		if (!zipfile) {
 			zip_close(archive);
-			zipfile = NULL;
-			return NULL;
+			archive = NULL;
+			return false;
 		}
+		return true;
+	} else {
+		return AmfImporter::open(filename);
+	}
+}
+
+int AmfImporterZIP::readData(char *buffer, int len)
+{
+	if (!archive) return AmfImporter::readData(buffer, len);
+	return int(zip_fread(zipfile, buffer, len));
+}
+
+void AmfImporterZIP::close()
+{
+	if (archive) {
+		zip_fclose(zipfile);
+		zip_close(archive);
+		zipfile = NULL;
+		archive = NULL;
 	} else {
-		return AmfImporter::createXmlReader(filename);
+		AmfImporter::close();
 	}
 }
 
@@ -1,27 +1,163 @@
 #include "import.h"
 #include "polyset.h"
 #include "printutils.h"
-#ifdef ENABLE_CGAL
-#include "cgalutils.h"
-#endif
+#include "handle_dep.h" // handle_dep()
+#include "numparse.h"
+
+#include <clocale>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace {
+
+/*!
+	Splits OFF data into tokens. Comments run from '#' to the end of the line.
+	Vertices and faces are one per line, and may be followed by colors or
+	other values we don't use, which are skipped with nextLine().
+*/
+class OffTokenizer
+{
+public:
+	OffTokenizer(const char *begin, const char *end) : p(begin), end(end), line(1) {}
+
+	// Skips whitespace and comments. Returns false at the end of the data.
+	bool skipSpace() {
+		while (this->p < this->end) {
+			if (*this->p == '#') {
+				while (this->p < this->end && *this->p != '\n') this->p++;
+			}
+			else if (std::isspace(static_cast<unsigned char>(*this->p))) {
+				if (*this->p == '\n') this->line++;
+				this->p++;
+			}
+			else return true;
+		}
+		return false;
+	}
+
+	// Skips the rest of the current line
+	void nextLine() {
+		while (this->p < this->end && *this->p != '\n') this->p++;
+	}
+
+	std::string word() {
+		if (!skipSpace()) return std::string();
+		const char *start = this->p;
+		while (this->p < this->end && !std::isspace(static_cast<unsigned char>(*this->p))) this->p++;
+		return std::string(start, this->p);
+	}
+
+	// Returns the next word without consuming it
+	std::string peekWord() {
+		const char *start = this->p;
+		int startline = this->line;
+		std::string w = word();
+		this->p = start;
+		this->line = startline;
+		return w;
+	}
+
+	bool number(double &value) {
+		return skipSpace() && NumParse::parseDouble(this->p, this->end, value) && delimited();
+	}
+
+	bool integer(long &value) {
+		return skipSpace() && NumParse::parseInt(this->p, this->end, value) && delimited();
+	}
+
+	int lineNumber() const { return this->line; }
+
+private:
+	bool delimited() const {
+		return this->p == this->end || std::isspace(static_cast<unsigned char>(*this->p)) || *this->p == '#';
+	}
+
+	const char *p;
+	const char *end;
+	int line;
+};
+
+/*!
+	Reads OFF data into ps. Faces are copied as they are, so non-manifold
+	meshes and faces with more than three vertices are kept. Returns false on
+	malformed data.
+*/
+bool read_off(const char *begin, const char *end, PolySet &ps, const std::string &filename)
+{
+	OffTokenizer tok(begin, end);
+
+	// The header keyword is optional. Prefixes describe extra per-vertex
+	// values, which we skip.
+	std::string header = tok.peekWord();
+	if (header.size() >= 3 && header.compare(header.size() - 3, 3, "OFF") == 0) {
+		tok.word();
+		if (header.find_first_of("4n") != std::string::npos || tok.peekWord() == "BINARY") {
+			PRINTB("WARNING: Unsupported OFF format '%s' in import file '%s'.", header % filename);
+			return false;
+		}
+	}
+
+	long numvertices, numfaces, numedges;
+	if (!tok.integer(numvertices) || !tok.integer(numfaces) || !tok.integer(numedges) ||
+			numvertices < 0 || numfaces < 0 || numvertices + numfaces > end - begin) {
+		PRINTB("WARNING: Invalid OFF header in import file '%s', line %d.", filename % tok.lineNumber());
+		return false;
+	}
+
+	std::vector<Vector3d> vertices(numvertices);
+	for (auto &v : vertices) {
+		if (!tok.number(v[0]) || !tok.number(v[1]) || !tok.number(v[2])) {
+			PRINTB("WARNING: Invalid vertex in import file '%s', line %d.", filename % tok.lineNumber());
+			return false;
+		}
+		tok.nextLine();
+	}
+
+	ps.resize_polygons(numfaces);
+	size_t i = 0;
+	for (long f = 0; f < numfaces; f++) {
+		long n;
+		if (!tok.integer(n) || n < 0) {
+			PRINTB("WARNING: Invalid face in import file '%s', line %d.", filename % tok.lineNumber());
+			return false;
+		}
+		Polygon &poly = ps.polygons[i];
+		poly.resize(n);
+		for (long j = 0; j < n; j++) {
+			long idx;
+			if (!tok.integer(idx) || idx < 0 || idx >= numvertices) {
+				PRINTB("WARNING: Invalid vertex index in import file '%s', line %d.", filename % tok.lineNumber());
+				return false;
+			}
+			poly[j] = vertices[idx];
+		}
+		tok.nextLine();
+		// Skip degenerate faces
+		if (n >= 3) i++;
+	}
+	ps.resize_polygons(i);
+	return true;
+}
+
+}
 
 PolySet *import_off(const std::string &filename)
 {
 	PolySet *p = new PolySet(3);
-#ifdef ENABLE_CGAL
-	CGAL_Polyhedron poly;
-	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
-	if (!file.good()) {
-		PRINTB("WARNING: Can't open import file '%s'.", filename);
+
+	handle_dep(filename);
+	try {
+		boost::interprocess::file_mapping file(filename.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+		const char *data = static_cast<const char *>(region.get_address());
+
+		setlocale(LC_NUMERIC, "C"); // Ensure radix is . (not ,) for strtod()
+		bool ok = read_off(data, data + region.get_size(), *p, filename);
+		setlocale(LC_NUMERIC, "");      // Set default locale
+		if (!ok) p->resize_polygons(0);
 	}
-	else {
-		file >> poly;
-		file.close();
-		bool err = CGALUtils::createPolySetFromPolyhedron(poly, *p);
+	catch (const boost::interprocess::interprocess_exception &) {
+		PRINTB("WARNING: Can't open import file '%s'.", filename);
 	}
-#else
-  PRINT("WARNING: OFF import requires CGAL.");
-#endif
 	return p;
 }
-	
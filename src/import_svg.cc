@@ -3,10 +3,27 @@
 #include "printutils.h"
 #include "libsvg/libsvg.h"
 #include "clipper-utils.h"
+#include "cache.h"
 
-Polygon2d *import_svg(const std::string &filename)
+#include <clocale>
+#include <ctime>
+#include <mutex>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+namespace {
+
+// Imported polygons by file and fragment settings, so importing a file
+// several times reads it once
+Cache<std::string, Polygon2d> svg_cache(32*1024*1024);
+// Guards svg_cache, and libsvg which reads one file at a time
+std::mutex svg_mutex;
+
+Polygon2d *read_svg(const std::string &filename, double fn, double fs, double fa)
 {
-	libsvg::shapes_list_t *shapes = libsvg::libsvg_read_file(filename.c_str());
+	setlocale(LC_NUMERIC, "C"); // Ensure radix is . (not ,) for strtod()
+	libsvg::shapes_list_t *shapes = libsvg::libsvg_read_file(filename.c_str(), libsvg::fn_params(fn, fs, fa));
+	setlocale(LC_NUMERIC, "");      // Set default locale
 	double x_min = 1.0/0.0;
 	double x_max = -1.0/0.0;
 	double y_min = 1.0/0.0;
@@ -34,17 +51,17 @@ Polygon2d *import_svg(const std::string &filename)
 			}
 		}
 	}
-	
+
 	double cx = (x_min + x_max) / 2;
 	double cy = (y_min + y_max) / 2;
-	
+
 	std::vector<const Polygon2d*> polygons;
 	for (libsvg::shapes_list_t::iterator it = shapes->begin();it != shapes->end();it++) {
 		Polygon2d *poly = new Polygon2d();
 		libsvg::shape *s = (*it);
 		for (libsvg::path_list_t::iterator it = s->get_path_list().begin();it != s->get_path_list().end();it++) {
 			libsvg::path_t& p = *it;
-			
+
 			Outline2d outline;
 			for (libsvg::path_t::iterator it2 = p.begin();it2 != p.end();it2++) {
 				Eigen::Vector3d& v = *it2;
@@ -57,6 +74,40 @@ Polygon2d *import_svg(const std::string &filename)
 		}
 		polygons.push_back(poly);
 	}
-	return ClipperUtils::apply(polygons, ClipperLib::ctUnion);
+	libsvg::libsvg_free(shapes);
+
+	Polygon2d *result = ClipperUtils::apply(polygons, ClipperLib::ctUnion);
+	for (const Polygon2d *poly : polygons) delete poly;
+	return result;
+}
+
+}
+
+/*!
+	Imports an SVG file, flattening curves according to fn, fs and fa.
+	Results are cached while the file's modification time and size are
+	unchanged.
+*/
+Polygon2d *import_svg(const std::string &filename, double fn, double fs, double fa)
+{
+	boost::system::error_code ec;
+	std::time_t mtime = boost::filesystem::last_write_time(filename, ec);
+	uintmax_t size = ec ? 0 : boost::filesystem::file_size(filename, ec);
+	std::stringstream key;
+	key.precision(17);
+	key << filename << "|" << mtime << "|" << size << "|" << fn << "|" << fs << "|" << fa;
+
+	std::lock_guard<std::mutex> lock(svg_mutex);
+	if (!ec) {
+		if (const Polygon2d *poly = svg_cache[key.str()]) return new Polygon2d(*poly);
+	}
+	Polygon2d *poly = read_svg(filename, fn, fs, fa);
+	if (!ec) svg_cache.insert(key.str(), new Polygon2d(*poly), poly->memsize());
+	return poly;
+}
+
+void import_svg_clear_cache()
+{
+	std::lock_guard<std::mutex> lock(svg_mutex);
+	svg_cache.clear();
 }
-	
@@ -18,15 +18,15 @@ circle::~circle()
 }
 
 void
-circle::set_attrs(attr_map_t& attrs)
+circle::set_attrs(attr_map_t& attrs, const fn_params& fn)
 {
-	shape::set_attrs(attrs);
+	shape::set_attrs(attrs, fn);
 	this->x = parse_double(attrs["cx"]);
 	this->y = parse_double(attrs["cy"]);
 	this->r = parse_double(attrs["r"]);
 	
 	path_t path;
-	draw_ellipse(path, get_x(), get_y(), get_radius(), get_radius());
+	draw_ellipse(path, get_x(), get_y(), get_radius(), get_radius(), fn);
 	path_list.push_back(path);
 }
 
@@ -16,7 +16,7 @@ public:
 
     virtual double get_radius() { return r; }
 
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     virtual void dump();
     const std::string& get_name() const { return circle::name; };
 
@@ -18,7 +18,7 @@ public:
     virtual double get_radius_x() { return rx; }
     virtual double get_radius_y() { return ry; }
 
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     virtual void dump();
     const std::string& get_name() const { return ellipse::name; };
 
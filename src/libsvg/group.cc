@@ -20,9 +20,9 @@ group::~group()
 }
 
 void
-group::set_attrs(attr_map_t& attrs)
+group::set_attrs(attr_map_t& attrs, const fn_params& fn)
 {
-	shape::set_attrs(attrs);
+	shape::set_attrs(attrs, fn);
 }
 
 void
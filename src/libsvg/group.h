@@ -15,7 +15,7 @@ public:
 
     virtual bool is_container() { return true; }
     
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     virtual void dump();
     const std::string& get_name() const { return group::name; };
     
@@ -44,7 +44,7 @@ attr_map_t read_attributes(xmlTextReaderPtr reader)
 	return attrs;
 }
 
-void processNode(xmlTextReaderPtr reader)
+void processNode(xmlTextReaderPtr reader, const fn_params& fn)
 {
 	const char *name = reinterpret_cast<const char *> (xmlTextReaderName(reader));
 	if (name == NULL)
@@ -66,11 +66,12 @@ void processNode(xmlTextReaderPtr reader)
 		shape *s = shape::create_from_name(name);
 		if (!in_defs && s) {
 			attr_map_t attrs = read_attributes(reader);
-			s->set_attrs(attrs);
-			shape_list->push_back(s);
+			// The parent is needed for the transformation when flattening curves
 			if (!shapes.empty()) {
 				shapes.top()->add_child(s);
 			}
+			s->set_attrs(attrs, fn);
+			shape_list->push_back(s);
 			if (s->is_container()) {
 				shapes.push(s);
 			}
@@ -113,17 +114,19 @@ void processNode(xmlTextReaderPtr reader)
 	xmlFree((void *) (name));
 }
 
-int streamFile(const char *filename)
+int streamFile(const char *filename, const fn_params& fn)
 {
 	xmlTextReaderPtr reader;
 
 	in_defs = false;
+	shapes = std::stack<shape *>();
+	path = "/";
 	reader = xmlNewTextReaderFilename(filename);
 	xmlTextReaderSetParserProp(reader, XML_PARSER_SUBST_ENTITIES, 1);
 	if (reader != NULL) {
 		int ret = xmlTextReaderRead(reader);
 		while (ret == 1) {
-			processNode(reader);
+			processNode(reader, fn);
 			ret = xmlTextReaderRead(reader);
 		}
 		xmlFreeTextReader(reader);
@@ -148,10 +151,10 @@ void dump(int idx, shape *s) {
 }
 
 shapes_list_t *
-libsvg_read_file(const char *filename)
+libsvg_read_file(const char *filename, const fn_params& fn)
 {
 	shape_list = new shapes_list_t();
-	streamFile(filename);
+	streamFile(filename, fn);
 
 //#ifdef DEBUG
 //	if (!shape_list->empty()) {
@@ -165,6 +168,9 @@ libsvg_read_file(const char *filename)
 void
 libsvg_free(shapes_list_t *shapes)
 {
+	for (shapes_list_t::iterator it = shapes->begin();it != shapes->end();it++) {
+		delete *it;
+	}
 	delete shapes;
 }
 
@@ -10,8 +10,12 @@ namespace libsvg {
 
 typedef std::vector<shape *> shapes_list_t;
 
+/*!
+    Reads the shapes of an SVG file. This uses global state, so only one file
+    can be read at a time.
+*/
 shapes_list_t *
-libsvg_read_file(const char *filename);
+libsvg_read_file(const char *filename, const fn_params& fn);
 
 void
 libsvg_free(shapes_list_t *shapes);
@@ -19,9 +19,9 @@ line::~line()
 }
 
 void
-line::set_attrs(attr_map_t& attrs)
+line::set_attrs(attr_map_t& attrs, const fn_params& fn)
 {
-	shape::set_attrs(attrs);
+	shape::set_attrs(attrs, fn);
 	this->x = parse_double(attrs["x1"]);
 	this->y = parse_double(attrs["y1"]);
 	this->x2 = parse_double(attrs["x2"]);
@@ -18,7 +18,7 @@ public:
     virtual double get_x2() { return x2; }
     virtual double get_y2() { return y2; }
 
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     virtual void dump();
     const std::string& get_name() const { return line::name; };
     
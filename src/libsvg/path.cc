@@ -3,14 +3,15 @@
 #include <string>
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
-#include <boost/tokenizer.hpp>
-#include <boost/algorithm/string.hpp>
-
 #include "path.h"
+#include "calc.h"
+#include "numparse.h"
 
 namespace libsvg {
 
@@ -61,8 +62,47 @@ vector_angle(double ux, double uy, double vx, double vy)
 	return angle;
 }
 
+/*!
+	Returns the number of segments used to flatten a Bezier curve, chosen
+	like Calc::get_fragments_from_r() does for circles: the fewer of segments
+	turning by $fa degrees and segments $fs long, but at least five per full
+	turn, or $fn per full turn. The length and the turning of the curve are
+	estimated from its control polygon, which bounds both. The length is
+	multiplied by scale, the stretch of the transformation applied later.
+*/
+static unsigned long
+get_curve_fragments(const Eigen::Vector2d *points, int count, double scale, const fn_params& fn)
+{
+	double length = 0;
+	double turning = 0;
+	Eigen::Vector2d last(0, 0);
+	for (int i = 1;i < count;i++) {
+		Eigen::Vector2d d = points[i] - points[i - 1];
+		double l = d.norm();
+		if (l == 0) {
+			continue;
+		}
+		if (length > 0) {
+			turning += std::fabs(std::atan2(last.x() * d.y() - last.y() * d.x(), last.dot(d)));
+		}
+		length += l;
+		last = d;
+	}
+
+	double turns = turning / (2 * M_PI);
+	double fragments;
+	if (std::isinf(fn.fn) || std::isnan(fn.fn)) {
+		fragments = 1;
+	} else if (fn.fn > 0) {
+		fragments = std::max(fn.fn, 3.0) * turns;
+	} else {
+		fragments = std::max(std::min(360.0 * turns / fn.fa, length * scale / fn.fs), 5 * turns);
+	}
+	return std::max(1.0, std::ceil(fragments));
+}
+
 void
-path::arc_to(path_t& path, double x1, double y1, double rx, double ry, double x2, double y2, double angle, bool large, bool sweep)
+path::arc_to(path_t& path, double x1, double y1, double rx, double ry, double x2, double y2, double angle, bool large, bool sweep, const fn_params& fn)
 {
 	// http://www.w3.org/TR/SVG/implnote.html#ArcImplementationNotes
 	
@@ -110,7 +150,8 @@ path::arc_to(path_t& path, double x1, double y1, double rx, double ry, double x2
             delta -= 2 * M_PI;
 	}
 	
-	int steps = std::fabs(delta) * 10.0 / M_PI + 4;
+	int fragments = Calc::get_fragments_from_r(std::max(rx, ry) * get_transform_scale(), fn.fn, fn.fs, fn.fa);
+	int steps = std::max(1, (int)std::ceil(fragments * std::fabs(delta) / (2 * M_PI)));
 	for (int a = 0;a <= steps;a++) {
 	        double phi = theta + delta * a / steps;
 
@@ -122,41 +163,39 @@ path::arc_to(path_t& path, double x1, double y1, double rx, double ry, double x2
 }
 
 void
-path::curve_to(path_t& path, double x, double y, double cx1, double cy1, double x2, double y2)
+path::curve_to(path_t& path, double x, double y, double cx1, double cy1, double x2, double y2, const fn_params& fn)
 {
-	unsigned long fn = 20;
-	for (unsigned long idx = 1;idx <= fn;idx++) {
-		const double a = idx * (1.0 / (double)fn);
-		const double xx = x * t(a, 2) + cx1 * 2 * t(a, 1) * a + x2 * a * a;
-		const double yy = y * t(a, 2) + cy1 * 2 * t(a, 1) * a + y2 * a * a;
+	const Eigen::Vector2d points[] = { Eigen::Vector2d(x, y), Eigen::Vector2d(cx1, cy1), Eigen::Vector2d(x2, y2) };
+	unsigned long fragments = get_curve_fragments(points, 3, get_transform_scale(), fn);
+	for (unsigned long idx = 1;idx <= fragments;idx++) {
+		const double a = idx * (1.0 / (double)fragments);
+		const double b = 1.0 - a;
+		const double xx = x * b * b + cx1 * 2 * b * a + x2 * a * a;
+		const double yy = y * b * b + cy1 * 2 * b * a + y2 * a * a;
 		path.push_back(Eigen::Vector3d(xx, yy, 0));
 	}
 }
 
 void
-path::curve_to(path_t& path, double x, double y, double cx1, double cy1, double cx2, double cy2, double x2, double y2)
+path::curve_to(path_t& path, double x, double y, double cx1, double cy1, double cx2, double cy2, double x2, double y2, const fn_params& fn)
 {
-	unsigned long fn = 20;
-	for (unsigned long idx = 1;idx <= fn;idx++) {
-		const double a = idx * (1.0 / (double)fn);
-		const double xx = x * t(a, 3) + cx1 * 3 * t(a, 2) * a + cx2 * 3 * t(a, 1) * a * a + x2 * a * a * a;
-		const double yy = y * t(a, 3) + cy1 * 3 * t(a, 2) * a + cy2 * 3 * t(a, 1) * a * a + y2 * a * a * a;
+	const Eigen::Vector2d points[] = { Eigen::Vector2d(x, y), Eigen::Vector2d(cx1, cy1), Eigen::Vector2d(cx2, cy2), Eigen::Vector2d(x2, y2) };
+	unsigned long fragments = get_curve_fragments(points, 4, get_transform_scale(), fn);
+	for (unsigned long idx = 1;idx <= fragments;idx++) {
+		const double a = idx * (1.0 / (double)fragments);
+		const double b = 1.0 - a;
+		const double xx = x * b * b * b + cx1 * 3 * b * b * a + cx2 * 3 * b * a * a + x2 * a * a * a;
+		const double yy = y * b * b * b + cy1 * 3 * b * b * a + cy2 * 3 * b * a * a + y2 * a * a * a;
 		path.push_back(Eigen::Vector3d(xx, yy, 0));
 	}
 }
 
 void
-path::set_attrs(attr_map_t& attrs)
+path::set_attrs(attr_map_t& attrs, const fn_params& fn)
 {
-	std::string commands = "-zmlcqahvstZMLCQAHVST";
-	
-	shape::set_attrs(attrs);
+	shape::set_attrs(attrs, fn);
 	this->data = attrs["d"];
 
-	typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-	boost::char_separator<char> sep(" ,", commands.c_str());
-	tokenizer tokens(this->data, sep);
-
 	double x = 0;
 	double y = 0;
 	double xx = 0;
@@ -175,35 +214,29 @@ path::set_attrs(attr_map_t& attrs)
 	char cmd = ' ';
 	int point = 0;
 	
-	bool negate = false;
 	bool path_closed = false;
-	std::string exp;
 	path_list.push_back(path_t());
-	for (tokenizer::iterator it = tokens.begin();it != tokens.end();++it) {
-		std::string v = (*it);
+	const char *it = this->data.c_str();
+	const char *end = it + this->data.size();
+	while (true) {
+		while (it != end && (std::isspace(static_cast<unsigned char>(*it)) || *it == ',')) {
+			it++;
+		}
+		if (it == end) {
+			break;
+		}
 
 		double p = 0;
-		if ((v.length() == 1) && (commands.find(v) != std::string::npos)) {
-			if (v[0] == '-') {
-				negate = true;
-				continue;
-			}
+		if (*it != '\0' && std::strchr("zmlcqahvstZMLCQAHVST", *it)) {
 			point = -1;
-			cmd = v[0];
-		} else {
-			if (*v.rbegin() == 'e') {
-				exp = negate ? std::string("-") + v : v;
-				negate = false;
-				continue;
-			}
-			if (exp.empty()) {
-				p = parse_double(v);
-				p = negate ? -p : p;
-			} else {
-				p = parse_double(exp + (negate ? "-" : "") + v);
-				exp = "";
-			}
-			negate = false;
+			cmd = *it++;
+		} else if ((cmd == 'a' || cmd == 'A') && (point == 3 || point == 4) && (*it == '0' || *it == '1')) {
+			// Arc flags are single digits, which need no separator
+			p = *it++ - '0';
+		} else if (!NumParse::parseDouble(it, end, p)) {
+			// Skip anything else
+			it++;
+			continue;
 		}
 		
 		switch (cmd) {
@@ -231,7 +264,7 @@ path::set_attrs(attr_map_t& attrs)
 				break;
 			case 6:
 				yy = cmd == 'a' ? y + p : p;
-				arc_to(path_list.back(), x, y, rx, ry, xx, yy, angle, large, sweep);
+				arc_to(path_list.back(), x, y, rx, ry, xx, yy, angle, large, sweep, fn);
 				x = xx;
 				y = yy;
 				point = -1;
@@ -281,7 +314,7 @@ path::set_attrs(attr_map_t& attrs)
 				cy1 = cmd == 'c' ? y + cy1 : cy1;
 				cx2 = cmd == 'c' ? x + cx2 : cx2;
 				cy2 = cmd == 'c' ? y + cy2 : cy2;
-				curve_to(path_list.back(), x, y, cx1, cy1, cx2, cy2, xx, yy);
+				curve_to(path_list.back(), x, y, cx1, cy1, cx2, cy2, xx, yy, fn);
 				x = xx;
 				y = yy;
 				point = -1;
@@ -316,7 +349,7 @@ path::set_attrs(attr_map_t& attrs)
 				yy = cmd == 's' ? y + p : p;
 				cx2 = cmd == 's' ? x + cx2 : cx2;
 				cy2 = cmd == 's' ? y + cy2 : cy2;
-				curve_to(path_list.back(), x, y, cx1, cy1, cx2, cy2, xx, yy);
+				curve_to(path_list.back(), x, y, cx1, cy1, cx2, cy2, xx, yy, fn);
 				x = xx;
 				y = yy;
 				point = -1;
@@ -341,7 +374,7 @@ path::set_attrs(attr_map_t& attrs)
 				yy = cmd == 'q' ? y + p : p;
 				cx1 = cmd == 'q' ? x + cx1 : cx1;
 				cy1 = cmd == 'q' ? y + cy1 : cy1;
-				curve_to(path_list.back(), x, y, cx1, cy1, xx, yy);
+				curve_to(path_list.back(), x, y, cx1, cy1, xx, yy, fn);
 				x = xx;
 				y = yy;
 				point = -1;
@@ -368,7 +401,7 @@ path::set_attrs(attr_map_t& attrs)
 				break;
 			case 1:
 				yy = cmd == 't' ? y + p : p;
-				curve_to(path_list.back(), x, y, cx1, cy1, xx, yy);
+				curve_to(path_list.back(), x, y, cx1, cy1, xx, yy, fn);
 				x = xx;
 				y = yy;
 				point = -1;
@@ -14,7 +14,7 @@ public:
     polygon(const polygon& orig);
     virtual ~polygon();
 
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     const std::string& get_name() const { return polygon::name; };
 
     static const std::string name;
@@ -20,9 +20,9 @@ polyline::~polyline()
 }
 
 void
-polyline::set_attrs(attr_map_t& attrs)
+polyline::set_attrs(attr_map_t& attrs, const fn_params& fn)
 {
-	shape::set_attrs(attrs);
+	shape::set_attrs(attrs, fn);
 	this->points = attrs["points"];
 	
 	typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
@@ -14,7 +14,7 @@ public:
     polyline(const polyline& orig);
     virtual ~polyline();
 
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     const std::string& get_name() const { return polyline::name; };
     
     static const std::string name;
@@ -23,7 +23,7 @@ public:
     virtual double get_rx() { return rx; }
     virtual double get_ry() { return ry; }
     
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     virtual void dump();
     const std::string& get_name() const { return rect::name; };
     
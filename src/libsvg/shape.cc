@@ -2,9 +2,11 @@
 #include <string>
 #include <vector>
 
-#include <boost/tokenizer.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
 #include <boost/algorithm/string.hpp>
-#include <boost/spirit/include/qi.hpp>
 
 #include "shape.h"
 #include "circle.h"
@@ -18,10 +20,12 @@
 #include "group.h"
 
 #include "transformation.h"
+#include "calc.h"
+#include "numparse.h"
 
 namespace libsvg {
 
-shape::shape() : parent(NULL), x(0), y(0)
+shape::shape() : parent(NULL), x(0), y(0), transform_matrix(Eigen::Matrix3d::Identity())
 {
 }
 
@@ -60,13 +64,25 @@ shape::create_from_name(const char *name)
 }
 
 void
-shape::set_attrs(attr_map_t& attrs)
+shape::set_attrs(attr_map_t& attrs, const fn_params& fn)
 {
 	this->id = attrs["id"];
 	this->transform = attrs["transform"];
 	this->stroke_width = attrs["stroke-width"];
 	this->stroke_linecap = attrs["stroke-linecap"];
 	this->style = attrs["style"];
+
+	// The transformation of the outermost element is not applied. Parents
+	// are created before their children, so only our own transformation
+	// needs to be parsed.
+	if (this->parent != NULL) {
+		std::vector<Eigen::Matrix3d> matrices;
+		collect_transform_matrices(matrices, this);
+		this->transform_matrix = this->parent->transform_matrix;
+		for (std::vector<Eigen::Matrix3d>::iterator it = matrices.begin();it != matrices.end();it++) {
+			this->transform_matrix = this->transform_matrix * *it;
+		}
+	}
 }
 
 std::string
@@ -123,56 +139,44 @@ shape::get_stroke_linecap()
 void
 shape::collect_transform_matrices(std::vector<Eigen::Matrix3d>& matrices, shape *s)
 {
-	std::string transform_arg(s->transform);
-
-	boost::replace_all(transform_arg, "matrix", "m");
-	boost::replace_all(transform_arg, "translate", "t");
-	boost::replace_all(transform_arg, "scale", "s");
-	boost::replace_all(transform_arg, "rotate", "r");
-	boost::replace_all(transform_arg, "skewX", "x");
-	boost::replace_all(transform_arg, "skewY", "y");
-
-	std::string commands = "mtsrxy";
-	
-	typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-	boost::char_separator<char> sep(" ,()", commands.c_str());
-	tokenizer tokens(transform_arg, sep);
+	const char *p = s->transform.c_str();
+	const char *end = p + s->transform.size();
 
 	transformation *t = NULL;
 	std::vector<transformation *> transformations;
-	for (tokenizer::iterator it = tokens.begin();it != tokens.end();++it) {
-		std::string v = (*it);
-		if ((v.length() == 1) && (commands.find(v) != std::string::npos)) {
+	while (p < end) {
+		if (std::isalpha(static_cast<unsigned char>(*p))) {
+			const char *op = p;
+			while (p < end && std::isalpha(static_cast<unsigned char>(*p))) p++;
+			std::string v(op, p);
 			if (t != NULL) {
 				transformations.push_back(t);
 				t = NULL;
 			}
-			switch (v[0]) {
-			case 'm':
+			if (v == "matrix") {
 				t = new matrix();
-				break;
-			case 't':
+			} else if (v == "translate") {
 				t = new translate();
-				break;
-			case 's':
+			} else if (v == "scale") {
 				t = new scale();
-				break;
-			case 'r':
+			} else if (v == "rotate") {
 				t = new rotate();
-				break;
-			case 'x':
+			} else if (v == "skewX") {
 				t = new skew_x();
-				break;
-			case 'y':
+			} else if (v == "skewY") {
 				t = new skew_y();
-				break;
-			default:
+			} else {
 				std::cout << "unknown transform op " << v << std::endl;
-				t = NULL;
 			}
 		} else {
-			if (t) {
-				t->add_arg(v);
+			double arg;
+			if (NumParse::parseDouble(p, end, arg)) {
+				if (t) {
+					t->add_arg(arg);
+				}
+			} else {
+				// Separators and parentheses
+				p++;
 			}
 		}
 	}
@@ -188,29 +192,32 @@ shape::collect_transform_matrices(std::vector<Eigen::Matrix3d>& matrices, shape
 	}
 }
 
+/*!
+	Returns the largest factor by which the transformation stretches
+	lengths, i.e. the largest singular value of its linear part. Curves are
+	flattened before they are transformed, so their sizes are multiplied by
+	this to get the number of fragments of the output.
+*/
+double
+shape::get_transform_scale()
+{
+	const double a = this->transform_matrix(0, 0);
+	const double b = this->transform_matrix(0, 1);
+	const double c = this->transform_matrix(1, 0);
+	const double d = this->transform_matrix(1, 1);
+	const double sum = a * a + b * b + c * c + d * d;
+	const double det = a * d - b * c;
+	return std::sqrt((sum + std::sqrt(std::max(0.0, sum * sum - 4 * det * det))) / 2);
+}
+
 void
 shape::apply_transform()
 {
-	std::vector<Eigen::Matrix3d> matrices;
-	for (shape *s = this;s->get_parent() != NULL;s = s->get_parent()) {
-		collect_transform_matrices(matrices, s);
-	}
-
-	path_list_t result_list;
 	for (path_list_t::iterator it = path_list.begin();it != path_list.end();it++) {
-		path_t& p = *it;
-		
-		result_list.push_back(path_t());
-		for (path_t::iterator it2 = p.begin();it2 != p.end();it2++) {
-			Eigen::Vector3d result((*it2).x(), (*it2).y(), 1);
-			for (std::vector<Eigen::Matrix3d>::reverse_iterator it3 = matrices.rbegin();it3 != matrices.rend();it3++) {
-				result = *it3 * result;
-			}
-			
-			result_list.back().push_back(result);
+		for (path_t::iterator it2 = (*it).begin();it2 != (*it).end();it2++) {
+			*it2 = this->transform_matrix * Eigen::Vector3d((*it2).x(), (*it2).y(), 1);
 		}
 	}
-	path_list = result_list;
 }
 
 void
@@ -238,10 +245,10 @@ shape::offset_path(path_list_t& path_list, path_t& path, double stroke_width, Cl
 }
 
 void
-shape::draw_ellipse(path_t& path, double x, double y, double rx, double ry) {
-	unsigned long fn = 40;
-	for (unsigned long idx = 1;idx <= fn;idx++) {
-		const double a = idx * (2 * M_PI / (double)fn);
+shape::draw_ellipse(path_t& path, double x, double y, double rx, double ry, const fn_params& fn) {
+	unsigned long fragments = Calc::get_fragments_from_r(std::max(rx, ry) * get_transform_scale(), fn.fn, fn.fs, fn.fa);
+	for (unsigned long idx = 1;idx <= fragments;idx++) {
+		const double a = idx * (2 * M_PI / (double)fragments);
 		const double xx = rx * sin(a) + x;
 		const double yy = ry * cos(a) + y;
 		path.push_back(Eigen::Vector3d(xx, yy, 0));
@@ -19,6 +19,16 @@ typedef std::vector<Eigen::Vector3d> path_t;
 typedef std::vector<path_t> path_list_t;
 typedef std::map<std::string, std::string> attr_map_t;
 
+/*!
+    Settings used to flatten curves, like $fn, $fs and $fa for circles.
+*/
+struct fn_params {
+    double fn;
+    double fs;
+    double fa;
+    fn_params(double fn, double fs, double fa) : fn(fn), fs(fs), fa(fa) {}
+};
+
 class shape {
 private:
     shape *parent;
@@ -33,13 +43,15 @@ protected:
     std::string stroke_width;
     std::string stroke_linecap;
     std::string style;
+    Eigen::Matrix3d transform_matrix; // Including the transformations of all parents
     
     double get_stroke_width();
     ClipperLib::EndType get_stroke_linecap();
     std::string get_style(std::string name);
-    void draw_ellipse(path_t& path, double x, double y, double rx, double ry);
+    void draw_ellipse(path_t& path, double x, double y, double rx, double ry, const fn_params& fn);
     void offset_path(path_list_t& path_list, path_t& path, double stroke_width, ClipperLib::EndType stroke_linecap);
     void collect_transform_matrices(std::vector<Eigen::Matrix3d>& matrices, shape *s);
+    double get_transform_scale();
     
 public:
     shape();
@@ -62,7 +74,7 @@ public:
     virtual void apply_transform();
    
     virtual const std::string& get_name() const = 0;
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     virtual void dump() {}
 
     static shape * create_from_name(const char *name);
@@ -22,7 +22,7 @@ svgpage::~svgpage()
 }
 
 void
-svgpage::set_attrs(attr_map_t& attrs)
+svgpage::set_attrs(attr_map_t& attrs, const fn_params& fn)
 {
 	this->x = 0;
 	this->y = 0;
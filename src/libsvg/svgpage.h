@@ -19,7 +19,7 @@ public:
     virtual double get_height() { return height; }
     virtual bool is_container() { return true; }
     
-    virtual void set_attrs(attr_map_t& attrs);
+    virtual void set_attrs(attr_map_t& attrs, const fn_params& fn);
     virtual void dump();
     const std::string& get_name() const { return svgpage::name; };
     
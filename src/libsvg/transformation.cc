@@ -28,10 +28,9 @@ transformation::get_name()
 }
 
 void
-transformation::add_arg(const std::string arg)
+transformation::add_arg(double arg)
 {
-	double d = parse_double(arg);
-	args.push_back(d);
+	args.push_back(arg);
 }
 
 const std::string
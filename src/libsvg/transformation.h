@@ -24,7 +24,7 @@ public:
     virtual const std::string& get_name();
     virtual const std::string get_args();
     
-    virtual void add_arg(const std::string arg);
+    virtual void add_arg(double arg);
     virtual std::vector<Eigen::Matrix3d> get_matrices() = 0;
 };
 
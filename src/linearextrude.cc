@@ -61,9 +61,9 @@ AbstractNode *LinearExtrudeModule::instantiate(const Context *ctx, const ModuleI
 	c.setVariables(args, evalctx);
 	inst->scope.apply(*evalctx);
 
-	node->fn = c.lookup_variable("$fn")->toDouble();
-	node->fs = c.lookup_variable("$fs")->toDouble();
-	node->fa = c.lookup_variable("$fa")->toDouble();
+	node->fn = c.lookup_variable(Symbols::fn)->toDouble();
+	node->fs = c.lookup_variable(Symbols::fs)->toDouble();
+	node->fa = c.lookup_variable(Symbols::fa)->toDouble();
 
 	ValuePtr file = c.lookup_variable("file");
 	ValuePtr layer = c.lookup_variable("layer", true);
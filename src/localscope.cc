@@ -5,6 +5,7 @@
 #include "expression.h"
 #include "function.h"
 #include "annotation.h"
+#include "ParallelInstantiation.h"
 
 LocalScope::LocalScope()
 {
@@ -52,12 +53,26 @@ std::string LocalScope::dump(const std::string &indent) const
 std::vector<AbstractNode*> LocalScope::instantiateChildren(const Context *evalctx) const
 {
 	std::vector<AbstractNode*> childnodes;
+	instantiateChildren(evalctx, childnodes);
+	return childnodes;
+}
+
+/*!
+	Appends the instantiated children to childnodes.
+*/
+void LocalScope::instantiateChildren(const Context *evalctx, std::vector<AbstractNode*> &childnodes) const
+{
+	if (ParallelInstantiation::enabled(this->children.size())) {
+		ParallelInstantiation::instantiate(this->children.size(), evalctx, [this](size_t i, Context &ctx, std::vector<AbstractNode*> &nodes) {
+				AbstractNode *node = this->children[i]->evaluate(&ctx);
+				if (node) nodes.push_back(node);
+			}, childnodes);
+		return;
+	}
 	for(const auto &modinst : this->children) {
 		AbstractNode *node = modinst->evaluate(evalctx);
 		if (node) childnodes.push_back(node);
 	}
-
-	return childnodes;
 }
 
 /*!
@@ -70,6 +85,6 @@ std::vector<AbstractNode*> LocalScope::instantiateChildren(const Context *evalct
 void LocalScope::apply(Context &ctx) const
 {
 	for(const auto &ass : this->assignments) {
-		ctx.set_variable(ass.name, ass.expr->evaluate(&ctx));
+		ctx.set_variable(ass.symbol, ass.expr->evaluate(&ctx));
 	}
 }
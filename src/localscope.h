@@ -12,6 +12,7 @@ public:
 	size_t numElements() const { return assignments.size() + children.size(); }
 	std::string dump(const std::string &indent) const;
 	std::vector<class AbstractNode*> instantiateChildren(const class Context *evalctx) const;
+	void instantiateChildren(const class Context *evalctx, std::vector<class AbstractNode*> &childnodes) const;
 	void addChild(class ModuleInstantiation *ch);
 	void apply(Context &ctx) const;
 
@@ -43,6 +43,8 @@
 #include "expression.h"
 #include "progress.h"
 #include "dxfdim.h"
+#include "dxfdata.h"
+#include "import.h"
 #include "legacyeditor.h"
 #include "settings.h"
 #ifdef USE_SCINTILLA_EDITOR
@@ -688,10 +690,12 @@ void MainWindow::loadDesignSettings()
 	}
 	uint polySetCacheSize = Preferences::inst()->getValue("advanced/polysetCacheSize").toUInt();
 	GeometryCache::instance()->setMaxSize(polySetCacheSize);
+	RenderSettings::inst()->previewLodFaces = Preferences::inst()->getValue("advanced/previewLodFaces").toUInt();
 #ifdef ENABLE_CGAL
 	uint cgalCacheSize = Preferences::inst()->getValue("advanced/cgalCacheSize").toUInt();
 	CGALCache::instance()->setMaxSize(cgalCacheSize);
 #endif
+	Preferences::updateCacheBudget();
 }
 
 void MainWindow::updateMdiMode(bool mdi)
@@ -1177,6 +1181,10 @@ void MainWindow::compileCSG(bool procevents)
 #ifdef ENABLE_OPENCSG
 		if (procevents) QApplication::processEvents();
 		this->csgRoot = csgrenderer.buildCSGTree(*root_node);
+		const CSGTreeEvaluator::LodStats &lod = csgrenderer.getLodStats();
+		if (lod.objects > 0) {
+			PRINTB("Previewing %d objects at reduced detail (%d of %d faces)", lod.objects % lod.lodfaces % lod.faces);
+		}
 #endif
 		GeometryCache::instance()->print();
 #ifdef ENABLE_CGAL
@@ -2280,6 +2288,8 @@ void MainWindow::actionFlushCaches()
 #endif
 	dxf_dim_cache.clear();
 	dxf_cross_cache.clear();
+	DxfData::clearFileCache();
+	import_svg_clear_cache();
 	ModuleCache::instance()->clear();
 }
 
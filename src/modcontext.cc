@@ -72,7 +72,7 @@ void ModuleContext::initializeModule(const UserModule &module)
 	this->functions_p = &module.scope.functions;
 	this->modules_p = &module.scope.modules;
 	for(const auto &ass : module.scope.assignments) {
-		this->set_variable(ass.name, ass.expr->evaluate(this));
+		this->set_variable(ass.symbol, ass.expr->evaluate(this));
 	}
 
 // Experimental code. See issue #399
@@ -90,7 +90,7 @@ void ModuleContext::registerBuiltin()
 	this->functions_p = &scope.functions;
 	this->modules_p = &scope.modules;
 	for(const auto &ass : scope.assignments) {
-		this->set_variable(ass.name, ass.expr->evaluate(this));
+		this->set_variable(ass.symbol, ass.expr->evaluate(this));
 	}
 
 	this->set_constant("PI", ValuePtr(M_PI));
@@ -157,20 +157,20 @@ std::string ModuleContext::dump(const AbstractModule *mod, const ModuleInstantia
 		if (m) {
 			s << "  module args:";
 			for(const auto &arg : m->definition_arguments) {
-				s << boost::format("    %s = %s") % arg.name % variables[arg.name];
+				const ValuePtr *v = variables.find(arg.symbol);
+				s << boost::format("    %s = %s") % arg.name % (v ? *v : ValuePtr::undefined);
 			}
 		}
 	}
-	typedef std::pair<std::string, ValuePtr> ValueMapType;
 	s << "  vars:";
 	for(const auto &v : constants) {
-		s << boost::format("    %s = %s") % v.first % v.second;
+		s << boost::format("    %s = %s") % v.first.name() % v.second;
 	}
 	for(const auto &v : variables) {
-		s << boost::format("    %s = %s") % v.first % v.second;
+		s << boost::format("    %s = %s") % v.first.name() % v.second;
 	}
 	for(const auto &v : config_variables) {
-		s << boost::format("    %s = %s") % v.first % v.second;
+		s << boost::format("    %s = %s") % v.first.name() % v.second;
 	}
 	return s.str();
 }
@@ -242,6 +242,6 @@ void FileContext::initializeModule(const class FileModule &module)
 	this->functions_p = &module.scope.functions;
 	this->modules_p = &module.scope.modules;
 	for(const auto &ass : module.scope.assignments) {
-		this->set_variable(ass.name, ass.expr->evaluate(this));
+		this->set_variable(ass.symbol, ass.expr->evaluate(this));
 	}
 }
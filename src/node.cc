@@ -33,7 +33,7 @@
 #include <iostream>
 #include <algorithm>
 
-size_t AbstractNode::idx_counter;
+std::atomic<size_t> AbstractNode::idx_counter(0);
 
 AbstractNode::AbstractNode(const ModuleInstantiation *mi)
 {
@@ -46,6 +46,12 @@ AbstractNode::~AbstractNode()
 	std::for_each(this->children.begin(), this->children.end(), del_fun<AbstractNode>());
 }
 
+void AbstractNode::reindex()
+{
+	this->idx = idx_counter++;
+	for (auto child : this->children) child->reindex();
+}
+
 std::string AbstractNode::toString() const
 {
 	return this->name() + "()";
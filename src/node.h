@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 #include "BaseVisitable.h"
 
 extern int progress_report_count;
@@ -24,7 +25,7 @@ class AbstractNode : public BaseVisitable
 	// We can hash on pointer value or smth. else.
   //  -> remove and
 	// use smth. else to display node identifier in CSG tree output?
-	static size_t idx_counter;   // Node instantiation index
+	static std::atomic<size_t> idx_counter;   // Node instantiation index
 public:
 	VISITABLE();
 	AbstractNode(const class ModuleInstantiation *mi);
@@ -40,7 +41,10 @@ public:
 	}
 	size_t index() const { return this->idx; }
 
-	static void resetIndexCounter() { idx_counter = 1; }
+	static void resetIndexCounter(size_t start = 1) { idx_counter = start; }
+	static size_t getIndexCounter() { return idx_counter; }
+	// Renumbers this subtree in pre-order, continuing at the index counter
+	void reindex();
 
 	// FIXME: Make protected
 	std::vector<AbstractNode*> children;
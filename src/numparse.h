@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+
+/*!
+	Parsing of numbers from character ranges which don't need to be zero
+	terminated, e.g. memory mapped files.
+
+	The parse functions skip nothing: they parse the number starting at p and
+	advance p past it. If there is no number at p, they return false and leave
+	p unchanged.
+*/
+namespace NumParse {
+	inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+	inline bool parseInt(const char *&p, const char *end, long &result)
+	{
+		const char *q = p;
+		bool neg = false;
+		if (q < end && (*q == '-' || *q == '+')) neg = *q++ == '-';
+		if (q == end || !isDigit(*q)) return false;
+		long value = 0;
+		while (q < end && isDigit(*q)) value = value * 10 + (*q++ - '0');
+		result = neg ? -value : value;
+		p = q;
+		return true;
+	}
+
+	/*!
+		Parses a decimal floating point number, e.g. -1.5e-3.
+
+		Numbers with at most 15 significant digits and a small exponent are
+		converted exactly with a single multiplication or division. Others fall
+		back to strtod(), which depends on LC_NUMERIC being "C".
+	*/
+	inline bool parseDouble(const char *&p, const char *end, double &result)
+	{
+		static const double pow10[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char *q = p;
+		bool neg = false;
+		if (q < end && (*q == '-' || *q == '+')) neg = *q++ == '-';
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool anydigits = false;
+		bool truncated = false;
+		for (; q < end && isDigit(*q); q++) {
+			anydigits = true;
+			if (mantissa == 0 && *q == '0') continue;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*q - '0');
+				digits++;
+			}
+			else {
+				exponent++;
+				truncated = true;
+			}
+		}
+		if (q < end && *q == '.') {
+			for (q++; q < end && isDigit(*q); q++) {
+				anydigits = true;
+				if (mantissa == 0 && *q == '0') exponent--;
+				else if (digits < 19) {
+					mantissa = mantissa * 10 + (*q - '0');
+					digits++;
+					exponent--;
+				}
+				else truncated = true;
+			}
+		}
+		if (!anydigits) return false;
+		if (q < end && (*q == 'e' || *q == 'E')) {
+			const char *e = q + 1;
+			long exp;
+			if (parseInt(e, end, exp)) {
+				exponent += exp > 1000 ? 1000 : (exp < -1000 ? -1000 : int(exp));
+				q = e;
+			}
+		}
+
+		double value;
+		if (mantissa == 0) {
+			value = 0;
+		}
+		else if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+			value = double(mantissa);
+			value = exponent < 0 ? value / pow10[-exponent] : value * pow10[exponent];
+		}
+		else {
+			std::string str(p + (*p == '-' || *p == '+'), q);
+			value = std::strtod(str.c_str(), NULL);
+		}
+		result = neg ? -value : value;
+		p = q;
+		return true;
+	}
+}
@@ -60,9 +60,9 @@ AbstractNode *OffsetModule::instantiate(const Context *ctx, const ModuleInstanti
 	c.setVariables(args, evalctx);
 	inst->scope.apply(*evalctx);
 
-	node->fn = c.lookup_variable("$fn")->toDouble();
-	node->fs = c.lookup_variable("$fs")->toDouble();
-	node->fa = c.lookup_variable("$fa")->toDouble();
+	node->fn = c.lookup_variable(Symbols::fn)->toDouble();
+	node->fs = c.lookup_variable(Symbols::fs)->toDouble();
+	node->fa = c.lookup_variable(Symbols::fa)->toDouble();
 
 	// default with no argument at all is (r = 1, chamfer = false)
 	// radius takes precedence if both r and delta are given.
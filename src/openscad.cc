@@ -42,10 +42,14 @@
 #include "LibraryInfo.h"
 #include "nodedumper.h"
 #include "stackcheck.h"
+#include "parallel.h"
 #include "CocoaUtils.h"
 #include "FontCache.h"
 #include "OffscreenView.h"
 #include "GeometryEvaluator.h"
+#include "Profiler.h"
+#include "GeometryCache.h"
+#include "ASTCache.h"
 
 #include"parameter/parameterset.h"
 #include <string>
@@ -55,6 +59,7 @@
 #ifdef ENABLE_CGAL
 #include "CGAL_Nef_polyhedron.h"
 #include "cgalutils.h"
+#include "CGALCache.h"
 #endif
 
 #include "csgnode.h"
@@ -91,6 +96,9 @@ std::string commandline_commands;
 std::string currentdir;
 static bool arg_info = false;
 static std::string arg_colorscheme;
+static std::string arg_profile;
+static unsigned int arg_animate = 0;
+static bool arg_compress_amf = false;
 
 #define QUOTE(x__) # x__
 #define QUOTED(x__) QUOTE(x__)
@@ -128,6 +136,34 @@ public:
 	}
 };
 
+/*!
+	Enables the profiler for its lifetime and writes the collected data on
+	destruction. The output format is chosen by suffix: .json writes JSON,
+	anything else writes collapsed stacks for flame graph tools.
+*/
+class ProfileWriter
+{
+public:
+	ProfileWriter(const std::string &filename) : filename(filename) {
+		Profiler::instance()->clear();
+		Profiler::instance()->setEnabled(true);
+	}
+	~ProfileWriter() {
+		Profiler::instance()->setEnabled(false);
+		std::ofstream fstream(this->filename.c_str());
+		if (!fstream.is_open()) {
+			PRINTB("Can't open file \"%s\" for profile output", this->filename);
+			return;
+		}
+		std::string suffix = fs::path(this->filename).extension().generic_string();
+		boost::algorithm::to_lower(suffix);
+		if (suffix == ".json") Profiler::instance()->exportJSON(fstream);
+		else Profiler::instance()->exportCollapsed(fstream);
+	}
+private:
+	std::string filename;
+};
+
 static void help(const char *progname, bool failure = false)
 {
   int tablen = strlen(progname)+8;
@@ -140,13 +176,15 @@ static void help(const char *progname, bool failure = false)
 	 "%2%[ --help ] print this help message and exit \\\n"
          "%2%[ --version ] [ --info ] \\\n"
          "%2%[ --camera=translatex,y,z,rotx,y,z,dist | \\\n"
-         "%2%  --camera=eyex,y,z,centerx,y,z ] \\\n"
+         "%2%  --camera=eyex,y,z,centerx,y,z ][;...] \\\n"
+         "%2%[ --turntable=views[,x|y|z] ] [ --animate=frames ] \\\n"
          "%2%[ --autocenter ] \\\n"
          "%2%[ --viewall ] \\\n"
          "%2%[ --imgsize=width,height ] [ --projection=(o)rtho|(p)ersp] \\\n"
-         "%2%[ --render | --preview[=throwntogether] ] \\\n"
+         "%2%[ --render | --preview[=throwntogether] ] [ --software-rendering ] [ --show-edges ] \\\n"
          "%2%[ --colorscheme=[Cornfield|Sunset|Metallic|Starnight|BeforeDawn|Nature|DeepOcean] ] \\\n"
-         "%2%[ --csglimit=num ]"
+         "%2%[ --csglimit=num ] [ --preview-lod=faces ] [ --profile=file.json|file.folded ] \\\n"
+         "%2%[ --cache-size=megabytes ] [ --ast-cache=directory ] [ --compress-amf ]"
 #ifdef ENABLE_EXPERIMENTAL
          " [ --enable=<feature> ] \\\n"
          "%2%[ -p <Parameter Filename>] [-P <Parameter Set>] "
@@ -202,28 +240,33 @@ void localization_init() {
 	}
 }
 
-Camera get_camera(po::variables_map vm)
+static Camera parse_camera(const std::string &spec)
 {
 	Camera camera;
-
-	if (vm.count("camera")) {
-		vector<string> strs;
-		vector<double> cam_parameters;
-		split(strs, vm["camera"].as<string>(), is_any_of(","));
-		if ( strs.size()==6 || strs.size()==7 ) {
-			try {
-				for(const auto &s : strs) cam_parameters.push_back(lexical_cast<double>(s));
-				camera.setup(cam_parameters);
-			}
-			catch (bad_lexical_cast &) {
-				PRINT("Camera setup requires numbers as parameters");
-			}
-		} else {
-			PRINT("Camera setup requires either 7 numbers for Gimbal Camera");
-			PRINT("or 6 numbers for Vector Camera");
-			exit(1);
+	vector<string> strs;
+	vector<double> cam_parameters;
+	split(strs, spec, is_any_of(","));
+	if ( strs.size()==6 || strs.size()==7 ) {
+		try {
+			for(const auto &s : strs) cam_parameters.push_back(lexical_cast<double>(s));
+			camera.setup(cam_parameters);
 		}
+		catch (bad_lexical_cast &) {
+			PRINT("Camera setup requires numbers as parameters");
+		}
+	} else {
+		PRINT("Camera setup requires either 7 numbers for Gimbal Camera");
+		PRINT("or 6 numbers for Vector Camera");
+		exit(1);
 	}
+	return camera;
+}
+
+static Camera get_camera(po::variables_map vm, const std::string &spec)
+{
+	Camera camera;
+
+	if (!spec.empty()) camera = parse_camera(spec);
 
 	if (camera.type == Camera::GIMBAL) {
 		camera.gimbalDefaultTranslate();
@@ -273,6 +316,62 @@ Camera get_camera(po::variables_map vm)
 	return camera;
 }
 
+/*!
+	Returns the cameras for png export: one per ';' separated --camera
+	parameter set, each turned around the --turntable axis if given.
+*/
+std::vector<Camera> get_cameras(po::variables_map vm)
+{
+	vector<string> specs(1);
+	if (vm.count("camera")) split(specs, vm["camera"].as<string>(), is_any_of(";"));
+
+	unsigned int views = 1;
+	Vector3d axis = Vector3d::UnitZ();
+	if (vm.count("turntable")) {
+		vector<string> strs;
+		split(strs, vm["turntable"].as<string>(), is_any_of(","));
+		try {
+			views = lexical_cast<unsigned int>(strs[0]);
+		}
+		catch (bad_lexical_cast &) {
+			views = 0;
+		}
+		if (strs.size() > 1) {
+			if (strs[1] == "x") axis = Vector3d::UnitX();
+			else if (strs[1] == "y") axis = Vector3d::UnitY();
+			else if (strs[1] != "z") views = 0;
+		}
+		if (views == 0 || strs.size() > 2) {
+			PRINT("turntable needs the number of views and optionally the axis: x, y or z");
+			exit(1);
+		}
+	}
+
+	std::vector<Camera> cameras;
+	for (const auto &spec : specs) {
+		Camera camera = get_camera(vm, spec);
+		for (unsigned int i = 0; i < views; i++) {
+			cameras.push_back(camera);
+			if (views > 1) cameras.back().turntable(axis, 360.0 * i / views);
+		}
+	}
+	return cameras;
+}
+
+/*!
+	Returns filename with the frame or view number inserted before the extension if
+	there is more than one, e.g. out-07.png.
+*/
+static std::string numbered_filename(const std::string &filename, size_t i, size_t count)
+{
+	if (count <= 1) return filename;
+	fs::path path(filename);
+	std::string number = std::to_string(i);
+	size_t digits = std::to_string(count - 1).size();
+	number.insert(0, digits - number.size(), '0');
+	return (path.parent_path() / (path.stem().string() + "-" + number + path.extension().string())).string();
+}
+
 #ifndef OPENSCAD_NOGUI
 #include <QSettings>
 #define OPENSCAD_QTGUI 1
@@ -288,6 +387,7 @@ static bool checkAndExport(shared_ptr<const Geometry> root_geom, unsigned nd,
 		PRINT("Current top level object is empty.");
 		return false;
 	}
+	Profiler::PhaseScope phase("export");
 	exportFileByName(root_geom, format, filename, filename);
 	return true;
 }
@@ -316,7 +416,7 @@ void set_render_color_scheme(const std::string color_scheme, const bool exit_if_
 
 #include <QCoreApplication>
 
-int cmdline(const char *deps_output_file, const std::string &filename, Camera &camera, const char *output_file, const fs::path &original_path, Render::type renderer,const std::string &parameterFile,const std::string &setName, int argc, char ** argv )
+int cmdline(const char *deps_output_file, const std::string &filename, std::vector<Camera> &cameras, const char *output_file, const fs::path &original_path, Render::type renderer,const std::string &parameterFile,const std::string &setName, int argc, char ** argv )
 {
 #ifdef OPENSCAD_QTGUI
 	QCoreApplication app(argc, argv);
@@ -381,6 +481,10 @@ int cmdline(const char *deps_output_file, const std::string &filename, Camera &c
 	if (echo_output_file)
 		echostream.reset( new Echostream( echo_output_file ) );
 
+	shared_ptr<ProfileWriter> profilewriter;
+	if (!arg_profile.empty())
+		profilewriter.reset(new ProfileWriter(arg_profile));
+
 	FileModule *root_module;
 	ModuleInstantiation root_inst("group");
 	AbstractNode *root_node;
@@ -397,7 +501,10 @@ int cmdline(const char *deps_output_file, const std::string &filename, Camera &c
 	std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
 	text += "\n" + commandline_commands;
 	fs::path abspath = fs::absolute(filename);
-	root_module = parse(text.c_str(), abspath, false);
+	{
+		Profiler::PhaseScope phase("parse");
+		root_module = parse(text.c_str(), abspath, false);
+	}
 	if (!root_module) {
 		PRINTB("Can't parse file '%s'!\n", filename.c_str());
 		return 1;
@@ -413,166 +520,221 @@ int cmdline(const char *deps_output_file, const std::string &filename, Camera &c
 		}
 	}
     
-	root_module->handleDependencies();
+	{
+		Profiler::PhaseScope phase("parse");
+		root_module->handleDependencies();
+	}
 
 	fs::path fpath = fs::absolute(fs::path(filename));
 	fs::path fparent = fpath.parent_path();
 	fs::current_path(fparent);
 	top_ctx.setDocumentPath(fparent.string());
 
-	AbstractNode::resetIndexCounter();
-	absolute_root_node = root_module->instantiate(&top_ctx, &root_inst, NULL);
+	// With --animate, export a numbered file per frame with $t stepping from 0
+	// towards 1 like the GUI animation
+	const unsigned int frames = std::max(1u, arg_animate);
+	// Files exported by all frames, written to the deps file after the last one
+	std::vector<std::string> deps_targets;
+	for (unsigned int frame = 0; frame < frames; frame++) {
+		const std::string frame_output_file = numbered_filename(output_file, frame, frames);
+		// Instantiate again for each frame. Subtrees which don't depend on $t
+		// give the same nodes, so their geometry comes from the caches.
+		if (arg_animate) {
+			fs::current_path(fparent);
+			top_ctx.set_variable("$t", ValuePtr(double(frame) / frames));
+		}
+		for (auto file : {&stl_output_file, &off_output_file, &amf_output_file, &dxf_output_file,
+					&svg_output_file, &csg_output_file, &png_output_file, &ast_output_file, &term_output_file,
+					&nefdbg_output_file, &nef3_output_file}) {
+			if (*file) *file = frame_output_file.c_str();
+		}
 
-	// Do we have an explicit root node (! modifier)?
-	if (!(root_node = find_root_tag(absolute_root_node)))
-		root_node = absolute_root_node;
+		AbstractNode::resetIndexCounter();
+		{
+			Profiler::PhaseScope phase("instantiation");
+			absolute_root_node = root_module->instantiate(&top_ctx, &root_inst, NULL);
+		}
 
-	tree.setRoot(root_node);
+		// Do we have an explicit root node (! modifier)?
+		if (!(root_node = find_root_tag(absolute_root_node)))
+			root_node = absolute_root_node;
 
-	if (csg_output_file) {
-		fs::current_path(original_path);
-		std::ofstream fstream(csg_output_file);
-		if (!fstream.is_open()) {
-			PRINTB("Can't open file \"%s\" for export", csg_output_file);
-		}
-		else {
-			fs::current_path(fparent); // Force exported filenames to be relative to document path
-			fstream << tree.getString(*root_node) << "\n";
-			fstream.close();
-		}
-	}
-	else if (ast_output_file) {
-		fs::current_path(original_path);
-		std::ofstream fstream(ast_output_file);
-		if (!fstream.is_open()) {
-			PRINTB("Can't open file \"%s\" for export", ast_output_file);
+		tree.setRoot(root_node);
+
+		if (csg_output_file) {
+			fs::current_path(original_path);
+			std::ofstream fstream(csg_output_file);
+			if (!fstream.is_open()) {
+				PRINTB("Can't open file \"%s\" for export", csg_output_file);
+			}
+			else {
+				fs::current_path(fparent); // Force exported filenames to be relative to document path
+				fstream << tree.getString(*root_node) << "\n";
+				fstream.close();
+			}
 		}
-		else {
-			fs::current_path(fparent); // Force exported filenames to be relative to document path
-			fstream << root_module->dump("", "") << "\n";
-			fstream.close();
+		else if (ast_output_file) {
+			fs::current_path(original_path);
+			std::ofstream fstream(ast_output_file);
+			if (!fstream.is_open()) {
+				PRINTB("Can't open file \"%s\" for export", ast_output_file);
+			}
+			else {
+				fs::current_path(fparent); // Force exported filenames to be relative to document path
+				fstream << root_module->dump("", "") << "\n";
+				fstream.close();
+			}
 		}
-	}
-	else if (term_output_file) {
-		CSGTreeEvaluator csgRenderer(tree);
-		shared_ptr<CSGNode> root_raw_term = csgRenderer.buildCSGTree(*root_node);
+		else if (term_output_file) {
+			CSGTreeEvaluator csgRenderer(tree);
+			shared_ptr<CSGNode> root_raw_term;
+			{
+				Profiler::PhaseScope phase("csg");
+				root_raw_term = csgRenderer.buildCSGTree(*root_node);
+			}
 
-		fs::current_path(original_path);
-		std::ofstream fstream(term_output_file);
-		if (!fstream.is_open()) {
-			PRINTB("Can't open file \"%s\" for export", term_output_file);
-		}
-		else {
-			if (!root_raw_term)
-				fstream << "No top-level CSG object\n";
+			fs::current_path(original_path);
+			std::ofstream fstream(term_output_file);
+			if (!fstream.is_open()) {
+				PRINTB("Can't open file \"%s\" for export", term_output_file);
+			}
 			else {
-				fstream << root_raw_term->dump() << "\n";
+				if (!root_raw_term)
+					fstream << "No top-level CSG object\n";
+				else {
+					fstream << root_raw_term->dump() << "\n";
+				}
+				fstream.close();
 			}
-			fstream.close();
 		}
-	}
-	else {
+		else {
 #ifdef ENABLE_CGAL
-		if ((echo_output_file || png_output_file) &&
-				(renderer==Render::OPENCSG || renderer==Render::THROWNTOGETHER)) {
-			// echo or OpenCSG png -> don't necessarily need geometry evaluation
-		} else {
-			// Force creation of CGAL objects (for testing)
-			root_geom = geomevaluator.evaluateGeometry(*tree.root(), true);
-			if (!root_geom) root_geom.reset(new CGAL_Nef_polyhedron());
-			if (renderer == Render::CGAL && root_geom->getDimension() == 3) {
-				const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron*>(root_geom.get());
-				if (!N) {
-					N = CGALUtils::createNefPolyhedronFromGeometry(*root_geom);
-					root_geom.reset(N);
-					PRINT("Converted to Nef polyhedron");
+			if ((echo_output_file || png_output_file) &&
+					(renderer==Render::OPENCSG || renderer==Render::THROWNTOGETHER)) {
+				// echo or OpenCSG png -> don't necessarily need geometry evaluation
+			} else {
+				// Force creation of CGAL objects (for testing)
+				{
+					Profiler::PhaseScope phase("geometry");
+					root_geom = geomevaluator.evaluateGeometry(*tree.root(), true);
+				}
+				if (!root_geom) root_geom.reset(new CGAL_Nef_polyhedron());
+				if (renderer == Render::CGAL && root_geom->getDimension() == 3) {
+					Profiler::PhaseScope phase("cgal");
+					const CGAL_Nef_polyhedron *N = dynamic_cast<const CGAL_Nef_polyhedron*>(root_geom.get());
+					if (!N) {
+						N = CGALUtils::createNefPolyhedronFromGeometry(*root_geom);
+						root_geom.reset(N);
+						PRINT("Converted to Nef polyhedron");
+					}
 				}
 			}
-		}
 
-		fs::current_path(original_path);
+			fs::current_path(original_path);
+
+			if (deps_output_file) {
+				std::string geom_out;
+				if ( stl_output_file ) geom_out = std::string(stl_output_file);
+				else if ( off_output_file ) geom_out = std::string(off_output_file);
+				else if ( amf_output_file ) geom_out = std::string(amf_output_file);
+				else if ( dxf_output_file ) geom_out = std::string(dxf_output_file);
+				else if ( svg_output_file ) geom_out = std::string(svg_output_file);
+				else if ( png_output_file ) geom_out = std::string(png_output_file);
+				else {
+					PRINTB("Output file:%s\n",output_file);
+					PRINT("Sorry, don't know how to write deps for that file type. Exiting\n");
+					return 1;
+				}
+				if (png_output_file) {
+					for (size_t i = 0; i < cameras.size(); i++) {
+						deps_targets.push_back(numbered_filename(geom_out, i, cameras.size()));
+					}
+				}
+				else deps_targets.push_back(geom_out);
+			}
 
-		if (deps_output_file) {
-			std::string deps_out( deps_output_file );
-			std::string geom_out;
-			if ( stl_output_file ) geom_out = std::string(stl_output_file);
-			else if ( off_output_file ) geom_out = std::string(off_output_file);
-			else if ( amf_output_file ) geom_out = std::string(amf_output_file);
-			else if ( dxf_output_file ) geom_out = std::string(dxf_output_file);
-			else if ( svg_output_file ) geom_out = std::string(svg_output_file);
-			else if ( png_output_file ) geom_out = std::string(png_output_file);
-			else {
-				PRINTB("Output file:%s\n",output_file);
-				PRINT("Sorry, don't know how to write deps for that file type. Exiting\n");
-				return 1;
+			if (stl_output_file) {
+				if (!checkAndExport(root_geom, 3, OPENSCAD_STL, stl_output_file))
+					return 1;
 			}
-			int result = write_deps( deps_out, geom_out );
-			if ( !result ) {
-				PRINT("error writing deps");
-				return 1;
+
+			if (off_output_file) {
+				if (!checkAndExport(root_geom, 3, OPENSCAD_OFF, off_output_file))
+					return 1;
 			}
-		}
 
-		if (stl_output_file) {
-			if (!checkAndExport(root_geom, 3, OPENSCAD_STL, stl_output_file))
-				return 1;
-		}
+			if (amf_output_file) {
+				if (!checkAndExport(root_geom, 3, arg_compress_amf ? OPENSCAD_AMF_ZIP : OPENSCAD_AMF, amf_output_file))
+					return 1;
+			}
 
-		if (off_output_file) {
-			if (!checkAndExport(root_geom, 3, OPENSCAD_OFF, off_output_file))
-				return 1;
-		}
+			if (dxf_output_file) {
+				if (!checkAndExport(root_geom, 2, OPENSCAD_DXF, dxf_output_file))
+					return 1;
+			}
+		
+			if (svg_output_file) {
+				if (!checkAndExport(root_geom, 2, OPENSCAD_SVG, svg_output_file))
+					return 1;
+			}
 
-		if (amf_output_file) {
-			if (!checkAndExport(root_geom, 3, OPENSCAD_AMF, amf_output_file))
-				return 1;
-		}
+			if (png_output_file) {
+				// All views share the evaluated model and the render setup
+				std::vector<std::unique_ptr<std::ofstream>> fstreams;
+				std::vector<std::ostream *> outputs;
+				for (size_t i = 0; i < cameras.size(); i++) {
+					std::string filename = numbered_filename(png_output_file, i, cameras.size());
+					fstreams.emplace_back(new std::ofstream(filename.c_str(), std::ios::out|std::ios::binary));
+					if (!fstreams.back()->is_open()) {
+						PRINTB("Can't open file \"%s\" for export", filename);
+						return 1;
+					}
+					outputs.push_back(fstreams.back().get());
+				}
 
-		if (dxf_output_file) {
-			if (!checkAndExport(root_geom, 2, OPENSCAD_DXF, dxf_output_file))
-				return 1;
-		}
-		
-		if (svg_output_file) {
-			if (!checkAndExport(root_geom, 2, OPENSCAD_SVG, svg_output_file))
-				return 1;
-		}
+				// The export fits unset and viewall cameras to the model, so each
+				// frame starts from the cameras given on the command line
+				std::vector<Camera> frame_cameras = cameras;
+				bool success = true;
+				{
+					Profiler::PhaseScope phase("export");
+					if (renderer==Render::CGAL || renderer==Render::GEOMETRY) {
+						success = export_png(root_geom, frame_cameras, outputs);
+					} else if (renderer==Render::THROWNTOGETHER) {
+						success = export_png_with_throwntogether(tree, frame_cameras, outputs);
+					} else {
+						success = export_png_with_opencsg(tree, frame_cameras, outputs);
+					}
+				}
+				for (auto &fstream : fstreams) fstream->close();
+				if (!success) return 1;
+			}
 
-		if (png_output_file) {
-			bool success = true;
-			std::ofstream fstream(png_output_file,std::ios::out|std::ios::binary);
-			if (!fstream.is_open()) {
-				PRINTB("Can't open file \"%s\" for export", png_output_file);
-				success = false;
+			if (nefdbg_output_file) {
+				if (!checkAndExport(root_geom, 3, OPENSCAD_NEFDBG, nefdbg_output_file))
+					return 1;
 			}
-			else {
-				if (renderer==Render::CGAL || renderer==Render::GEOMETRY) {
-					success = export_png(root_geom, camera, fstream);
-				} else if (renderer==Render::THROWNTOGETHER) {
-					success = export_png_with_throwntogether(tree, camera, fstream);
-				} else {
-					success = export_png_with_opencsg(tree, camera, fstream);
-				}
-				fstream.close();
+
+			if (nef3_output_file) {
+				if (!checkAndExport(root_geom, 3, OPENSCAD_NEF3, nef3_output_file))
+					return 1;
 			}
-			return success ? 0 : 1;
+#else
+			PRINT("OpenSCAD has been compiled without CGAL support!\n");
+			return 1;
+#endif
 		}
 
-		if (nefdbg_output_file) {
-			if (!checkAndExport(root_geom, 3, OPENSCAD_NEFDBG, nefdbg_output_file))
-				return 1;
-		}
+		delete absolute_root_node;
+	}
 
-		if (nef3_output_file) {
-			if (!checkAndExport(root_geom, 3, OPENSCAD_NEF3, nef3_output_file))
-				return 1;
+	if (!deps_targets.empty()) {
+		fs::current_path(original_path);
+		if (!write_deps(deps_output_file, deps_targets)) {
+			PRINT("error writing deps");
+			return 1;
 		}
-#else
-		PRINT("OpenSCAD has been compiled without CGAL support!\n");
-		return 1;
-#endif
 	}
-	delete root_node;
 	return 0;
 }
 
@@ -812,12 +974,21 @@ int main(int argc, char **argv)
 		("render", po::value<string>()->implicit_value(""), "if exporting a png image, do a full geometry evaluation")
 		("preview", po::value<string>()->implicit_value(""), "if exporting a png image, do an OpenCSG(default) or ThrownTogether preview")
 		("csglimit", po::value<unsigned int>(), "if exporting a png image, stop rendering at the given number of CSG elements")
-		("camera", po::value<string>(), "parameters for camera when exporting png")
+		("preview-lod", po::value<unsigned int>(), "simplify meshes with more than the given number of faces for previews")
+		("software-rendering", "if exporting a png image, render on the CPU without OpenGL")
+		("show-edges", "if exporting a png image, draw the polygon edges")
+		("compress-amf", "if exporting an amf file, write it zip compressed")
+		("camera", po::value<string>(), "parameters for camera when exporting png, separate several cameras with ';'")
+		("turntable", po::value<string>(), "=views[,x|y|z] export views turned around the z (or given) axis")
+		("animate", po::value<unsigned int>(), "export the given number of frames with $t stepping from 0 towards 1")
 		("autocenter", "adjust camera to look at object center")
 		("viewall", "adjust camera to fit object")
 		("imgsize", po::value<string>(), "=width,height for exporting png")
 		("projection", po::value<string>(), "(o)rtho or (p)erspective when exporting png")
 		("colorscheme", po::value<string>(), "colorscheme")
+		("profile", po::value<string>(), "write per-node timing to file (.json or collapsed stacks for flame graphs)")
+		("cache-size", po::value<unsigned int>(), "total memory budget for geometry caches in megabytes")
+		("ast-cache", po::value<string>(), "store parsed libraries in this directory and reuse them in later runs")
 		("debug", po::value<string>(), "special debug info")
 		("quiet,q", "quiet mode (don't print anything *except* errors)")
 		("o,o", po::value<string>(), "out-file")
@@ -835,7 +1006,8 @@ int main(int argc, char **argv)
 
 	po::options_description hidden("Hidden options");
 	hidden.add_options()
-		("input-file", po::value< vector<string>>(), "input file");
+		("input-file", po::value< vector<string>>(), "input file")
+		("threads", po::value<unsigned int>(), "number of threads for parallel work, 0 for the number of cores");
 
 	po::positional_options_description p;
 	p.add("input-file", -1);
@@ -878,6 +1050,32 @@ int main(int argc, char **argv)
 		RenderSettings::inst()->openCSGTermLimit = vm["csglimit"].as<unsigned int>();
 	}
 
+	if (vm.count("preview-lod")) {
+		RenderSettings::inst()->previewLodFaces = vm["preview-lod"].as<unsigned int>();
+	}
+
+	if (vm.count("software-rendering")) {
+		RenderSettings::inst()->softwareRendering = true;
+	}
+
+	if (vm.count("show-edges")) {
+		RenderSettings::inst()->showEdges = true;
+	}
+
+	if (vm.count("cache-size")) {
+		// The budget is shared by all caches, so each cache may use all of it
+		size_t cachesize = size_t(vm["cache-size"].as<unsigned int>()) * 1024 * 1024;
+		CacheBudget::global()->setMaxCost(cachesize);
+		GeometryCache::instance()->setMaxSize(cachesize);
+#ifdef ENABLE_CGAL
+		CGALCache::instance()->setMaxSize(cachesize);
+#endif
+	}
+
+	if (vm.count("ast-cache")) {
+		ASTCache::instance()->setPath(vm["ast-cache"].as<string>());
+	}
+
 	if (vm.count("o")) {
 		// FIXME: Allow for multiple output files?
 		if (output_file) help(argv[0], true);
@@ -908,6 +1106,9 @@ int main(int argc, char **argv)
 			commandline_commands += ";\n";
 		}
 	}
+	if (vm.count("threads")) {
+		set_parallel_thread_count(vm["threads"].as<unsigned int>());
+	}
 #ifdef ENABLE_EXPERIMENTAL
 	if (vm.count("enable")) {
 		for(const auto &feature : vm["enable"].as<vector<string>>()) {
@@ -949,9 +1150,26 @@ int main(int argc, char **argv)
 		arg_colorscheme = vm["colorscheme"].as<string>();
 	}
 
+	if (vm.count("profile")) {
+		// Make absolute since cmdline() changes the current directory
+		arg_profile = fs::absolute(vm["profile"].as<string>()).string();
+	}
+
+	if (vm.count("compress-amf")) {
+		arg_compress_amf = true;
+	}
+
+	if (vm.count("animate")) {
+		arg_animate = vm["animate"].as<unsigned int>();
+		if (arg_animate == 0) {
+			PRINT("animate needs at least one frame");
+			exit(1);
+		}
+	}
+
 	currentdir = fs::current_path().generic_string();
 
-	Camera camera = get_camera(vm);
+	std::vector<Camera> cameras = get_cameras(vm);
 
 	// Initialize global visitors
 	NodeCache nodecache;
@@ -965,7 +1183,7 @@ int main(int argc, char **argv)
 
 	if (arg_info || cmdlinemode) {
 		if (inputFiles.size() > 1) help(argv[0], true);
-		rc = cmdline(deps_output_file, inputFiles[0], camera, output_file, original_path, renderer, parameterFile, parameterSet, argc, argv);
+		rc = cmdline(deps_output_file, inputFiles[0], cameras, output_file, original_path, renderer, parameterFile, parameterSet, argc, argv);
 	}
 	else if (QtUseGUI()) {
 		rc = gui(inputFiles, original_path, argc, argv);
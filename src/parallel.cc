@@ -0,0 +1,82 @@
+#include "parallel.h"
+#include "stackcheck.h"
+
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <boost/thread/thread.hpp>
+
+static std::atomic<size_t> threadcount(0);
+
+size_t parallel_thread_count()
+{
+	size_t n = threadcount;
+	return n ? n : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void set_parallel_thread_count(size_t n)
+{
+	threadcount = n;
+}
+
+namespace {
+	/*
+		Worker threads started once and reused, so loops with little work per
+		call don't pay for starting threads and reserving their stacks. Jobs
+		of concurrent callers are queued and run in order.
+	*/
+	class WorkerPool
+	{
+	public:
+		void run(size_t numthreads, const std::function<void()> &task) {
+			Job job = {&task, numthreads - 1};
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				if (this->threads.size() < job.pending) {
+					boost::thread::attributes attrs;
+					attrs.set_stack_size(StackCheck::threadStackSize());
+					while (this->threads.size() < job.pending) {
+						this->threads.emplace_back(attrs, [this]() { this->work(); });
+					}
+				}
+				for (size_t i = 0; i < job.pending; i++) this->queue.push_back(&job);
+			}
+			this->wakeup.notify_all();
+			task();
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->done.wait(lock, [&job]() { return job.pending == 0; });
+		}
+
+	private:
+		struct Job {
+			const std::function<void()> *task;
+			size_t pending;
+		};
+
+		void work() {
+			std::unique_lock<std::mutex> lock(this->mutex);
+			while (true) {
+				this->wakeup.wait(lock, [this]() { return !this->queue.empty(); });
+				Job *job = this->queue.front();
+				this->queue.pop_front();
+				lock.unlock();
+				(*job->task)();
+				lock.lock();
+				if (--job->pending == 0) this->done.notify_all();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable wakeup, done;
+		std::deque<Job *> queue;
+		std::vector<boost::thread> threads;
+	};
+}
+
+void parallel_run(size_t numthreads, const std::function<void()> &task)
+{
+	// Never destroyed, so the workers can stay blocked until the process exits
+	static WorkerPool *pool = new WorkerPool;
+	if (numthreads <= 1) task();
+	else pool->run(numthreads, task);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Shared by all parallel_for() instantiations, so nesting is detected across different fn types
+inline bool &parallel_worker_flag()
+{
+	static thread_local bool inworker = false;
+	return inworker;
+}
+
+/*!
+	Returns true when called from within a parallel_for() call, where further
+	parallel_for() calls run serially.
+*/
+inline bool in_parallel_worker()
+{
+	return parallel_worker_flag();
+}
+
+/*!
+	Returns the number of threads parallel_for() uses, including the calling
+	thread. This is the number of cores unless set_parallel_thread_count() was called.
+*/
+size_t parallel_thread_count();
+// Sets the number of threads parallel_for() uses, 0 for the number of cores
+void set_parallel_thread_count(size_t n);
+
+/*!
+	Calls task() in the calling thread and in numthreads - 1 threads of a
+	pool of workers, and returns when all calls have returned. The workers are
+	started on first use and reused by later calls. They get the stack size
+	StackCheck assumes, as deep recursion may run in task. task must not throw.
+*/
+void parallel_run(size_t numthreads, const std::function<void()> &task);
+
+/*!
+	Calls fn(i) for all i in [0, n), distributing the calls over parallel_thread_count() threads.
+
+	fn must be safe to call concurrently for different i. Note that CGAL Nef
+	polyhedra and other objects based on exact number types are not thread safe
+	and must not be used from fn.
+
+	Calls made from within fn run serially to avoid oversubscribing the cores.
+	If fn throws, the remaining calls are skipped and the first exception is
+	rethrown in the calling thread.
+*/
+template <typename Fn>
+void parallel_for(size_t n, Fn fn)
+{
+	bool &inworker = parallel_worker_flag();
+	size_t numthreads = std::min(n, parallel_thread_count());
+	if (inworker || numthreads <= 1) {
+		for (size_t i = 0; i < n; i++) fn(i);
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+	std::exception_ptr error;
+	std::mutex errormutex;
+	auto worker = [&]() {
+		bool &inworker = parallel_worker_flag();
+		inworker = true;
+		size_t i;
+		while ((i = next++) < n) {
+			try {
+				fn(i);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(errormutex);
+				if (!error) error = std::current_exception();
+				next = n;
+			}
+		}
+		inworker = false;
+	};
+
+	parallel_run(numthreads, worker);
+	if (error) std::rethrow_exception(error);
+}
+
+/*!
+	Sorts [begin, end) by sorting chunks on all available cores and merging
+	them pairwise. Same contract as std::sort; comp must be safe to call
+	concurrently.
+*/
+template <typename RandomIt, typename Compare>
+void parallel_sort(RandomIt begin, RandomIt end, Compare comp)
+{
+	size_t n = end - begin;
+	size_t numchunks = std::min(n / 4096 + 1, parallel_thread_count());
+	if (numchunks <= 1) {
+		std::sort(begin, end, comp);
+		return;
+	}
+
+	std::vector<size_t> bounds(numchunks + 1);
+	for (size_t i = 0; i <= numchunks; i++) bounds[i] = n * i / numchunks;
+	parallel_for(numchunks, [&](size_t i) {
+		std::sort(begin + bounds[i], begin + bounds[i + 1], comp);
+	});
+	for (size_t width = 1; width < numchunks; width *= 2) {
+		parallel_for((numchunks + 2 * width - 1) / (2 * width), [&](size_t m) {
+			size_t lo = 2 * width * m;
+			size_t mid = std::min(lo + width, numchunks);
+			size_t hi = std::min(lo + 2 * width, numchunks);
+			if (mid < hi) std::inplace_merge(begin + bounds[lo], begin + bounds[mid], begin + bounds[hi], comp);
+		});
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 namespace fs = boost::filesystem;
@@ -12,6 +13,9 @@ extern int parser_error_pos;
  */
 void parser_init();
 
+// Returns the library directories searched by use<> and include<>, in search order
+const std::vector<std::string> &get_library_path();
+
 fs::path search_libs(const fs::path &localpath);
 fs::path find_valid_path(const fs::path &sourcepath, 
                          const fs::path &localpath, 
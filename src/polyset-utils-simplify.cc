@@ -0,0 +1,448 @@
+#include "polyset-utils.h"
+#include "polyset.h"
+#include "Reindexer.h"
+#include "parallel.h"
+#include "printutils.h"
+#include "linalg.h"
+
+#include <array>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+/*
+	Mesh simplification by iterative edge collapse using quadric error metrics
+	(Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics").
+
+	Each vertex carries the sum of the plane quadrics of its incident triangles.
+	The edge with the lowest combined quadric error is collapsed into the
+	position minimizing that error, as long as this keeps the mesh manifold and
+	doesn't flip any triangle. Vertices on boundary or non-manifold edges are
+	never moved, so open and closed meshes keep their borders.
+
+	Large meshes are first split into slabs along their longest axis which are
+	simplified in parallel. Vertices shared by triangles of different slabs are
+	kept fixed in that phase, so slabs never touch the same vertices or triangles.
+	A final serial pass over the whole mesh then simplifies the slab seams.
+*/
+
+namespace {
+
+	// Symmetric 4x4 matrix, stored as its upper triangle
+	class Quadric
+	{
+	public:
+		Quadric() { std::fill(a, a + 10, 0.0); }
+
+		// Quadric of the squared distance to the plane n.x + d = 0, n normalized
+		Quadric(const Vector3d &n, double d) {
+			a[0] = n[0]*n[0]; a[1] = n[0]*n[1]; a[2] = n[0]*n[2]; a[3] = n[0]*d;
+			a[4] = n[1]*n[1]; a[5] = n[1]*n[2]; a[6] = n[1]*d;
+			a[7] = n[2]*n[2]; a[8] = n[2]*d;
+			a[9] = d*d;
+		}
+
+		Quadric &operator+=(const Quadric &q) {
+			for (int i = 0; i < 10; i++) a[i] += q.a[i];
+			return *this;
+		}
+
+		Quadric operator+(const Quadric &q) const {
+			Quadric r(*this);
+			return r += q;
+		}
+
+		double error(const Vector3d &v) const {
+			double x = v[0], y = v[1], z = v[2];
+			return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x
+				+ a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y
+				+ a[7]*z*z + 2*a[8]*z
+				+ a[9];
+		}
+
+		// Position with minimal error. Returns false if it isn't well defined.
+		bool optimum(Vector3d &v) const {
+			Eigen::Matrix3d m;
+			m << a[0], a[1], a[2],
+			     a[1], a[4], a[5],
+			     a[2], a[5], a[7];
+			double det = m.determinant();
+			double scale = m.cwiseAbs().maxCoeff();
+			if (std::fabs(det) <= 1e-10 * scale * scale * scale) return false;
+			v = m.inverse() * Vector3d(-a[3], -a[6], -a[8]);
+			return true;
+		}
+
+	private:
+		double a[10];
+	};
+
+	typedef std::array<int, 3> Triangle;
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const PolySet &ps);
+
+		size_t numFaces() const { return this->numfaces; }
+		void simplify(size_t targetfaces, double maxerror);
+		void fill(PolySet &ps) const;
+
+	private:
+		struct Candidate {
+			double cost;
+			int u, v;
+			unsigned int ustamp, vstamp;
+			Vector3d pos;
+			bool operator<(const Candidate &c) const { return cost > c.cost; }
+		};
+		typedef std::priority_queue<Candidate> CandidateQueue;
+
+		void collapsePartition(int part, size_t targetfaces, double maxerror);
+		bool evaluate(int u, int v, Candidate &c) const;
+		bool canCollapse(const Candidate &c) const;
+		void collapse(const Candidate &c, int part, CandidateQueue &queue);
+		bool movable(int v, int part) const {
+			return !this->vertremoved[v] && this->vertpart[v] == part;
+		}
+		Vector3d normal(const Triangle &t, int v, const Vector3d &pos) const;
+
+		std::vector<Vector3d> verts;
+		std::vector<Quadric> quadrics;
+		std::vector<std::vector<int>> vertfaces;
+		std::vector<unsigned int> stamps;
+		std::vector<char> vertremoved;
+		std::vector<char> locked; // On a boundary or non-manifold edge
+		std::vector<int> vertpart; // Partition which may move the vertex, -1 for none
+		std::vector<Triangle> faces;
+		std::vector<char> faceremoved;
+		std::vector<int> facepart;
+		std::vector<size_t> partfaces; // Number of faces per partition
+		size_t numfaces;
+	};
+
+	Simplifier::Simplifier(const PolySet &ps)
+	{
+		PolySet psq(3);
+		PolysetUtils::tessellate_faces(ps, psq);
+
+		Reindexer<Vector3d> indexer;
+		indexer.reserve(psq.polygons.size());
+		for (const auto &p : psq.polygons) {
+			if (p.size() != 3) continue;
+			Triangle t = {{indexer.lookup(p[0]), indexer.lookup(p[1]), indexer.lookup(p[2])}};
+			// Skip degenerate triangles
+			if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0]) continue;
+			this->faces.push_back(t);
+		}
+		this->verts.resize(indexer.size());
+		indexer.copy(this->verts.begin());
+
+		size_t n = this->verts.size();
+		this->numfaces = this->faces.size();
+		this->quadrics.resize(n);
+		this->vertfaces.resize(n);
+		this->stamps.assign(n, 0);
+		this->vertremoved.assign(n, 0);
+		this->locked.assign(n, 0);
+		this->faceremoved.assign(this->numfaces, 0);
+
+		for (size_t f = 0; f < this->faces.size(); f++) {
+			const Triangle &t = this->faces[f];
+			Vector3d nrm = (this->verts[t[1]] - this->verts[t[0]]).cross(this->verts[t[2]] - this->verts[t[0]]);
+			double len = nrm.norm();
+			if (len > 0) {
+				nrm /= len;
+				Quadric q(nrm, -nrm.dot(this->verts[t[0]]));
+				for (int i = 0; i < 3; i++) this->quadrics[t[i]] += q;
+			}
+			for (int i = 0; i < 3; i++) this->vertfaces[t[i]].push_back(f);
+		}
+
+		// Every edge of a closed manifold is used exactly once in each direction
+		std::vector<std::pair<std::pair<int,int>, int>> edges;
+		edges.reserve(3 * this->faces.size());
+		for (const auto &t : this->faces) {
+			for (int i = 0; i < 3; i++) {
+				int a = t[i], b = t[(i+1)%3];
+				edges.push_back(std::make_pair(std::make_pair(std::min(a, b), std::max(a, b)), a < b ? 1 : -1));
+			}
+		}
+		parallel_sort(edges.begin(), edges.end(), [](const std::pair<std::pair<int,int>, int> &x, const std::pair<std::pair<int,int>, int> &y) {
+			return x.first < y.first;
+		});
+		for (size_t i = 0; i < edges.size();) {
+			size_t j = i;
+			int count = 0, balance = 0;
+			for (; j < edges.size() && edges[j].first == edges[i].first; j++) {
+				count++;
+				balance += edges[j].second;
+			}
+			if (count != 2 || balance != 0) {
+				this->locked[edges[i].first.first] = 1;
+				this->locked[edges[i].first.second] = 1;
+			}
+			i = j;
+		}
+	}
+
+	Vector3d Simplifier::normal(const Triangle &t, int v, const Vector3d &pos) const
+	{
+		const Vector3d &p0 = t[0] == v ? pos : this->verts[t[0]];
+		const Vector3d &p1 = t[1] == v ? pos : this->verts[t[1]];
+		const Vector3d &p2 = t[2] == v ? pos : this->verts[t[2]];
+		return (p1 - p0).cross(p2 - p0);
+	}
+
+	/*
+		Finds the position and error for collapsing edge u-v. Returns false if the
+		edge cannot be collapsed.
+	*/
+	bool Simplifier::evaluate(int u, int v, Candidate &c) const
+	{
+		Quadric q = this->quadrics[u] + this->quadrics[v];
+		const Vector3d &pu = this->verts[u];
+		const Vector3d &pv = this->verts[v];
+		Vector3d mid = (pu + pv) / 2;
+
+		c.u = u;
+		c.v = v;
+		c.ustamp = this->stamps[u];
+		c.vstamp = this->stamps[v];
+		c.pos = mid;
+		c.cost = q.error(mid);
+
+		// The optimum may lie far away for nearly flat regions; only use it if
+		// it stays close to the edge
+		Vector3d opt;
+		if (q.optimum(opt) && (opt - mid).squaredNorm() <= (pu - pv).squaredNorm()) {
+			double e = q.error(opt);
+			if (e < c.cost) {
+				c.cost = e;
+				c.pos = opt;
+			}
+		}
+		double eu = q.error(pu), ev = q.error(pv);
+		if (eu < c.cost) {
+			c.cost = eu;
+			c.pos = pu;
+		}
+		if (ev < c.cost) {
+			c.cost = ev;
+			c.pos = pv;
+		}
+		c.cost = std::max(c.cost, 0.0);
+		return true;
+	}
+
+	bool Simplifier::canCollapse(const Candidate &c) const
+	{
+		int u = c.u, v = c.v;
+		if (this->vertremoved[u] || this->vertremoved[v]) return false;
+		if (this->stamps[u] != c.ustamp || this->stamps[v] != c.vstamp) return false;
+
+		// The edge must be shared by exactly two triangles, and these must be the
+		// only common neighbors of u and v (link condition)
+		std::vector<int> unbrs, vnbrs, opposite;
+		for (int f : this->vertfaces[u]) {
+			if (this->faceremoved[f]) continue;
+			const Triangle &t = this->faces[f];
+			bool hasv = t[0] == v || t[1] == v || t[2] == v;
+			for (int i = 0; i < 3; i++) {
+				if (t[i] == u) continue;
+				unbrs.push_back(t[i]);
+				if (hasv && t[i] != v) opposite.push_back(t[i]);
+			}
+		}
+		if (opposite.size() != 2 || opposite[0] == opposite[1]) return false;
+		for (int f : this->vertfaces[v]) {
+			if (this->faceremoved[f]) continue;
+			const Triangle &t = this->faces[f];
+			for (int i = 0; i < 3; i++) if (t[i] != v) vnbrs.push_back(t[i]);
+		}
+		std::sort(unbrs.begin(), unbrs.end());
+		unbrs.erase(std::unique(unbrs.begin(), unbrs.end()), unbrs.end());
+		std::sort(vnbrs.begin(), vnbrs.end());
+		vnbrs.erase(std::unique(vnbrs.begin(), vnbrs.end()), vnbrs.end());
+		std::vector<int> common;
+		std::set_intersection(unbrs.begin(), unbrs.end(), vnbrs.begin(), vnbrs.end(), std::back_inserter(common));
+		if (common.size() != 2) return false;
+
+		// Remaining triangles must not flip or degenerate
+		for (int w : {u, v}) {
+			for (int f : this->vertfaces[w]) {
+				if (this->faceremoved[f]) continue;
+				const Triangle &t = this->faces[f];
+				if ((t[0] == u || t[1] == u || t[2] == u) && (t[0] == v || t[1] == v || t[2] == v)) continue;
+				Vector3d before = normal(t, -1, c.pos);
+				Vector3d after = normal(t, w, c.pos);
+				double lb = before.norm(), la = after.norm();
+				if (la <= 1e-12 * lb) return false;
+				if (before.dot(after) < 0.2 * lb * la) return false;
+			}
+		}
+		return true;
+	}
+
+	void Simplifier::collapse(const Candidate &c, int part, CandidateQueue &queue)
+	{
+		int u = c.u, v = c.v;
+		this->verts[v] = c.pos;
+		this->quadrics[v] += this->quadrics[u];
+		this->vertremoved[u] = 1;
+		this->stamps[u]++;
+		this->stamps[v]++;
+
+		for (int f : this->vertfaces[u]) {
+			if (this->faceremoved[f]) continue;
+			Triangle &t = this->faces[f];
+			if (t[0] == v || t[1] == v || t[2] == v) {
+				this->faceremoved[f] = 1;
+				this->partfaces[part]--;
+			}
+			else {
+				for (int i = 0; i < 3; i++) if (t[i] == u) t[i] = v;
+				this->vertfaces[v].push_back(f);
+			}
+		}
+		std::vector<int>().swap(this->vertfaces[u]);
+
+		std::vector<int> &vf = this->vertfaces[v];
+		vf.erase(std::remove_if(vf.begin(), vf.end(), [this](int f) { return this->faceremoved[f] != 0; }), vf.end());
+
+		// Moving v changes the cost of all its edges
+		std::vector<int> nbrs;
+		for (int f : vf) {
+			const Triangle &t = this->faces[f];
+			for (int i = 0; i < 3; i++) if (t[i] != v) nbrs.push_back(t[i]);
+		}
+		std::sort(nbrs.begin(), nbrs.end());
+		nbrs.erase(std::unique(nbrs.begin(), nbrs.end()), nbrs.end());
+		for (int w : nbrs) {
+			if (!movable(w, part)) continue;
+			Candidate cand;
+			if (evaluate(v, w, cand)) queue.push(cand);
+		}
+	}
+
+	/*
+		Collapses edges between movable vertices of the given partition until it
+		has no more than targetfaces faces or the error would exceed maxerror.
+	*/
+	void Simplifier::collapsePartition(int part, size_t targetfaces, double maxerror)
+	{
+		CandidateQueue queue;
+		for (size_t f = 0; f < this->faces.size(); f++) {
+			if (this->faceremoved[f] || this->facepart[f] != part) continue;
+			const Triangle &t = this->faces[f];
+			for (int i = 0; i < 3; i++) {
+				int a = t[i], b = t[(i+1)%3];
+				// Each interior edge is seen from both triangles, only add it once
+				if (a > b || !movable(a, part) || !movable(b, part)) continue;
+				Candidate c;
+				if (evaluate(a, b, c)) queue.push(c);
+			}
+		}
+
+		while (this->partfaces[part] > targetfaces && !queue.empty()) {
+			Candidate c = queue.top();
+			queue.pop();
+			if (c.cost > maxerror) break;
+			if (canCollapse(c)) collapse(c, part, queue);
+		}
+	}
+
+	void Simplifier::simplify(size_t targetfaces, double maxerror)
+	{
+		size_t n = this->verts.size();
+		this->facepart.assign(this->faces.size(), 0);
+		this->vertpart.assign(n, 0);
+
+		// Split large meshes into slabs along the longest axis, simplified in parallel
+		const size_t minpartfaces = 50000;
+		size_t numparts = std::min<size_t>(this->numfaces / minpartfaces, 2 * parallel_thread_count());
+		if (numparts > 1 && targetfaces < this->numfaces) {
+			BoundingBox bbox;
+			for (const auto &p : this->verts) bbox.extend(p);
+			int axis;
+			bbox.sizes().maxCoeff(&axis);
+
+			std::vector<double> centers(this->faces.size());
+			for (size_t f = 0; f < this->faces.size(); f++) {
+				const Triangle &t = this->faces[f];
+				centers[f] = this->verts[t[0]][axis] + this->verts[t[1]][axis] + this->verts[t[2]][axis];
+			}
+			std::vector<double> sorted(centers);
+			std::vector<double> bounds;
+			for (size_t i = 1; i < numparts; i++) {
+				std::nth_element(sorted.begin(), sorted.begin() + sorted.size() * i / numparts, sorted.end());
+				bounds.push_back(sorted[sorted.size() * i / numparts]);
+			}
+			std::sort(bounds.begin(), bounds.end());
+			for (size_t f = 0; f < this->faces.size(); f++) {
+				this->facepart[f] = std::upper_bound(bounds.begin(), bounds.end(), centers[f]) - bounds.begin();
+			}
+			this->partfaces.assign(numparts, 0);
+			for (int p : this->facepart) this->partfaces[p]++;
+
+			for (size_t v = 0; v < n; v++) {
+				const std::vector<int> &vf = this->vertfaces[v];
+				int part = vf.empty() || this->locked[v] ? -1 : this->facepart[vf[0]];
+				for (int f : vf) if (this->facepart[f] != part) part = -1;
+				this->vertpart[v] = part;
+			}
+
+			parallel_for(numparts, [&](size_t p) {
+				size_t target = size_t(std::ceil(double(targetfaces) * this->partfaces[p] / this->numfaces));
+				collapsePartition(p, target, maxerror);
+			});
+
+			this->numfaces = 0;
+			for (size_t p : this->partfaces) this->numfaces += p;
+			std::fill(this->facepart.begin(), this->facepart.end(), 0);
+		}
+
+		// Final pass over the whole mesh
+		this->partfaces.assign(1, this->numfaces);
+		for (size_t v = 0; v < n; v++) this->vertpart[v] = this->locked[v] ? -1 : 0;
+		collapsePartition(0, targetfaces, maxerror);
+		this->numfaces = this->partfaces[0];
+	}
+
+	void Simplifier::fill(PolySet &ps) const
+	{
+		ps.resize_polygons(this->numfaces);
+		size_t i = 0;
+		for (size_t f = 0; f < this->faces.size(); f++) {
+			if (this->faceremoved[f]) continue;
+			const Triangle &t = this->faces[f];
+			ps.polygons[i++] = {this->verts[t[0]], this->verts[t[1]], this->verts[t[2]]};
+		}
+	}
+
+}
+
+namespace PolysetUtils {
+
+	/*!
+		Returns a simplified copy of the 3D PolySet ps with at most targetfaces
+		triangles, collapsing only edges whose quadric error, roughly the squared
+		distance to the original surface, stays below maxerror.
+		Pass targetfaces = 0 to only limit the error, or an infinite maxerror to
+		only limit the number of triangles.
+	*/
+	PolySet *simplify(const PolySet &ps, size_t targetfaces, double maxerror)
+	{
+		Simplifier simplifier(ps);
+		size_t numfaces = simplifier.numFaces();
+		simplifier.simplify(targetfaces, maxerror);
+		PRINTDB("simplify: %d -> %d faces", numfaces % simplifier.numFaces());
+
+		PolySet *result = new PolySet(3);
+		result->setConvexity(ps.getConvexity());
+		simplifier.fill(*result);
+		return result;
+	}
+
+}
@@ -5,6 +5,8 @@
 #include "GeometryUtils.h"
 #include "Reindexer.h"
 #include "grid.h"
+#include "parallel.h"
+#include <cmath>
 #ifdef ENABLE_CGAL
 #include "cgalutils.h"
 #endif
@@ -41,11 +43,43 @@ namespace PolysetUtils {
 	 the polyhedron() input.
 */
 	
+	/*!
+		Returns true if the face is strictly convex around its normal, in which case it
+		can be triangulated as a fan from its first vertex without involving libtess2.
+	*/
+	static bool is_fan_triangulable(const Vector3f *verts, const IndexedFace &face)
+	{
+		const size_t n = face.size();
+		Vector3d normal(0, 0, 0);
+		for (size_t i = 0; i < n; i++) {
+			const Vector3f &v = verts[face[i]];
+			if (!std::isfinite(v[0]) || !std::isfinite(v[1]) || !std::isfinite(v[2])) return false;
+			normal += v.cast<double>().cross(verts[face[(i+1)%n]].cast<double>());
+		}
+		if (normal.squaredNorm() == 0) return false;
+
+		// All corners must turn the same way, and all fan triangles must have the same
+		// orientation. The latter rules out self-intersecting (star shaped) faces.
+		const Vector3d v0 = verts[face[0]].cast<double>();
+		for (size_t i = 0; i < n; i++) {
+			const Vector3d prev = verts[face[(i+n-1)%n]].cast<double>();
+			const Vector3d curr = verts[face[i]].cast<double>();
+			const Vector3d next = verts[face[(i+1)%n]].cast<double>();
+			if ((curr - prev).cross(next - curr).dot(normal) <= 0) return false;
+			if (i > 0 && i < n-1 && (curr - v0).cross(next - v0).dot(normal) <= 0) return false;
+		}
+		return true;
+	}
+
 /* Given a 3D PolySet with near planar polygonal faces, tessellate the
-	 faces. As of writing, our only tessellation method is triangulation
-	 using CGAL's Constrained Delaunay algorithm. This code assumes the input
+	 faces. Triangles are passed through, and strictly convex faces are
+	 triangulated as fans. The remaining faces are triangulated using
+	 libtess2's Constrained Delaunay algorithm. This code assumes the input
 	 polyset has simple polygon faces with no holes.
 	 The tessellation will be robust wrt. degenerate and self-intersecting
+
+	 Faces are tessellated in parallel chunks. The chunks are concatenated
+	 in order, so the output doesn't depend on the number of threads.
 */
 	void tessellate_faces(const PolySet &inps, PolySet &outps)
 	{
@@ -54,6 +88,7 @@ namespace PolysetUtils {
 		// Build Indexed PolyMesh
 		Reindexer<Vector3f> allVertices;
 		std::vector<std::vector<IndexedFace>> polygons;
+		polygons.reserve(inps.polygons.size());
 
 		for (const auto &pgon : inps.polygons) {
 			if (pgon.size() < 3) {
@@ -65,37 +100,54 @@ namespace PolysetUtils {
 			std::vector<IndexedFace> &faces = polygons.back();
 			faces.push_back(IndexedFace());
 			IndexedFace &currface = faces.back();
+			currface.reserve(pgon.size());
 			for(const auto &v : pgon) {
 				// Create vertex indices and remove consecutive duplicate vertices
 				int idx = allVertices.lookup(v.cast<float>());
 				if (currface.empty() || idx != currface.back()) currface.push_back(idx);
 			}
 			if (currface.front() == currface.back()) currface.pop_back();
-                    if (currface.size() < 3) {
-                        faces.pop_back(); // Cull empty triangles
-                        if (faces.empty()) polygons.pop_back(); // All faces were culled
-                    }
+			if (currface.size() < 3) {
+				faces.pop_back(); // Cull empty triangles
+				if (faces.empty()) polygons.pop_back(); // All faces were culled
+			}
 		}
 
 		// Tessellate indexed mesh
 		const Vector3f *verts = allVertices.getArray();
-		std::vector<IndexedTriangle> allTriangles;
-		for(const auto &faces : polygons) {
-			std::vector<IndexedTriangle> triangles;
-			bool err = false;
-			if (faces[0].size() == 3) {
-				triangles.push_back(IndexedTriangle(faces[0][0], faces[0][1], faces[0][2]));
-			}
-			else {
-				err = GeometryUtils::tessellatePolygonWithHoles(verts, faces, triangles, NULL);
-			}
-			if (!err) {
-				for(const auto &t : triangles) {
-					outps.append_poly();
-					outps.append_vertex(verts[t[0]]);
-					outps.append_vertex(verts[t[1]]);
-					outps.append_vertex(verts[t[2]]);
+		const size_t chunksize = 256;
+		const size_t numchunks = (polygons.size() + chunksize - 1) / chunksize;
+		std::vector<std::vector<IndexedTriangle>> chunktriangles(numchunks);
+		parallel_for(numchunks, [&](size_t c) {
+			std::vector<IndexedTriangle> &triangles = chunktriangles[c];
+			const size_t end = std::min(polygons.size(), (c + 1) * chunksize);
+			for (size_t p = c * chunksize; p < end; p++) {
+				const auto &faces = polygons[p];
+				const IndexedFace &face = faces[0];
+				if (faces.size() == 1 && (face.size() == 3 || is_fan_triangulable(verts, face))) {
+					for (size_t i = 1; i + 1 < face.size(); i++) {
+						triangles.push_back(IndexedTriangle(face[0], face[i], face[i+1]));
+					}
 				}
+				else {
+					// Drop partial output of failed tessellations
+					const size_t start = triangles.size();
+					if (GeometryUtils::tessellatePolygonWithHoles(verts, faces, triangles, NULL)) {
+						triangles.resize(start);
+					}
+				}
+			}
+		});
+
+		size_t numtriangles = 0;
+		for (const auto &triangles : chunktriangles) numtriangles += triangles.size();
+		outps.polygons.reserve(outps.polygons.size() + numtriangles);
+		for (const auto &triangles : chunktriangles) {
+			for (const auto &t : triangles) {
+				outps.append_poly();
+				outps.append_vertex(verts[t[0]]);
+				outps.append_vertex(verts[t[1]]);
+				outps.append_vertex(verts[t[2]]);
 			}
 		}
 		if (degeneratePolygons > 0) PRINT("WARNING: PolySet has degenerate polygons");
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 class Polygon2d;
 class PolySet;
 
@@ -8,5 +10,6 @@ namespace PolysetUtils {
 	Polygon2d *project(const PolySet &ps);
 	void tessellate_faces(const PolySet &inps, PolySet &outps);
 	bool is_approximately_convex(const PolySet &ps);
+	PolySet *simplify(const PolySet &ps, size_t targetfaces, double maxerror);
 
 };
@@ -152,6 +152,9 @@ void PolySet::append(const PolySet &ps)
 	if (!dirty && !this->bbox.isNull()) {
 		this->bbox.extend(ps.getBoundingBox());
 	}
+	else {
+		this->dirty = true;
+	}
 }
 
 void PolySet::transform(const Transform3d &mat)
@@ -208,29 +211,36 @@ void PolySet::resize(const Vector3d &newsize, const Eigen::Matrix<bool,3,1> &aut
 */
 void PolySet::quantizeVertices()
 {
-	Grid3d<int> grid(GRID_FINE);
-	int numverts = 0;
-	std::vector<int> indices; // Vertex indices in one polygon
-	for (std::vector<Polygon>::iterator iter = this->polygons.begin(); iter != this->polygons.end();) {
-		Polygon &p = *iter;
-		indices.resize(p.size());
-		// Quantize all vertices. Build index list
-		for (int i=0;i<p.size();i++) indices[i] = grid.align(p[i]);
-		// Remove consequtive duplicate vertices
-		Polygon::iterator currp = p.begin();
-		for (int i=0;i<indices.size();i++) {
-			if (indices[i] != indices[(i+1)%indices.size()]) {
-				(*currp++) = p[i];
-			}
+	// Quantize all vertices in one batch
+	size_t numverts = 0;
+	for (const auto &p : this->polygons) numverts += p.size();
+	std::vector<Vector3d> vertices;
+	vertices.reserve(numverts);
+	for (const auto &p : this->polygons) vertices.insert(vertices.end(), p.begin(), p.end());
+	VertexWelder welder(GRID_FINE);
+	std::vector<int> indices = welder.align(vertices);
+
+	// Write back the vertices, removing consecutive duplicates and compacting
+	// away collapsed polygons in a single pass
+	size_t offset = 0;
+	size_t numpolygons = 0;
+	for (auto &p : this->polygons) {
+		const size_t size = p.size();
+		const int *pindices = indices.data() + offset;
+		size_t curr = 0;
+		for (size_t i = 0; i < size; i++) {
+			if (pindices[i] != pindices[(i + 1) % size]) p[curr++] = vertices[offset + i];
 		}
-		p.erase(currp, p.end());
+		p.resize(curr);
+		offset += size;
 		if (p.size() < 3) {
 			PRINTD("Removing collapsed polygon due to quantizing");
-			this->polygons.erase(iter);
 		}
 		else {
-			iter++;
+			if (&p != &this->polygons[numpolygons]) this->polygons[numpolygons].swap(p);
+			numpolygons++;
 		}
 	}
+	this->polygons.resize(numpolygons);
 }
 
@@ -39,6 +39,8 @@ public:
 	void insert_vertex(const Vector3d &v);
 	void insert_vertex(const Vector3f &v);
 	void append(const PolySet &ps);
+	// Resizes the polygon list, for callers filling in polygons directly
+	void resize_polygons(size_t n) { polygons.resize(n); this->dirty = true; }
 
 	void render_surface(Renderer::csgmode_e csgmode, const Transform3d &m, GLint *shaderinfo = NULL) const;
 	void render_edges(Renderer::csgmode_e csgmode) const;
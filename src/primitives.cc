@@ -39,8 +39,6 @@
 #include <boost/assign/std/vector.hpp>
 using namespace boost::assign; // bring 'operator+=()' into scope
 
-#define F_MINIMUM 0.01
-
 enum primitive_type_e {
 	CUBE,
 	SPHERE,
@@ -172,9 +170,9 @@ AbstractNode *PrimitiveModule::instantiate(const Context *ctx, const ModuleInsta
 	Context c(ctx);
 	c.setVariables(args, evalctx);
 
-	node->fn = c.lookup_variable("$fn")->toDouble();
-	node->fs = c.lookup_variable("$fs")->toDouble();
-	node->fa = c.lookup_variable("$fa")->toDouble();
+	node->fn = c.lookup_variable(Symbols::fn)->toDouble();
+	node->fs = c.lookup_variable(Symbols::fs)->toDouble();
+	node->fa = c.lookup_variable(Symbols::fa)->toDouble();
 
 	if (node->fs < F_MINIMUM) {
 		PRINTB("WARNING: $fs too small - clamping to %f", F_MINIMUM);
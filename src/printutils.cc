@@ -15,6 +15,31 @@ bool OpenSCAD::quiet = false;
 
 boost::circular_buffer<std::string> lastmessages(5);
 
+static thread_local PrintCapture *print_capture = NULL;
+
+void PrintCapture::start()
+{
+	this->previous = print_capture;
+	print_capture = this;
+}
+
+void PrintCapture::stop()
+{
+	print_capture = this->previous;
+	this->previous = NULL;
+}
+
+void PrintCapture::replay() const
+{
+	for (const auto &msg : this->messages) {
+		switch (msg.first) {
+		case Kind::Cached: PRINT(msg.second); break;
+		case Kind::Uncached: PRINT_NOCACHE(msg.second); break;
+		case Kind::Deprecation: printDeprecation(msg.second); break;
+		}
+	}
+}
+
 void set_output_handler(OutputHandlerFunc *newhandler, void *userdata)
 {
 	outputhandler = newhandler;
@@ -41,6 +66,10 @@ void print_messages_pop()
 void PRINT(const std::string &msg)
 {
 	if (msg.empty()) return;
+	if (print_capture) {
+		print_capture->messages.push_back(std::make_pair(PrintCapture::Kind::Cached, msg));
+		return;
+	}
 	if (print_messages_stack.size() > 0) {
 		if (!print_messages_stack.back().empty()) {
 			print_messages_stack.back() += "\n";
@@ -53,6 +82,10 @@ void PRINT(const std::string &msg)
 void PRINT_NOCACHE(const std::string &msg)
 {
 	if (msg.empty()) return;
+	if (print_capture) {
+		print_capture->messages.push_back(std::make_pair(PrintCapture::Kind::Uncached, msg));
+		return;
+	}
 
 	if (boost::starts_with(msg, "WARNING") || boost::starts_with(msg, "ERROR")) {
 		size_t i;
@@ -112,6 +145,10 @@ std::set<std::string> printedDeprecations;
 
 void printDeprecation(const std::string &str)
 {
+	if (print_capture) {
+		print_capture->messages.push_back(std::make_pair(PrintCapture::Kind::Deprecation, str));
+		return;
+	}
 	if (printedDeprecations.find(str) == printedDeprecations.end()) {
 		printedDeprecations.insert(str);
 		std::string msg = "DEPRECATED: " + str;
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <iostream>
 #include <boost/format.hpp>
 
@@ -37,6 +38,35 @@ void PRINT_NOCACHE(const std::string &msg);
 
 void PRINT_CONTEXT(const class Context *ctx, const class Module *mod, const class ModuleInstantiation *inst);
 
+/*!
+	Collects the messages printed by a thread instead of printing them, so the
+	output of work done in parallel can be printed in a deterministic order.
+*/
+class PrintCapture
+{
+public:
+	PrintCapture() : previous(NULL) {}
+
+	// Captures messages printed by the calling thread until stop() is called
+	void start();
+	void stop();
+	// Prints the captured messages in the calling thread
+	void replay() const;
+
+	enum class Kind { Cached, Uncached, Deprecation };
+	typedef std::vector<std::pair<Kind, std::string>> Messages;
+	const Messages &getMessages() const { return this->messages; }
+	void addMessage(Kind kind, const std::string &msg) { this->messages.push_back(std::make_pair(kind, msg)); }
+
+private:
+	friend void PRINT(const std::string &msg);
+	friend void PRINT_NOCACHE(const std::string &msg);
+	friend void printDeprecation(const std::string &str);
+
+	Messages messages;
+	PrintCapture *previous;
+};
+
 /*PRINTD: debugging/verbose output. Usage in code:
   CGAL_Point_3 p0(0,0,0),p1(1,0,0),p2(0,1,0);
   PRINTD(" Created 3 points: ");
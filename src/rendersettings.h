@@ -9,6 +9,11 @@ public:
 	static RenderSettings *inst(bool erase = false);
 
 	unsigned int openCSGTermLimit, img_width, img_height;
+	// Meshes with more faces are simplified for previews, 0 to disable
+	unsigned int previewLodFaces;
+	// Render png exports on the CPU instead of with OpenGL
+	bool softwareRendering;
+	bool showEdges;
 	double far_gl_clip_limit;
 	std::string colorscheme;
 private:
@@ -4,8 +4,9 @@
 #include "PlatformUtils.h"
 
 StackCheck * StackCheck::self = 0;
+thread_local unsigned char * StackCheck::ptr = 0;
 
-StackCheck::StackCheck() : ptr(0)
+StackCheck::StackCheck()
 {
 }
 
@@ -27,9 +28,16 @@ unsigned long StackCheck::size()
 
 bool StackCheck::check()
 {
+    // Threads other than the main thread start checking at their first call
+    if (!ptr) init();
     return size() >= PlatformUtils::stackLimit();
 }
 
+unsigned long StackCheck::threadStackSize()
+{
+    return PlatformUtils::stackLimit() + STACK_BUFFER_SIZE;
+}
+
 StackCheck * StackCheck::inst()
 {
     if (self == 0) {
@@ -11,9 +11,13 @@ public:
     void init();
     bool check();
     unsigned long size();
+
+    // Stack size needed by other threads for check() to stop recursion in time
+    static unsigned long threadStackSize();
     
 private:
-    unsigned char * ptr;
+    // Start of the stack of each thread, set by init() or the first check()
+    static thread_local unsigned char * ptr;
     
     static StackCheck *self;
 };
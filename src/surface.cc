@@ -34,13 +34,12 @@
 #include "fileutils.h"
 #include "handle_dep.h" // handle_dep()
 #include "lodepng.h"
+#include "parallel.h"
 
 #include <sstream>
 #include <fstream>
-#include <unordered_map>
-#include <boost/functional/hash.hpp>
-#include <boost/tokenizer.hpp>
-#include <boost/lexical_cast.hpp>
+#include <cstring>
+#include <cstdlib>
 #include <boost/algorithm/string.hpp>
 #include <boost/assign/std/vector.hpp>
 using namespace boost::assign; // bring 'operator+=()' into scope
@@ -55,7 +54,28 @@ public:
 	virtual AbstractNode *instantiate(const Context *ctx, const ModuleInstantiation *inst, EvalContext *evalctx) const;
 };
 
-typedef std::unordered_map<std::pair<int,int>, double, boost::hash<std::pair<int,int>>> img_data_t;
+/*!
+	Heightmap values stored row by row. Cells not given in a DAT file are 0.
+*/
+class HeightMap
+{
+public:
+	HeightMap() : lines(0), columns(0), min_val(0) {}
+
+	void resize(int lines, int columns) {
+		this->lines = lines;
+		this->columns = columns;
+		this->data.assign(size_t(lines) * columns, 0.0);
+	}
+	double operator()(int line, int column) const { return this->data[size_t(line) * this->columns + column]; }
+	double &operator()(int line, int column) { return this->data[size_t(line) * this->columns + column]; }
+
+	int lines;
+	int columns;
+	double min_val; // Bottom of the surface, 1 below the lowest value but at most 0
+private:
+	std::vector<double> data;
+};
 
 class SurfaceNode : public LeafNode
 {
@@ -69,13 +89,17 @@ public:
 	bool center;
 	bool invert;
 	int convexity;
-	
+	int triangles; // Triangles per grid cell, 4 (around a center vertex) or 2
+	double decimate; // Flatness tolerance for merging cells, negative to disable
+
 	virtual const Geometry *createGeometry() const;
 private:
-	void convert_image(img_data_t &data, std::vector<unsigned char> &img, unsigned int width, unsigned int height) const;
+	void convert_image(HeightMap &data, const std::vector<unsigned char> &img, unsigned int width, unsigned int height) const;
 	bool is_png(std::vector<unsigned char> &img) const;
-	img_data_t read_dat(std::string filename) const;
-	img_data_t read_png_or_dat(std::string filename) const;
+	HeightMap read_dat(std::string filename) const;
+	HeightMap read_png_or_dat(std::string filename) const;
+	void add_cell(Polygons &out, const HeightMap &data, int i, int j, double ox, double oy) const;
+	void add_block(Polygons &out, const HeightMap &data, int i0, int j0, int i1, int j1, double ox, double oy) const;
 };
 
 AbstractNode *SurfaceModule::instantiate(const Context *ctx, const ModuleInstantiation *inst, EvalContext *evalctx) const
@@ -84,6 +108,8 @@ AbstractNode *SurfaceModule::instantiate(const Context *ctx, const ModuleInstant
 	node->center = false;
 	node->invert = false;
 	node->convexity = 1;
+	node->triangles = 4;
+	node->decimate = -1;
 
 	AssignmentList args;
 	args += Assignment("file"), Assignment("center"), Assignment("convexity");
@@ -109,17 +135,35 @@ AbstractNode *SurfaceModule::instantiate(const Context *ctx, const ModuleInstant
 		node->invert = invert->toBool();
 	}
 
+	ValuePtr triangles = c.lookup_variable("triangles", true);
+	if (triangles->type() == Value::NUMBER) {
+		int t = (int)triangles->toDouble();
+		if (t == 2 || t == 4) node->triangles = t;
+		else PRINTB("WARNING: surface(..., triangles=%s) must be 2 or 4, using 4", triangles->toString());
+	}
+
+	ValuePtr decimate = c.lookup_variable("decimate", true);
+	if (decimate->type() == Value::BOOL) {
+		if (decimate->toBool()) node->decimate = 0;
+	}
+	else if (decimate->type() == Value::NUMBER && decimate->toDouble() >= 0) {
+		node->decimate = decimate->toDouble();
+	}
+
 	return node;
 }
 
-void SurfaceNode::convert_image(img_data_t &data, std::vector<unsigned char> &img, unsigned int width, unsigned int height) const
+void SurfaceNode::convert_image(HeightMap &data, const std::vector<unsigned char> &img, unsigned int width, unsigned int height) const
 {
+	data.resize(height, width);
+	data.min_val = 0;
 	for (unsigned int y = 0;y < height;y++) {
 		for (unsigned int x = 0;x < width;x++) {
-			long idx = 4 * (y * width + x);
+			long idx = 3 * (y * width + x);
 			double pixel = 0.2126 * img[idx] + 0.7152 * img[idx + 1] + 0.0722 * img[idx + 2];
 			double z = 100.0/255 * (invert ? 1 - pixel : pixel);
-			data[std::make_pair(height - 1 - y, x)] = z;
+			data(height - 1 - y, x) = z;
+			data.min_val = std::min(z - 1, data.min_val);
 		}
 	}
 }
@@ -137,9 +181,9 @@ bool SurfaceNode::is_png(std::vector<unsigned char> &png) const
 		&& (png[7] == 0x0a);
 }
 
-img_data_t SurfaceNode::read_png_or_dat(std::string filename) const
+HeightMap SurfaceNode::read_png_or_dat(std::string filename) const
 {
-	img_data_t data;
+	HeightMap data;
 	std::vector<unsigned char> png;
 	
 	lodepng::load_file(png, filename);
@@ -149,12 +193,13 @@ img_data_t SurfaceNode::read_png_or_dat(std::string filename) const
 		return read_dat(filename);
 	}
 	
+	// Decode to 8 bit RGB, alpha doesn't contribute to the height
 	unsigned int width, height;
 	std::vector<unsigned char> img;
-	unsigned error = lodepng::decode(img, width, height, png);
+	unsigned error = lodepng::decode(img, width, height, png, LCT_RGB, 8);
+	std::vector<unsigned char>().swap(png);
 	if (error) {
 		PRINTB("ERROR: Can't read PNG image '%s'", filename);
-		data.clear();
 		return data;
 	}
 	
@@ -163,9 +208,9 @@ img_data_t SurfaceNode::read_png_or_dat(std::string filename) const
 	return data;
 }
 
-img_data_t SurfaceNode::read_dat(std::string filename) const
+HeightMap SurfaceNode::read_dat(std::string filename) const
 {
-	img_data_t data;
+	HeightMap data;
 	std::ifstream stream(filename.c_str());
 
 	if (!stream.good()) {
@@ -173,13 +218,15 @@ img_data_t SurfaceNode::read_dat(std::string filename) const
 		return data;
 	}
 
-	int lines = 0, columns = 0;
+	// Values are collected line by line, as the number of columns is only
+	// known at the end
+	std::vector<double> values;
+	std::vector<size_t> linestart;
+	int columns = 0;
 	double min_val = 0;
 
-	typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
-	boost::char_separator<char> sep(" \t");
-
-	while (!stream.eof()) {
+	bool error = false;
+	while (!stream.eof() && !error) {
 		std::string line;
 		while (!stream.eof() && (line.size() == 0 || line[0] == '#')) {
 			std::getline(stream, line);
@@ -187,89 +234,161 @@ img_data_t SurfaceNode::read_dat(std::string filename) const
 		}
 		if (line.size() == 0 && stream.eof()) break;
 
-		int col = 0;
-		tokenizer tokens(line, sep);
-		try {
-			for(const auto &token : tokens) {
-				double v = boost::lexical_cast<double>(token);
-				data[std::make_pair(lines, col++)] = v;
-				if (col > columns) columns = col;
-				min_val = std::min(v-1, min_val);
+		linestart.push_back(values.size());
+		const char *p = line.c_str();
+		while (true) {
+			p += strspn(p, " \t");
+			if (!*p) break;
+			size_t len = strcspn(p, " \t");
+			char *end;
+			double v = strtod(p, &end);
+			if (end != p + len) {
+				if (!stream.eof()) {
+					PRINTB("WARNING: Illegal value in '%s': %s", filename % std::string(p, len));
+				}
+				error = true;
+				break;
 			}
+			values.push_back(v);
+			min_val = std::min(v-1, min_val);
+			p += len;
 		}
-		catch (const boost::bad_lexical_cast &blc) {
-			if (!stream.eof()) {
-				PRINTB("WARNING: Illegal value in '%s': %s", filename % blc.what());
-			}
-			break;
-  	}
-		lines++;
+		columns = std::max(columns, int(values.size() - linestart.back()));
+	}
+
+	// A line with no valid values doesn't count
+	while (!linestart.empty() && linestart.back() == values.size()) linestart.pop_back();
+
+	data.resize(linestart.size(), columns);
+	data.min_val = min_val;
+	for (size_t i = 0; i < linestart.size(); i++) {
+		size_t end = i + 1 < linestart.size() ? linestart[i + 1] : values.size();
+		for (size_t k = linestart[i]; k < end; k++) data(i, k - linestart[i]) = values[k];
 	}
-	
 	return data;
 }
 
+/*!
+	Adds the top surface triangles of the grid cell between lines i-1, i and
+	columns j-1, j.
+*/
+void SurfaceNode::add_cell(Polygons &out, const HeightMap &data, int i, int j, double ox, double oy) const
+{
+	double v1 = data(i-1, j-1);
+	double v2 = data(i-1, j);
+	double v3 = data(i, j-1);
+	double v4 = data(i, j);
+
+	if (this->triangles == 2) {
+		out.push_back({Vector3d(ox + j-1, oy + i-1, v1), Vector3d(ox + j, oy + i-1, v2), Vector3d(ox + j, oy + i, v4)});
+		out.push_back({Vector3d(ox + j, oy + i, v4), Vector3d(ox + j-1, oy + i, v3), Vector3d(ox + j-1, oy + i-1, v1)});
+		return;
+	}
+
+	double vx = (v1 + v2 + v3 + v4) / 4;
+	Vector3d center(ox + j-0.5, oy + i-0.5, vx);
+	out.push_back({Vector3d(ox + j-1, oy + i-1, v1), Vector3d(ox + j, oy + i-1, v2), center});
+	out.push_back({Vector3d(ox + j, oy + i-1, v2), Vector3d(ox + j, oy + i, v4), center});
+	out.push_back({Vector3d(ox + j, oy + i, v4), Vector3d(ox + j-1, oy + i, v3), center});
+	out.push_back({Vector3d(ox + j-1, oy + i, v3), Vector3d(ox + j-1, oy + i-1, v1), center});
+}
+
+/*!
+	Adds the top surface of the grid block between lines i0, i1 and columns
+	j0, j1. A block whose heights are within the decimate tolerance becomes a
+	single polygon, otherwise the block is split in four. The polygon keeps
+	all grid vertices along its border, so it connects to smaller neighboring
+	blocks without cracks.
+*/
+void SurfaceNode::add_block(Polygons &out, const HeightMap &data, int i0, int j0, int i1, int j1, double ox, double oy) const
+{
+	double lo = data(i0, j0), hi = lo;
+	for (int i = i0; i <= i1; i++) {
+		for (int j = j0; j <= j1; j++) {
+			lo = std::min(lo, data(i, j));
+			hi = std::max(hi, data(i, j));
+		}
+	}
+	if (hi - lo <= this->decimate) {
+		Polygon poly;
+		poly.reserve(2 * (i1 - i0 + j1 - j0));
+		for (int j = j0; j < j1; j++) poly.push_back(Vector3d(ox + j, oy + i0, data(i0, j)));
+		for (int i = i0; i < i1; i++) poly.push_back(Vector3d(ox + j1, oy + i, data(i, j1)));
+		for (int j = j1; j > j0; j--) poly.push_back(Vector3d(ox + j, oy + i1, data(i1, j)));
+		for (int i = i1; i > i0; i--) poly.push_back(Vector3d(ox + j0, oy + i, data(i, j0)));
+		out.push_back(poly);
+	}
+	else if (i1 - i0 == 1 && j1 - j0 == 1) {
+		add_cell(out, data, i1, j1, ox, oy);
+	}
+	else {
+		int im = i1 - i0 > 1 ? (i0 + i1) / 2 : i1;
+		int jm = j1 - j0 > 1 ? (j0 + j1) / 2 : j1;
+		add_block(out, data, i0, j0, im, jm, ox, oy);
+		if (jm < j1) add_block(out, data, i0, jm, im, j1, ox, oy);
+		if (im < i1) {
+			add_block(out, data, im, j0, i1, jm, ox, oy);
+			if (jm < j1) add_block(out, data, im, jm, i1, j1, ox, oy);
+		}
+	}
+}
+
 const Geometry *SurfaceNode::createGeometry() const
 {
-	img_data_t data = read_png_or_dat(filename);
+	HeightMap data = read_png_or_dat(filename);
 
 	PolySet *p = new PolySet(3);
 	p->setConvexity(convexity);
 	
-	int lines = 0;
-	int columns = 0;
-	double min_val = 0;
-	for (img_data_t::iterator it = data.begin();it != data.end();it++) {
-		lines = std::max(lines, (*it).first.first + 1);
-		columns = std::max(columns, (*it).first.second + 1);
-		min_val = std::min((*it).second - 1, min_val);
-	}
+	int lines = data.lines;
+	int columns = data.columns;
+	double min_val = data.min_val;
 
 	double ox = center ? -(columns-1)/2.0 : 0;
 	double oy = center ? -(lines-1)/2.0 : 0;
 
-	for (int i = 1; i < lines; i++)
-	for (int j = 1; j < columns; j++)
-	{
-		double v1 = data[std::make_pair(i-1, j-1)];
-		double v2 = data[std::make_pair(i-1, j)];
-		double v3 = data[std::make_pair(i, j-1)];
-		double v4 = data[std::make_pair(i, j)];
-		double vx = (v1 + v2 + v3 + v4) / 4;
-
-		p->append_poly();
-		p->append_vertex(ox + j-1, oy + i-1, v1);
-		p->append_vertex(ox + j, oy + i-1, v2);
-		p->append_vertex(ox + j-0.5, oy + i-0.5, vx);
-
-		p->append_poly();
-		p->append_vertex(ox + j, oy + i-1, v2);
-		p->append_vertex(ox + j, oy + i, v4);
-		p->append_vertex(ox + j-0.5, oy + i-0.5, vx);
-
-		p->append_poly();
-		p->append_vertex(ox + j, oy + i, v4);
-		p->append_vertex(ox + j-1, oy + i, v3);
-		p->append_vertex(ox + j-0.5, oy + i-0.5, vx);
-
-		p->append_poly();
-		p->append_vertex(ox + j-1, oy + i, v3);
-		p->append_vertex(ox + j-1, oy + i-1, v1);
-		p->append_vertex(ox + j-0.5, oy + i-0.5, vx);
+	// The top surface is generated in parallel for bands of lines, each
+	// split into square blocks when decimating
+	const int blocksize = 64;
+	int numbands = lines > 1 && columns > 1 ? (lines - 2) / blocksize + 1 : 0;
+	std::vector<Polygons> bands(numbands);
+	parallel_for(numbands, [&](size_t b) {
+		int i0 = b * blocksize;
+		int i1 = std::min(i0 + blocksize, lines - 1);
+		if (this->decimate >= 0) {
+			for (int j0 = 0; j0 < columns - 1; j0 += blocksize) {
+				add_block(bands[b], data, i0, j0, i1, std::min(j0 + blocksize, columns - 1), ox, oy);
+			}
+		}
+		else {
+			bands[b].reserve(size_t(i1 - i0) * (columns - 1) * this->triangles);
+			for (int i = i0 + 1; i <= i1; i++) {
+				for (int j = 1; j < columns; j++) add_cell(bands[b], data, i, j, ox, oy);
+			}
+		}
+	});
+
+	size_t numpolygons = 0;
+	for (const auto &band : bands) numpolygons += band.size();
+	p->resize_polygons(numpolygons);
+	Polygons::iterator out = p->polygons.begin();
+	for (auto &band : bands) {
+		out = std::move(band.begin(), band.end(), out);
+		Polygons().swap(band);
 	}
 
 	for (int i = 1; i < lines; i++)
 	{
 		p->append_poly();
 		p->append_vertex(ox + 0, oy + i-1, min_val);
-		p->append_vertex(ox + 0, oy + i-1, data[std::make_pair(i-1, 0)]);
-		p->append_vertex(ox + 0, oy + i, data[std::make_pair(i, 0)]);
+		p->append_vertex(ox + 0, oy + i-1, data(i-1, 0));
+		p->append_vertex(ox + 0, oy + i, data(i, 0));
 		p->append_vertex(ox + 0, oy + i, min_val);
 
 		p->append_poly();
 		p->insert_vertex(ox + columns-1, oy + i-1, min_val);
-		p->insert_vertex(ox + columns-1, oy + i-1, data[std::make_pair(i-1, columns-1)]);
-		p->insert_vertex(ox + columns-1, oy + i, data[std::make_pair(i, columns-1)]);
+		p->insert_vertex(ox + columns-1, oy + i-1, data(i-1, columns-1));
+		p->insert_vertex(ox + columns-1, oy + i, data(i, columns-1));
 		p->insert_vertex(ox + columns-1, oy + i, min_val);
 	}
 
@@ -277,14 +396,14 @@ const Geometry *SurfaceNode::createGeometry() const
 	{
 		p->append_poly();
 		p->insert_vertex(ox + i-1, oy + 0, min_val);
-		p->insert_vertex(ox + i-1, oy + 0, data[std::make_pair(0, i-1)]);
-		p->insert_vertex(ox + i, oy + 0, data[std::make_pair(0, i)]);
+		p->insert_vertex(ox + i-1, oy + 0, data(0, i-1));
+		p->insert_vertex(ox + i, oy + 0, data(0, i));
 		p->insert_vertex(ox + i, oy + 0, min_val);
 
 		p->append_poly();
 		p->append_vertex(ox + i-1, oy + lines-1, min_val);
-		p->append_vertex(ox + i-1, oy + lines-1, data[std::make_pair(lines-1, i-1)]);
-		p->append_vertex(ox + i, oy + lines-1, data[std::make_pair(lines-1, i)]);
+		p->append_vertex(ox + i-1, oy + lines-1, data(lines-1, i-1));
+		p->append_vertex(ox + i, oy + lines-1, data(lines-1, i));
 		p->append_vertex(ox + i, oy + lines-1, min_val);
 	}
 
@@ -310,8 +429,10 @@ std::string SurfaceNode::toString() const
 
 	stream << this->name() << "(file = " << this->filename
 		<< ", center = " << (this->center ? "true" : "false")
-		<< ", invert = " << (this->invert ? "true" : "false")
-				 << ", " "timestamp = " << (fs::exists(path) ? fs::last_write_time(path) : 0)
+		<< ", invert = " << (this->invert ? "true" : "false");
+	if (this->triangles != 4) stream << ", triangles = " << this->triangles;
+	if (this->decimate >= 0) stream << ", decimate = " << this->decimate;
+	stream << ", " "timestamp = " << (fs::exists(path) ? fs::last_write_time(path) : 0)
 				 << ")";
 
 	return stream.str();
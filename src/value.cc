@@ -771,6 +771,9 @@ uint32_t RangeType::numValues() const
     numvals = (end_val - begin_val) / step_val + 1;
   }
   
+  if (numvals >= std::numeric_limits<uint32_t>::max()) {
+    return std::numeric_limits<uint32_t>::max();
+  }
   return numvals;
 }
 
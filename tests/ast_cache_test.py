@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+
+# AST cache test
+#
+#
+# Usage: <script> <inputfile> --openscad=<executable-path> --format=<format> [<openscad args>] file.<format>
+#
+#
+# step 1. Run OpenSCAD on the input file with --ast-cache set to an empty
+#         directory, exporting to the given format. This parses the used
+#         libraries and stores them in the cache.
+# step 2. Check that the cache directory is no longer empty.
+# step 3. Run OpenSCAD again with the same cache directory, which loads the
+#         used libraries from the cache.
+# step 4. Check that both runs exported the same file, which for echo output
+#         includes the warnings printed by the parser, and copy it to
+#         file.<format>.
+# step 5. (done in CTest) - compare file.<format> to the expected output.
+#
+# All the optional openscad args are passed on to OpenSCAD.
+#
+# This script should return 0 on success, not-0 on error.
+
+import sys, os, shutil, subprocess, tempfile, argparse
+
+def failquit(*args):
+	if len(args)!=0: print(args)
+	print('ast_cache_test args:',str(sys.argv))
+	print('exiting ast_cache_test.py with failure')
+	sys.exit(1)
+
+def read(filename):
+	f = open(filename, 'rb')
+	data = f.read()
+	f.close()
+	return data
+
+def run_openscad(exportfile):
+	cmd = [args.openscad, inputfile, '-o', exportfile, '--ast-cache=' + cachedir] + remaining_args
+	sys.stderr.write('Running OpenSCAD:\n' + ' '.join(cmd) + '\n')
+	result = subprocess.call(cmd)
+	if result != 0:
+		failquit('OpenSCAD failed with return code ' + str(result))
+	if not os.path.exists(exportfile):
+		failquit('OpenSCAD exported no file ' + exportfile)
+
+#
+# Parse arguments
+#
+parser = argparse.ArgumentParser()
+parser.add_argument('--openscad', required=True, help='Specify OpenSCAD executable')
+parser.add_argument('--format', required=True, help='Specify export format, e.g. echo or csg')
+args,remaining_args = parser.parse_known_args()
+
+inputfile = remaining_args[0]
+outputfile = remaining_args[-1]
+remaining_args = remaining_args[1:-1] # Passed on to the OpenSCAD executable
+
+if not os.path.exists(inputfile):
+	failquit('cant find input file named: ' + inputfile)
+if not os.path.exists(args.openscad):
+	failquit('cant find openscad executable named: ' + args.openscad)
+
+inputbasename = os.path.splitext(os.path.basename(inputfile))[0]
+tmpdir = tempfile.mkdtemp(prefix='ast_cache_test')
+cachedir = os.path.join(tmpdir, 'cache')
+os.mkdir(cachedir)
+
+#
+# Export without and with the cached libraries, then compare the exports
+#
+try:
+	firstfile = os.path.join(tmpdir, inputbasename + '-parsed.' + args.format.lower())
+	secondfile = os.path.join(tmpdir, inputbasename + '-cached.' + args.format.lower())
+	run_openscad(firstfile)
+	if not os.listdir(cachedir):
+		failquit('OpenSCAD stored nothing in the AST cache')
+	run_openscad(secondfile)
+	if read(firstfile) != read(secondfile):
+		failquit('the export with the AST cache differs from the export without it')
+	shutil.copyfile(firstfile, outputfile)
+except SystemExit:
+	raise
+except:
+	failquit('failure while writing ' + outputfile + ': ' + str(sys.exc_info()))
+finally:
+	shutil.rmtree(tmpdir, True)
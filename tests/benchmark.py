@@ -0,0 +1,233 @@
+#!/usr/bin/env python
+
+# Performance benchmark and regression harness
+#
+# Usage: benchmark.py --openscad=<executable-path> [--output=<results.json>]
+#                     [--baseline=<baseline.json>] [--save-baseline]
+#                     [--tolerance=<fraction>] [--repeat=<n>] [--only=<regex>]
+#
+# Runs a curated set of models from examples/ and testdata/scad/ plus the
+# synthetic stress cases in testdata/scad/benchmark/ through OpenSCAD.
+# Each run uses --profile to obtain the time spent per processing phase
+# (parse, instantiation, csg, geometry, cgal, export), and the peak memory
+# of the OpenSCAD process is recorded where the platform supports it.
+#
+# Results are written as JSON. If a baseline file is given, every phase
+# and the peak memory is compared against it, and the script returns
+# non-zero if any value got slower/larger than the tolerance allows.
+# With --save-baseline, the results are written to the baseline file instead.
+#
+# Timings below --min-time seconds are not compared to avoid reporting noise.
+#
+# This script should return 0 on success, not-0 on error or regression.
+
+from __future__ import print_function
+
+import sys, os, re, json, time, argparse, tempfile, shutil, subprocess, math
+
+srcdir = os.path.dirname(os.path.abspath(__file__))
+rootdir = os.path.dirname(srcdir)
+
+def failquit(*args):
+    if len(args)!=0: print(*args)
+    print('exiting benchmark.py with failure')
+    sys.exit(1)
+
+#
+# Benchmark cases: (name, input file, output suffix, extra OpenSCAD arguments)
+# Input files are relative to the repository root. Files starting with '@'
+# are generated into the working directory by the functions below.
+#
+cases = [
+    ('example-csg',            'examples/Basics/CSG.scad',                               'stl', []),
+    ('example-logo',           'examples/Basics/logo.scad',                              'stl', []),
+    ('example-geb',            'examples/Advanced/GEB.scad',                             'stl', []),
+    ('example-recursion',      'examples/Functions/recursion.scad',                      'stl', []),
+    ('example024',             'examples/Old/example024.scad',                           'stl', []),
+    ('minkowski3',             'testdata/scad/3D/features/minkowski3-tests.scad',        'stl', []),
+    ('hull3',                  'testdata/scad/3D/features/hull3-tests.scad',             'stl', []),
+    ('rotate-extrude',         'testdata/scad/3D/features/rotate_extrude-tests.scad',    'stl', []),
+    ('linear-extrude',         'testdata/scad/3D/features/linear_extrude-tests.scad',    'stl', []),
+    ('surface',                'testdata/scad/3D/features/surface-tests.scad',           'stl', []),
+    ('offset-2d',              'testdata/scad/2D/features/offset-tests.scad',            'dxf', []),
+    ('many-holes-difference',  'testdata/scad/benchmark/many-holes-difference.scad',     'stl', []),
+    ('deep-union',             'testdata/scad/benchmark/deep-union.scad',                'stl', []),
+    ('large-minkowski',        'testdata/scad/benchmark/large-minkowski.scad',           'stl', []),
+    ('list-comprehension',     'testdata/scad/benchmark/list-comprehension.scad',        'stl', []),
+    ('big-export-stl',         'testdata/scad/benchmark/big-export.scad',                'stl', []),
+    ('big-export-off',         'testdata/scad/benchmark/big-export.scad',                'off', []),
+    ('big-import-stl',         '@big-import-stl',                                        'stl', []),
+    ('dump-csg',               'testdata/scad/misc/allmodules.scad',                     'csg', []),
+]
+
+def generate_big_stl(workdir, rows=400, cols=400):
+    """ Writes an ASCII STL of a closed, wavy box with 4*rows*cols triangles
+        and a .scad file importing it. Returns the .scad file name. """
+    stlfile = os.path.join(workdir, 'big-import.stl')
+    def height(i, j):
+        return 10 + 2*math.sin(i*0.1)*math.cos(j*0.1)
+    with open(stlfile, 'w') as f:
+        f.write('solid big\n')
+        def tri(a, b, c):
+            f.write('facet normal 0 0 0\nouter loop\n')
+            for v in (a, b, c): f.write('vertex %f %f %f\n' % v)
+            f.write('endloop\nendfacet\n')
+        for i in range(rows):
+            for j in range(cols):
+                t = [(i, j, height(i, j)), (i+1, j, height(i+1, j)),
+                     (i+1, j+1, height(i+1, j+1)), (i, j+1, height(i, j+1))]
+                b = [(p[0], p[1], 0) for p in t]
+                tri(t[0], t[1], t[2]); tri(t[0], t[2], t[3])
+                tri(b[0], b[2], b[1]); tri(b[0], b[3], b[2])
+        # Side walls
+        for k in range(rows):
+            for (j, flip) in ((0, False), (cols, True)):
+                a, b = (k, j, 0), (k+1, j, 0)
+                c, d = (k+1, j, height(k+1, j)), (k, j, height(k, j))
+                if flip: tri(a, c, b); tri(a, d, c)
+                else: tri(a, b, c); tri(a, c, d)
+        for k in range(cols):
+            for (i, flip) in ((0, True), (rows, False)):
+                a, b = (i, k, 0), (i, k+1, 0)
+                c, d = (i, k+1, height(i, k+1)), (i, k, height(i, k))
+                if flip: tri(a, c, b); tri(a, d, c)
+                else: tri(a, b, c); tri(a, c, d)
+        f.write('endsolid big\n')
+    scadfile = os.path.join(workdir, 'big-import.scad')
+    with open(scadfile, 'w') as f:
+        f.write('import("' + stlfile.replace('\\', '/') + '");\n')
+    return scadfile
+
+generators = {
+    '@big-import-stl': generate_big_stl,
+}
+
+def run_openscad(openscad, inputfile, outputfile, profilefile, extra_args):
+    """ Runs OpenSCAD once. Returns (returncode, wall time, peak memory in kB or None) """
+    args = [openscad, inputfile, '-o', outputfile, '--profile=' + profilefile] + extra_args
+    start = time.time()
+    with open(os.devnull, 'w') as devnull:
+        proc = subprocess.Popen(args, stdout=devnull, stderr=devnull)
+        peak = None
+        if hasattr(os, 'wait4'):
+            pid, status, rusage = os.wait4(proc.pid, 0)
+            proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+            # ru_maxrss is reported in bytes on Mac OS X and in kilobytes elsewhere
+            peak = rusage.ru_maxrss / 1024 if sys.platform == 'darwin' else rusage.ru_maxrss
+        else:
+            proc.wait()
+    return proc.returncode, time.time() - start, peak
+
+def run_case(args, workdir, name, inputfile, suffix, extra_args):
+    if inputfile.startswith('@'):
+        inputfile = generators[inputfile](workdir)
+    else:
+        inputfile = os.path.join(rootdir, inputfile)
+    if not os.path.exists(inputfile):
+        return {'status': 'missing input: ' + inputfile}
+
+    outputfile = os.path.join(workdir, name + '.' + suffix)
+    profilefile = os.path.join(workdir, name + '-profile.json')
+    best = None
+    for i in range(args.repeat):
+        rc, wall, peak = run_openscad(args.openscad, inputfile, outputfile, profilefile, extra_args)
+        if rc != 0:
+            return {'status': 'failed with return code %d' % rc}
+        try:
+            with open(profilefile) as f:
+                profile = json.load(f)
+        except (IOError, ValueError) as e:
+            return {'status': 'invalid profile output: ' + str(e)}
+        result = {'status': 'ok', 'total': wall, 'peak_memory_kb': peak,
+                  'phases': dict((p['name'], p['wall']) for p in profile['phases'])}
+        # Keep the fastest run, which is the least affected by system noise
+        if best is None or result['total'] < best['total']: best = result
+    return best
+
+def compare(results, baseline, tolerance, min_time):
+    """ Prints a comparison table, returns the list of regressions """
+    regressions = []
+    print('\n%-24s %-14s %12s %12s %8s' % ('case', 'phase', 'baseline', 'current', 'ratio'))
+    for name in sorted(results):
+        current = results[name]
+        base = baseline.get(name)
+        if not base or current.get('status') != 'ok' or base.get('status') != 'ok': continue
+        items = [(phase, base['phases'].get(phase), t) for phase, t in sorted(current['phases'].items())]
+        items.append(('total', base.get('total'), current.get('total')))
+        for phase, old, new in items:
+            if old is None or new is None: continue
+            ratio = new / old if old > 0 else float('inf')
+            mark = ''
+            if max(old, new) >= min_time and ratio > 1 + tolerance:
+                mark = ' <-- REGRESSION'
+                regressions.append((name, phase, old, new))
+            print('%-24s %-14s %11.3fs %11.3fs %7.2fx%s' % (name, phase, old, new, ratio, mark))
+        oldmem, newmem = base.get('peak_memory_kb'), current.get('peak_memory_kb')
+        if oldmem and newmem:
+            ratio = float(newmem) / oldmem
+            mark = ''
+            if ratio > 1 + tolerance:
+                mark = ' <-- REGRESSION'
+                regressions.append((name, 'peak memory', oldmem, newmem))
+            print('%-24s %-14s %10dkB %10dkB %7.2fx%s' % (name, 'peak memory', oldmem, newmem, ratio, mark))
+    return regressions
+
+#
+# Parse arguments
+#
+parser = argparse.ArgumentParser()
+parser.add_argument('--openscad', required=True, help='Specify OpenSCAD executable')
+parser.add_argument('--output', default='benchmark-results.json', help='Write results to this file')
+parser.add_argument('--baseline', help='Compare against (or with --save-baseline, write) this baseline file')
+parser.add_argument('--save-baseline', dest='savebaseline', action='store_true', help='Store results as new baseline')
+parser.add_argument('--tolerance', type=float, default=0.2, help='Allowed relative slowdown before reporting a regression')
+parser.add_argument('--min-time', dest='mintime', type=float, default=0.1, help='Ignore timings shorter than this (seconds)')
+parser.add_argument('--repeat', type=int, default=1, help='Run each case this many times and keep the fastest')
+parser.add_argument('--only', help='Only run cases matching this regular expression')
+parser.add_argument('--workdir', help='Directory for generated and output files (default: temporary directory)')
+args = parser.parse_args()
+
+if not os.path.exists(args.openscad):
+    failquit('cant find openscad executable named: ' + args.openscad)
+
+workdir = args.workdir or tempfile.mkdtemp(prefix='openscad-benchmark-')
+if not os.path.exists(workdir): os.makedirs(workdir)
+
+results = {}
+try:
+    for name, inputfile, suffix, extra_args in cases:
+        if args.only and not re.search(args.only, name): continue
+        sys.stdout.write('%-24s ' % name)
+        sys.stdout.flush()
+        result = run_case(args, workdir, name, inputfile, suffix, extra_args)
+        results[name] = result
+        if result['status'] == 'ok':
+            print('%8.3fs  %s' % (result['total'], ' '.join('%s=%.3fs' % item for item in sorted(result['phases'].items()))))
+        else:
+            print(result['status'])
+finally:
+    if not args.workdir: shutil.rmtree(workdir, ignore_errors=True)
+
+with open(args.output, 'w') as f:
+    json.dump({'openscad': os.path.abspath(args.openscad), 'date': time.strftime('%Y-%m-%d %H:%M:%S'),
+               'cases': results}, f, indent=2, sort_keys=True)
+
+failed = [name for name in results if results[name]['status'] != 'ok']
+if failed: print('\nFailed cases: ' + ', '.join(sorted(failed)))
+
+if args.baseline:
+    if args.savebaseline:
+        shutil.copyfile(args.output, args.baseline)
+        print('\nBaseline written to ' + args.baseline)
+    elif not os.path.exists(args.baseline):
+        print('\nNo baseline found at ' + args.baseline + ', run with --save-baseline to create one')
+    else:
+        with open(args.baseline) as f:
+            baseline = json.load(f)['cases']
+        regressions = compare(results, baseline, args.tolerance, args.mintime)
+        if regressions:
+            print('\n%d performance regression(s) found' % len(regressions))
+            sys.exit(1)
+        print('\nNo performance regressions found')
+
+sys.exit(1 if failed else 0)
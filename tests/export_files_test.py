@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+
+# Multiple file export test
+#
+#
+# Usage: <script> <inputfile> --openscad=<executable-path> --format=<format> [--console=<text>] [<openscad args>] file.txt
+#
+#
+# step 1. Run OpenSCAD on the input file, exporting to the given format in an
+#         empty directory, e.g. with --animate, --turntable or several --camera
+#         parameter sets, which export more than one file.
+# step 2. List the names of all exported files in file.txt, sorted by name.
+#         The width and height of png images, the number of vertices and faces
+#         of off files, the names of the files in zip archives, and the
+#         contents of other files are listed with them.
+#         With --console, the console output lines of OpenSCAD starting with
+#         the given text are listed after the files.
+# step 3. (done in CTest) - compare file.txt to the expected output.
+#
+# All the optional openscad args are passed on to OpenSCAD.
+#
+# This script should return 0 on success, not-0 on error.
+
+import sys, os, shutil, struct, subprocess, tempfile, argparse, zipfile
+
+def failquit(*args):
+	if len(args)!=0: print(args)
+	print('export_files_test args:',str(sys.argv))
+	print('exiting export_files_test.py with failure')
+	sys.exit(1)
+
+def describe(filename):
+	f = open(filename, 'rb')
+	data = f.read()
+	f.close()
+	if filename.endswith('.png'):
+		if len(data) < 24 or data[12:16] != b'IHDR':
+			return ': not a png file\n'
+		width, height = struct.unpack('>II', data[16:24])
+		return ': %dx%d\n' % (width, height)
+	if filename.endswith('.off'):
+		header = data.decode('utf-8').split(None, 3)
+		if len(header) < 3 or header[0] != 'OFF':
+			return ': not an off file\n'
+		return ': %s vertices, %s faces\n' % (header[1], header[2])
+	if data.startswith(b'PK\x03\x04'):
+		archive = zipfile.ZipFile(filename)
+		names = archive.namelist()
+		archive.close()
+		return ': zip archive of ' + ', '.join(names) + '\n'
+	return ':\n' + data.decode('utf-8')
+
+#
+# Parse arguments
+#
+parser = argparse.ArgumentParser()
+parser.add_argument('--openscad', required=True, help='Specify OpenSCAD executable')
+parser.add_argument('--format', required=True, help='Specify export format, e.g. png or csg')
+parser.add_argument('--console', help='List console output lines starting with this text')
+args,remaining_args = parser.parse_known_args()
+
+inputfile = remaining_args[0]
+listfile = remaining_args[-1]
+remaining_args = remaining_args[1:-1] # Passed on to the OpenSCAD executable
+
+if not os.path.exists(inputfile):
+	failquit('cant find input file named: ' + inputfile)
+if not os.path.exists(args.openscad):
+	failquit('cant find openscad executable named: ' + args.openscad)
+
+inputbasename = os.path.splitext(os.path.basename(inputfile))[0]
+exportdir = tempfile.mkdtemp(prefix='export_files_test')
+exportfile = os.path.join(exportdir, inputbasename + '.' + args.format.lower())
+
+#
+# Export, then list the exported files
+#
+export_cmd = [args.openscad, inputfile, '-o', exportfile] + remaining_args
+sys.stderr.write('Running OpenSCAD:\n' + ' '.join(export_cmd) + '\n')
+proc = subprocess.Popen(export_cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+console = proc.communicate()[0].decode('utf-8', 'replace')
+sys.stderr.write(console)
+result = proc.returncode
+if result != 0:
+	shutil.rmtree(exportdir, True)
+	failquit('OpenSCAD failed with return code ' + str(result))
+
+try:
+	f = open(listfile, 'w')
+	for name in sorted(os.listdir(exportdir)):
+		f.write(name + describe(os.path.join(exportdir, name)))
+	if args.console:
+		for line in console.splitlines():
+			if line.startswith(args.console): f.write(line + '\n')
+	f.close()
+except:
+	failquit('failure while writing ' + listfile + ': ' + str(sys.exc_info()))
+finally:
+	shutil.rmtree(exportdir, True)
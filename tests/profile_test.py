@@ -0,0 +1,176 @@
+#!/usr/bin/env python
+
+# Profiler output test
+#
+#
+# Usage: <script> <inputfile> --openscad=<executable-path> [<openscad args>] file.txt
+#
+#
+# step 1. Run OpenSCAD on the input file, exporting to STL with
+#         --profile=<name>.json, and again with --profile=<name>.folded
+# step 2. Check the structure of the JSON profile: the value types of all
+#         phases, entries and summary items, non-negative times, self times
+#         not exceeding total times, and stacks starting with the stage of
+#         their entry. Check that every line of the
+#         collapsed stacks is "stack count" with a stack found in the JSON
+#         entries.
+# step 3. List the phases, entries and summary items in file.txt without the
+#         times, which differ between runs.
+# step 4. (done in CTest) - compare file.txt to the expected output.
+#
+# All the optional openscad args are passed on to OpenSCAD.
+#
+# This script should return 0 on success, not-0 on error.
+
+import sys, os, re, shutil, subprocess, tempfile, argparse, json
+
+def failquit(*args):
+	if len(args)!=0: print(args)
+	print('profile_test args:',str(sys.argv))
+	print('exiting profile_test.py with failure')
+	sys.exit(1)
+
+def is_int(value):
+	return isinstance(value, int) and not isinstance(value, bool)
+
+def is_number(value):
+	return isinstance(value, (int, float)) and not isinstance(value, bool)
+
+def check_item(kind, item, keys):
+	for key, check in keys:
+		if key not in item:
+			failquit(kind + ' without "' + key + '": ' + str(item))
+		if not check(item[key]):
+			failquit(kind + ' with a bad "' + key + '": ' + str(item))
+	for total, selftime in (('wall', 'self_wall'), ('cpu', 'self_cpu')):
+		if total in item and selftime in item and item[selftime] > item[total] + 1e-6:
+			failquit(kind + ' with "' + selftime + '" above "' + total + '": ' + str(item))
+
+def time_value(value):
+	return is_number(value) and value >= 0
+
+def count_value(value):
+	return is_int(value) and value >= 0
+
+def text_value(value):
+	return isinstance(value, str) or type(value).__name__ == 'unicode'
+
+def stage_value(value):
+	return value in ('instantiation', 'geometry')
+
+def cache_value(value):
+	return value in (None, 'hit', 'miss')
+
+PHASE_KEYS = [('name', text_value), ('wall', time_value), ('cpu', time_value)]
+ENTRY_KEYS = [('stage', stage_value), ('name', text_value),
+              ('line', count_value), ('column', count_value), ('stack', text_value),
+              ('wall', time_value), ('self_wall', time_value),
+              ('cpu', time_value), ('self_cpu', time_value), ('cache', cache_value),
+              ('vertices_in', count_value), ('vertices_out', count_value), ('memsize', count_value)]
+SUMMARY_KEYS = [('stage', stage_value), ('name', text_value),
+                ('line', count_value), ('column', count_value),
+                ('count', count_value), ('cache_hits', count_value),
+                ('self_wall', time_value), ('self_cpu', time_value)]
+
+def run_openscad(profilefile):
+	cmd = [args.openscad, inputfile, '-o', os.path.join(profiledir, inputbasename + '.stl'),
+	       '--profile=' + profilefile] + remaining_args
+	sys.stderr.write('Running OpenSCAD:\n' + ' '.join(cmd) + '\n')
+	result = subprocess.call(cmd)
+	if result != 0:
+		failquit('OpenSCAD failed with return code ' + str(result))
+	if not os.path.exists(profilefile):
+		failquit('OpenSCAD wrote no profile ' + profilefile)
+
+def check_json(jsonfile):
+	f = open(jsonfile, 'r')
+	try:
+		profile = json.load(f)
+	except ValueError:
+		failquit('invalid JSON in ' + jsonfile + ': ' + str(sys.exc_info()[1]))
+	f.close()
+	for section in ('phases', 'entries', 'summary'):
+		if not isinstance(profile.get(section), list):
+			failquit('no "' + section + '" list in ' + jsonfile)
+	for phase in profile['phases']: check_item('phase', phase, PHASE_KEYS)
+	for entry in profile['entries']: check_item('entry', entry, ENTRY_KEYS)
+	for item in profile['summary']: check_item('summary item', item, SUMMARY_KEYS)
+	for entry in profile['entries']:
+		if not entry['stack'].startswith(entry['stage'] + ';'):
+			failquit('entry with a stack not starting at its stage: ' + str(entry))
+		if (entry['stage'] == 'geometry') != (entry['cache'] is not None):
+			failquit('entry with a cache state not matching its stage: ' + str(entry))
+	for item in profile['summary']:
+		if item['cache_hits'] > item['count']:
+			failquit('summary item with more cache hits than entries: ' + str(item))
+	if len(profile['entries']) != sum([item['count'] for item in profile['summary']]):
+		failquit('the summary counts do not add up to the number of entries')
+	return profile
+
+def check_collapsed(foldedfile, stacks):
+	f = open(foldedfile, 'r')
+	for line in f:
+		match = re.match(r'^(\S+) (\d+)$', line.rstrip('\n'))
+		if not match:
+			failquit('bad line in collapsed stacks: ' + line)
+		if match.group(1) not in stacks:
+			failquit('collapsed stack not in the JSON entries: ' + line)
+		if int(match.group(2)) == 0:
+			failquit('collapsed stack with a zero count: ' + line)
+	f.close()
+
+def location(item):
+	return '%s %s:%d:%d' % (item['stage'], item['name'], item['line'], item['column'])
+
+def cache_name(value):
+	return value if value else 'none'
+
+#
+# Parse arguments
+#
+parser = argparse.ArgumentParser()
+parser.add_argument('--openscad', required=True, help='Specify OpenSCAD executable')
+args,remaining_args = parser.parse_known_args()
+
+inputfile = remaining_args[0]
+listfile = remaining_args[-1]
+remaining_args = remaining_args[1:-1] # Passed on to the OpenSCAD executable
+
+if not os.path.exists(inputfile):
+	failquit('cant find input file named: ' + inputfile)
+if not os.path.exists(args.openscad):
+	failquit('cant find openscad executable named: ' + args.openscad)
+
+inputbasename = os.path.splitext(os.path.basename(inputfile))[0]
+profiledir = tempfile.mkdtemp(prefix='profile_test')
+
+#
+# Profile in both formats, check them, then list the JSON profile
+#
+try:
+	jsonfile = os.path.join(profiledir, inputbasename + '.json')
+	foldedfile = os.path.join(profiledir, inputbasename + '.folded')
+	run_openscad(jsonfile)
+	profile = check_json(jsonfile)
+	run_openscad(foldedfile)
+	check_collapsed(foldedfile, set([entry['stack'] for entry in profile['entries']]))
+
+	f = open(listfile, 'w')
+	f.write('phases:\n')
+	for phase in profile['phases']:
+		f.write('  ' + phase['name'] + '\n')
+	f.write('entries:\n')
+	for entry in profile['entries']:
+		f.write('  %s cache=%s vertices=%d/%d %s\n' %
+		        (location(entry), cache_name(entry['cache']),
+		         entry['vertices_in'], entry['vertices_out'], entry['stack']))
+	f.write('summary:\n')
+	for item in profile['summary']:
+		f.write('  %s count=%d cache_hits=%d\n' % (location(item), item['count'], item['cache_hits']))
+	f.close()
+except SystemExit:
+	raise
+except:
+	failquit('failure while writing ' + listfile + ': ' + str(sys.exc_info()))
+finally:
+	shutil.rmtree(profiledir, True)